@@ -6,9 +6,9 @@ int main(int argc, char *argv[])
 {
         gcal_t gcal;
         gcal_contact_t contact;
-        struct gcal_contact_array all_contacts;
+        gcal_contact_iter_t iter;
         int result;
-        size_t i;
+        size_t i = 0;
 
         /* Create a gcal 'object' and authenticate with server */
         if (!(gcal = gcal_new(GCONTACT)))
@@ -24,16 +24,17 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-        /* Get all contacts and print its name/prefered email/updated time */
-        result = gcal_get_contacts(gcal, &all_contacts);
-
-        for (i = 0; i < all_contacts.length; ++i) {
-                contact = gcal_contact_element(&all_contacts, i);
-                if (!contact)
-                        break;
+        /* Read contacts one at a time (while they are downloaded) and
+         * print its name/prefered email/updated time
+         */
+        if (!(iter = gcal_contact_iter_open(gcal))) {
+                printf("Failed getting contacts, exiting...\n");
+                return -1;
+        }
 
+        while ((contact = gcal_contact_iter_next(iter))) {
                 printf("contact: %d\ttitle:%s\temail:%s\tupdated:%s\n",
-                       i,
+                       i++,
                        gcal_contact_get_title(contact),
                        gcal_contact_get_email(contact),
                        gcal_contact_get_updated(contact));
@@ -41,7 +42,8 @@ int main(int argc, char *argv[])
         }
 
         /* Cleanup */
-        gcal_cleanup_contacts(&all_contacts);
+        if (gcal_contact_iter_close(iter))
+                printf("Failed reading all contacts!\n");
         gcal_delete(gcal);
         gcal_final_cleanup();
 
@@ -80,7 +80,8 @@ void clean_doc_tree(xmlDoc **document);
 
 
 /** This function returns the number of event entries that a Atom feed
- * has.
+ * has (i.e. 'openSearch:totalResults', partial responses without it have
+ * the entries counted).
  *
  * @param document Pointer to a pointer of libxml document.
  *
@@ -110,6 +111,16 @@ xmlXPathObject *atom_get_entries(xmlDoc *document);
  */
 char *get_etag_attribute(xmlNode * a_node);
 
+/* This function extracts the entry id (i.e. the 'atom:id' child element)
+ * without running xpath expressions.
+ *
+ * @param a_node A xmlNode that has an atom xml entry.
+ *
+ * @return The string with the id or NULL in error case. You must cleanup
+ * this memory.
+ */
+char *get_id_element(xmlNode *a_node);
+
 
 /** Extract calendar information from a Atom entry (what, where, location, etc).
  *
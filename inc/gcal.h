@@ -53,6 +53,64 @@ typedef enum { GCALENDAR, GCONTACT } gservice;
  */
 typedef enum { HIDE, SHOW } display_deleted_entries;
 
+/** Fields extracted from entries of a feed (see \ref gcal_set_field_mask).
+ *
+ * Fields outside of the mask are not searched in the entry and are left
+ * NULL (or 0) in events and contacts.
+ */
+typedef enum {
+	/** Entry id */
+	GCAL_F_ID = 1 << 0,
+	/** Entry ETag */
+	GCAL_F_ETAG = 1 << 1,
+	/** Event title, contact name (full and structured) */
+	GCAL_F_TITLE = 1 << 2,
+	/** Edit URL */
+	GCAL_F_EDIT_URI = 1 << 3,
+	/** Updated and published timestamps */
+	GCAL_F_UPDATED = 1 << 4,
+	/** Event description, contact notes */
+	GCAL_F_CONTENT = 1 << 5,
+	/** Event status, it also flags deleted entries */
+	GCAL_F_STATUS = 1 << 6,
+	/** Event start, end and recurrence */
+	GCAL_F_WHEN = 1 << 7,
+	/** Event location */
+	GCAL_F_WHERE = 1 << 8,
+	/** Event attendees */
+	GCAL_F_ATTENDEES = 1 << 9,
+	/** Event alarms (reminders) */
+	GCAL_F_ALARMS = 1 << 10,
+	/** Event guests permissions (e.g. 'guestsCanModify') */
+	GCAL_F_GUESTS = 1 << 11,
+	/** Event sequence number */
+	GCAL_F_SEQUENCE = 1 << 12,
+	/** Event visibility */
+	GCAL_F_VISIBILITY = 1 << 13,
+	/** Contact emails */
+	GCAL_F_EMAILS = 1 << 14,
+	/** Contact nickname */
+	GCAL_F_NICKNAME = 1 << 15,
+	/** Contact homepage and blog */
+	GCAL_F_WEBSITES = 1 << 16,
+	/** Contact organization, title and occupation */
+	GCAL_F_ORGANIZATION = 1 << 17,
+	/** Contact phone numbers */
+	GCAL_F_PHONES = 1 << 18,
+	/** Contact IM addresses */
+	GCAL_F_IM = 1 << 19,
+	/** Contact postal addresses (formatted and structured) */
+	GCAL_F_ADDRESS = 1 << 20,
+	/** Contact groups */
+	GCAL_F_GROUPS = 1 << 21,
+	/** Contact birthday */
+	GCAL_F_BIRTHDAY = 1 << 22,
+	/** Contact photo URL and ETag */
+	GCAL_F_PHOTO = 1 << 23,
+	/** All fields (default) */
+	GCAL_F_ALL = (1 << 24) - 1
+} gcal_field;
+
 /** Upload (being POST or PUT) definition option.
  *
  * Its used to set behavior in \ref up_entry function.
@@ -80,6 +138,10 @@ static const size_t TIMESTAMP_SIZE = 23;
  */
 struct gcal_resource;
 
+/** curl header list (see 'curl/curl.h').
+ */
+struct curl_slist;
+
 /** Library structure, represents each calendar event entry.
  */
 struct gcal_event;
@@ -280,6 +342,17 @@ void gcal_init_event(struct gcal_event *entry);
  */
 void gcal_destroy_entry(struct gcal_event *entry);
 
+/** Makes a deep copy of an entry.
+ *
+ * @param dest A pointer to a \ref gcal_event, it must be initialized (see
+ * \ref gcal_init_event) and its current data is released.
+ *
+ * @param src The entry to be copied.
+ *
+ * @return 0 on success, -1 otherwise (and 'dest' is left untouched).
+ */
+int gcal_copy_entry(struct gcal_event *dest, const struct gcal_event *src);
+
 
 /** Generic HTTP GET function.
  *
@@ -302,6 +375,90 @@ void gcal_destroy_entry(struct gcal_event *entry);
 int get_follow_redirection(struct gcal_resource *gcalobj, const char *url,
 			   void *cb_download, const char *gdata_version);
 
+/** Internal use function, sets up the curl handle of a gcal object for a
+ * GET (it's the first half of \ref get_follow_redirection). It makes
+ * possible to drive the transfer outside (e.g. with a curl multi handle).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param url URL string.
+ *
+ * @param cb_download Callback used for writing downloaded data (NULL
+ * for default text buffer writer).
+ *
+ * @param gdata_version Version of Data API.
+ *
+ * @return 0 for success, -1 for error.
+ */
+int prepare_follow_redirection(struct gcal_resource *gcalobj, const char *url,
+			       void *cb_download, const char *gdata_version);
+
+/** Internal use function, the default text buffer writer of downloads (a
+ * libcurl write callback whose user data is the gcal object).
+ *
+ * @param ptr Downloaded data.
+ *
+ * @param count Number of members.
+ *
+ * @param chunk_size Size of each member.
+ *
+ * @param data Pointer to a \ref gcal_resource structure.
+ *
+ * @return Number of bytes handled.
+ */
+size_t gcal_write_buffer(void *ptr, size_t count, size_t chunk_size,
+			 void *data);
+
+/** Internal use function, returns the authorization header string of a
+ * gcal object. It is built once and reused by all requests, until the
+ * authentication token changes.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return The header (owned by the gcal object, don't free it) or NULL
+ * if there is no authentication.
+ */
+char *gcal_auth_header(struct gcal_resource *gcalobj);
+
+/** Internal use function, checks the result of a transfer started with
+ * \ref prepare_follow_redirection.
+ *
+ * For google calendar, the first answer is a redirection to a gsessionid
+ * URL: the function sets the curl handle to the new URL and the transfer
+ * must be performed again.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param code The curl return code of the transfer.
+ *
+ * @param redirected 1 if the transfer already followed the redirection,
+ * 0 otherwise.
+ *
+ * @return 0 for success, 1 when the transfer must be performed again
+ * and -1 for error.
+ */
+int check_follow_redirection(struct gcal_resource *gcalobj, int code,
+			     int redirected);
+
+/** Internal use function, mounts the query URL for the current service
+ * (calendar or contacts) of a gcal object.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param parameters First extra query parameter (e.g. "start-index=1")
+ * or NULL. Following parameters are passed as extra arguments and the list
+ * must be terminated by NULL.
+ *
+ * @return A new allocated string with the URL (remember to free it) or
+ * NULL on error.
+ */
+char *mount_query_url(struct gcal_resource *gcalobj,
+		      const char *parameters, ...);
+
 
 /** Cleanup the memory of a vector of calendar entries created using
  * \ref gcal_get_entries.
@@ -380,6 +537,35 @@ int up_entry(char *data2post, unsigned int m_length,
 	     HTTP_CMD up_mode, char *content_type,
 	     int expected_code);
 
+/** Uploads (using PUT) the contents of a file.
+ *
+ * Same as \ref up_entry, but data is read from the file while it is sent,
+ * so it doesn't have to be loaded in memory.
+ *
+ * @param fd File descriptor of a regular file, data is read from its
+ * beginning (the file offset is not changed).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param url_server The URL of server.
+ *
+ * @param etag Google Data API 2.0 requires an Etag in HTTP header for some
+ * operations.
+ *
+ * @param content_type The content type, to use default (application/atom+xml)
+ * pass NULL.
+ *
+ * @param expected_code The expected return code from server (200, 201, etc.)
+ * See GCAL_DEFAULT_ANSWER and friends.
+ *
+ * @return -1 on error, 0 on success.
+ */
+int up_file(int fd, struct gcal_resource *gcalobj,
+	    const char *url_server, char *etag,
+	    char *content_type, int expected_code);
+
 
 /** Creates an new calendar event.
  *
@@ -521,6 +707,300 @@ int gcal_set_timezone(struct gcal_resource *gcalobj, char *atimezone);
  */
 void gcal_set_store_xml(struct gcal_resource *gcalobj, char flag);
 
+/** Sets contact photo lazy mode.
+ *
+ * By default, contact photos are downloaded together with the contacts
+ * (one extra request by photo). In lazy mode, contacts have only the photo
+ * URL and ETag and the photos can be downloaded later using
+ * \ref gcal_contact_fetch_photo.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 to download photos with contacts, 1 to activate lazy mode.
+ */
+void gcal_set_lazy_photo(struct gcal_resource *gcalobj, char flag);
+
+/** Sets the cache of downloaded pages.
+ *
+ * Downloaded feeds (e.g. \ref gcal_dump, \ref gcal_query) are kept with
+ * their ETag. While younger than 'ttl', a page is used without asking the
+ * server, after that it is revalidated (i.e. it is downloaded again only
+ * if it has changed). Adding, editing or deleting entries makes all
+ * cached pages revalidate.
+ *
+ * Pages belong to the authenticated account: \ref gcal_get_authentication
+ * drops pages in memory and pages in disk are only used by the same
+ * account (several accounts can share the directory).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 to disable the cache (default), 1 to enable it.
+ *
+ * @param ttl Time (in seconds) while a page is used without revalidation,
+ * 0 makes it revalidate always.
+ *
+ * @param path Directory to save pages (so they can be used by next
+ * sessions), NULL for memory only. The directory must exist.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_set_response_cache(struct gcal_resource *gcalobj, char flag,
+			    int ttl, const char *path);
+
+/** Sets the cache of parsed entries.
+ *
+ * Entries (events or contacts) are kept after parsing, so when a feed is
+ * downloaded again, only entries with a new ETag are extracted (the others
+ * are copied from the cache). Use it when the same feed is synced many
+ * times (e.g. \ref gcal_get_updated_events). The cache uses the current
+ * service (see \ref gcal_set_service).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 to disable the cache (default), 1 to enable it.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_set_parse_cache(struct gcal_resource *gcalobj, char flag);
+
+/** Sets a directory to cache contact photos.
+ *
+ * Downloaded photos are saved in this directory (one file by contact) with
+ * their ETag. Next time, a photo is loaded from the cache if its ETag
+ * hasn't changed, instead of being downloaded again. The directory must
+ * exist.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param path Directory path, NULL disables the cache (default).
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_set_photo_cache(struct gcal_resource *gcalobj, const char *path);
+
+/** Sets the max number of simultaneous transfers.
+ *
+ * It is used when a feed is downloaded split in several ranges (e.g.
+ * \ref gcal_get_events_range). Default is 4.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param transfers Number of transfers (values smaller than 1 are
+ * handled as 1).
+ */
+void gcal_set_max_transfers(struct gcal_resource *gcalobj, int transfers);
+
+/** Sets how failed requests are retried.
+ *
+ * Requests that failed due to network errors or temporary server errors
+ * (i.e. 'Too Many Requests' and 5xx answers) are sent again after a delay.
+ * The delay doubles after each retry, it is randomized (between half and
+ * full value) and is never shorter than the server 'Retry-After'. Default
+ * is no retries.
+ *
+ * Requests adding entries (e.g. \ref gcal_create_event) are only retried
+ * when server surely didn't process them (i.e. connection failed or server
+ * answered 429/503 with 'Retry-After'), otherwise the entry could be added
+ * twice.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param retries Max number of retries by request, 0 disables it.
+ *
+ * @param delay Delay (in miliseconds) before first retry.
+ *
+ * @param max_delay Max delay (in miliseconds) between retries.
+ */
+void gcal_set_retry(struct gcal_resource *gcalobj, int retries, int delay,
+		    int max_delay);
+
+/** Limits the rate of requests sent to server.
+ *
+ * Use it to keep bulk jobs (e.g. adding hundreds of contacts) below the
+ * account quota. Requests are spaced to a average rate, but up to 'burst'
+ * requests can be sent at once after a idle period. Default is no limit.
+ *
+ * The quota is by account, so objects authenticated as the same user
+ * share one bucket, even in distinct threads (each one refills it at its
+ * own rate, so use the same values for all of them).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param rate Requests by second, 0 disables the limit.
+ *
+ * @param burst Max number of requests sent at once (values smaller than 1
+ * are handled as 1).
+ */
+void gcal_set_rate_limit(struct gcal_resource *gcalobj, double rate,
+			 int burst);
+
+/** Sets how long a request can take.
+ *
+ * The timeout covers the whole request (including retries and google
+ * calendar redirection). A request is also aborted if it transfers less
+ * than 'low_speed' bytes by second during 'low_speed_time' seconds (it can
+ * be retried, see \ref gcal_set_retry). Interrupted requests fail and
+ * \ref gcal_status_interrupted tells why. Default is no limits.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param timeout Max duration (in miliseconds), 0 for no limit.
+ *
+ * @param low_speed Min speed (in bytes by second), 0 for no limit.
+ *
+ * @param low_speed_time Time (in seconds) below min speed to abort.
+ */
+void gcal_set_timeout(struct gcal_resource *gcalobj, long timeout,
+		      long low_speed, long low_speed_time);
+
+/** Sets hedged reads.
+ *
+ * If the server hasn't started to answer a download (e.g. \ref gcal_dump,
+ * \ref gcal_query, a contact photo) after a delay, the same request is
+ * sent again in a new connection. The first one to finish successfully is
+ * used and the other is aborted (an error answer doesn't abort the other). The delay is a percentile of the latencies (time to
+ * first byte) of last downloads. Only downloads are hedged, as they can be
+ * repeated without side effects. Default is disabled.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param percentile Percentile used as delay (e.g. 95), 0 disables it.
+ *
+ * @param delay Min delay (in miliseconds), it is also used while there
+ * are not enough latencies.
+ */
+void gcal_set_hedging(struct gcal_resource *gcalobj, int percentile,
+		      int delay);
+
+/** Shares downloads between gcal objects.
+ *
+ * If several objects (e.g. one by thread) download the same page at the
+ * same time (same URL and account), only one request is sent and the
+ * others wait and get a copy of its answer. It only affects objects
+ * with this flag enabled. Default is disabled.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 to disable (default), 1 to enable.
+ */
+void gcal_set_single_flight(struct gcal_resource *gcalobj, char flag);
+
+/** Sets compression of transfers.
+ *
+ * Downloads are asked compressed (gzip or deflate) and decoded as they
+ * arrive, Atom feeds are a lot smaller this way. Request bodies (e.g. new
+ * or edited entries) can be sent compressed too, if libgcal was built
+ * with zlib and the server accepts it. Default is compressed downloads
+ * and plain uploads.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param download 0 to disable, 1 to enable (default).
+ *
+ * @param upload Min length (in bytes) of compressed request bodies, 0
+ * disables it (default).
+ */
+void gcal_set_compression(struct gcal_resource *gcalobj, char download,
+			  int upload);
+
+/** Sets the format of downloaded feeds.
+ *
+ * Google Data can send feeds in JSON ('alt=json') instead of Atom: they are
+ * parsed without building a DOM tree, which is a lot faster and uses less
+ * memory. Events and contacts are the same in both formats, except for the
+ * raw entry (see \ref gcal_set_store_xml) that is kept in JSON.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 for Atom (default), 1 for JSON.
+ */
+void gcal_set_json(struct gcal_resource *gcalobj, char flag);
+
+/** Sets the fields of entries downloaded by queries (partial response).
+ *
+ * Only the chosen fields are sent by the server (e.g.
+ * "entry(@gd:etag,id,updated,gd:when)"), for read-only uses this is a
+ * fraction of the full feed. Fields left out are empty strings in events
+ * and contacts. Remember to select '@gd:etag' and 'link' if the entries
+ * are going to be edited or deleted later, the ETag is also used by the
+ * cache of parsed entries (see \ref gcal_set_parse_cache).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param fields Selector in Google Data 'fields' syntax, NULL to download
+ * full entries (default).
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_set_fields(struct gcal_resource *gcalobj, const char *fields);
+
+/** Sets the fields extracted from downloaded entries.
+ *
+ * Parsing is faster and uses less memory when only some fields are needed
+ * (e.g. GCAL_F_ID | GCAL_F_ETAG | GCAL_F_WHEN), other fields are not
+ * searched in the feed and are NULL. Unlike \ref gcal_set_fields, it doesn't
+ * change what is downloaded.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param mask Fields (see \ref gcal_field), default is GCAL_F_ALL.
+ */
+void gcal_set_field_mask(struct gcal_resource *gcalobj, unsigned int mask);
+
+/** Sets lazy decoding of entry fields.
+ *
+ * When enabled, parsing a feed only extracts the id, ETag and updated
+ * fields of each entry. The other fields are decoded from the downloaded
+ * feed the first time a getter reads them (e.g.
+ * \ref gcal_event_get_where), so programs reading a few fields of a few
+ * entries don't pay for decoding the whole feed. The feed is kept in
+ * memory until all its entries are decoded or destroyed, and the parse
+ * cache (\ref gcal_set_parse_cache) is not used.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param flag 0 to decode all fields at once (default), 1 to enable lazy
+ * decoding.
+ */
+void gcal_set_lazy_fields(struct gcal_resource *gcalobj, char flag);
+
+/** Sets how many parsed entries a feed iterator can keep (see
+ * \ref gcal_event_iter_open and \ref gcal_contact_iter_open).
+ *
+ * When the program reads entries slower than they are downloaded, the
+ * transfer is paused once the queue is full and resumed when the program
+ * empties it. So memory use doesn't depend on the feed size: it is at
+ * most the queue plus the entries of a single received chunk.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param length Number of entries (default is 64), 0 is the same as 1.
+ */
+void gcal_set_stream_queue(struct gcal_resource *gcalobj, size_t length);
+
+/** Cancels the running request.
+ *
+ * It is safe to call it from another thread (or a signal handler), the
+ * request fails as soon as possible and the partially downloaded data is
+ * dropped.
+ *
+ * The cancel is sticky: it is only cleared by the request it aborts, so a
+ * cancel racing with the start of a request isn't lost. If there is no
+ * running request, the *next* one is canceled, whatever it is; use
+ * \ref gcal_cancel_reset before starting a new operation to drop a cancel
+ * that came too late.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ */
+void gcal_cancel(gcal_t gcalobj);
+
+/** Drops a pending cancel (see \ref gcal_cancel) that didn't abort any
+ * request.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ */
+void gcal_cancel_reset(gcal_t gcalobj);
+
 /** Sets network proxy.
  *
  * Use it if you are behind a network proxy and can't directly access
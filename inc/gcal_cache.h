@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_cache.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Cache of downloaded pages (feeds, photos).
+ *
+ * Internal module used by \ref get_follow_redirection. Pages are kept in
+ * memory (and optionally in a directory) together with their ETag, a page
+ * is used without asking the server while it is fresh (i.e. younger than
+ * the cache TTL) and after that it is revalidated with 'If-None-Match'.
+ *
+ * It also has a cache of parsed entries (events or contacts), used to
+ * skip the extraction of entries that didn't change since last parse.
+ */
+
+#ifndef __GCAL_CACHE__
+#define __GCAL_CACHE__
+
+#include <stdlib.h>
+#include "gcal.h"
+
+/** Max number of pages kept in memory */
+#define GCAL_CACHE_ENTRIES 32
+
+/** The cache, see \ref gcal_cache_new */
+struct gcal_cache;
+
+/** A cached page */
+struct gcal_cache_entry;
+
+/** Creates a new cache.
+ *
+ * @param ttl Time (in seconds) while a page is used without revalidation,
+ * 0 revalidates always.
+ *
+ * @param path Directory to save pages, NULL for memory only.
+ *
+ * @return The cache or NULL in error case.
+ */
+struct gcal_cache *gcal_cache_new(int ttl, const char *path);
+
+/** Releases the cache memory (pages saved in disk are kept).
+ *
+ * @param cache The cache.
+ */
+void gcal_cache_delete(struct gcal_cache *cache);
+
+/** Sets the account whose pages are cached, dropping the pages in memory.
+ *
+ * Account is part of the page key (in disk too), since feed URLs like
+ * 'default/private/full' are the same for every user.
+ *
+ * @param cache The cache.
+ *
+ * @param account Account name (e.g. 'user@gmail.com'), can be NULL.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_cache_account(struct gcal_cache *cache, const char *account);
+
+/** Finds a page.
+ *
+ * @param cache The cache.
+ *
+ * @param url Page URL.
+ *
+ * @param gdata_version The GData version header used to get the page.
+ *
+ * @return The page or NULL if it is not cached.
+ */
+struct gcal_cache_entry *gcal_cache_find(struct gcal_cache *cache,
+					 const char *url,
+					 const char *gdata_version);
+
+/** Checks if a page can be used without asking the server.
+ *
+ * @param cache The cache.
+ *
+ * @param entry A page, see \ref gcal_cache_find.
+ *
+ * @return 1 if fresh, 0 otherwise.
+ */
+int gcal_cache_fresh(struct gcal_cache *cache, struct gcal_cache_entry *entry);
+
+/** Page ETag.
+ *
+ * @param entry A page, see \ref gcal_cache_find.
+ *
+ * @return The ETag (dont free it!) or NULL if server didn't send it.
+ */
+const char *gcal_cache_etag(struct gcal_cache_entry *entry);
+
+/** Copies a page to gcal object buffer, like it was just downloaded.
+ *
+ * @param entry A page, see \ref gcal_cache_find.
+ *
+ * @param gcalobj A gcal object.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_cache_restore(struct gcal_cache_entry *entry,
+		       struct gcal_resource *gcalobj);
+
+/** Makes a page fresh again, use it when server answers 'Not Modified'.
+ *
+ * @param cache The cache.
+ *
+ * @param entry A page, see \ref gcal_cache_find.
+ */
+void gcal_cache_touch(struct gcal_cache *cache, struct gcal_cache_entry *entry);
+
+/** Adds a page (or replaces it, if already cached).
+ *
+ * @param cache The cache.
+ *
+ * @param url Page URL.
+ *
+ * @param gdata_version The GData version header used to get the page.
+ *
+ * @param etag Page ETag (can be NULL).
+ *
+ * @param data Page data.
+ *
+ * @param length Data length.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_cache_store(struct gcal_cache *cache, const char *url,
+		     const char *gdata_version, const char *etag,
+		     const char *data, size_t length);
+
+/** Makes all cached pages stale (i.e. they will be revalidated).
+ *
+ * Use it after changing data in server (add/edit/delete).
+ *
+ * @param cache The cache.
+ */
+void gcal_cache_expire(struct gcal_cache *cache);
+
+/** Mounts a file path for a cache key (file name is a hash of the key).
+ *
+ * @param dir Cache directory.
+ *
+ * @param key Cache key.
+ *
+ * @return The path (you should free it) or NULL in error case.
+ */
+char *gcal_cache_path(const char *dir, const char *key);
+
+/** Writes a file in a temporary name and renames it, so readers never
+ * see a partially written file.
+ *
+ * @param path File path.
+ *
+ * @param header File header (must be a string).
+ *
+ * @param data File data.
+ *
+ * @param length Data length.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_cache_save(const char *path, const char *header,
+		    const char *data, size_t length);
+
+/** Cache of parsed entries, see \ref gcal_entries_cache_new */
+struct gcal_entries_cache;
+
+/** Copies an entry (e.g. \ref gcal_copy_entry) */
+typedef int (*gcal_copy_cb)(void *dest, const void *src);
+
+/** Initializes (e.g. \ref gcal_init_event) or releases an entry */
+typedef void (*gcal_entry_cb)(void *entry);
+
+/** Creates a new cache of parsed entries.
+ *
+ * Entries are \ref gcal_event or \ref gcal_contact (both start with
+ * a \ref gcal_entry, which has the id and ETag).
+ *
+ * @param size Size of an entry.
+ *
+ * @param init Function to initialize an entry.
+ *
+ * @param copy Function to copy an entry.
+ *
+ * @param destroy Function to release an entry.
+ *
+ * @return The cache or NULL in error case.
+ */
+struct gcal_entries_cache *gcal_entries_cache_new(size_t size,
+						  gcal_entry_cb init,
+						  gcal_copy_cb copy,
+						  gcal_entry_cb destroy);
+
+/** Releases the cache and all its entries.
+ *
+ * @param cache The cache.
+ */
+void gcal_entries_cache_delete(struct gcal_entries_cache *cache);
+
+/** Gets a copy of a cached entry, if it has the same ETag.
+ *
+ * @param cache The cache.
+ *
+ * @param id Entry id.
+ *
+ * @param etag Entry ETag.
+ *
+ * @param entry An initialized entry, it receives the copy. Only entries
+ * with the same 'store_xml' flag are used.
+ *
+ * @return 0 on success, -1 if the entry is not cached (or changed).
+ */
+int gcal_entries_cache_get(struct gcal_entries_cache *cache, const char *id,
+			   const char *etag, void *entry);
+
+/** Adds a copy of an entry (or replaces it, if already cached).
+ *
+ * @param cache The cache.
+ *
+ * @param entry The entry.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_entries_cache_put(struct gcal_entries_cache *cache,
+			   const void *entry);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_flight.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Single flight downloads.
+ *
+ * Internal module used by \ref get_follow_redirection. When several gcal
+ * objects (e.g. in distinct threads) ask for the same page at once, only
+ * the first one sends the request, the others wait for it and get a copy
+ * of its answer. Requests are the same if they have the same URL, GData
+ * version, write callback and authorization (i.e. the same account and
+ * service).
+ */
+
+#ifndef __GCAL_FLIGHT__
+#define __GCAL_FLIGHT__
+
+#include "gcal.h"
+
+/** Callback that downloads the page.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param url The page URL.
+ *
+ * @param cb_download Curl write callback (can be NULL).
+ *
+ * @param gdata_version GData version header.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+typedef int (*gcal_fetch_cb)(struct gcal_resource *gcalobj, const char *url,
+			     void *cb_download, const char *gdata_version);
+
+/** Downloads a page, sharing the request with other objects downloading the
+ * same page at the same time.
+ *
+ * The answer (buffer, HTTP code, ETag, error message) is copied to each
+ * object. If the request that was shared got interrupted (e.g. canceled),
+ * the others send their own request.
+ *
+ * While waiting, an object still follows its own deadline and
+ * \ref gcal_cancel: a canceled object stops waiting and returns -1 (status
+ * GCAL_INTERRUPT_CANCEL), an object out of time stops waiting and sends its
+ * own request (which then runs with what is left of the deadline, if one
+ * was already running).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param url The page URL.
+ *
+ * @param cb_download Curl write callback (can be NULL), only requests with
+ * the same callback are shared.
+ *
+ * @param gdata_version GData version header.
+ *
+ * @param fetch Callback that downloads the page.
+ *
+ * @return Value returned by 'fetch' (for the object that sent the request
+ * or a copy of it).
+ */
+int gcal_flight_get(struct gcal_resource *gcalobj, const char *url,
+		    void *cb_download, const char *gdata_version,
+		    gcal_fetch_cb fetch);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_gzip.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Compression of request bodies.
+ *
+ * Internal module used by uploads (\ref up_entry): large bodies can be
+ * sent compressed with gzip ('Content-Encoding: gzip'). Downloads don't
+ * need it, curl negotiates the encoding and decodes the answer before
+ * passing it to the write callbacks. It depends on zlib, if libgcal was
+ * built without it, bodies are always sent as they are.
+ */
+
+#ifndef __GCAL_GZIP__
+#define __GCAL_GZIP__
+
+#include <stddef.h>
+
+/** Header sent with compressed bodies */
+static const char HEADER_GZIP[] = "Content-Encoding: gzip";
+
+/** Checks if compression is supported.
+ *
+ * @return 1 if libgcal was built with zlib, 0 otherwise.
+ */
+int gcal_gzip_available(void);
+
+/** Compresses data using gzip format.
+ *
+ * @param data Data to be compressed.
+ *
+ * @param length Data length.
+ *
+ * @param packed Returns the compressed data (free it after use).
+ *
+ * @param packed_length Returns the compressed data length.
+ *
+ * @return 0 on success, -1 on error (or if compression is not supported).
+ */
+int gcal_gzip(const char *data, size_t length, char **packed,
+	      size_t *packed_length);
+
+#endif
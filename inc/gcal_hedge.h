@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_hedge.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Hedged reads.
+ *
+ * Internal module used by \ref gcal_perform_read. If the server hasn't
+ * answered a GET after a delay (a percentile of the latencies of last
+ * requests), a copy of the request is sent in another connection and the
+ * first one to finish with a usable answer (i.e. not an error) is used. It cuts the tail latency caused by stuck
+ * connections at the cost of a few extra requests.
+ */
+
+#ifndef __GCAL_HEDGE__
+#define __GCAL_HEDGE__
+
+#include "gcal.h"
+
+/** Sends the request prepared in the curl handle, hedging it if
+ * enabled.
+ *
+ * If the copy wins, its curl handle and buffer replace the ones of the gcal
+ * object (the handles have the same options, see
+ * \ref gcal_slot_new).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return The curl code of the request used.
+ */
+CURLcode gcal_hedge_send(struct gcal_resource *gcalobj);
+
+/** Returns the delay before the request copy is sent.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return Delay in miliseconds.
+ */
+long gcal_hedge_delay(struct gcal_resource *gcalobj);
+
+/** Keeps the latency of a request, used to compute the delay.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param latency Time to first byte (in miliseconds).
+ */
+void gcal_hedge_sample(struct gcal_resource *gcalobj, long latency);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_lazy.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Lazy decoding of entry fields (see \ref gcal_set_lazy_fields).
+ *
+ * Entries of a feed parsed in lazy mode get only a few key fields (id, etag
+ * and updated) and keep a reference to the parsed feed (the DOM tree or the
+ * JSON text). Each other field is decoded from the entry the first time it
+ * is read, the feed is released when all its entries were decoded or
+ * destroyed.
+ *
+ * Entries sharing a feed can be used (and destroyed) by distinct threads,
+ * but a single entry can't: a getter may write the decoded field in it.
+ */
+
+#ifndef __GCAL_LAZY__
+#define __GCAL_LAZY__
+
+#include <pthread.h>
+#include "internal_gcal.h"
+#include "gcal.h"
+
+/** Fields decoded when a feed is parsed in lazy mode */
+#define GCAL_LAZY_KEYS (GCAL_F_ID | GCAL_F_ETAG | GCAL_F_UPDATED)
+
+/** A parsed feed shared by its lazy entries */
+struct gcal_lazy_feed {
+	/** Number of entries (plus the parser) using the feed */
+	int refs;
+	/** Protects the counter, entries can be in distinct threads */
+	pthread_mutex_t lock;
+	/** DOM tree of an Atom feed (NULL for JSON feeds) */
+	dom_document *document;
+	/** Text of a JSON feed (NULL for Atom feeds) */
+	char *data;
+};
+
+/** Creates a feed, the caller has the first reference.
+ *
+ * @param document DOM tree of an Atom feed, the feed takes ownership of
+ * it. Use NULL for JSON feeds.
+ *
+ * @param data Text of a JSON feed, it is copied (not used if there is a
+ * DOM tree).
+ *
+ * @return The new feed or NULL on error.
+ */
+struct gcal_lazy_feed *gcal_lazy_feed_new(dom_document *document,
+					  const char *data);
+
+/** Drops a reference of the feed, freeing it when it was the last one.
+ *
+ * @param feed A feed (can be NULL).
+ */
+void gcal_lazy_feed_release(struct gcal_lazy_feed *feed);
+
+/** Makes an entry lazy: only \ref GCAL_LAZY_KEYS of its field mask will be
+ * extracted by the parser, the other fields are left pending.
+ *
+ * The parser sets where the entry is in the feed ('node' or 'text' of
+ * \ref gcal_entry) when it finds an entry with a feed.
+ *
+ * @param entry An initialized entry, with its field mask set.
+ *
+ * @param feed Feed that has the entry.
+ */
+void gcal_lazy_attach(struct gcal_entry *entry, struct gcal_lazy_feed *feed);
+
+/** Makes 'dest' share the feed and pending fields of 'src' (used when
+ * entries are copied).
+ *
+ * @param dest An entry without feed.
+ *
+ * @param src Copied entry.
+ */
+void gcal_lazy_share(struct gcal_entry *dest, const struct gcal_entry *src);
+
+/** Drops the entry reference to its feed, pending fields are left NULL.
+ *
+ * @param entry An entry.
+ */
+void gcal_lazy_detach(struct gcal_entry *entry);
+
+/** Decodes pending fields of an event, fields already decoded are kept.
+ *
+ * @param event An event (can be NULL).
+ *
+ * @param fields Fields to decode (see \ref gcal_field).
+ *
+ * @return 0 on success (or if there was nothing to decode), -1 otherwise.
+ */
+int gcal_lazy_event(struct gcal_event *event, unsigned int fields);
+
+/** Decodes pending fields of a contact, see \ref gcal_lazy_event.
+ *
+ * @param contact A contact (can be NULL).
+ *
+ * @param fields Fields to decode (see \ref gcal_field).
+ *
+ * @return 0 on success (or if there was nothing to decode), -1 otherwise.
+ */
+int gcal_lazy_contact(struct gcal_contact *contact, unsigned int fields);
+
+#endif
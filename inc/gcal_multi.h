@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_multi.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Simultaneous transfers (using curl multi interface).
+ *
+ * Internal module used to download several URLs at once (e.g. a feed
+ * split in ranges). Each transfer runs in a 'slot', a gcal object that
+ * is a copy of the original (same authentication, service and proxy) but
+ * has its own curl handle and buffer.
+ */
+
+#ifndef __GCAL_MULTI__
+#define __GCAL_MULTI__
+
+#include <stdlib.h>
+#include "gcal.h"
+
+/** Callback called when each transfer is finished.
+ *
+ * @param slot The gcal object used in the transfer, the downloaded data is
+ * in its buffer (it will be reused by the next transfer after return).
+ *
+ * @param job Index of the URL in the vector passed to \ref gcal_multi_get.
+ *
+ * @param result 0 for success, -1 otherwise (see slot http code).
+ *
+ * @param user User data pointer.
+ *
+ * @return 0 to continue, anything else will abort remaining transfers.
+ */
+typedef int (*gcal_multi_cb)(struct gcal_resource *slot, size_t job,
+			     int result, void *user);
+
+/** Creates a slot, i.e. a copy of a gcal object that can be used for
+ * a distinct transfer.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @return A new gcal object (free it with \ref gcal_destroy) or NULL.
+ */
+struct gcal_resource *gcal_slot_new(struct gcal_resource *gcalobj);
+
+/** Downloads a set of URLs, running up to 'max_transfers' (see
+ * \ref gcal_set_max_transfers) transfers at same time.
+ *
+ * Google calendar redirection is followed as in \ref get_follow_redirection.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param urls Vector of URLs.
+ *
+ * @param count Vector length.
+ *
+ * @param cb_download Callback used for writing downloaded data (NULL
+ * for default text buffer writer).
+ *
+ * @param gdata_version Version of Data API.
+ *
+ * @param done Callback called for each finished transfer.
+ *
+ * @param user User data passed to callback.
+ *
+ * @return 0 when all transfers were successful, -1 otherwise.
+ */
+int gcal_multi_get(struct gcal_resource *gcalobj, const char * const *urls,
+		   size_t count, void *cb_download, const char *gdata_version,
+		   gcal_multi_cb done, void *user);
+
+/** Joins a set of entry vectors (events or contacts) in a single one.
+ *
+ * The entries are moved, the parts vectors are freed (but not the entries
+ * data) on success.
+ *
+ * @param parts Vector of entry vectors (NULL elements are skipped).
+ *
+ * @param lengths Length of each entry vector.
+ *
+ * @param count Number of entry vectors.
+ *
+ * @param size Size of each entry (e.g. sizeof(struct gcal_event)).
+ *
+ * @param length Returns the length of the new vector.
+ *
+ * @return The new entry vector or NULL.
+ */
+void *gcal_multi_merge(void **parts, size_t *lengths, size_t count,
+		       size_t size, size_t *length);
+
+/** Removes entries with duplicated ID, keeping the first one (the entry
+ * order is kept).
+ *
+ * @param entries Vector of entries (events or contacts), each one must
+ * start with a \ref gcal_entry.
+ *
+ * @param length Vector length.
+ *
+ * @param size Size of each entry.
+ *
+ * @param destroy Function used to cleanup each removed entry.
+ *
+ * @return The new vector length.
+ */
+size_t gcal_multi_dedup(void *entries, size_t length, size_t size,
+			void (*destroy)(void *));
+
+#endif
@@ -44,6 +44,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "gcal.h"
 #include "gcontact.h"
 
+struct gcal_entries_cache;
+
 /** Parses the returned HTML page and extracts the redirection URL
  * that has the Atom feed.
  *
@@ -156,11 +158,48 @@ int get_calendar_entry(dom_document *doc, int index, struct gcal_resource *res);
 int extract_all_entries(dom_document *doc,
 			struct gcal_event *data_extract, int length);
 
+/** Same as \ref extract_all_entries, but entries that didn't change since
+ * last parse (i.e. same id and ETag) are copied from a cache instead of
+ * being extracted. New and changed entries are added to the cache.
+ *
+ * @param doc A document pointer to the Atom stream.
+ *
+ * @param data_extract A pointer to a pre-allocated vector \ref gcal_event.
+ *
+ * @param length Its length, should be the same as the number of entries.
+ *
+ * @param cache Cache of parsed entries (see \ref gcal_entries_cache_new),
+ * NULL disables it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int extract_all_entries_cached(dom_document *doc,
+			       struct gcal_event *data_extract, int length,
+			       struct gcal_entries_cache *cache);
+
+
+/** Writes the XML of a calendar entry into a buffer, growing it if
+ * required. No document tree is built: the entry is written as it goes,
+ * so the same buffer can be reused for each upload.
+ *
+ * @param entry A pointer to an calendar entry event (see \ref gcal_event).
+ *
+ * @param buffer Pointer to the buffer (it can point to NULL), the caller
+ * owns it and must free its memory.
+ *
+ * @param size Pointer to the buffer size, updated when it grows.
+ *
+ * @param length A pointer to a variable that will have the XML length
+ * (without the last 0).
+ *
+ * @return 0 on sucess, -1 on error.
+ */
+int xmlentry_write(struct gcal_event *entry, char **buffer, size_t *size,
+		   size_t *length);
 
 /** Creates the XML for a new calendar entry.
  *
- * It depends on \ref xmlentry_init_resources and
- * \ref xmlentry_destroy_resources.
+ * It depends on \ref xmlentry_write.
  *
  * @param entry A pointer to an calendar entry event (see \ref gcal_event).
  *
@@ -191,11 +230,44 @@ int xmlentry_create(struct gcal_event *entry, char **xml_entry, int *length);
 int extract_all_contacts(dom_document *doc,
 			 struct gcal_contact *data_extract, int length);
 
+/** Same as \ref extract_all_contacts, using a cache of parsed contacts
+ * (see \ref extract_all_entries_cached).
+ *
+ * @param doc A document pointer with the Atom stream.
+ *
+ * @param data_extract A pointer to a pre-allocated vector \ref gcal_contact.
+ *
+ * @param length Its length, should be the same as the number of entries.
+ *
+ * @param cache Cache of parsed contacts, NULL disables it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int extract_all_contacts_cached(dom_document *doc,
+				struct gcal_contact *data_extract, int length,
+				struct gcal_entries_cache *cache);
+
+
+/** Writes the XML of a contact into a buffer, see \ref xmlentry_write.
+ *
+ * @param contact A pointer to a contact (see \ref gcal_contact).
+ *
+ * @param buffer Pointer to the buffer (it can point to NULL), the caller
+ * owns it and must free its memory.
+ *
+ * @param size Pointer to the buffer size, updated when it grows.
+ *
+ * @param length A pointer to a variable that will have the XML length
+ * (without the last 0).
+ *
+ * @return 0 on sucess, -1 on error.
+ */
+int xmlcontact_write(struct gcal_contact *contact, char **buffer,
+		     size_t *size, size_t *length);
 
 /** Creates the XML for a new contact entry.
  *
- * It depends on \ref xmlentry_init_resources and
- * \ref xmlentry_destroy_resources.
+ * It depends on \ref xmlcontact_write.
  *
  * @param contact A pointer to a contact (see \ref gcal_contact).
  *
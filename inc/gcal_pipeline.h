@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_pipeline.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Pipelined download of feeds (see \ref gcal_get_events_pipeline
+ * and \ref gcal_get_contacts_pipeline).
+ *
+ * The feed goes through four stages, each one in its own thread:
+ *  - network: receives the feed (the gcal object curl handle);
+ *  - parser: extracts the entries (a \ref gcal_stream);
+ *  - delivery: hands entries to the user (the calling thread);
+ *  - persistence: optional, hands delivered entries to a second user
+ *  callback (e.g. one that writes them in a database).
+ *
+ * Stages are connected by bounded single producer/single consumer rings,
+ * so download, parsing and user work overlap and memory is capped by the
+ * rings length. A stage that gets ahead waits on a full ring.
+ */
+
+#ifndef __GCAL_PIPELINE__
+#define __GCAL_PIPELINE__
+
+#include <stddef.h>
+#include "gcal.h"
+#include "gcal_stream.h"
+
+struct gcal_ring;
+
+/** Creates a ring (a bounded queue of pointers) to connect two threads:
+ * one pushes, the other pops. Pushing and popping don't take locks, a
+ * thread only sleeps (on a condition variable) while the ring is full or
+ * empty.
+ *
+ * @param length Number of items, it is rounded up to a power of 2.
+ *
+ * @return The ring or NULL on error.
+ */
+struct gcal_ring *gcal_ring_new(size_t length);
+
+/** Frees a ring, items left in it are not freed.
+ *
+ * @param ring A ring (can be NULL).
+ */
+void gcal_ring_delete(struct gcal_ring *ring);
+
+/** Adds an item to the ring, waiting while it is full (producer only).
+ *
+ * @param ring A ring.
+ *
+ * @param item The item (can't be NULL).
+ *
+ * @return 0 on success, -1 if the consumer canceled the ring (see
+ * \ref gcal_ring_cancel).
+ */
+int gcal_ring_push(struct gcal_ring *ring, void *item);
+
+/** Removes the oldest item of the ring (consumer only).
+ *
+ * @param ring A ring.
+ *
+ * @param wait 1 to wait while the ring is empty, 0 to return at once.
+ *
+ * @return The item or NULL if the ring is empty and closed (or empty, if
+ * not waiting).
+ */
+void *gcal_ring_pop(struct gcal_ring *ring, int wait);
+
+/** Tells the consumer that nothing else will be pushed (producer only).
+ *
+ * @param ring A ring.
+ */
+void gcal_ring_close(struct gcal_ring *ring);
+
+/** Makes the next pushes fail, the producer should stop and close the
+ * ring. Items already in the ring can still be popped.
+ *
+ * It can be called from any thread.
+ *
+ * @param ring A ring.
+ */
+void gcal_ring_cancel(struct gcal_ring *ring);
+
+/** Downloads and parses the feed of gcal object in pipeline.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param contacts 1 for a contacts feed, 0 for calendar events.
+ *
+ * @param gdata_version Google Data API version header.
+ *
+ * @param deliver Called (in the calling thread) for each entry, see
+ * \ref gcal_stream_cb.
+ *
+ * @param deliver_user User data pointer passed to 'deliver'.
+ *
+ * @param persist Called (in the persistence thread) for each entry that
+ * 'deliver' didn't take, can be NULL.
+ *
+ * @param persist_user User data pointer passed to 'persist'.
+ *
+ * @return 0 on success (or if a callback stopped it), -1 otherwise.
+ */
+int gcal_pipeline_run(struct gcal_resource *gcalobj, char contacts,
+		      const char *gdata_version,
+		      gcal_stream_cb deliver, void *deliver_user,
+		      gcal_stream_cb persist, void *persist_user);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_retry.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Retry of failed requests, rate limit and deadlines.
+ *
+ * Internal module used by every request sent by the easy interface
+ * (e.g. \ref http_post, \ref get_follow_redirection). A request that
+ * failed due to a network error or a temporary server error (i.e. 429
+ * and 5xx) is sent again after a delay that doubles each time (randomized
+ * and never shorter than server's 'Retry-After'). Requests are spaced
+ * by a token bucket, so bulk jobs don't exceed the account quota (objects
+ * of the same account share the bucket). POST
+ * requests are only sent again if server didn't process them.
+ *
+ * Retries never go beyond the request deadline and a request can be
+ * canceled from another thread (see \ref gcal_cancel).
+ */
+
+#ifndef __GCAL_RETRY__
+#define __GCAL_RETRY__
+
+#include <stdlib.h>
+#include "gcal.h"
+
+/** Callback called before a failed request is sent again.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param data User data pointer.
+ *
+ * @return 0 if request can be repeated, -1 otherwise (e.g. part of the
+ * answer was already consumed).
+ */
+typedef int (*gcal_rewind_cb)(struct gcal_resource *gcalobj, void *data);
+
+/** Sends the request prepared in the curl handle, retrying it on
+ * temporary failures.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param rewind Callback to prepare a retry, NULL will only clean the
+ * buffer (see \ref clean_buffer).
+ *
+ * @param data User data pointer passed to 'rewind'.
+ *
+ * @return The curl code of last try. If it was interrupted (see
+ * \ref gcal_status_interrupted), the buffer is cleaned.
+ */
+CURLcode gcal_perform(struct gcal_resource *gcalobj, gcal_rewind_cb rewind,
+		      void *data);
+
+/** Sends a request that is not idempotent (i.e. a POST adding an entry),
+ * like \ref gcal_perform but it is only retried when server surely didn't
+ * process it: connection failed, nothing was sent or server asked for a
+ * later retry (429 or 503 with 'Retry-After').
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return The curl code of last try.
+ */
+CURLcode gcal_perform_post(struct gcal_resource *gcalobj);
+
+/** Sends the GET request prepared in the curl handle, retrying it on
+ * temporary failures. As it can be repeated without side effects, it can
+ * be hedged (see \ref gcal_set_hedging).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return The curl code of last try.
+ */
+CURLcode gcal_perform_read(struct gcal_resource *gcalobj);
+
+/** Sets the account whose token bucket is used by the rate limit.
+ *
+ * Quota is by account, so every object authenticated as the same user
+ * (e.g. a calendar and a contacts object, in any thread) takes tokens
+ * from the same bucket. Objects without account use their own bucket.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param account Account name (e.g. 'user@gmail.com'), NULL stops using
+ * the bucket of the previous account.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_rate_account(struct gcal_resource *gcalobj, const char *account);
+
+/** Waits until a new request can be sent (see \ref gcal_set_rate_limit).
+ *
+ * The wait ends early if the request is canceled or when it would go
+ * beyond the deadline; the token is given back then.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return CURLE_OK if the request can be sent, CURLE_ABORTED_BY_CALLBACK
+ * if it was canceled or CURLE_OPERATION_TIMEDOUT if its deadline came
+ * first.
+ */
+CURLcode gcal_rate_limit(struct gcal_resource *gcalobj);
+
+/** Starts the deadline of a request (see \ref gcal_set_timeout).
+ *
+ * Requests sent while the deadline is running share it, e.g. google
+ * calendar redirection is part of the same request.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @return 1 if the deadline was started, 0 if there is no timeout or a
+ * deadline is already running.
+ */
+int gcal_deadline_start(struct gcal_resource *gcalobj);
+
+/** Finishes the deadline of a request.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param started Value returned by \ref gcal_deadline_start.
+ */
+void gcal_deadline_end(struct gcal_resource *gcalobj, int started);
+
+/** Sets the curl timeout to what is left of the deadline.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param curl The curl handle (it can belong to other gcal object, e.g. a
+ * slot of \ref gcal_multi_get).
+ */
+void gcal_deadline_apply(struct gcal_resource *gcalobj, CURL *curl);
+
+/** Curl progress callback, it aborts the transfer after a cancel.
+ *
+ * @param data Pointer to a \ref gcal_resource structure.
+ *
+ * @return 0 to continue, 1 to abort.
+ */
+int gcal_progress_cb(void *data, curl_off_t dltotal, curl_off_t dlnow,
+		     curl_off_t ultotal, curl_off_t ulnow);
+
+/** Parses the value of 'Retry-After' header.
+ *
+ * @param value Header value, either seconds or a HTTP date.
+ *
+ * @param length Value length.
+ *
+ * @return Seconds to wait or -1 in error case.
+ */
+long gcal_retry_after(const char *value, size_t length);
+
+#endif
@@ -41,6 +41,16 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "gcal.h"
 
+/** Why last request was interrupted, see \ref gcal_status_interrupted */
+enum gcal_interruption {
+	/** Request wasn't interrupted */
+	GCAL_INTERRUPT_NONE = 0,
+	/** Request took longer than the timeout (see \ref gcal_set_timeout) */
+	GCAL_INTERRUPT_TIMEOUT = 1,
+	/** Request was canceled (see \ref gcal_cancel) */
+	GCAL_INTERRUPT_CANCEL = 2
+};
+
 /** Returns HTTP status of a gcal object.
  *
  * Use it to check for status of object after last HTTP request.
@@ -74,4 +84,14 @@ int gcal_status_setlog(struct gcal_resource *ptr_gcal, char *filepath);
  * @return NULL if everything is ok, pointer to string with error message.
  */
 const char *gcal_status_msg(struct gcal_resource *ptr_gcal);
+
+/** Returns if last request was interrupted.
+ *
+ * Use it to tell a timeout or a cancel apart from other failures.
+ *
+ * @param ptr_gcal Pointer to a library resource structure \ref gcal_resource.
+ *
+ * @return One of \ref gcal_interruption values (or -1 for a NULL object).
+ */
+int gcal_status_interrupted(struct gcal_resource *ptr_gcal);
 #endif
@@ -0,0 +1,253 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_stream.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Streaming parser of feeds (see \ref gcal_get_events_cb and
+ * \ref gcal_get_contacts_cb).
+ *
+ * The feed is parsed while it is downloaded: each entry is extracted as
+ * soon as it is complete and handed to a callback, then its data is
+ * dropped. Memory use doesn't depend on the number of entries.
+ *
+ * Atom feeds go through a libxml2 push parser that builds only the tree
+ * of the current entry, JSON feeds are scanned for complete entry objects
+ * (see \ref json_next_entry).
+ *
+ * The iterator (see \ref gcal_iter_open) drives the download with the curl
+ * multi interface, so the feed is read only when the caller asks for the
+ * next entry. Its queue of parsed entries is bounded: the transfer is
+ * paused when it is full (see \ref gcal_set_stream_queue).
+ */
+
+#ifndef __GCAL_STREAM__
+#define __GCAL_STREAM__
+
+#include <stddef.h>
+#include "gcal.h"
+
+/** Called for each entry of the feed.
+ *
+ * @param entry Pointer to the entry (a \ref gcal_event or a
+ * \ref gcal_contact). Setting it to NULL takes ownership of the entry,
+ * otherwise its memory is reused for the next one.
+ *
+ * @param user User data pointer.
+ *
+ * @return 0 to go on, anything else stops the parsing.
+ */
+typedef int (*gcal_stream_cb)(void **entry, void *user);
+
+struct gcal_stream;
+
+/** Creates a stream parser, entries get the field mask and the raw data
+ * option of the gcal object (see \ref gcal_set_field_mask and
+ * \ref gcal_set_store_xml).
+ *
+ * Besides feeds, the parser reads several Atom documents one after
+ * another, e.g. entries saved with their raw XML.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure. With NULL
+ * entries have all fields and no raw XML (the stream can't download).
+ *
+ * @param contacts 1 for a contacts feed, 0 for calendar events.
+ *
+ * @param callback Function called for each entry.
+ *
+ * @param user User data pointer passed to 'callback'.
+ *
+ * @return The new parser or NULL on error.
+ */
+struct gcal_stream *gcal_stream_new(struct gcal_resource *gcalobj,
+				    char contacts, gcal_stream_cb callback,
+				    void *user);
+
+/** Frees a stream parser (and the last entry if it wasn't taken).
+ *
+ * @param stream A stream parser (can be NULL).
+ */
+void gcal_stream_delete(struct gcal_stream *stream);
+
+/** Parses the next part of a feed, calling the callback for the entries
+ * that are complete.
+ *
+ * @param stream A stream parser.
+ *
+ * @param data Part of the feed.
+ *
+ * @param length Length of data.
+ *
+ * @return 0 on success, 1 if the callback stopped the parsing, -1 on
+ * error (parsing is stopped too).
+ */
+int gcal_stream_parse(struct gcal_stream *stream, const char *data,
+		      size_t length);
+
+/** Ends the feed, checking that it was complete.
+ *
+ * @param stream A stream parser.
+ *
+ * @return 0 on success (or if parsing was stopped by the callback), -1
+ * otherwise.
+ */
+int gcal_stream_finish(struct gcal_stream *stream);
+
+/** Number of entries handed to the callback so far.
+ *
+ * @param stream A stream parser.
+ *
+ * @return The number of entries.
+ */
+size_t gcal_stream_count(const struct gcal_stream *stream);
+
+/** Gives back the memory of an entry taken from the callback, it will be
+ * reused by the next entry.
+ *
+ * @param stream A stream parser.
+ *
+ * @param entry The entry, its fields are freed.
+ */
+void gcal_stream_recycle(struct gcal_stream *stream, void *entry);
+
+/** Holds the download: the next data received pauses the transfer
+ * (the write callback answers CURL_WRITEFUNC_PAUSE). Data already being
+ * parsed is not affected.
+ *
+ * @param stream A stream parser.
+ */
+void gcal_stream_hold(struct gcal_stream *stream);
+
+/** Ends the hold of the download.
+ *
+ * @param stream A stream parser.
+ *
+ * @return 1 if the transfer was paused (the caller must resume it with
+ * curl_easy_pause), 0 otherwise.
+ */
+int gcal_stream_release(struct gcal_stream *stream);
+
+/** Downloads the feed of gcal object (like \ref gcal_dump), parsing it
+ * with a stream parser while it is downloaded.
+ *
+ * Error and redirection pages are stored in the gcal object buffer as
+ * usual. A failed request is retried only if no entry was found yet.
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param gdata_version Google Data API version header.
+ *
+ * @param stream A stream parser.
+ *
+ * @return 0 on success (or if parsing was stopped by the callback), -1
+ * otherwise.
+ */
+int gcal_stream_dump(struct gcal_resource *gcalobj, const char *gdata_version,
+		     struct gcal_stream *stream);
+
+/** Parses a whole feed (or saved entries, one after another) held in
+ * memory, returning its entries in an array.
+ *
+ * @param contacts 1 for contacts, 0 for calendar events.
+ *
+ * @param buffer The feed.
+ *
+ * @param length Its length.
+ *
+ * @param entries Pointer where the array of entries (\ref gcal_event or
+ * \ref gcal_contact) is returned, NULL if there are none.
+ *
+ * @param count Pointer where the number of entries is returned.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_stream_array(char contacts, const char *buffer, size_t length,
+		      void **entries, size_t *count);
+
+/** Same as \ref gcal_stream_array, reading a file (it is memory mapped).
+ *
+ * @param contacts 1 for contacts, 0 for calendar events.
+ *
+ * @param path File path.
+ *
+ * @param entries Pointer where the array of entries is returned.
+ *
+ * @param count Pointer where the number of entries is returned.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_stream_array_file(char contacts, const char *path, void **entries,
+			   size_t *count);
+
+struct gcal_iter;
+
+/** Starts reading the feed of gcal object entry by entry (see
+ * \ref gcal_event_iter_open and \ref gcal_contact_iter_open).
+ *
+ * The gcal object can't be used for other requests until the iterator
+ * is closed (it owns the curl handle).
+ *
+ * @param gcalobj Pointer to a \ref gcal_resource structure.
+ *
+ * @param contacts 1 for a contacts feed, 0 for calendar events.
+ *
+ * @param gdata_version Google Data API version header.
+ *
+ * @return The iterator or NULL on error.
+ */
+struct gcal_iter *gcal_iter_open(struct gcal_resource *gcalobj, char contacts,
+				 const char *gdata_version);
+
+/** Returns the next entry of the feed, downloading it if needed.
+ *
+ * @param iter An iterator.
+ *
+ * @return The entry (valid until the next call, unless detached) or NULL
+ * at the end of the feed or on error.
+ */
+void *gcal_iter_next(struct gcal_iter *iter);
+
+/** Gives the last entry returned to the caller.
+ *
+ * @param iter An iterator.
+ *
+ * @return The entry or NULL if there isn't one.
+ */
+void *gcal_iter_detach(struct gcal_iter *iter);
+
+/** Ends reading a feed, freeing the iterator.
+ *
+ * @param iter An iterator (can be NULL).
+ *
+ * @return 0 if there was no error (closing before the end of the feed is
+ * not an error), -1 otherwise.
+ */
+int gcal_iter_close(struct gcal_iter *iter);
+
+#endif
@@ -92,6 +92,35 @@ gcal_event_t gcal_event_new(char *raw_xml);
  */
 void gcal_event_delete(gcal_event_t event);
 
+/** Builds all events of a feed held in memory, parsing it at once.
+ *
+ * The feed can also be several entries saved one after another (e.g.
+ * their raw XML, see \ref gcal_set_store_xml), which is a lot faster than
+ * creating each one with \ref gcal_event_new.
+ *
+ * @param buffer The feed (Atom or JSON).
+ *
+ * @param length Its length.
+ *
+ * @param events Pointer to an events array structure, free it with
+ * \ref gcal_cleanup_events.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_events_from_feed(const char *buffer, size_t length,
+			  struct gcal_event_array *events);
+
+/** Same as \ref gcal_events_from_feed, reading a file (it is mapped in
+ * memory, not copied).
+ *
+ * @param path File path.
+ *
+ * @param events Pointer to an events array structure.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_events_from_file(const char *path, struct gcal_event_array *events);
+
 
 /** Helper function, does all calendar events dump and parsing, returning
  * the data as an array of \ref gcal_event. See too \ref gcal_event_array.
@@ -106,6 +135,169 @@ void gcal_event_delete(gcal_event_t event);
  */
 int gcal_get_events(gcal_t gcalobj, struct gcal_event_array *events_array);
 
+/** Called by \ref gcal_get_events_cb for each event of the feed.
+ *
+ * @param event Pointer to the event. It is valid only during the call,
+ * unless the callback takes it by setting it to NULL (then it must be
+ * freed with \ref gcal_event_delete).
+ *
+ * @param user_data User data pointer.
+ *
+ * @return 0 to go on, anything else stops the download.
+ */
+typedef int (*gcal_event_cb)(gcal_event_t *event, void *user_data);
+
+/** Helper function, does the calendar events dump and parsing like
+ * \ref gcal_get_events, but each event is passed to a callback as soon as
+ * it is parsed (there is no array). Memory use doesn't depend on the
+ * number of events.
+ *
+ * Events are fully decoded (lazy mode is not used, see
+ * \ref gcal_set_lazy_fields).
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param callback Function called for each event, see \ref gcal_event_cb.
+ *
+ * @param user_data User data pointer passed to callback.
+ *
+ * @return 0 on success (including when callback stopped it), -1
+ * otherwise. Events handed to callback before an error are not undone.
+ */
+int gcal_get_events_cb(gcal_t gcalobj, gcal_event_cb callback,
+		       void *user_data);
+
+/** Helper function, does the calendar events dump and parsing like
+ * \ref gcal_get_events_cb, but in a pipeline: the download, the parsing
+ * and each callback run in distinct threads, so they overlap instead of
+ * running one after the other. Stages are connected by bounded queues
+ * (see \ref gcal_set_stream_queue).
+ *
+ * Use it when handling an event takes about as long as downloading and
+ * parsing it (e.g. storing it in a database). The libgcal object can't be
+ * used by other threads until it returns.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param deliver Function called for each event (in the calling thread),
+ * see \ref gcal_event_cb.
+ *
+ * @param persist Function called (in its own thread) for each event that
+ * 'deliver' didn't take, in the same order. It can be NULL. It can take
+ * the event too.
+ *
+ * @param user_data User data pointer passed to both callbacks.
+ *
+ * @return 0 on success (including when a callback stopped it), -1
+ * otherwise.
+ */
+int gcal_get_events_pipeline(gcal_t gcalobj, gcal_event_cb deliver,
+			     gcal_event_cb persist, void *user_data);
+
+/** Calendar events iterator, see \ref gcal_event_iter_open. */
+typedef struct gcal_iter *gcal_event_iter_t;
+
+/** Starts reading calendar events one at a time: the feed is downloaded
+ * and parsed while events are read (there is no array).
+ *
+ * The libgcal object can't be used for other requests until the iterator
+ * is closed.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @return An iterator on success or NULL otherwise.
+ */
+gcal_event_iter_t gcal_event_iter_open(gcal_t gcalobj);
+
+/** Returns the next calendar event.
+ *
+ * @param iter An events iterator, see \ref gcal_event_iter_open.
+ *
+ * @return The event or NULL at the end of the feed (or on error, see
+ * \ref gcal_event_iter_close). The event is valid until the next call,
+ * its memory is reused unless it is detached (see
+ * \ref gcal_event_iter_detach).
+ */
+gcal_event_t gcal_event_iter_next(gcal_event_iter_t iter);
+
+/** Takes the last event returned by \ref gcal_event_iter_next, so it is
+ * kept after the next call.
+ *
+ * @param iter An events iterator.
+ *
+ * @return The event (free it with \ref gcal_event_delete) or NULL.
+ */
+gcal_event_t gcal_event_iter_detach(gcal_event_iter_t iter);
+
+/** Ends reading calendar events, freeing the iterator.
+ *
+ * @param iter An events iterator.
+ *
+ * @return 0 on success (closing before the last event is fine), -1 if
+ * the download or the parsing failed.
+ */
+int gcal_event_iter_close(gcal_event_iter_t iter);
+
+/** Helper function, does the dump and parsing of calendar events in a
+ * time interval, splitting it in several windows downloaded at same time
+ * (see \ref gcal_set_max_transfers).
+ *
+ * It is useful for the initial sync of calendars with a large number of
+ * events. Events crossing windows limits are returned once (duplicates
+ * are removed by ID).
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param events_array Pointer to an events array structure. See
+ * \ref gcal_event_array.
+ *
+ * @param start_min Start of the interval as a RFC 3339 timestamp
+ * (e.g. 2008-09-10T21:00:00Z).
+ *
+ * @param start_max End of the interval (exclusive), RFC 3339 timestamp.
+ *
+ * @param ranges Number of windows the interval will be split.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_get_events_range(gcal_t gcalobj, struct gcal_event_array *events_array,
+			  const char *start_min, const char *start_max,
+			  size_t ranges);
+
+
+/** Helper function, does the events dump and parsing of several calendars
+ * at same time (see \ref gcal_set_max_transfers).
+ *
+ * Each calendar is downloaded using its own connection, so the time to
+ * sync all calendars is close to the time of the slowest calendar.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param gcal_array Calendars array, see \ref gcal_calendar_list.
+ *
+ * @param indexes Vector with indexes of the calendars to download, NULL to
+ * download all calendars.
+ *
+ * @param count Length of indexes vector (ignored when indexes is NULL).
+ *
+ * @param events_arrays Vector of events arrays, one per calendar (in the
+ * same order of indexes). It must have room for 'count' elements (or the
+ * number of calendars when indexes is NULL). Remember to cleanup each one
+ * with \ref gcal_cleanup_events, even on error (calendars that failed to
+ * download will be empty).
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_get_calendars_events(gcal_t gcalobj,
+			      struct gcal_resource_array *gcal_array,
+			      const size_t *indexes, size_t count,
+			      struct gcal_event_array *events_arrays);
+
 
 /** Use this function to cleanup an array of calendar events.
  *
@@ -46,6 +46,20 @@ POSSIBILITY OF SUCH DAMAGE.
 /** Contact data type */
 struct gcal_contact;
 
+/** Callback used to write contact photo data as it is downloaded.
+ *
+ * @param data Photo data chunk.
+ *
+ * @param length Chunk length.
+ *
+ * @param user User data pointer.
+ *
+ * @return Number of bytes written. Anything different from length will
+ * abort the download.
+ */
+typedef size_t (*gcal_photo_sink)(const void *data, size_t length,
+				  void *user);
+
 /** Extracts from the atom stream the contact entries  (you should
  * had got the atom stream before, using \ref gcal_dump).
  *
@@ -63,6 +77,62 @@ struct gcal_contact;
 struct gcal_contact *gcal_get_all_contacts(struct gcal_resource *ptr_gcal,
 					   size_t *length);
 
+/** Downloads the photos of a set of contacts, filling their photo data and
+ * length. When there is more than one photo, they are downloaded at same
+ * time (see \ref gcal_set_max_transfers).
+ *
+ * Contacts without photo are skipped. Contacts whose photo download failed
+ * keep the photo length set to 1 (i.e. has photo).
+ *
+ * @param ptr_gcal Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param contacts Vector of pointers to contacts.
+ *
+ * @param count Vector length.
+ *
+ * @return 0 if all photos were downloaded, -1 otherwise.
+ */
+int gcal_get_photos(struct gcal_resource *ptr_gcal,
+		    struct gcal_contact **contacts, size_t count);
+
+/** Downloads a contact photo, writing the data straight to a user callback
+ * (i.e. the photo is not kept in memory).
+ *
+ * @param ptr_gcal Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param contact A contact with photo.
+ *
+ * @param write Callback that receives each chunk of data, see
+ * \ref gcal_photo_sink.
+ *
+ * @param user User data passed to callback.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_get_photo_sink(struct gcal_resource *ptr_gcal,
+			struct gcal_contact *contact,
+			gcal_photo_sink write, void *user);
+
+/** Uploads a contact photo, reading data from a file while it is sent.
+ *
+ * @param ptr_gcal Pointer to a \ref gcal_resource structure, which has
+ *                 previously got the authentication using
+ *                 \ref gcal_get_authentication.
+ *
+ * @param contact A contact already in the server (i.e. it must have the
+ * photo link).
+ *
+ * @param fd File descriptor of a regular file.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_put_photo_file(struct gcal_resource *ptr_gcal,
+			struct gcal_contact *contact, int fd);
+
 
 /** Cleanup memory of 1 contact structure pointer.
  *
@@ -80,6 +150,18 @@ void gcal_destroy_contact(struct gcal_contact *contact);
  */
 void gcal_init_contact(struct gcal_contact *contact);
 
+/** Makes a deep copy of a contact.
+ *
+ * @param dest A pointer to a \ref gcal_contact, it must be initialized (see
+ * \ref gcal_init_contact) and its current data is released.
+ *
+ * @param src The contact to be copied.
+ *
+ * @return 0 on success, -1 otherwise (and 'dest' is left untouched).
+ */
+int gcal_copy_contact(struct gcal_contact *dest,
+		      const struct gcal_contact *src);
+
 /** Cleanup the memory of a vector of calendar entries created using
  * \ref gcal_get_contacts.
  *
@@ -130,6 +130,36 @@ gcal_contact_t gcal_contact_new(char *raw_xml);
  */
 void gcal_contact_delete(gcal_contact_t contact);
 
+/** Builds all contacts of a feed held in memory, parsing it at once.
+ *
+ * The feed can also be several entries saved one after another (e.g.
+ * their raw XML, see \ref gcal_set_store_xml), which is a lot faster than
+ * creating each one with \ref gcal_contact_new.
+ *
+ * @param buffer The feed (Atom or JSON).
+ *
+ * @param length Its length.
+ *
+ * @param contacts Pointer to a contacts array structure, free it with
+ * \ref gcal_cleanup_contacts.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_contacts_from_feed(const char *buffer, size_t length,
+			    struct gcal_contact_array *contacts);
+
+/** Same as \ref gcal_contacts_from_feed, reading a file (it is mapped in
+ * memory, not copied).
+ *
+ * @param path File path.
+ *
+ * @param contacts Pointer to a contacts array structure.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_contacts_from_file(const char *path,
+			    struct gcal_contact_array *contacts);
+
 
 /** Helper function, does all contact dump and parsing, returning
  * the data as an array of \ref gcal_contact.
@@ -144,6 +174,143 @@ void gcal_contact_delete(gcal_contact_t contact);
  */
 int gcal_get_contacts(gcal_t gcalobj, struct gcal_contact_array *contact_array);
 
+/** Called by \ref gcal_get_contacts_cb for each contact of the feed.
+ *
+ * @param contact Pointer to the contact. It is valid only during the
+ * call, unless the callback takes it by setting it to NULL (then it must
+ * be freed with \ref gcal_contact_delete).
+ *
+ * @param user_data User data pointer.
+ *
+ * @return 0 to go on, anything else stops the download.
+ */
+typedef int (*gcal_contact_cb)(gcal_contact_t *contact, void *user_data);
+
+/** Helper function, does the contacts dump and parsing like
+ * \ref gcal_get_contacts, but each contact is passed to a callback as soon
+ * as it is parsed (there is no array). Memory use doesn't depend on the
+ * number of contacts.
+ *
+ * Photos are not downloaded, see \ref gcal_contact_fetch_photo. Contacts
+ * are fully decoded (lazy mode is not used, see
+ * \ref gcal_set_lazy_fields).
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param callback Function called for each contact, see
+ * \ref gcal_contact_cb.
+ *
+ * @param user_data User data pointer passed to callback.
+ *
+ * @return 0 on success (including when callback stopped it), -1
+ * otherwise. Contacts handed to callback before an error are not undone.
+ */
+int gcal_get_contacts_cb(gcal_t gcalobj, gcal_contact_cb callback,
+			 void *user_data);
+
+/** Helper function, does the contacts dump and parsing like
+ * \ref gcal_get_contacts_cb, but in a pipeline: the download, the parsing
+ * and each callback run in distinct threads, so they overlap instead of
+ * running one after the other. Stages are connected by bounded queues
+ * (see \ref gcal_set_stream_queue).
+ *
+ * Use it when handling a contact takes about as long as downloading and
+ * parsing it (e.g. storing it in a database). Photos are not downloaded.
+ * The libgcal object can't be used by other threads until it returns.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param deliver Function called for each contact (in the calling
+ * thread), see \ref gcal_contact_cb.
+ *
+ * @param persist Function called (in its own thread) for each contact
+ * that 'deliver' didn't take, in the same order. It can be NULL. It can
+ * take the contact too.
+ *
+ * @param user_data User data pointer passed to both callbacks.
+ *
+ * @return 0 on success (including when a callback stopped it), -1
+ * otherwise.
+ */
+int gcal_get_contacts_pipeline(gcal_t gcalobj, gcal_contact_cb deliver,
+			       gcal_contact_cb persist, void *user_data);
+
+/** Contacts iterator, see \ref gcal_contact_iter_open. */
+typedef struct gcal_iter *gcal_contact_iter_t;
+
+/** Starts reading contacts one at a time: the feed is downloaded and
+ * parsed while contacts are read (there is no array). Photos are not
+ * downloaded, see \ref gcal_contact_fetch_photo.
+ *
+ * The libgcal object can't be used for other requests until the iterator
+ * is closed.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @return An iterator on success or NULL otherwise.
+ */
+gcal_contact_iter_t gcal_contact_iter_open(gcal_t gcalobj);
+
+/** Returns the next contact.
+ *
+ * @param iter A contacts iterator, see \ref gcal_contact_iter_open.
+ *
+ * @return The contact or NULL at the end of the feed (or on error, see
+ * \ref gcal_contact_iter_close). The contact is valid until the next
+ * call, its memory is reused unless it is detached (see
+ * \ref gcal_contact_iter_detach).
+ */
+gcal_contact_t gcal_contact_iter_next(gcal_contact_iter_t iter);
+
+/** Takes the last contact returned by \ref gcal_contact_iter_next, so it
+ * is kept after the next call.
+ *
+ * @param iter A contacts iterator.
+ *
+ * @return The contact (free it with \ref gcal_contact_delete) or NULL.
+ */
+gcal_contact_t gcal_contact_iter_detach(gcal_contact_iter_t iter);
+
+/** Ends reading contacts, freeing the iterator.
+ *
+ * @param iter A contacts iterator.
+ *
+ * @return 0 on success (closing before the last contact is fine), -1 if
+ * the download or the parsing failed.
+ */
+int gcal_contact_iter_close(gcal_contact_iter_t iter);
+
+/** Helper function, does the contacts dump and parsing splitting the feed
+ * in several ranges (using 'start-index') downloaded at same time (see
+ * \ref gcal_set_max_transfers).
+ *
+ * It is useful for the initial sync of accounts with a large number of
+ * contacts. Duplicated contacts (i.e. same ID) are removed.
+ *
+ * Ranges are slices of the feed ordered by last modification: contacts
+ * edited while they are downloaded move to the end of the feed, so they
+ * can be read twice (the duplicate is removed) or *not at all* (when they
+ * move from a range not yet downloaded to one already read). Take a UTC
+ * timestamp before the call and pass it to \ref gcal_get_updated_contacts
+ * afterwards to get the contacts edited meanwhile.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication. See also \ref gcal_new.
+ *
+ * @param contact_array Pointer to a contact array structure. See
+ * \ref gcal_contact_array.
+ *
+ * @param ranges Number of ranges the feed will be split.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_get_contacts_range(gcal_t gcalobj,
+			    struct gcal_contact_array *contact_array,
+			    size_t ranges);
+
 /** Use this function to cleanup an array of contacts.
  *
  * See also \ref gcal_get_contacts.
@@ -641,6 +808,125 @@ char *gcal_contact_get_photo(gcal_contact_t contact);
  */
 unsigned int gcal_contact_get_photolength(gcal_contact_t contact);
 
+/** Access contact photo ETag.
+ *
+ * It changes every time the photo is updated, so it can be used to check
+ * if a previously downloaded photo is still valid.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @return Pointer to internal object field (dont free it!) or NULL (in error
+ * case or if the field is not set). If the entry hasn't this field in the
+ * atom stream, it will be set to an empty string (i.e. "").
+ */
+char *gcal_contact_get_photo_etag(gcal_contact_t contact);
+
+/** Downloads a contact photo.
+ *
+ * Use it when photos are not downloaded together with the contacts (see
+ * \ref gcal_set_lazy_photo). After success, photo data can be accessed
+ * using \ref gcal_contact_get_photo and \ref gcal_contact_get_photolength.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @return 0 on success, -1 otherwise (or if the contact has no photo).
+ */
+int gcal_contact_fetch_photo(gcal_t gcalobj, gcal_contact_t contact);
+
+/** Downloads the photos of several contacts at same time (see
+ * \ref gcal_set_max_transfers).
+ *
+ * Contacts without photo are skipped, see also \ref gcal_contact_fetch_photo.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contacts A vector of contact objects.
+ *
+ * @param count Vector length.
+ *
+ * @return 0 if all photos were downloaded, -1 otherwise.
+ */
+int gcal_contact_fetch_photos(gcal_t gcalobj, gcal_contact_t *contacts,
+			      size_t count);
+
+/** Downloads a contact photo to a user callback.
+ *
+ * Data is passed to the callback as it arrives, so memory usage doesn't
+ * depend on photo size and the photo isn't stored in the contact
+ * (\ref gcal_contact_get_photo is left untouched). Error pages are not
+ * passed to the callback.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @param write Callback that receives photo data, see \ref gcal_photo_sink.
+ *
+ * @param user User data passed to callback.
+ *
+ * @return 0 on success, -1 otherwise (or if the contact has no photo).
+ */
+int gcal_contact_fetch_photo_cb(gcal_t gcalobj, gcal_contact_t contact,
+				gcal_photo_sink write, void *user);
+
+/** Downloads a contact photo to a file descriptor.
+ *
+ * Same as \ref gcal_contact_fetch_photo_cb, but data is written to a file
+ * (or pipe, socket, etc). The descriptor is not closed.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @param fd An open file descriptor.
+ *
+ * @return 0 on success, -1 otherwise (or if the contact has no photo).
+ */
+int gcal_contact_fetch_photo_fd(gcal_t gcalobj, gcal_contact_t contact,
+				int fd);
+
+/** Uploads a contact photo from a file descriptor.
+ *
+ * The photo is read while it is sent, instead of being loaded in memory
+ * first (as with \ref gcal_contact_set_photo). Contact must be already
+ * in the server (i.e. it was added or downloaded). After success, any
+ * previously downloaded photo data is released, since it is outdated.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @param fd File descriptor of a regular file (data is read from its
+ * beginning). The descriptor is not closed.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_contact_upload_photo_fd(gcal_t gcalobj, gcal_contact_t contact,
+				 int fd);
+
+/** Uploads a contact photo from a file.
+ *
+ * See \ref gcal_contact_upload_photo_fd.
+ *
+ * @param gcalobj A libgcal object, must be previously authenticated with
+ * \ref gcal_get_authentication.
+ *
+ * @param contact A contact object, see \ref gcal_contact.
+ *
+ * @param path Photo file path.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int gcal_contact_upload_photo_file(gcal_t gcalobj, gcal_contact_t contact,
+				   const char *path);
+
 /* Here starts the gcal_contact setters */
 
 /** Sets contact name.
@@ -74,10 +74,21 @@ static const char GCONTACT_END[] = "/full";
  */
 static const char GCAL_UPPER[] = "max-results=999999999";
 
+/* Default number of simultaneous transfers when downloading a feed
+ * split in ranges (see \ref gcal_set_max_transfers).
+ */
+static const int GCAL_MAX_TRANSFERS = 4;
+
+/* Default number of parsed entries an iterator keeps before pausing the
+ * download (see \ref gcal_set_stream_queue).
+ */
+static const size_t GCAL_STREAM_QUEUE = 64;
+
 static const int GCAL_DEFAULT_ANSWER = 200;
 static const int GCAL_REDIRECT_ANSWER = 302;
 static const int GCAL_EDIT_ANSWER = 201;
 static const int GCAL_CONFLICT = 409;
+static const int GCAL_NOT_MODIFIED = 304;
 
 static const char ACCOUNT_TYPE[] = "accountType=HOSTED_OR_GOOGLE";
 static const char EMAIL_FIELD[] = "Email=";
@@ -86,9 +97,62 @@ static const char SERVICE_FIELD[] = "service=";
 static const char CLIENT_SOURCE[] = "source=libgcal";
 static const char HEADER_AUTH[] = "Auth=";
 static const char HEADER_GET[] = "Authorization: GoogleLogin auth=";
+static const char HEADER_NONE_MATCH[] = "If-None-Match: ";
+
+/** Number of latencies kept to compute the hedging delay */
+#define GCAL_HEDGE_SAMPLES 64
+
+/** Hedged reads policy (see \ref gcal_set_hedging) */
+struct gcal_hedge {
+	/** Percentile of latencies used as delay, 0 disables hedging */
+	int percentile;
+	/** Min delay (in miliseconds), also used while there are few
+	 * latencies.
+	 */
+	long delay;
+	/** Last latencies (time to first byte, in miliseconds) */
+	long samples[GCAL_HEDGE_SAMPLES];
+	/** Number of latencies */
+	size_t count;
+	/** Next latency to be replaced */
+	size_t next;
+};
 
 /** Library structure. It holds resources (curl, buffer, etc).
  */
+struct gcal_cache;
+struct gcal_entries_cache;
+struct gcal_bucket;
+struct gcal_lazy_feed;
+
+/** Retry, rate limit and deadline policy (see \ref gcal_set_retry,
+ * \ref gcal_set_rate_limit and \ref gcal_set_timeout).
+ */
+struct gcal_policy {
+	/** Max number of retries of a failed request (0 disables it) */
+	int retries;
+	/** Delay (in miliseconds) before first retry, it doubles each time */
+	long delay;
+	/** Max delay (in miliseconds) between retries */
+	long max_delay;
+	/** Seed used to randomize the delays */
+	unsigned int seed;
+	/** Requests by second (0 disables the rate limit) */
+	double rate;
+	/** Max number of requests sent at once (i.e. the bucket size) */
+	double burst;
+	/** Available tokens (object without account, see \ref gcal_bucket) */
+	double tokens;
+	/** When the tokens were last updated (in seconds) */
+	double last;
+	/** Max duration (in miliseconds) of a request, 0 for no limit */
+	long timeout;
+	/** When the running request must be finished (in seconds), 0 if
+	 * there is no deadline.
+	 */
+	double deadline;
+};
+
 struct gcal_resource {
 	/** Memory buffer */
 	char *buffer;
@@ -118,7 +182,7 @@ struct gcal_resource {
 	long http_code;
 	/** CURL error messages */
 	char *curl_msg;
-	/** Internal status from last request */
+	/** Internal status from last request (see \ref gcal_status_interrupted) */
 	int internal_status;
 	/** Handler to internal logging file */
 	FILE *fout_log;
@@ -139,6 +203,60 @@ struct gcal_resource {
 	 * event/contact object.
 	 */
 	char store_xml_entry;
+	/** Max number of simultaneous transfers used when a feed is
+	 * fetched in parallel ranges.
+	 */
+	int max_transfers;
+	/** Controls if contact photos are downloaded with the contacts or
+	 * only when requested.
+	 */
+	char lazy_photo;
+	/** Directory where contact photos are cached (NULL disables it) */
+	char *photo_cache;
+	/** Cache of downloaded pages (NULL disables it) */
+	struct gcal_cache *cache;
+	/** ETag of last downloaded page (NULL if server didn't send it) */
+	char *etag;
+	/** Cache of parsed entries (NULL disables it) */
+	struct gcal_entries_cache *entries_cache;
+	/** Retry and rate limit policy */
+	struct gcal_policy policy;
+	/** Seconds that server asked to wait ('Retry-After'), -1 if none */
+	long retry_after;
+	/** Token bucket of the account (NULL if not authenticated) */
+	struct gcal_bucket *bucket;
+	/** Set by \ref gcal_cancel (from any thread) to abort the transfer,
+	 * always accessed with __atomic builtins.
+	 */
+	int canceled;
+	/** Hedged reads policy and latencies */
+	struct gcal_hedge hedge;
+	/** Controls if downloads are shared with other objects */
+	char single_flight;
+	/** Prebuilt authorization header (see \ref gcal_auth_header) */
+	char *auth_header;
+	/** Prebuilt GET headers: GData version plus authorization */
+	struct curl_slist *get_headers;
+	/** Min length of request bodies sent compressed (0 disables it) */
+	unsigned int gzip_upload;
+	/** Controls if feeds are downloaded in JSON (see \ref gcal_set_json) */
+	char json;
+	/** Partial response selector, URL encoded (see \ref gcal_set_fields) */
+	char *fields;
+	/** Fields extracted from entries (see \ref gcal_set_field_mask) */
+	unsigned int field_mask;
+	/** Controls if entry fields are decoded only when used (see
+	 * \ref gcal_set_lazy_fields).
+	 */
+	char lazy_fields;
+	/** Parsed entries kept by an iterator before the download is paused
+	 * (see \ref gcal_set_stream_queue).
+	 */
+	size_t stream_queue;
+	/** Buffer where entries are written before upload (reused) */
+	char *upload;
+	/** Its size */
+	size_t upload_size;
 };
 
 /** This structure has the common data fields between google services
@@ -147,6 +265,8 @@ struct gcal_resource {
 struct gcal_entry {
 	/** Controls if raw XML data will be stored. */
 	char store_xml;
+	/** Fields to extract, see \ref gcal_field */
+	unsigned int field_mask;
 	/** Flags if this entry was deleted/canceled */
 	char deleted;
 	/** element ID */
@@ -165,6 +285,16 @@ struct gcal_entry {
 	char *etag;
 	/** RAW XML data of this entry */
 	char *xml;
+	/** Feed used to decode pending fields (NULL if there are none) */
+	struct gcal_lazy_feed *feed;
+	/** The entry node in an Atom feed */
+	xmlNode *node;
+	/** The entry object text in a JSON feed */
+	const char *text;
+	/** Length of entry object text */
+	size_t text_length;
+	/** Fields of the mask not decoded yet (see \ref gcal_lazy_event) */
+	unsigned int pending;
 };
 
 /** Sub structures, e.g. represents each field of gd:structuredPostalAddress or gd:name.
@@ -325,6 +455,8 @@ struct gcal_contact {
 	char *birthday;
 	/** Photo edit url */
 	char *photo;
+	/** Photo ETag */
+	char *photo_etag;
 	/** Photo byte array */
 	unsigned char *photo_data;
 	/** Photo byte length. Values:
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   json_parser.h
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  This is the JSON feed parser (feeds downloaded with 'alt=json',
+ * see \ref gcal_set_json), it has the same functions of the Atom parser.
+ *
+ * There is no document tree and no XPath: each entry is read straight from
+ * the downloaded buffer, skipping the values that are not used. Entries
+ * get the same data they would get from the Atom feed (see
+ * \ref atom_extract_data and \ref atom_extract_contact), except for the raw
+ * data stored in 'xml' that is the JSON entry.
+ *
+ * Feeds follow the GData JSON format: an element is an object, its text is
+ * member '$t', attributes are string members and namespace prefixes use
+ * '$' (e.g. 'gd:when' is 'gd$when'). Elements that can repeat may be an
+ * array or a single object.
+ */
+
+#ifndef __GCAL_JSON__
+#define __GCAL_JSON__
+
+#include <stddef.h>
+#include "gcal.h"
+#include "gcontact.h"
+#include "gcal_cache.h"
+
+/** Checks if a downloaded feed is in JSON format.
+ *
+ * @param data The downloaded data.
+ *
+ * @return 1 if it is JSON, 0 otherwise.
+ */
+int json_is_feed(const char *data);
+
+/** This function returns the number of entries that a JSON feed has
+ * (like \ref atom_entries, it is the feed 'openSearch$totalResults' or the
+ * entries count for partial responses).
+ *
+ * @param data A pointer to string with the JSON feed.
+ *
+ * @return -1 on error, the number of entries otherwise (can be 0 zero).
+ */
+int json_entries(const char *data);
+
+/** Extract calendar information from a JSON entry.
+ *
+ * @param entry Pointer to the entry object text.
+ *
+ * @param length Length of entry object text.
+ *
+ * @param ptr_entry Pointer to a libgcal entry (see \ref gcal_event).
+ *
+ * @return 0 on sucess, -1 otherwise.
+ */
+int json_extract_data(const char *entry, size_t length,
+		      struct gcal_event *ptr_entry);
+
+/** Extract contact information from a JSON entry.
+ *
+ * @param entry Pointer to the entry object text.
+ *
+ * @param length Length of entry object text.
+ *
+ * @param ptr_entry Pointer to a libgcal contact (see \ref gcal_contact).
+ *
+ * @return 0 on sucess, -1 otherwise.
+ */
+int json_extract_contact(const char *entry, size_t length,
+			 struct gcal_contact *ptr_entry);
+
+/** Extracts all events of a JSON feed, see
+ * \ref extract_all_entries_cached.
+ *
+ * @param data A pointer to string with the JSON feed.
+ *
+ * @param data_extract Array of initialized events.
+ *
+ * @param length Length of array (must be the number of feed entries).
+ *
+ * @param cache Cache of parsed entries (can be NULL).
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int json_extract_all_entries(const char *data,
+			     struct gcal_event *data_extract, int length,
+			     struct gcal_entries_cache *cache);
+
+/** Extracts all contacts of a JSON feed, see
+ * \ref extract_all_contacts_cached.
+ *
+ * @param data A pointer to string with the JSON feed.
+ *
+ * @param data_extract Array of initialized contacts.
+ *
+ * @param length Length of array (must be the number of feed entries).
+ *
+ * @param cache Cache of parsed entries (can be NULL).
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int json_extract_all_contacts(const char *data,
+			      struct gcal_contact *data_extract, int length,
+			      struct gcal_entries_cache *cache);
+
+/** Incremental scan of a JSON feed downloaded in parts (see
+ * \ref json_next_entry).
+ */
+struct json_scan {
+	/** Where the scan is (root object, feed object, entries, end) */
+	int state;
+	/** Object that has the entries array */
+	int parent;
+};
+
+/** Starts the scan of a JSON feed.
+ *
+ * @param scan Pointer to a \ref json_scan structure.
+ */
+void json_scan_init(struct json_scan *scan);
+
+/** Finds the next entry of a JSON feed, using only the data downloaded so
+ * far. Values that are not complete yet are left for the next call.
+ *
+ * @param scan Pointer to a \ref json_scan structure.
+ *
+ * @param data Feed data that was not consumed yet.
+ *
+ * @param length Length of data.
+ *
+ * @param used Returns the number of bytes consumed, the caller must drop
+ * them before the next call (after using the entry).
+ *
+ * @param entry Returns the entry object text (it points into 'data').
+ *
+ * @param entry_length Returns the length of entry object text.
+ *
+ * @return 1 if an entry was found, 0 if more data is needed (or the
+ * feed ended, see \ref json_scan_done), -1 if the feed is malformed.
+ */
+int json_next_entry(struct json_scan *scan, const char *data, size_t length,
+		    size_t *used, const char **entry, size_t *entry_length);
+
+/** Checks if the scan has reached the end of the feed.
+ *
+ * @param scan Pointer to a \ref json_scan structure.
+ *
+ * @return 1 if the whole feed was read, 0 otherwise.
+ */
+int json_scan_done(const struct json_scan *scan);
+
+#endif
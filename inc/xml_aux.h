@@ -128,4 +128,55 @@ int xmlentry_init_resources(xmlTextWriter **writer, xmlBuffer **buffer);
  */
 void xmlentry_destroy_resources(xmlTextWriter **writer, xmlBuffer **buffer);
 
+
+/** Output of \ref xml_write_raw and friends: a growable buffer owned by
+ * the caller, reused between documents.
+ */
+struct xml_writer {
+	/** Pointer to the buffer (it can be moved when grown) */
+	char **buffer;
+	/** Pointer to the buffer size */
+	size_t *size;
+	/** Bytes written, the buffer is always 0 terminated */
+	size_t length;
+	/** Set if memory allocation failed (next writes are ignored) */
+	int error;
+};
+
+/** Starts writing a new document over a buffer (it can be NULL).
+ *
+ * @param writer A writer.
+ *
+ * @param buffer Pointer to the buffer, the writer may reallocate it.
+ *
+ * @param size Pointer to the buffer size.
+ */
+void xml_writer_init(struct xml_writer *writer, char **buffer, size_t *size);
+
+/** Appends bytes without escaping.
+ *
+ * @param writer A writer.
+ *
+ * @param data Bytes to append.
+ *
+ * @param length How many bytes.
+ */
+void xml_write_raw(struct xml_writer *writer, const char *data, size_t length);
+
+/** Appends an UTF-8 string escaped as libxml does when dumping a document
+ * without encoding (non ASCII characters become character references).
+ *
+ * @param writer A writer.
+ *
+ * @param text The string (NULL is the same as an empty string).
+ *
+ * Control characters are dropped and bytes that aren't UTF-8 are written
+ * as character references of their value.
+ *
+ * @param attribute Set it to escape an attribute value (quotes, tabs and
+ * new lines are escaped too).
+ */
+void xml_write_escaped(struct xml_writer *writer, const char *text,
+		       int attribute);
+
 #endif
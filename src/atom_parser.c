@@ -134,11 +134,20 @@ int atom_entries(xmlDoc *document)
 	if (!xpath_obj)
 		goto exit;
 
-	if ((node = xpath_obj->nodesetval)) {
-		/* The expression can only return 1 node */
-		if (node->nodeNr != 1)
-			goto cleanup;
-	} else
+	/* Partial responses (see 'gcal_set_fields') may not have the
+	 * total: then entries are counted.
+	 */
+	node = xpath_obj->nodesetval;
+	if ((!node) || (!node->nodeNr)) {
+		xmlXPathFreeObject(xpath_obj);
+		if ((xpath_obj = atom_get_entries(document)))
+			result = xpath_obj->nodesetval ?
+				xpath_obj->nodesetval->nodeNr : 0;
+		goto cleanup;
+	}
+
+	/* The expression can only return 1 node */
+	if (node->nodeNr != 1)
 		goto cleanup;
 
 	/* Node type must be 'text' */
@@ -231,6 +240,20 @@ exit:
 	return result;
 }
 
+/* Fields can be left out of partial responses (see 'gcal_set_fields'):
+ * absent elements are already empty strings, this does the same for
+ * absent attributes.
+ */
+static char *extract_optional(xmlDoc *doc, char *xpath_expression, char *attr)
+{
+	char *result = extract_and_check(doc, xpath_expression, attr);
+
+	if (!result)
+		result = strdup("");
+
+	return result;
+}
+
 static int extract_and_check_multi(xmlDoc *doc, char *xpath_expression,
 				   int getContent, char *attr1, char *attr2,
 				   char* attr3, char* attr4, char ***values,
@@ -666,6 +689,30 @@ char *get_etag_attribute(xmlNode * a_node)
 	return result;
 }
 
+char *get_id_element(xmlNode *a_node)
+{
+	xmlNode *child;
+	xmlChar *content;
+	char *result = NULL;
+
+	if (!a_node)
+		return result;
+
+	for (child = a_node->children; child; child = child->next)
+		if ((child->type == XML_ELEMENT_NODE) &&
+		    (!xmlStrcmp(child->name, "id")))
+			break;
+
+	if (child) {
+		content = xmlNodeGetContent(child);
+		if (content) {
+			result = strdup(content);
+			xmlFree(content);
+		}
+	}
+
+	return result;
+}
 
 int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 {
@@ -674,10 +721,13 @@ int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 	xmlChar *xml_str = NULL;
 	xmlDoc	*doc = NULL;
 	xmlNode *copy = NULL;
+	unsigned int mask;
+	char recurrent = 0;
 
 
 	if (!entry || !ptr_entry)
 		goto exit;
+	mask = ptr_entry->common.field_mask;
 
 	/* Creates a doc from this element node: yeah, nasty, I should
 	 * think of a better way later...
@@ -691,14 +741,17 @@ int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 		goto cleanup;
 
 	xmlDocSetRootElement(doc, copy);
-	xmlSaveFormatFileEnc("-", doc, "UTF-8", 1);
 
-	/* Google Data API 2.0 requires ETag to edit an entry */
+	/* Google Data API 2.0 requires ETag to edit an entry, but it
+	 * can be left out of partial responses.
+	 */
 	/* //atom:entry/@gd:etag*/
-	ptr_entry->common.etag = get_etag_attribute(copy);
-	if (!ptr_entry->common.etag) {
-		fprintf(stderr, "failed getting ETag!!!!!!\n");
-		goto cleanup;
+	if (mask & GCAL_F_ETAG) {
+		ptr_entry->common.etag = get_etag_attribute(copy);
+		if (!ptr_entry->common.etag)
+			ptr_entry->common.etag = strdup("");
+		if (!ptr_entry->common.etag)
+			goto cleanup;
 	}
 
 	/* Store XML raw data */
@@ -715,18 +768,22 @@ int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 			goto cleanup;
 
 	/* Gets the 'what' calendar field */
-	ptr_entry->common.title = extract_and_check(doc,
-					     "//atom:entry/atom:title/text()",
-					     NULL);
-	if (!ptr_entry->common.title)
-		goto cleanup;
+	if (mask & GCAL_F_TITLE) {
+		ptr_entry->common.title = extract_and_check(doc,
+						     "//atom:entry/atom:title/text()",
+						     NULL);
+		if (!ptr_entry->common.title)
+			goto cleanup;
+	}
 
 	/* Gets the 'id' calendar field */
-	ptr_entry->common.id = extract_and_check(doc,
-					  "//atom:entry/atom:id/text()",
-					  NULL);
-	if (!ptr_entry->common.id)
-		goto cleanup;
+	if (mask & GCAL_F_ID) {
+		ptr_entry->common.id = extract_and_check(doc,
+						  "//atom:entry/atom:id/text()",
+						  NULL);
+		if (!ptr_entry->common.id)
+			goto cleanup;
+	}
 
 	/* Gets the 'edit url' calendar field
 	 * FIXME: I dont known how to extract attribute value from
@@ -734,56 +791,68 @@ int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 	 * should work with the XPath expression:
 	 * '//atom:entry/atom:link[@rel='edit']/@href'
 	 */
-	ptr_entry->common.edit_uri = extract_and_check(doc, "//atom:entry/"
-						"atom:link[@rel='edit']",
-						"href");
-	if (!ptr_entry->common.edit_uri)
-		goto cleanup;
-	/* XXX: Starting with gcalendar protocol 2.1, the edit URL is
-	 * different between a just added event versus a retrieved event.
-	 * This makes the same event to have 2 distinct urls and breaks
-	 * the akonadi resource (because I use it as the remoteID of
-	 * item).
-	 * The 'alternate' link is the same but doesn't work.
-	 * See further info here:
-	 * http://groups.google.com/group/google-calendar-help-dataapi/browse_thread/thread/a5cb021dd6fa5d9c
-	 */
-	workaround_edit_url(ptr_entry->common.edit_uri);
+	if (mask & GCAL_F_EDIT_URI) {
+		ptr_entry->common.edit_uri = extract_and_check(doc, "//atom:entry/"
+							"atom:link[@rel='edit']",
+							"href");
+		if (!ptr_entry->common.edit_uri)
+			goto cleanup;
+		/* XXX: Starting with gcalendar protocol 2.1, the edit URL is
+		 * different between a just added event versus a retrieved event.
+		 * This makes the same event to have 2 distinct urls and breaks
+		 * the akonadi resource (because I use it as the remoteID of
+		 * item).
+		 * The 'alternate' link is the same but doesn't work.
+		 * See further info here:
+		 * http://groups.google.com/group/google-calendar-help-dataapi/browse_thread/thread/a5cb021dd6fa5d9c
+		 */
+		workaround_edit_url(ptr_entry->common.edit_uri);
+	}
 
 	/* Gets the 'content' calendar field */
-	ptr_entry->content = extract_and_check(doc,
-					       "//atom:entry/"
-					       "atom:content/text()",
-					       NULL);
+	if (mask & GCAL_F_CONTENT)
+		ptr_entry->content = extract_and_check(doc,
+						       "//atom:entry/"
+						       "atom:content/text()",
+						       NULL);
 
 	/* Gets the 'where' calendar field */
-	ptr_entry->where = extract_and_check(doc,
-					     "//atom:entry/"
-					     "gd:where",
-					     "valueString");
+	if (mask & GCAL_F_WHERE)
+		ptr_entry->where = extract_and_check(doc,
+						     "//atom:entry/"
+						     "gd:where",
+						     "valueString");
 
 	/* Gets the 'status' calendar field */
-	ptr_entry->status = extract_and_check(doc,
-					      "//atom:entry/gd:eventStatus",
-					      "value");
-	if (!ptr_entry->status)
-		goto cleanup;
+	if (mask & GCAL_F_STATUS) {
+		ptr_entry->status = extract_optional(doc,
+						     "//atom:entry/gd:eventStatus",
+						     "value");
+		if (!ptr_entry->status)
+			goto cleanup;
+	}
 
 	/* Gets informations about the attendees invited to the event */
 
-	ptr_entry->attendees_nr = extract_and_check_attendees(doc,
-							      "//atom:entry/gd:who",
-							      &ptr_entry->attendees);
+	if (mask & GCAL_F_ATTENDEES)
+		ptr_entry->attendees_nr = extract_and_check_attendees(doc,
+								      "//atom:entry/gd:who",
+								      &ptr_entry->attendees);
 
 	/* Retreive the recurrence pattern */
-	ptr_entry->dt_recurrent = extract_and_check(doc,"//atom:entry/"
-							  "gd:recurrence/text()",
-							  NULL);
-	if (ptr_entry->dt_recurrent[0] != 0) {
+	if (mask & (GCAL_F_WHEN | GCAL_F_ALARMS)) {
+		ptr_entry->dt_recurrent = extract_optional(doc, "//atom:entry/"
+							   "gd:recurrence/text()",
+							   NULL);
+		if (!ptr_entry->dt_recurrent)
+			goto cleanup;
+		recurrent = ptr_entry->dt_recurrent[0] != 0;
+	}
+
+	if ((mask & GCAL_F_WHEN) && (recurrent)) {
 	  ptr_entry->dt_start = strdup("");
 	  ptr_entry->dt_end = strdup("");
-	  ptr_entry->alarms_nr = extract_and_check_alarms(doc, 1, &ptr_entry->alarms);
-	} else {
+	} else if (mask & GCAL_F_WHEN) {
 	  /* Gets the when 'start' calendar field */
 	  ptr_entry->dt_start = extract_and_check(doc,
 						  "//atom:entry/gd:when",
@@ -793,75 +862,83 @@ int atom_extract_data(xmlNode *entry, struct gcal_event *ptr_entry)
 	  ptr_entry->dt_end = extract_and_check(doc,
 						"//atom:entry/gd:when",
 						"endTime");
-
-	  ptr_entry->alarms_nr = extract_and_check_alarms(doc, 0, &ptr_entry->alarms);
 	}
 
+	if (mask & GCAL_F_ALARMS)
+		ptr_entry->alarms_nr = extract_and_check_alarms(doc, recurrent,
+								&ptr_entry->alarms);
+
 	/* Gets the 'anyoneCanAddSelf' calendar field */
-	ptr_entry->anyoneCanAddSelf = extract_and_check(doc,
-							"//atom:entry/gCal:anyoneCanAddSelf",
-							"value");
-	if (!ptr_entry->anyoneCanAddSelf)
-	  goto cleanup;
-
-	/* Gets the 'guestsCanInviteOthers' calendar field */
-	ptr_entry->guestsCanInviteOthers = extract_and_check(doc,
-							     "//atom:entry/gCal:guestsCanInviteOthers",
-							     "value");
-	if (!ptr_entry->guestsCanInviteOthers)
-	  goto cleanup;
-
-	/* Gets the 'guestsCanModify' calendar field */
-	ptr_entry->guestsCanModify = extract_and_check(doc,
-						       "//atom:entry/gCal:guestsCanModify",
-						       "value");
-	if (!ptr_entry->guestsCanModify)
-	  goto cleanup;
-
-	/* Gets the 'guestsCanSeeGuests' calendar field */
-	ptr_entry->guestsCanSeeGuests = extract_and_check(doc,
-							  "//atom:entry/gCal:guestsCanSeeGuests",
-							  "value");
-	if (!ptr_entry->guestsCanSeeGuests)
-	  goto cleanup;
+	if (mask & GCAL_F_GUESTS) {
+		ptr_entry->anyoneCanAddSelf = extract_optional(doc,
+								"//atom:entry/gCal:anyoneCanAddSelf",
+								"value");
+		if (!ptr_entry->anyoneCanAddSelf)
+			goto cleanup;
+
+		/* Gets the 'guestsCanInviteOthers' calendar field */
+		ptr_entry->guestsCanInviteOthers = extract_optional(doc,
+								    "//atom:entry/gCal:guestsCanInviteOthers",
+								    "value");
+		if (!ptr_entry->guestsCanInviteOthers)
+			goto cleanup;
+
+		/* Gets the 'guestsCanModify' calendar field */
+		ptr_entry->guestsCanModify = extract_optional(doc,
+							      "//atom:entry/gCal:guestsCanModify",
+							      "value");
+		if (!ptr_entry->guestsCanModify)
+			goto cleanup;
+
+		/* Gets the 'guestsCanSeeGuests' calendar field */
+		ptr_entry->guestsCanSeeGuests = extract_optional(doc,
+								 "//atom:entry/gCal:guestsCanSeeGuests",
+								 "value");
+		if (!ptr_entry->guestsCanSeeGuests)
+			goto cleanup;
+	}
 
 	/* Gets the 'sequence' calendar field */
-	ptr_entry->sequence = extract_and_check(doc,
-						"//atom:entry/gCal:sequence",
-						"value");
-	if (!ptr_entry->sequence)
-	  goto cleanup;
+	if (mask & GCAL_F_SEQUENCE) {
+		ptr_entry->sequence = extract_optional(doc,
+							"//atom:entry/gCal:sequence",
+							"value");
+		if (!ptr_entry->sequence)
+			goto cleanup;
+	}
 
 	/* Detects if event was deleted/canceled and marks the flag */
-	if (!(strcmp("http://schemas.google.com/g/2005#event.canceled",
-		     ptr_entry->status)))
+	if ((ptr_entry->status) &&
+	    (!(strcmp("http://schemas.google.com/g/2005#event.canceled",
+		      ptr_entry->status))))
 		ptr_entry->common.deleted = 1;
 	else
 		ptr_entry->common.deleted = 0;
 
 	/* Gets the 'published' calendar field */
-	ptr_entry->common.published = extract_and_check(doc,
-							"//atom:entry/"
-							"atom:published/text()",
-							NULL);
-	if (!ptr_entry->common.published)
-	  goto cleanup;
-
-	/* Gets the 'updated' calendar field */
-	ptr_entry->common.updated = extract_and_check(doc,
-						      "//atom:entry/"
-						      "atom:updated/text()",
-						      NULL);
-	if (!ptr_entry->common.updated)
-		goto cleanup;
+	if (mask & GCAL_F_UPDATED) {
+		ptr_entry->common.published = extract_optional(doc,
+								"//atom:entry/"
+								"atom:published/text()",
+								NULL);
+		if (!ptr_entry->common.published)
+			goto cleanup;
+
+		/* Gets the 'updated' calendar field */
+		ptr_entry->common.updated = extract_optional(doc,
+							     "//atom:entry/"
+							     "atom:updated/text()",
+							     NULL);
+		if (!ptr_entry->common.updated)
+			goto cleanup;
+	}
 
 	/* Gets the 'visibility' calendar field */
-	ptr_entry->common.visibility = extract_and_check(doc,
-							 "//atom:entry/"
-							 "gd:visibility",
-							 "value");
-	if (!ptr_entry->common.updated)
-		goto cleanup;
+	if (mask & GCAL_F_VISIBILITY)
+		ptr_entry->common.visibility = extract_and_check(doc,
+								 "//atom:entry/"
+								 "gd:visibility",
+								 "value");
 
 	result = 0;
 
@@ -939,9 +1016,11 @@ int atom_extract_contact(xmlNode *entry, struct gcal_contact *ptr_entry)
 	xmlChar *xml_str = NULL;
 	xmlDoc *doc = NULL;
 	xmlNode *copy = NULL;
+	unsigned int mask;
 
 	if (!entry || !ptr_entry)
 		goto exit;
+	mask = ptr_entry->common.field_mask;
 
 	/* XXX: this function is pretty much a copy of 'atom_extract_data'
 	 * some code could be shared if I provided a common type between
@@ -961,12 +1040,16 @@ int atom_extract_contact(xmlNode *entry, struct gcal_contact *ptr_entry)
 
 	xmlDocSetRootElement(doc, copy);
 
-	/* Google Data API 2.0 requires ETag to edit an entry */
+	/* Google Data API 2.0 requires ETag to edit an entry, but it
+	 * can be left out of partial responses.
+	 */
 	/* //atom:entry/@gd:etag*/
-	ptr_entry->common.etag = get_etag_attribute(copy);
-	if (!ptr_entry->common.etag) {
-		fprintf(stderr, "failed getting ETag!!!!!!\n");
-		goto cleanup;
+	if (mask & GCAL_F_ETAG) {
+		ptr_entry->common.etag = get_etag_attribute(copy);
+		if (!ptr_entry->common.etag)
+			ptr_entry->common.etag = strdup("");
+		if (!ptr_entry->common.etag)
+			goto cleanup;
 	}
 
 	/* Store XML raw data */
@@ -983,69 +1066,79 @@ int atom_extract_contact(xmlNode *entry, struct gcal_contact *ptr_entry)
 			goto cleanup;
 
 	/* Detects if this contacts was deleted */
-	tmp = extract_and_check(doc, "//atom:entry/gd:deleted", NULL);
-	if (tmp) {
-		free(tmp);
-		ptr_entry->common.deleted = 0;
-	} else
-		ptr_entry->common.deleted = 1;
+	if (mask & GCAL_F_STATUS) {
+		tmp = extract_and_check(doc, "//atom:entry/gd:deleted", NULL);
+		if (tmp) {
+			free(tmp);
+			ptr_entry->common.deleted = 0;
+		} else
+			ptr_entry->common.deleted = 1;
+	}
 
 	/* Gets the 'id' contact field */
-	ptr_entry->common.id = extract_and_check(doc,
-					  "//atom:entry/atom:id/text()",
-					  NULL);
-	if (!ptr_entry->common.id)
-		goto cleanup;
+	if (mask & GCAL_F_ID) {
+		ptr_entry->common.id = extract_and_check(doc,
+						  "//atom:entry/atom:id/text()",
+						  NULL);
+		if (!ptr_entry->common.id)
+			goto cleanup;
+	}
 
 	/* Gets the 'updated' contact field */
-	ptr_entry->common.updated = extract_and_check(doc,
-					       "//atom:entry/"
-					       "atom:updated/text()",
-					       NULL);
-
-
-	ptr_entry->structured_name_nr = extract_and_check_multisub(doc,
-						    "//atom:entry/"
-						    "gd:name",
-						    1,
-						    NULL,
-						    NULL,
-						    &ptr_entry->structured_name,
-						    NULL,
-						    NULL);
-
-	/* The 'who' contact field changed in GData-Version: 3.0 API, see:
-	 * http://code.google.com/intl/en-EN/apis/contacts/docs/3.0/
-	 * migration_guide.html#Protocol
-	 */
-	ptr_entry->common.title = extract_and_check(doc, "//atom:entry"
-						    "/gd:name/gd:fullName/text()",
-						    NULL);
-
-
-	if (!ptr_entry->common.title && !ptr_entry->structured_name_nr)
-		goto cleanup;
+	if (mask & GCAL_F_UPDATED)
+		ptr_entry->common.updated = extract_and_check(doc,
+						       "//atom:entry/"
+						       "atom:updated/text()",
+						       NULL);
+
+
+	if (mask & GCAL_F_TITLE) {
+		ptr_entry->structured_name_nr = extract_and_check_multisub(doc,
+							    "//atom:entry/"
+							    "gd:name",
+							    1,
+							    NULL,
+							    NULL,
+							    &ptr_entry->structured_name,
+							    NULL,
+							    NULL);
+
+		/* The 'who' contact field changed in GData-Version: 3.0 API, see:
+		 * http://code.google.com/intl/en-EN/apis/contacts/docs/3.0/
+		 * migration_guide.html#Protocol
+		 */
+		ptr_entry->common.title = extract_and_check(doc, "//atom:entry"
+							    "/gd:name/gd:fullName/text()",
+							    NULL);
+
+
+		if (!ptr_entry->common.title && !ptr_entry->structured_name_nr)
+			goto cleanup;
+	}
 
 	/* Gets the 'edit url' contact field */
-	ptr_entry->common.edit_uri = extract_and_check(doc, "//atom:entry/"
-						"atom:link[@rel='edit']",
-						"href");
-	if (!ptr_entry->common.edit_uri)
-		goto cleanup;
+	if (mask & GCAL_F_EDIT_URI) {
+		ptr_entry->common.edit_uri = extract_and_check(doc, "//atom:entry/"
+							"atom:link[@rel='edit']",
+							"href");
+		if (!ptr_entry->common.edit_uri)
+			goto cleanup;
+	}
 
 	/* Gets email addressess */
-	ptr_entry->emails_nr = extract_and_check_multi(doc,
-						    "//atom:entry/"
-						    "gd:email",
-						    0,
-						    "address",
-						    "rel",
-						    NULL,
-						    "primary",
-						    &ptr_entry->emails_field,
-						    &ptr_entry->emails_type,
-						    NULL,
-						    &ptr_entry->pref_email);
+	if (mask & GCAL_F_EMAILS)
+		ptr_entry->emails_nr = extract_and_check_multi(doc,
+							    "//atom:entry/"
+							    "gd:email",
+							    0,
+							    "address",
+							    "rel",
+							    NULL,
+							    "primary",
+							    &ptr_entry->emails_field,
+							    &ptr_entry->emails_type,
+							    NULL,
+							    &ptr_entry->pref_email);
 
 	/* TODO Commented to allow contacts without an email address
 	if (!ptr_entry->email)
@@ -1054,126 +1147,138 @@ int atom_extract_contact(xmlNode *entry, struct gcal_contact *ptr_entry)
 	/* Here begins extra fields */
 
 	/* Gets the 'content' contact field */
-	ptr_entry->content = extract_and_check(doc,
-					       "//atom:entry/"
-					       "atom:content/text()",
-					       NULL);
+	if (mask & GCAL_F_CONTENT)
+		ptr_entry->content = extract_and_check(doc,
+						       "//atom:entry/"
+						       "atom:content/text()",
+						       NULL);
 
 	/* Gets contact nickname */
-	ptr_entry->nickname = extract_and_check(doc,
-						"//atom:entry/"
-						"gContact:nickname/text()",
-						NULL);
+	if (mask & GCAL_F_NICKNAME)
+		ptr_entry->nickname = extract_and_check(doc,
+							"//atom:entry/"
+							"gContact:nickname/text()",
+							NULL);
 
 	/* Gets the 'homepage' contact field */
-	ptr_entry->homepage = extract_and_check(doc, "//atom:entry/"
-						"gContact:website[@rel='home-page']",
-						"href");
-
-	/* Gets the 'blog' contact field */
-	ptr_entry->blog = extract_and_check(doc, "//atom:entry/"
-						"gContact:website[@rel='blog']",
-						"href");
+	if (mask & GCAL_F_WEBSITES) {
+		ptr_entry->homepage = extract_and_check(doc, "//atom:entry/"
+							"gContact:website[@rel='home-page']",
+							"href");
+
+		/* Gets the 'blog' contact field */
+		ptr_entry->blog = extract_and_check(doc, "//atom:entry/"
+							"gContact:website[@rel='blog']",
+							"href");
+	}
 
 	/* Gets the organization contact field */
-	ptr_entry->org_name = extract_and_check(doc,
-						"//atom:entry/"
-						"gd:organization/"
-						"gd:orgName/text()",
-						NULL);
-
-	/* Gets the org. title contact field */
-	ptr_entry->org_title = extract_and_check(doc,
-						"//atom:entry/"
-						"gd:organization/"
-						"gd:orgTitle/text()",
-						NULL);
-
-	/* Gets the occupation/profession contact field */
-	ptr_entry->occupation = extract_and_check(doc,
-						"//atom:entry/"
-						"gContact:occupation/text()",
-						NULL);
+	if (mask & GCAL_F_ORGANIZATION) {
+		ptr_entry->org_name = extract_and_check(doc,
+							"//atom:entry/"
+							"gd:organization/"
+							"gd:orgName/text()",
+							NULL);
+
+		/* Gets the org. title contact field */
+		ptr_entry->org_title = extract_and_check(doc,
+							"//atom:entry/"
+							"gd:organization/"
+							"gd:orgTitle/text()",
+							NULL);
+
+		/* Gets the occupation/profession contact field */
+		ptr_entry->occupation = extract_and_check(doc,
+							"//atom:entry/"
+							"gContact:occupation/text()",
+							NULL);
+	}
 
 	/* Gets contact phone numbers */
-	ptr_entry->phone_numbers_nr = extract_and_check_multi(doc,
-						    "//atom:entry/"
-						    "gd:phoneNumber",
-						    1,
-						    NULL,
-						    "rel",
-						    NULL,
-						    NULL,
-						    &ptr_entry->phone_numbers_field,
-						    &ptr_entry->phone_numbers_type,
-						    NULL,
-						    NULL);
+	if (mask & GCAL_F_PHONES)
+		ptr_entry->phone_numbers_nr = extract_and_check_multi(doc,
+							    "//atom:entry/"
+							    "gd:phoneNumber",
+							    1,
+							    NULL,
+							    "rel",
+							    NULL,
+							    NULL,
+							    &ptr_entry->phone_numbers_field,
+							    &ptr_entry->phone_numbers_type,
+							    NULL,
+							    NULL);
 
 	/* Gets contact IM addresses */
-	ptr_entry->im_nr = extract_and_check_multi(doc,
-						    "//atom:entry/"
-						    "gd:im",
-						    0,
-						    "address",
-						    "rel",
-						    "protocol",
-						    "primary",
-						    &ptr_entry->im_address,
-						    &ptr_entry->im_type,
-						    &ptr_entry->im_protocol,
-						    &ptr_entry->im_pref);
+	if (mask & GCAL_F_IM)
+		ptr_entry->im_nr = extract_and_check_multi(doc,
+							    "//atom:entry/"
+							    "gd:im",
+							    0,
+							    "address",
+							    "rel",
+							    "protocol",
+							    "primary",
+							    &ptr_entry->im_address,
+							    &ptr_entry->im_type,
+							    &ptr_entry->im_protocol,
+							    &ptr_entry->im_pref);
 
 	/* The 'postalAddress' contact field changed in GData-Version: 3.0 API, see:
 	 * http://code.google.com/intl/en-EN/apis/contacts/docs/3.0/
 	 * migration_guide.html#Protocol
 	 */
-	ptr_entry->post_address = extract_and_check(doc,
-				"//atom:entry/"
-				"gd:structuredPostalAddress/"
-				"gd:formattedAddress/text()",
-				NULL);
-
-	/* Gets contact structured postal addressees (Google API 3.0) */
-	ptr_entry->structured_address_nr = extract_and_check_multisub(doc,
-						    "//atom:entry/"
-						    "gd:structuredPostalAddress",
-						    1,
-						    "rel",
-						    "primary",
-						    &ptr_entry->structured_address,
-						    &ptr_entry->structured_address_type,
-						    &ptr_entry->structured_address_pref);
+	if (mask & GCAL_F_ADDRESS) {
+		ptr_entry->post_address = extract_and_check(doc,
+					"//atom:entry/"
+					"gd:structuredPostalAddress/"
+					"gd:formattedAddress/text()",
+					NULL);
+
+		/* Gets contact structured postal addressees (Google API 3.0) */
+		ptr_entry->structured_address_nr = extract_and_check_multisub(doc,
+							    "//atom:entry/"
+							    "gd:structuredPostalAddress",
+							    1,
+							    "rel",
+							    "primary",
+							    &ptr_entry->structured_address,
+							    &ptr_entry->structured_address_type,
+							    &ptr_entry->structured_address_pref);
+	}
 
 	/* Gets contact group membership info */
-	ptr_entry->groupMembership_nr = extract_and_check_multi(doc,
-						    "//atom:entry/"
-						    "gContact:groupMembershipInfo[@deleted='false']",
-						    0,
-						    "href",
-						    NULL,
-						    NULL,
-						    NULL,
-						    &ptr_entry->groupMembership,
-						    NULL,
-						    NULL,
-						    NULL);
+	if (mask & GCAL_F_GROUPS)
+		ptr_entry->groupMembership_nr = extract_and_check_multi(doc,
+							    "//atom:entry/"
+							    "gContact:groupMembershipInfo[@deleted='false']",
+							    0,
+							    "href",
+							    NULL,
+							    NULL,
+							    NULL,
+							    &ptr_entry->groupMembership,
+							    NULL,
+							    NULL,
+							    NULL);
 
 	/* Gets contact birthday */
-	ptr_entry->birthday = extract_and_check(doc,
-						    "//atom:entry/"
-						    "gContact:birthday",
-						    "when");
+	if (mask & GCAL_F_BIRTHDAY)
+		ptr_entry->birthday = extract_and_check(doc,
+							    "//atom:entry/"
+							    "gContact:birthday",
+							    "when");
 
 	/* Gets contact photo edit url and test for etag */
-	ptr_entry->photo = extract_and_check(doc, "//atom:entry/"
-					     "atom:link[@type='image/*']",
-					     "href");
-	tmp = extract_and_check(doc, "//atom:entry/"
-				"atom:link[@type='image/*']",
-				"etag");
-	if (tmp) {
-		ptr_entry->photo_length = 1;
-		free(tmp);
+	if (mask & GCAL_F_PHOTO) {
+		ptr_entry->photo = extract_and_check(doc, "//atom:entry/"
+						     "atom:link[@type='image/*']",
+						     "href");
+		ptr_entry->photo_etag = extract_and_check(doc, "//atom:entry/"
+							  "atom:link[@type='image/*']",
+							  "etag");
+		if (ptr_entry->photo_etag)
+			ptr_entry->photo_length = 1;
 	}
 
 	result = 0;
@@ -56,11 +56,21 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <curl/curl.h>
 
 #include "internal_gcal.h"
 #include "gcal.h"
 #include "gcal_parser.h"
+#include "json_parser.h"
+#include "gcal_cache.h"
+#include "gcal_retry.h"
+#include "gcal_flight.h"
+#include "gcal_gzip.h"
+#include "gcal_lazy.h"
 #include "msvc_hacks.h"
 #include "gcontact.h"
 
@@ -103,6 +113,28 @@ struct gcal_resource *gcal_construct(gservice mode)
 	ptr->location = NULL;
 	ptr->deleted = HIDE;
 	ptr->store_xml_entry = 0;
+	ptr->max_transfers = GCAL_MAX_TRANSFERS;
+	ptr->lazy_photo = 0;
+	ptr->photo_cache = NULL;
+	ptr->cache = NULL;
+	ptr->etag = NULL;
+	ptr->entries_cache = NULL;
+	memset(&ptr->policy, 0, sizeof(ptr->policy));
+	ptr->retry_after = -1;
+	ptr->bucket = NULL;
+	__atomic_store_n(&ptr->canceled, 0, __ATOMIC_SEQ_CST);
+	memset(&ptr->hedge, 0, sizeof(ptr->hedge));
+	ptr->single_flight = 0;
+	ptr->auth_header = NULL;
+	ptr->get_headers = NULL;
+	ptr->gzip_upload = 0;
+	ptr->json = 0;
+	ptr->fields = NULL;
+	ptr->field_mask = GCAL_F_ALL;
+	ptr->lazy_fields = 0;
+	ptr->stream_queue = GCAL_STREAM_QUEUE;
+	ptr->upload = NULL;
+	ptr->upload_size = 0;
 
 	if (!(ptr->buffer) || (!(ptr->curl)) || (!ptr->max_results)) {
 		if (ptr->max_results)
@@ -112,6 +144,16 @@ struct gcal_resource *gcal_construct(gservice mode)
 		goto exit;
 	}
 
+	/* Progress callback is used to cancel transfers */
+	curl_easy_setopt(ptr->curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(ptr->curl, CURLOPT_XFERINFOFUNCTION, gcal_progress_cb);
+	curl_easy_setopt(ptr->curl, CURLOPT_XFERINFODATA, (void *)ptr);
+
+	/* Feeds are asked compressed, curl decodes them (all encodings
+	 * it supports) before passing data to write callbacks.
+	 */
+	curl_easy_setopt(ptr->curl, CURLOPT_ACCEPT_ENCODING, "");
+
 	/* Initializes to google calendar as default */
 	if (gcal_set_service(ptr, mode)) {
 		free(ptr);
@@ -177,6 +219,24 @@ static void _gcal_destroy(struct gcal_resource *gcal_obj, int free_obj)
 		free(gcal_obj->location);
 	if (gcal_obj->domain)
 		free(gcal_obj->domain);
+	if (gcal_obj->photo_cache)
+		free(gcal_obj->photo_cache);
+	if (gcal_obj->cache)
+		gcal_cache_delete(gcal_obj->cache);
+	if (gcal_obj->etag)
+		free(gcal_obj->etag);
+	if (gcal_obj->entries_cache)
+		gcal_entries_cache_delete(gcal_obj->entries_cache);
+	if (gcal_obj->bucket)
+		gcal_rate_account(gcal_obj, NULL);
+	if (gcal_obj->auth_header)
+		free(gcal_obj->auth_header);
+	if (gcal_obj->get_headers)
+		curl_slist_free_all(gcal_obj->get_headers);
+	if (gcal_obj->fields)
+		curl_free(gcal_obj->fields);
+	if (gcal_obj->upload)
+		free(gcal_obj->upload);
 
 	if (free_obj == 0) {
 		free(gcal_obj);
@@ -223,6 +283,12 @@ exit:
 	return size;
 }
 
+size_t gcal_write_buffer(void *ptr, size_t count, size_t chunk_size,
+			 void *data)
+{
+	return write_cb(ptr, count, chunk_size, data);
+}
+
 static int check_request_error(struct gcal_resource *gcalobj, int code,
 			       int expected_answer)
 {
@@ -249,11 +315,53 @@ static int check_request_error(struct gcal_resource *gcalobj, int code,
 	return result;
 }
 
+/* Returns the value of a header line (or NULL if it is another header) */
+static char *header_value(char *line, size_t size, const char *header,
+			  size_t *length)
+{
+	size_t header_length = strlen(header);
+
+	if ((size <= header_length) ||
+	    (strncasecmp(line, header, header_length)))
+		return NULL;
+
+	line += header_length;
+	*length = size - header_length;
+	for (; *length && (*line == ' '); --*length)
+		++line;
+	while (*length && ((line[*length - 1] == '\r') ||
+			   (line[*length - 1] == '\n')))
+		--*length;
+
+	return line;
+}
+
+/* Keeps the page ETag (used by the page cache) and how long server asked
+ * to wait before a retry.
+ */
+static size_t header_cb(void *ptr, size_t count, size_t chunk_size, void *data)
+{
+	size_t size = count * chunk_size, length;
+	struct gcal_resource *gcal_ptr = (struct gcal_resource *)data;
+	char *value;
+
+	if ((value = header_value((char *)ptr, size, "ETag:", &length))) {
+		if (gcal_ptr->etag)
+			free(gcal_ptr->etag);
+		gcal_ptr->etag = strndup(value, length);
+
+	} else if ((value = header_value((char *)ptr, size, "Retry-After:",
+					 &length)))
+		gcal_ptr->retry_after = gcal_retry_after(value, length);
+
+	return size;
+}
+
 static int common_upload(struct gcal_resource *gcalobj,
 			 char *header, char *header2, char *header3,
 			 char *header4,
 			 struct curl_slist **curl_headers,
-			 const char *gdata_version)
+			 const char *gdata_version, int packed)
 {
 	int result = -1;
 	CURL *curl_ctx = gcalobj->curl;
@@ -280,19 +388,53 @@ static int common_upload(struct gcal_resource *gcalobj,
 		response_headers = curl_slist_append(response_headers, header3);
 	if (header4)
 		response_headers = curl_slist_append(response_headers, header4);
+	if (packed)
+		response_headers = curl_slist_append(response_headers,
+						     HEADER_GZIP);
 
 	if (!response_headers)
 		return result;
 
+	/* Data in server will change, cached pages must be revalidated */
+	gcal_cache_expire(gcalobj->cache);
+
 	*curl_headers = response_headers;
 
 	curl_easy_setopt(curl_ctx, CURLOPT_HTTPHEADER, response_headers);
 	curl_easy_setopt(curl_ctx, CURLOPT_WRITEFUNCTION, write_cb);
 	curl_easy_setopt(curl_ctx, CURLOPT_WRITEDATA, (void *)gcalobj);
+	curl_easy_setopt(curl_ctx, CURLOPT_HEADERFUNCTION, header_cb);
+	curl_easy_setopt(curl_ctx, CURLOPT_HEADERDATA, (void *)gcalobj);
 
 	return result = 0;
 }
 
+/* Compresses large request bodies (if enabled). Returns the compressed body
+ * (free it after the request) or NULL if the body is sent as it is.
+ */
+static char *pack_body(struct gcal_resource *gcalobj, char *post_data,
+		       unsigned int *length)
+{
+	char *packed = NULL;
+	size_t packed_length;
+
+	if ((!post_data) || (!gcalobj->gzip_upload) ||
+	    (*length < gcalobj->gzip_upload))
+		return NULL;
+
+	if (gcal_gzip(post_data, *length, &packed, &packed_length))
+		return NULL;
+
+	/* Not worth it */
+	if (packed_length >= *length) {
+		free(packed);
+		return NULL;
+	}
+
+	*length = packed_length;
+	return packed;
+}
+
 int http_post(struct gcal_resource *gcalobj, const char *url,
 	      char *header, char *header2, char *header3,
 	      char *header4,
@@ -304,15 +446,18 @@ int http_post(struct gcal_resource *gcalobj, const char *url,
 	CURLcode res;
 	struct curl_slist *response_headers = NULL;
 	CURL *curl_ctx;
+	char *packed;
 	if (!gcalobj)
 		goto exit;
 
 	curl_ctx = gcalobj->curl;
+	if ((packed = pack_body(gcalobj, post_data, &length)))
+		post_data = packed;
 	result = common_upload(gcalobj, header, header2, header3, header4,
 			       &response_headers,
-			       gdata_version);
+			       gdata_version, packed != NULL);
 	if (result)
-		goto exit;
+		goto cleanup;
 
 	/* It seems deprecated, as long I set POSTFIELDS */
 	curl_easy_setopt(curl_ctx, CURLOPT_POST, 1);
@@ -325,11 +470,14 @@ int http_post(struct gcal_resource *gcalobj, const char *url,
 	else
 		curl_easy_setopt(curl_ctx, CURLOPT_POSTFIELDSIZE, 0);
 
-	res = curl_easy_perform(curl_ctx);
+	/* A retry after server added the entry would add it twice */
+	res = gcal_perform_post(gcalobj);
 	result = check_request_error(gcalobj, res, expected_answer);
 
-	/* cleanup */
+cleanup:
 	curl_slist_free_all(response_headers);
+	if (packed)
+		free(packed);
 
 exit:
 	return result;
@@ -347,15 +495,18 @@ static int http_put(struct gcal_resource *gcalobj, const char *url,
 	CURLcode res;
 	struct curl_slist *response_headers = NULL;
 	CURL *curl_ctx;
+	char *packed;
 	if (!gcalobj)
 		goto exit;
 
 	curl_ctx = gcalobj->curl;
+	if ((packed = pack_body(gcalobj, post_data, &length)))
+		post_data = packed;
 	result = common_upload(gcalobj, header, header2, header3, header4,
 			       &response_headers,
-			       gdata_version);
+			       gdata_version, packed != NULL);
 	if (result)
-		goto exit;
+		goto cleanup;
 
 	curl_easy_setopt(curl_ctx, CURLOPT_URL, url);
 	/* Tells curl that I want to PUT */
@@ -371,11 +522,13 @@ static int http_put(struct gcal_resource *gcalobj, const char *url,
 
 
 
-	res = curl_easy_perform(curl_ctx);
+	res = gcal_perform(gcalobj, NULL, NULL);
 	result = check_request_error(gcalobj, res, expected_answer);
 
-	/* cleanup */
+cleanup:
 	curl_slist_free_all(response_headers);
+	if (packed)
+		free(packed);
 
 	/* Restores curl context to previous standard mode */
 	curl_easy_setopt(gcalobj->curl, CURLOPT_CUSTOMREQUEST, NULL);
@@ -385,6 +538,132 @@ exit:
 
 }
 
+/** File being uploaded, see \ref up_file */
+struct gcal_upload_file {
+	/** File descriptor */
+	int fd;
+	/** Current position */
+	off_t offset;
+	/** File size */
+	off_t length;
+};
+
+static size_t read_cb_upload_file(char *ptr, size_t count,
+				  size_t chunk_size, void *data)
+{
+	struct gcal_upload_file *file = (struct gcal_upload_file *)data;
+	size_t size = count * chunk_size;
+	ssize_t result;
+
+	if ((off_t)size > file->length - file->offset)
+		size = file->length - file->offset;
+	if (!size)
+		return 0;
+
+	/* pread: a failed request can be repeated without lseek */
+	do
+		result = pread(file->fd, ptr, size, file->offset);
+	while ((result == -1) && (errno == EINTR));
+
+	/* The file is shorter than it was when the upload started */
+	if (result <= 0)
+		return CURL_READFUNC_ABORT;
+
+	file->offset += result;
+	return result;
+}
+
+/* A failed upload is sent again from the file start */
+static int rewind_upload_file(struct gcal_resource *gcalobj, void *data)
+{
+	struct gcal_upload_file *file = (struct gcal_upload_file *)data;
+
+	file->offset = 0;
+	clean_buffer(gcalobj);
+
+	return 0;
+}
+
+static int http_put_file(struct gcal_resource *gcalobj, const char *url,
+			 char *header, char *header2, char *header3,
+			 struct gcal_upload_file *file,
+			 const int expected_answer,
+			 const char *gdata_version)
+{
+	int result = -1;
+	CURLcode res;
+	struct curl_slist *response_headers = NULL;
+	CURL *curl_ctx;
+	if (!gcalobj)
+		goto exit;
+
+	curl_ctx = gcalobj->curl;
+	/* The empty 'Expect' avoids a round trip for '100 Continue' */
+	/* Length of a compressed stream is only known after sending it */
+	result = common_upload(gcalobj, header, header2, header3, "Expect:",
+			       &response_headers,
+			       gdata_version, 0);
+	if (result)
+		goto exit;
+
+	file->offset = 0;
+	curl_easy_setopt(curl_ctx, CURLOPT_URL, url);
+	/* Upload is a PUT, with data from the read callback */
+	curl_easy_setopt(curl_ctx, CURLOPT_UPLOAD, 1L);
+	curl_easy_setopt(curl_ctx, CURLOPT_READFUNCTION,
+			 read_cb_upload_file);
+	curl_easy_setopt(curl_ctx, CURLOPT_READDATA, (void *)file);
+	curl_easy_setopt(curl_ctx, CURLOPT_INFILESIZE_LARGE,
+			 (curl_off_t)file->length);
+
+	res = gcal_perform(gcalobj, rewind_upload_file, file);
+	result = check_request_error(gcalobj, res, expected_answer);
+
+	/* cleanup */
+	curl_slist_free_all(response_headers);
+
+	/* Restores curl context to previous standard mode */
+	curl_easy_setopt(curl_ctx, CURLOPT_UPLOAD, 0L);
+	curl_easy_setopt(curl_ctx, CURLOPT_READFUNCTION, NULL);
+	curl_easy_setopt(curl_ctx, CURLOPT_READDATA, NULL);
+	curl_easy_setopt(curl_ctx, CURLOPT_INFILESIZE_LARGE, (curl_off_t)-1);
+
+exit:
+	return result;
+
+}
+
+/* Cached pages and the rate limit bucket belong to the authenticated
+ * account.
+ */
+static int set_account(struct gcal_resource *gcalobj)
+{
+	char *account = NULL;
+	size_t length;
+	int result = -1;
+
+	if ((gcalobj->auth) && (gcalobj->user) && (gcalobj->domain)) {
+		length = strlen(gcalobj->user) + strlen(gcalobj->domain) + 2;
+		if (!(account = malloc(length)))
+			goto exit;
+		snprintf(account, length, "%s@%s", gcalobj->user,
+			 gcalobj->domain);
+	}
+
+	if (gcal_rate_account(gcalobj, account))
+		goto cleanup;
+	if ((gcalobj->cache) && (gcal_cache_account(gcalobj->cache, account)))
+		goto cleanup;
+
+	result = 0;
+
+cleanup:
+	if (account)
+		free(account);
+exit:
+	return result;
+}
+
 int gcal_get_authentication(struct gcal_resource *gcalobj,
 			    char *user, char *password)
 {
@@ -438,6 +717,18 @@ int gcal_get_authentication(struct gcal_resource *gcalobj,
 			   GCAL_DEFAULT_ANSWER,
 			   "GData-Version: 2");
 
+	/* Re-authenticating can be as another user: pages and bucket of
+	 * previous account must not be used.
+	 */
+	if (gcalobj->user)
+		free(gcalobj->user);
+	if (gcalobj->domain)
+		free(gcalobj->domain);
+	gcalobj->user = gcalobj->domain = NULL;
+	if (gcalobj->cache)
+		gcal_cache_account(gcalobj->cache, NULL);
+	gcal_rate_account(gcalobj, NULL);
+
 	if ((tmp = strstr(user, "@"))) {
 		if (!(buffer = strdup(user)))
 			goto cleanup;
@@ -479,7 +770,7 @@ int gcal_get_authentication(struct gcal_resource *gcalobj,
 	if (tmp)
 		*tmp = '\0';
 
-	result = 0;
+	result = set_account(gcalobj);
 
 cleanup:
 	if (enc_user)
@@ -494,13 +785,72 @@ exit:
 
 }
 
-int get_follow_redirection(struct gcal_resource *gcalobj, const char *url,
-			   void *cb_download, const char *gdata_version)
+char *gcal_auth_header(struct gcal_resource *gcalobj)
+{
+	size_t length;
+
+	if ((!gcalobj) || (!gcalobj->auth))
+		return NULL;
+
+	/* Still valid while the token is the same */
+	if ((gcalobj->auth_header) &&
+	    (!strcmp(gcalobj->auth_header + sizeof(HEADER_GET) - 1,
+		     gcalobj->auth)))
+		return gcalobj->auth_header;
+
+	if (gcalobj->auth_header)
+		free(gcalobj->auth_header);
+	if (gcalobj->get_headers) {
+		curl_slist_free_all(gcalobj->get_headers);
+		gcalobj->get_headers = NULL;
+	}
+
+	length = strlen(gcalobj->auth) + sizeof(HEADER_GET);
+	if ((gcalobj->auth_header = malloc(length)))
+		snprintf(gcalobj->auth_header, length, "%s%s", HEADER_GET,
+			 gcalobj->auth);
+
+	return gcalobj->auth_header;
+}
+
+/* Returns the GET header list, only rebuilt if the token or the Data API
+ * version changes. It belongs to the gcal object, callers must not free it.
+ */
+static struct curl_slist *get_headers(struct gcal_resource *gcalobj,
+				      const char *gdata_version)
+{
+	struct curl_slist *headers = NULL, *tmp;
+	char *auth;
+
+	if (!(auth = gcal_auth_header(gcalobj)))
+		return NULL;
+
+	/* First node is the version, second one the authorization */
+	if ((gcalobj->get_headers) &&
+	    (!strcmp(gcalobj->get_headers->data, gdata_version)))
+		return gcalobj->get_headers;
+
+	/* To support Google Data API 2.0 */
+	if (!(headers = curl_slist_append(headers, gdata_version)))
+		return NULL;
+	/* curl keeps its own copy of each header string */
+	if (!(tmp = curl_slist_append(headers, auth))) {
+		curl_slist_free_all(headers);
+		return NULL;
+	}
+
+	if (gcalobj->get_headers)
+		curl_slist_free_all(gcalobj->get_headers);
+	gcalobj->get_headers = tmp;
+
+	return gcalobj->get_headers;
+}
+
+int prepare_follow_redirection(struct gcal_resource *gcalobj, const char *url,
+			       void *cb_download, const char *gdata_version)
 {
 	struct curl_slist *response_headers = NULL;
-	int length = 0;
 	int result = -1;
-	char *tmp_buffer = NULL;
 	void *downloader = NULL;
 
 	if (cb_download == NULL)
@@ -511,49 +861,47 @@ int get_follow_redirection(struct gcal_resource *gcalobj, const char *url,
 	/* Must cleanup HTTP buffer between requests */
 	clean_buffer(gcalobj);
 
-	if (!gcalobj->auth)
+	if (!(response_headers = get_headers(gcalobj, gdata_version)))
 		goto exit;
-	length = strlen(gcalobj->auth) + sizeof(HEADER_GET) + 1;
-	tmp_buffer = (char *) malloc(length);
-	if (!tmp_buffer)
-		goto exit;
-	snprintf(tmp_buffer, length - 1, "%s%s", HEADER_GET, gcalobj->auth);
-
-	/* To support Google Data API 2.0 */
-	response_headers = curl_slist_append(response_headers,
-					     gdata_version);
-
-	response_headers = curl_slist_append(response_headers, tmp_buffer);
-	if (!response_headers)
-		return result;
 
 	curl_easy_setopt(gcalobj->curl, CURLOPT_HTTPGET, 1);
 	curl_easy_setopt(gcalobj->curl, CURLOPT_HTTPHEADER, response_headers);
 	curl_easy_setopt(gcalobj->curl, CURLOPT_URL, url);
 	curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEFUNCTION, downloader);
 	curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEDATA, (void *)gcalobj);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_HEADERFUNCTION, header_cb);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_HEADERDATA, (void *)gcalobj);
+	if (gcalobj->etag) {
+		free(gcalobj->etag);
+		gcalobj->etag = NULL;
+	}
 
-	result = curl_easy_perform(gcalobj->curl);
+	result = 0;
 
-	if (!(strcmp(gcalobj->service, "cp"))) {
-		/* For contacts, there is *not* redirection. */
-		if (!(result = check_request_error(gcalobj, result,
-						   GCAL_DEFAULT_ANSWER))) {
+exit:
+	return result;
+}
+
+int check_follow_redirection(struct gcal_resource *gcalobj, int code,
+			     int redirected)
+{
+	int result = -1;
+
+	if (!(strcmp(gcalobj->service, "cp")) || redirected) {
+		/* For contacts, there is *not* redirection (and calendar
+		 * was already redirected).
+		 */
+		if (!check_request_error(gcalobj, code, GCAL_DEFAULT_ANSWER))
 			result = 0;
-			goto cleanup;
-		}
-	} else if (!(strcmp(gcalobj->service, "cl"))) {
-		/* For calendar, it *must* be redirection */
-		if (check_request_error(gcalobj, result,
-					GCAL_REDIRECT_ANSWER)) {
-			result = -1;
-			goto cleanup;
-		}
-	} else {
+		goto exit;
+
+	} else if (strcmp(gcalobj->service, "cl"))
 		/* No valid service, just exit. */
-		result = -1;
-		goto cleanup;
-	}
+		goto exit;
+
+	/* For calendar, it *must* be redirection */
+	if (check_request_error(gcalobj, code, GCAL_REDIRECT_ANSWER))
+		goto exit;
 
 	/* It will extract and follow the first 'REF' link in the stream */
 	if (gcalobj->url) {
@@ -561,34 +909,139 @@ int get_follow_redirection(struct gcal_resource *gcalobj, const char *url,
 		gcalobj->url = NULL;
 	}
 
-	if (get_the_url(gcalobj->buffer, gcalobj->length, &gcalobj->url)) {
-		result = -1;
-		goto cleanup;
-	}
+	if (get_the_url(gcalobj->buffer, gcalobj->length, &gcalobj->url))
+		goto exit;
 
 	clean_buffer(gcalobj);
 	curl_easy_setopt(gcalobj->curl, CURLOPT_URL, gcalobj->url);
-	result = curl_easy_perform(gcalobj->curl);
-	if ((result = check_request_error(gcalobj, result,
-					  GCAL_DEFAULT_ANSWER))) {
-		result = -1;
-		goto cleanup;
+	result = 1;
+
+exit:
+	return result;
+}
+
+/* Checks if server answered that cached page is still valid */
+static int not_modified(struct gcal_resource *gcalobj,
+			struct gcal_cache_entry *cached, int code)
+{
+	long http_code = 0;
+
+	if ((!cached) || (code != CURLE_OK))
+		return 0;
+
+	curl_easy_getinfo(gcalobj->curl, CURLINFO_RESPONSE_CODE, &http_code);
+	if (http_code != GCAL_NOT_MODIFIED)
+		return 0;
+
+	gcal_cache_touch(gcalobj->cache, cached);
+	return 1;
+}
+
+static int fetch_page(struct gcal_resource *gcalobj, const char *url,
+		      void *cb_download, const char *gdata_version)
+{
+	struct curl_slist *response_headers = NULL;
+	struct gcal_cache_entry *cached = NULL;
+	int result = -1, code, deadline = 0;
+	char *header, *auth;
+	size_t length;
+
+	if (gcalobj->cache) {
+		cached = gcal_cache_find(gcalobj->cache, url, gdata_version);
+		/* Fresh page, no need to ask the server */
+		if (gcal_cache_fresh(gcalobj->cache, cached)) {
+			result = gcal_cache_restore(cached, gcalobj);
+			goto exit;
+		}
 	}
 
-cleanup:
+	if (prepare_follow_redirection(gcalobj, url, cb_download,
+				       gdata_version))
+		goto exit;
 
-	if (tmp_buffer)
-		free(tmp_buffer);
-	if (response_headers)
-		curl_slist_free_all(response_headers);
+	/* Redirection is part of the same request */
+	deadline = gcal_deadline_start(gcalobj);
+
+	/* Server answers 'Not Modified' if page is still valid (the prebuilt
+	 * list is shared, so this request gets its own one).
+	 */
+	if (gcal_cache_etag(cached)) {
+		if (!(auth = gcal_auth_header(gcalobj)))
+			goto cleanup;
+		length = strlen(gcal_cache_etag(cached)) +
+			sizeof(HEADER_NONE_MATCH);
+		if (!(header = malloc(length)))
+			goto cleanup;
+		snprintf(header, length, "%s%s", HEADER_NONE_MATCH,
+			 gcal_cache_etag(cached));
+		/* Appending to a list keeps its head */
+		response_headers = curl_slist_append(NULL, gdata_version);
+		if ((!response_headers) ||
+		    (!curl_slist_append(response_headers, auth)) ||
+		    (!curl_slist_append(response_headers, header))) {
+			free(header);
+			goto cleanup;
+		}
+		free(header);
+		curl_easy_setopt(gcalobj->curl, CURLOPT_HTTPHEADER,
+				 response_headers);
+	}
+
+	code = gcal_perform_read(gcalobj);
+	if (not_modified(gcalobj, cached, code))
+		goto restore;
+	result = check_follow_redirection(gcalobj, code, 0);
+	if (result == 1) {
+		code = gcal_perform_read(gcalobj);
+		if (not_modified(gcalobj, cached, code))
+			goto restore;
+		result = check_follow_redirection(gcalobj, code, 1);
+	}
+
+	/* Keeps the page for next time */
+	if ((!result) && (gcalobj->cache)) {
+		/* Text pages don't update previous length */
+		length = gcalobj->previous_length;
+		if (!length)
+			length = strlen(gcalobj->buffer);
+		gcal_cache_store(gcalobj->cache, url, gdata_version,
+				 gcalobj->etag, gcalobj->buffer, length);
+	}
+	goto cleanup;
+
+restore:
+	result = gcal_cache_restore(cached, gcalobj);
+
+cleanup:
+	gcal_deadline_end(gcalobj, deadline);
+	curl_slist_free_all(response_headers);
 
 exit:
 	return result;
 }
 
+int get_follow_redirection(struct gcal_resource *gcalobj, const char *url,
+			   void *cb_download, const char *gdata_version)
+{
+	if (gcalobj->single_flight)
+		return gcal_flight_get(gcalobj, url, cb_download,
+				       gdata_version, fetch_page);
+
+	return fetch_page(gcalobj, url, cb_download, gdata_version);
+}
+
+
+/* Appends to an URL of 'length' bytes (allocated), never past its end */
+static void url_append(char *url, size_t length, const char *str)
+{
+	size_t used = strlen(url);
+
+	if (used + 1 < length)
+		strncat(url, str, length - used - 1);
+}
 
-static char *mount_query_url(struct gcal_resource *gcalobj,
-			     const char *parameters, ...)
+char *mount_query_url(struct gcal_resource *gcalobj,
+		      const char *parameters, ...)
 {
 	va_list ap;
 	char *result = NULL, *query_param = NULL, *ptr_tmp = NULL;
@@ -597,6 +1050,9 @@ static char *mount_query_url(struct gcal_resource *gcalobj,
 	char query_init[] = "?";
 	/* By default, google contacts are not ordered */
 	char contact_order[] = "&orderby=lastmodified";
+	/* Feeds in JSON are parsed a lot faster */
+	char query_json[] = "&alt=json";
+	char query_fields[] = "&fields=";
 	if (!gcalobj)
 		goto exit;
 
@@ -685,8 +1141,8 @@ static char *mount_query_url(struct gcal_resource *gcalobj,
 		if (!ptr_tmp)
 			goto cleanup;
 		result = ptr_tmp;
-		strncat(result, query_separator, sizeof(query_separator));
-		strncat(result, parameters, strlen(parameters));
+		url_append(result, length, query_separator);
+		url_append(result, length, parameters);
 
 		va_start(ap, parameters);
 		while ((query_param = va_arg(ap, char *))) {
@@ -696,13 +1152,32 @@ static char *mount_query_url(struct gcal_resource *gcalobj,
 				goto cleanup;
 			result = ptr_tmp;
 
-			strncat(result, query_separator,
-				sizeof(query_separator));
-			strncat(result, query_param, strlen(query_param));
+			url_append(result, length, query_separator);
+			url_append(result, length, query_param);
 		}
 
 	}
 
+	if (gcalobj->json) {
+		length += sizeof(query_json);
+		ptr_tmp = realloc(result, length);
+		if (!ptr_tmp)
+			goto cleanup;
+		result = ptr_tmp;
+		url_append(result, length, query_json);
+	}
+
+	/* Partial response: only the chosen fields are downloaded */
+	if (gcalobj->fields) {
+		length += strlen(gcalobj->fields) + sizeof(query_fields);
+		ptr_tmp = realloc(result, length);
+		if (!ptr_tmp)
+			goto cleanup;
+		result = ptr_tmp;
+		url_append(result, length, query_fields);
+		url_append(result, length, gcalobj->fields);
+	}
+
 	goto exit;
 
 cleanup:
@@ -842,6 +1317,7 @@ int gcal_calendar_list(struct gcal_resource *gcalobj,
 		gcal_array->entries[i].document = NULL;
 		reset_buffer(&gcal_array->entries[i]);
 		gcal_array->entries[i].max_results = strdup(GCAL_UPPER);
+		gcal_array->entries[i].max_transfers = gcalobj->max_transfers;
 		gcal_set_service(&(gcal_array->entries[i]), GCALENDAR);
 
 		result = get_calendar_entry(gcalobj->document, i, &gcal_array->entries[i]);
@@ -877,6 +1353,11 @@ int gcal_entry_number(struct gcal_resource *gcalobj)
 	if (!gcalobj->buffer || !gcalobj->has_xml)
 		goto exit;
 
+	if (json_is_feed(gcalobj->buffer)) {
+		result = json_entries(gcalobj->buffer);
+		goto exit;
+	}
+
 	gcalobj->document = build_dom_document(gcalobj->buffer);
 	if (!gcalobj->document)
 		goto exit;
@@ -895,6 +1376,10 @@ struct gcal_event *gcal_get_entries(struct gcal_resource *gcalobj,
 
 	int result = -1, i;
 	struct gcal_event *ptr_res = NULL;
+	struct gcal_lazy_feed *feed = NULL;
+	dom_document *doc;
+	const char *data;
+	struct gcal_entries_cache *cache;
 
 	if (!gcalobj)
 		goto exit;
@@ -902,14 +1387,31 @@ struct gcal_event *gcal_get_entries(struct gcal_resource *gcalobj,
 	if (!gcalobj->buffer || !gcalobj->has_xml)
 		goto exit;
 
-	gcalobj->document = build_dom_document(gcalobj->buffer);
-	if (!gcalobj->document)
+	/* JSON feeds don't need a DOM tree */
+	if (json_is_feed(gcalobj->buffer))
+		result = json_entries(gcalobj->buffer);
+	else if ((gcalobj->document = build_dom_document(gcalobj->buffer)))
+		result = get_entries_number(gcalobj->document);
+	else
 		goto exit;
 
-	result = get_entries_number(gcalobj->document);
 	if (result == -1)
 		goto cleanup;
 
+	doc = gcalobj->document;
+	data = gcalobj->buffer;
+	cache = gcalobj->entries_cache;
+
+	/* Lazy entries keep the feed (and don't use the parse cache) */
+	if (gcalobj->lazy_fields) {
+		if (!(feed = gcal_lazy_feed_new(doc, data)))
+			goto cleanup;
+		gcalobj->document = NULL;
+		if (!doc)
+			data = feed->data;
+		cache = NULL;
+	}
+
 	ptr_res = malloc(sizeof(struct gcal_event) * result);
 	if (!ptr_res) {
 		*length = 0;
@@ -923,15 +1425,22 @@ struct gcal_event *gcal_get_entries(struct gcal_resource *gcalobj,
 		gcal_init_event((ptr_res + i));
 		if (gcalobj->store_xml_entry)
 			(ptr_res + i)->common.store_xml = 1;
+		(ptr_res + i)->common.field_mask = gcalobj->field_mask;
+		gcal_lazy_attach(&(ptr_res + i)->common, feed);
 	}
 
-	result = extract_all_entries(gcalobj->document, ptr_res, result);
+	if (!doc)
+		result = json_extract_all_entries(data, ptr_res, result, cache);
+	else
+		result = extract_all_entries_cached(doc, ptr_res, result,
+						    cache);
 	if (result == -1) {
-		free(ptr_res);
+		gcal_destroy_entries(ptr_res, *length);
 		ptr_res = NULL;
 	}
 
 cleanup:
+	gcal_lazy_feed_release(feed);
 	clean_dom_document(gcalobj->document);
 	gcalobj->document = NULL;
 
@@ -953,6 +1462,7 @@ void gcal_init_event(struct gcal_event *entry)
 		return;
 
 	entry->common.store_xml = entry->common.deleted = 0;
+	entry->common.field_mask = GCAL_F_ALL;
 	entry->common.title = entry->common.id = NULL;
 	entry->common.edit_uri = entry->common.etag = NULL;
 	entry->common.xml = entry->common.updated = NULL;
@@ -966,10 +1476,17 @@ void gcal_init_event(struct gcal_event *entry)
 	entry->alarms = NULL;
 	entry->alarms_nr = 0;
 	entry->attendees_nr = 0;
+	entry->common.feed = NULL;
+	entry->common.node = NULL;
+	entry->common.text = NULL;
+	entry->common.text_length = 0;
+	entry->common.pending = 0;
 }
 
 void gcal_destroy_entry(struct gcal_event *entry)
 {
+	unsigned int i;
+
 	if (!entry)
 		return;
 
@@ -993,14 +1510,100 @@ void gcal_destroy_entry(struct gcal_event *entry)
 	clean_string(entry->guestsCanSeeGuests);
 	clean_string(entry->sequence);
 	if(entry->attendees) {
-		if(entry->attendees->email) {
-			clean_string(entry->attendees->email);
-		}
+		for (i = 0; i < entry->attendees_nr; ++i)
+			clean_string(entry->attendees[i].email);
 		free(entry->attendees);
 	}
 	if(entry->alarms) {
 		free(entry->alarms);
 	}
+	gcal_lazy_detach(&entry->common);
+}
+
+static int copy_string(char **dest, const char *src)
+{
+	*dest = NULL;
+	if (!src)
+		return 0;
+
+	if (!(*dest = strdup(src)))
+		return -1;
+
+	return 0;
+}
+
+int gcal_copy_entry(struct gcal_event *dest, const struct gcal_event *src)
+{
+	int result = -1;
+	unsigned int i;
+	struct gcal_event copy;
+
+	if ((!dest) || (!src))
+		return result;
+
+	gcal_init_event(&copy);
+	copy.common.store_xml = src->common.store_xml;
+	copy.common.field_mask = src->common.field_mask;
+	copy.common.deleted = src->common.deleted;
+
+	if (copy_string(&copy.common.id, src->common.id) ||
+	    copy_string(&copy.common.published, src->common.published) ||
+	    copy_string(&copy.common.updated, src->common.updated) ||
+	    copy_string(&copy.common.visibility, src->common.visibility) ||
+	    copy_string(&copy.common.title, src->common.title) ||
+	    copy_string(&copy.common.edit_uri, src->common.edit_uri) ||
+	    copy_string(&copy.common.etag, src->common.etag) ||
+	    copy_string(&copy.common.xml, src->common.xml) ||
+	    copy_string(&copy.content, src->content) ||
+	    copy_string(&copy.dt_recurrent, src->dt_recurrent) ||
+	    copy_string(&copy.dt_start, src->dt_start) ||
+	    copy_string(&copy.dt_end, src->dt_end) ||
+	    copy_string(&copy.where, src->where) ||
+	    copy_string(&copy.status, src->status) ||
+	    copy_string(&copy.anyoneCanAddSelf, src->anyoneCanAddSelf) ||
+	    copy_string(&copy.guestsCanInviteOthers,
+			src->guestsCanInviteOthers) ||
+	    copy_string(&copy.guestsCanModify, src->guestsCanModify) ||
+	    copy_string(&copy.guestsCanSeeGuests, src->guestsCanSeeGuests) ||
+	    copy_string(&copy.sequence, src->sequence))
+		goto cleanup;
+
+	if ((src->attendees) && (src->attendees_nr)) {
+		copy.attendees = malloc(sizeof(struct gcal_event_attendees) *
+					src->attendees_nr);
+		if (!copy.attendees)
+			goto cleanup;
+		memcpy(copy.attendees, src->attendees,
+		       sizeof(struct gcal_event_attendees) * src->attendees_nr);
+		copy.attendees_nr = src->attendees_nr;
+		for (i = 0; i < copy.attendees_nr; ++i)
+			copy.attendees[i].email = NULL;
+		for (i = 0; i < copy.attendees_nr; ++i)
+			if (copy_string(&copy.attendees[i].email,
+					src->attendees[i].email))
+				goto cleanup;
+	}
+
+	if ((src->alarms) && (src->alarms_nr)) {
+		copy.alarms = malloc(sizeof(struct gcal_event_alarms) *
+				     src->alarms_nr);
+		if (!copy.alarms)
+			goto cleanup;
+		memcpy(copy.alarms, src->alarms,
+		       sizeof(struct gcal_event_alarms) * src->alarms_nr);
+		copy.alarms_nr = src->alarms_nr;
+	}
+
+	/* Pending fields are decoded from the same feed */
+	gcal_lazy_share(&copy.common, &src->common);
+
+	gcal_destroy_entry(dest);
+	*dest = copy;
+	return 0;
+
+cleanup:
+	gcal_destroy_entry(&copy);
+	return result;
 }
 
 void gcal_destroy_entries(struct gcal_event *entries, size_t length)
@@ -1025,9 +1628,7 @@ int up_entry(char *data2post, unsigned int m_length,
 	     int expected_code)
 {
 	int result = -1;
-	int length = 0;
-	char *h_auth = NULL, *h_length = NULL, *tmp, *content;
-	const char header[] = "Content-length: ";
+	char *h_auth = NULL, *content;
 	int (*up_callback)(struct gcal_resource *, const char *,
 			   char *, char *, char *, char *,
 			   char *, unsigned int, const int,
@@ -1049,22 +1650,9 @@ int up_entry(char *data2post, unsigned int m_length,
 	/* Must cleanup HTTP buffer between requests */
 	clean_buffer(gcalobj);
 
-	/* Mounts content length and  authentication header strings */
-	length = m_length + strlen(header) + 1;
-	h_length = (char *) malloc(length) ;
-	if (!h_length)
+	/* Content length is set by curl (it can be compressed) */
+	if (!(h_auth = gcal_auth_header(gcalobj)))
 		goto exit;
-	strncpy(h_length, header, sizeof(header));
-	tmp = h_length + sizeof(header) - 1;
-	snprintf(tmp, length - (sizeof(header) + 1), "%d", m_length);
-
-
-	length = strlen(gcalobj->auth) + sizeof(HEADER_GET) + 1;
-	h_auth = (char *) malloc(length);
-	if (!h_auth)
-		goto exit;
-	snprintf(h_auth, length - 1, "%s%s", HEADER_GET, gcalobj->auth);
-
 
 	if (!content_type)
 		content = "Content-Type: application/atom+xml";
@@ -1076,9 +1664,9 @@ int up_entry(char *data2post, unsigned int m_length,
 		/* For contacts, there is *not* redirection. */
 		result = up_callback(gcalobj, url_server,
 				     content,
-				     h_length,
 				     h_auth,
 				     etag,
+				     NULL,
 				     data2post, m_length,
 				     expected_code,
 				     "GData-Version: 3.0");
@@ -1091,9 +1679,9 @@ int up_entry(char *data2post, unsigned int m_length,
 		/* For calendar, it *must* be redirection */
 		result = up_callback(gcalobj, url_server,
 				     content,
-				     h_length,
 				     h_auth,
 				     etag,
+				     NULL,
 				     data2post, m_length,
 				     GCAL_REDIRECT_ANSWER,
 				     "GData-Version: 2");
@@ -1124,18 +1712,18 @@ int up_entry(char *data2post, unsigned int m_length,
 	if (!(strcmp(gcalobj->service, "cp"))) {
 		result = up_callback(gcalobj, gcalobj->url,
 				"Content-Type: application/atom+xml",
-				h_length,
 				h_auth,
 				etag,
+				NULL,
 				data2post, m_length,
 				expected_code,
 				"GData-Version: 3.0");
 	} else if (!(strcmp(gcalobj->service, "cl"))) {
 		result = up_callback(gcalobj, gcalobj->url,
 				"Content-Type: application/atom+xml",
-				h_length,
 				h_auth,
 				etag,
+				NULL,
 				data2post, m_length,
 				expected_code,
 				"GData-Version: 2");
@@ -1147,20 +1735,80 @@ int up_entry(char *data2post, unsigned int m_length,
 			fprintf(gcalobj->fout_log,
 				"result = %s\n", gcalobj->buffer);
 			fprintf(gcalobj->fout_log,
-				"\nurl = %s\nh_length = %s\nh_auth = %s"
+				"\nurl = %s\nh_auth = %s"
 				"\ndata2post =%s%d\n",
-				gcalobj->url, h_length, h_auth, data2post,
+				gcalobj->url, h_auth, data2post,
 				m_length);
 		}
 		goto cleanup;
 	}
 
 cleanup:
+exit:
+	return result;
+}
 
-	if (h_length)
-		free(h_length);
-	if (h_auth)
-		free(h_auth);
+int up_file(int fd, struct gcal_resource *gcalobj,
+	    const char *url_server, char *etag,
+	    char *content_type, int expected_code)
+{
+	int result = -1;
+	char *h_auth = NULL;
+	const char *gdata_version, *url = url_server;
+	struct gcal_upload_file file;
+	struct stat info;
+
+	if ((fd < 0) || !gcalobj || !url_server)
+		goto exit;
+
+	if (!gcalobj->auth)
+		goto exit;
+
+	/* Only regular files: size must be known before sending */
+	if (fstat(fd, &info) || !S_ISREG(info.st_mode))
+		goto exit;
+	file.fd = fd;
+	file.length = info.st_size;
+
+	if (!(strcmp(gcalobj->service, "cp")))
+		gdata_version = "GData-Version: 3.0";
+	else if (!(strcmp(gcalobj->service, "cl")))
+		gdata_version = "GData-Version: 2";
+	else
+		goto exit;
+
+	if (!(h_auth = gcal_auth_header(gcalobj)))
+		goto exit;
+
+	if (!content_type)
+		content_type = "Content-Type: application/atom+xml";
+
+	/* For calendar, it can be redirection */
+	while (1) {
+		/* Must cleanup HTTP buffer between requests */
+		clean_buffer(gcalobj);
+		result = http_put_file(gcalobj, url, content_type, h_auth,
+				       etag, &file, expected_code,
+				       gdata_version);
+		if ((!result) || (url != url_server) ||
+		    (gcalobj->http_code != GCAL_REDIRECT_ANSWER))
+			break;
+
+		if (gcalobj->url) {
+			free(gcalobj->url);
+			gcalobj->url = NULL;
+		}
+
+		result = -1;
+		if (get_the_url(gcalobj->buffer, gcalobj->length,
+				&gcalobj->url))
+			break;
+		url = gcalobj->url;
+	}
+
+	if ((result == -1) && (gcalobj->fout_log))
+		fprintf(gcalobj->fout_log, "up_file: url = %s\nresult = %s\n",
+			url, gcalobj->buffer);
 
 exit:
 	return result;
@@ -1170,37 +1818,41 @@ int gcal_create_event(struct gcal_resource *gcalobj,
 		      struct gcal_event *entries,
 		      struct gcal_event *updated)
 {
-	int result = -1, length;
-	char *xml_entry = NULL;
+	int result = -1;
+	size_t length;
 
 	if ((!entries) || (!gcalobj))
 		return result;
 
-	result = xmlentry_create(entries, &xml_entry, &length);
+	if (gcal_lazy_event(entries, GCAL_F_ALL))
+		return result;
+
+	result = xmlentry_write(entries, &gcalobj->upload, &gcalobj->upload_size,
+				&length);
 	if (result == -1)
 		goto exit;
 
-	result = up_entry(xml_entry, strlen(xml_entry),
+	result = up_entry(gcalobj->upload, length,
 			  gcalobj, GCAL_EDIT_URL, NULL,
 			  POST, NULL, GCAL_EDIT_ANSWER);
 	if (result)
-		goto cleanup;
+		goto exit;
 
 	/* Copy raw XML */
 	if (gcalobj->store_xml_entry) {
 		if (entries->common.xml)
 			free(entries->common.xml);
 		if (!(entries->common.xml = strdup(gcalobj->buffer)))
-			goto cleanup;
+			goto exit;
 	}
 
 	/* Parse buffer and create the new contact object */
 	if (!updated)
-		goto cleanup;
+		goto exit;
 	result = -2;
 	gcalobj->document = build_dom_document(gcalobj->buffer);
 	if (!gcalobj->document)
-		goto cleanup;
+		goto exit;
 
 	/* There is only one 'entry' in the buffer */
 	result = extract_all_entries(gcalobj->document, updated, 1);
@@ -1213,10 +1865,6 @@ xmlclean:
 	clean_dom_document(gcalobj->document);
 	gcalobj->document = NULL;
 
-cleanup:
-	if (xml_entry)
-		free(xml_entry);
-
 exit:
 	return result;
 }
@@ -1224,20 +1872,20 @@ exit:
 int gcal_delete_event(struct gcal_resource *gcalobj,
 		      struct gcal_event *entry)
 {
-	int result = -1, length;
+	int result = -1;
 	char *h_auth;
 
 	if ((!entry) || (!gcalobj) || (!gcalobj->auth))
 		goto exit;
 
+	if (gcal_lazy_event(entry, GCAL_F_EDIT_URI))
+		goto exit;
+
 	/* Must cleanup HTTP buffer between requests */
 	clean_buffer(gcalobj);
 
-	length = strlen(gcalobj->auth) + sizeof(HEADER_GET) + 1;
-	h_auth = (char *) malloc(length);
-	if (!h_auth)
+	if (!(h_auth = gcal_auth_header(gcalobj)))
 		goto exit;
-	snprintf(h_auth, length - 1, "%s%s", HEADER_GET, gcalobj->auth);
 
 	curl_easy_setopt(gcalobj->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
 	result = http_post(gcalobj, entry->common.edit_uri,
@@ -1279,9 +1927,6 @@ cleanup:
 	/* Restores curl context to previous standard mode */
 	curl_easy_setopt(gcalobj->curl, CURLOPT_CUSTOMREQUEST, NULL);
 
-	if (h_auth)
-		free(h_auth);
-
 exit:
 
 	return result;
@@ -1293,39 +1938,43 @@ int gcal_edit_event(struct gcal_resource *gcalobj,
 		    struct gcal_event *updated)
 {
 
-	int result = -1, length;
-	char *xml_entry = NULL;
+	int result = -1;
+	size_t length;
 
 	if ((!entry) || (!gcalobj))
 		goto exit;
 
-	result = xmlentry_create(entry, &xml_entry, &length);
+	if (gcal_lazy_event(entry, GCAL_F_ALL))
+		goto exit;
+
+	result = xmlentry_write(entry, &gcalobj->upload, &gcalobj->upload_size,
+				&length);
 	if (result == -1)
 		goto exit;
 
-	result = up_entry(xml_entry, strlen(xml_entry),
+	result = up_entry(gcalobj->upload, length,
 			  gcalobj, entry->common.edit_uri,
 			  /* Google Data API 2.0 requires ETag */
 			  "If-Match: *",
 			  PUT, NULL, GCAL_DEFAULT_ANSWER);
 	if (result)
-		goto cleanup;
+		goto exit;
 
 	/* Copy raw XML */
 	if (gcalobj->store_xml_entry) {
 		if (entry->common.xml)
 			free(entry->common.xml);
 		if (!(entry->common.xml = strdup(gcalobj->buffer)))
-			goto cleanup;
+			goto exit;
 	}
 
 	/* Parse buffer and create the new contact object */
 	if (!updated)
-		goto cleanup;
+		goto exit;
 	result = -2;
 	gcalobj->document = build_dom_document(gcalobj->buffer);
 	if (!gcalobj->document)
-		goto cleanup;
+		goto exit;
 
 	/* There is only one 'entry' in the buffer */
 	result = extract_all_entries(gcalobj->document, updated, 1);
@@ -1338,10 +1987,6 @@ xmlclean:
 	clean_dom_document(gcalobj->document);
 	gcalobj->document = NULL;
 
-cleanup:
-	if (xml_entry)
-		free(xml_entry);
-
 exit:
 	return result;
 }
@@ -1556,6 +2201,270 @@ void gcal_set_store_xml(struct gcal_resource *gcalobj, char flag)
 	gcalobj->store_xml_entry = flag;
 }
 
+void gcal_set_lazy_photo(struct gcal_resource *gcalobj, char flag)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->lazy_photo = flag;
+}
+
+int gcal_set_photo_cache(struct gcal_resource *gcalobj, const char *path)
+{
+	char *tmp = NULL;
+
+	if ((!gcalobj))
+		return -1;
+
+	if (path)
+		if (!(tmp = strdup(path)))
+			return -1;
+
+	if (gcalobj->photo_cache)
+		free(gcalobj->photo_cache);
+	gcalobj->photo_cache = tmp;
+
+	return 0;
+}
+
+int gcal_set_response_cache(struct gcal_resource *gcalobj, char flag,
+			    int ttl, const char *path)
+{
+	struct gcal_cache *cache = NULL;
+
+	if ((!gcalobj))
+		return -1;
+
+	if (flag)
+		if (!(cache = gcal_cache_new(ttl, path)))
+			return -1;
+
+	if (gcalobj->cache)
+		gcal_cache_delete(gcalobj->cache);
+	gcalobj->cache = cache;
+
+	return set_account(gcalobj);
+}
+
+/* Entry functions used by the parse cache */
+static void init_event(void *entry)
+{
+	gcal_init_event((struct gcal_event *)entry);
+}
+
+static int copy_event(void *dest, const void *src)
+{
+	return gcal_copy_entry((struct gcal_event *)dest,
+			       (const struct gcal_event *)src);
+}
+
+static void destroy_event(void *entry)
+{
+	gcal_destroy_entry((struct gcal_event *)entry);
+}
+
+static void init_contact(void *entry)
+{
+	gcal_init_contact((struct gcal_contact *)entry);
+}
+
+static int copy_contact(void *dest, const void *src)
+{
+	return gcal_copy_contact((struct gcal_contact *)dest,
+				 (const struct gcal_contact *)src);
+}
+
+static void destroy_contact(void *entry)
+{
+	gcal_destroy_contact((struct gcal_contact *)entry);
+}
+
+int gcal_set_parse_cache(struct gcal_resource *gcalobj, char flag)
+{
+	struct gcal_entries_cache *cache = NULL;
+
+	if ((!gcalobj))
+		return -1;
+
+	if (flag) {
+		if (!(strcmp(gcalobj->service, "cl")))
+			cache = gcal_entries_cache_new(sizeof(struct gcal_event),
+						       init_event, copy_event,
+						       destroy_event);
+		else if (!(strcmp(gcalobj->service, "cp")))
+			cache = gcal_entries_cache_new(
+				sizeof(struct gcal_contact), init_contact,
+				copy_contact, destroy_contact);
+		if (!cache)
+			return -1;
+	}
+
+	if (gcalobj->entries_cache)
+		gcal_entries_cache_delete(gcalobj->entries_cache);
+	gcalobj->entries_cache = cache;
+
+	return 0;
+}
+
+void gcal_set_max_transfers(struct gcal_resource *gcalobj, int transfers)
+{
+	if ((!gcalobj))
+		return;
+
+	if (transfers < 1)
+		transfers = 1;
+
+	gcalobj->max_transfers = transfers;
+}
+
+void gcal_set_retry(struct gcal_resource *gcalobj, int retries, int delay,
+		    int max_delay)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->policy.retries = retries < 0 ? 0 : retries;
+	gcalobj->policy.delay = delay < 1 ? 1 : delay;
+	gcalobj->policy.max_delay = max_delay < gcalobj->policy.delay ?
+		gcalobj->policy.delay : max_delay;
+	gcalobj->policy.seed = (unsigned int)time(NULL) ^
+		(unsigned int)(size_t)gcalobj;
+}
+
+void gcal_set_rate_limit(struct gcal_resource *gcalobj, double rate,
+			 int burst)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->policy.rate = rate < 0 ? 0 : rate;
+	gcalobj->policy.burst = burst < 1 ? 1 : burst;
+	/* Starts with a full bucket */
+	gcalobj->policy.tokens = gcalobj->policy.burst;
+	gcalobj->policy.last = 0;
+}
+
+void gcal_set_timeout(struct gcal_resource *gcalobj, long timeout,
+		      long low_speed, long low_speed_time)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->policy.timeout = timeout < 0 ? 0 : timeout;
+
+	if ((low_speed <= 0) || (low_speed_time <= 0))
+		low_speed = low_speed_time = 0;
+	curl_easy_setopt(gcalobj->curl, CURLOPT_LOW_SPEED_LIMIT, low_speed);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_LOW_SPEED_TIME,
+			 low_speed_time);
+}
+
+void gcal_set_hedging(struct gcal_resource *gcalobj, int percentile,
+		      int delay)
+{
+	if ((!gcalobj))
+		return;
+
+	if (percentile < 0)
+		percentile = 0;
+	else if (percentile > 100)
+		percentile = 100;
+
+	gcalobj->hedge.percentile = percentile;
+	gcalobj->hedge.delay = delay < 1 ? 1 : delay;
+}
+
+void gcal_set_single_flight(struct gcal_resource *gcalobj, char flag)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->single_flight = flag ? 1 : 0;
+}
+
+void gcal_set_compression(struct gcal_resource *gcalobj, char download,
+			  int upload)
+{
+	if ((!gcalobj))
+		return;
+
+	/* Empty string asks for all encodings supported by curl */
+	curl_easy_setopt(gcalobj->curl, CURLOPT_ACCEPT_ENCODING,
+			 download ? "" : NULL);
+	gcalobj->gzip_upload = upload > 0 ? upload : 0;
+}
+
+void gcal_set_json(struct gcal_resource *gcalobj, char flag)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->json = flag ? 1 : 0;
+}
+
+void gcal_set_field_mask(struct gcal_resource *gcalobj, unsigned int mask)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->field_mask = mask & GCAL_F_ALL;
+}
+
+void gcal_set_lazy_fields(struct gcal_resource *gcalobj, char flag)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->lazy_fields = flag ? 1 : 0;
+}
+
+void gcal_set_stream_queue(struct gcal_resource *gcalobj, size_t length)
+{
+	if ((!gcalobj))
+		return;
+
+	gcalobj->stream_queue = length ? length : 1;
+}
+
+int gcal_set_fields(struct gcal_resource *gcalobj, const char *fields)
+{
+	int result = -1;
+	if ((!gcalobj))
+		goto exit;
+
+	if (gcalobj->fields)
+		curl_free(gcalobj->fields);
+	gcalobj->fields = NULL;
+
+	/* Selector has reserved characters (e.g. '/', '@' and '(') */
+	if ((!fields) || (!fields[0]) ||
+	    (gcalobj->fields = curl_easy_escape(gcalobj->curl, fields, 0)))
+		result = 0;
+
+	/* Parsed entries have other fields now */
+	if ((!result) && (gcalobj->entries_cache))
+		result = gcal_set_parse_cache(gcalobj, 1);
+
+exit:
+	return result;
+}
+
+void gcal_cancel(gcal_t gcalobj)
+{
+	if ((!gcalobj))
+		return;
+
+	__atomic_store_n(&gcalobj->canceled, 1, __ATOMIC_SEQ_CST);
+}
+
+void gcal_cancel_reset(gcal_t gcalobj)
+{
+	if ((!gcalobj))
+		return;
+
+	__atomic_store_n(&gcalobj->canceled, 0, __ATOMIC_SEQ_CST);
+}
+
 void gcal_set_proxy(struct gcal_resource *gcalobj, char *proxy)
 {
 	if ((!gcalobj) || (!proxy)) {
@@ -0,0 +1,664 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_cache.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Cache of downloaded pages (feeds, photos).
+ *
+ * Pages are kept in a list, most recently used first. Pages saved in disk
+ * have one file each: the header has the cache key (account, URL and GData
+ * version) and ETag, one by line, and the file modification time is when
+ * the page was last validated.
+ *
+ * Parsed entries are kept in a hash table (by entry id).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "internal_gcal.h"
+#include "gcal_cache.h"
+
+struct gcal_cache_entry {
+	/** Account, URL and GData version (one by line) */
+	char *key;
+	/** Page ETag (can be NULL) */
+	char *etag;
+	/** Page data */
+	char *data;
+	/** Data length */
+	size_t length;
+	/** When the page was downloaded or last validated */
+	time_t stored;
+	/** Next page */
+	struct gcal_cache_entry *next;
+};
+
+/** A parsed entry */
+struct gcal_entries_node {
+	/** Entry (event or contact) */
+	void *entry;
+	/** Next entry in the same bucket */
+	struct gcal_entries_node *next;
+};
+
+struct gcal_entries_cache {
+	/** Hash table buckets */
+	struct gcal_entries_node **buckets;
+	/** Number of buckets */
+	size_t size;
+	/** Number of entries */
+	size_t count;
+	/** Size of an entry */
+	size_t entry_size;
+	/** Entry functions */
+	gcal_entry_cb init;
+	gcal_copy_cb copy;
+	gcal_entry_cb destroy;
+};
+
+struct gcal_cache {
+	/** Cached pages */
+	struct gcal_cache_entry *entries;
+	/** Number of pages */
+	size_t count;
+	/** Time to live (in seconds) */
+	int ttl;
+	/** Pages stored before it are stale, see \ref gcal_cache_expire */
+	time_t expired;
+	/** Directory to save pages (can be NULL) */
+	char *path;
+	/** Account owning the pages, see \ref gcal_cache_account */
+	char *account;
+};
+
+/* FNV-1a hash */
+static unsigned long long hash_key(const char *key)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+
+	for (; *key; ++key) {
+		hash ^= (unsigned char)*key;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static void destroy_entry(struct gcal_cache_entry *entry)
+{
+	if (entry->key)
+		free(entry->key);
+	if (entry->etag)
+		free(entry->etag);
+	if (entry->data)
+		free(entry->data);
+	free(entry);
+}
+
+/* Feed URLs (e.g. 'default/private/full') don't always tell the account */
+static char *mount_key(struct gcal_cache *cache, const char *url,
+		       const char *gdata_version)
+{
+	const char *account = cache->account ? cache->account : "";
+	size_t length;
+	char *key;
+
+	length = strlen(account) + strlen(url) + strlen(gdata_version) + 3;
+	if ((key = malloc(length)))
+		snprintf(key, length, "%s\n%s\n%s", account, url,
+			 gdata_version);
+
+	return key;
+}
+
+/* Keeps at most GCAL_CACHE_ENTRIES, dropping the least recently used */
+static void insert_entry(struct gcal_cache *cache,
+			 struct gcal_cache_entry *entry)
+{
+	struct gcal_cache_entry *ptr;
+
+	entry->next = cache->entries;
+	cache->entries = entry;
+	if (++cache->count <= GCAL_CACHE_ENTRIES)
+		return;
+
+	for (ptr = cache->entries; ptr->next->next; ptr = ptr->next)
+		;
+	destroy_entry(ptr->next);
+	ptr->next = NULL;
+	--cache->count;
+}
+
+static struct gcal_cache_entry *load_entry(struct gcal_cache *cache,
+					   const char *key)
+{
+	struct gcal_cache_entry *entry = NULL;
+	char *path, *line = NULL;
+	size_t size = 0, length;
+	ssize_t read;
+	struct stat info;
+	FILE *file = NULL;
+
+	if (!(path = gcal_cache_path(cache->path, key)))
+		goto exit;
+	if (!(file = fopen(path, "rb")))
+		goto cleanup;
+
+	/* Key has 3 lines, all must match (or it is a hash collision) */
+	length = strlen(key) + 1;
+	if (!(line = malloc(length + 1)))
+		goto cleanup;
+	if ((fread(line, 1, length, file) != length) ||
+	    (strncmp(line, key, length - 1)) || (line[length - 1] != '\n'))
+		goto cleanup;
+
+	if (!(entry = malloc(sizeof(struct gcal_cache_entry))))
+		goto cleanup;
+	memset(entry, 0, sizeof(struct gcal_cache_entry));
+
+	/* ETag line (empty if there is no ETag) */
+	free(line);
+	line = NULL;
+	if ((read = getline(&line, &size, file)) < 1)
+		goto error;
+	line[read - 1] = '\0';
+	if ((line[0]) && (!(entry->etag = strdup(line))))
+		goto error;
+
+	if (fstat(fileno(file), &info))
+		goto error;
+	length = info.st_size - ftell(file);
+	if (!(entry->data = malloc(length + 1)))
+		goto error;
+	if (fread(entry->data, 1, length, file) != length)
+		goto error;
+	entry->data[length] = '\0';
+	entry->length = length;
+	entry->stored = info.st_mtime;
+	if (!(entry->key = strdup(key)))
+		goto error;
+
+	insert_entry(cache, entry);
+	goto cleanup;
+
+error:
+	destroy_entry(entry);
+	entry = NULL;
+
+cleanup:
+	if (line)
+		free(line);
+	if (file)
+		fclose(file);
+	free(path);
+
+exit:
+	return entry;
+}
+
+struct gcal_cache *gcal_cache_new(int ttl, const char *path)
+{
+	struct gcal_cache *cache;
+
+	if (!(cache = malloc(sizeof(struct gcal_cache))))
+		return NULL;
+
+	cache->entries = NULL;
+	cache->count = 0;
+	cache->ttl = ttl < 0 ? 0 : ttl;
+	cache->expired = 0;
+	cache->path = NULL;
+	cache->account = NULL;
+	if (path)
+		if (!(cache->path = strdup(path))) {
+			free(cache);
+			cache = NULL;
+		}
+
+	return cache;
+}
+
+void gcal_cache_delete(struct gcal_cache *cache)
+{
+	struct gcal_cache_entry *entry;
+
+	if (!cache)
+		return;
+
+	while ((entry = cache->entries)) {
+		cache->entries = entry->next;
+		destroy_entry(entry);
+	}
+
+	if (cache->path)
+		free(cache->path);
+	if (cache->account)
+		free(cache->account);
+	free(cache);
+}
+
+int gcal_cache_account(struct gcal_cache *cache, const char *account)
+{
+	struct gcal_cache_entry *entry;
+	char *tmp = NULL;
+
+	if (!cache)
+		return -1;
+
+	if (account)
+		if (!(tmp = strdup(account)))
+			return -1;
+
+	while ((entry = cache->entries)) {
+		cache->entries = entry->next;
+		destroy_entry(entry);
+	}
+	cache->count = 0;
+
+	if (cache->account)
+		free(cache->account);
+	cache->account = tmp;
+
+	return 0;
+}
+
+struct gcal_cache_entry *gcal_cache_find(struct gcal_cache *cache,
+					 const char *url,
+					 const char *gdata_version)
+{
+	struct gcal_cache_entry *entry = NULL, *previous = NULL;
+	char *key;
+
+	if ((!cache) || (!url) || (!gdata_version))
+		return NULL;
+
+	if (!(key = mount_key(cache, url, gdata_version)))
+		return NULL;
+
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if (!strcmp(entry->key, key))
+			break;
+		previous = entry;
+	}
+
+	/* Move to the head of list (i.e. most recently used) */
+	if ((entry) && (previous)) {
+		previous->next = entry->next;
+		entry->next = cache->entries;
+		cache->entries = entry;
+	}
+
+	if ((!entry) && (cache->path))
+		entry = load_entry(cache, key);
+
+	free(key);
+	return entry;
+}
+
+int gcal_cache_fresh(struct gcal_cache *cache, struct gcal_cache_entry *entry)
+{
+	if ((!cache) || (!entry) || (!cache->ttl))
+		return 0;
+
+	if (entry->stored <= cache->expired)
+		return 0;
+
+	return (time(NULL) - entry->stored) < cache->ttl;
+}
+
+const char *gcal_cache_etag(struct gcal_cache_entry *entry)
+{
+	if (!entry)
+		return NULL;
+
+	return entry->etag;
+}
+
+int gcal_cache_restore(struct gcal_cache_entry *entry,
+		       struct gcal_resource *gcalobj)
+{
+	char *ptr_tmp;
+
+	if ((!entry) || (!gcalobj))
+		return -1;
+
+	if (gcalobj->length < entry->length + 1) {
+		ptr_tmp = realloc(gcalobj->buffer, entry->length + 1);
+		if (!ptr_tmp)
+			return -1;
+		gcalobj->buffer = ptr_tmp;
+		gcalobj->length = entry->length + 1;
+	}
+
+	clean_buffer(gcalobj);
+	memcpy(gcalobj->buffer, entry->data, entry->length);
+	gcalobj->previous_length = entry->length;
+	gcalobj->http_code = GCAL_DEFAULT_ANSWER;
+
+	return 0;
+}
+
+void gcal_cache_touch(struct gcal_cache *cache, struct gcal_cache_entry *entry)
+{
+	char *path;
+
+	if ((!cache) || (!entry))
+		return;
+
+	entry->stored = time(NULL);
+
+	if (cache->path)
+		if ((path = gcal_cache_path(cache->path, entry->key))) {
+			utime(path, NULL);
+			free(path);
+		}
+}
+
+int gcal_cache_store(struct gcal_cache *cache, const char *url,
+		     const char *gdata_version, const char *etag,
+		     const char *data, size_t length)
+{
+	int result = -1;
+	struct gcal_cache_entry *entry;
+	char *path, *header;
+	size_t size;
+
+	if ((!cache) || (!url) || (!gdata_version) || (!data))
+		goto exit;
+
+	if (!(entry = malloc(sizeof(struct gcal_cache_entry))))
+		goto exit;
+	memset(entry, 0, sizeof(struct gcal_cache_entry));
+
+	if (!(entry->key = mount_key(cache, url, gdata_version)))
+		goto error;
+	if (etag)
+		if (!(entry->etag = strdup(etag)))
+			goto error;
+	if (!(entry->data = malloc(length + 1)))
+		goto error;
+	memcpy(entry->data, data, length);
+	entry->data[length] = '\0';
+	entry->length = length;
+	entry->stored = time(NULL);
+
+	/* An older copy of the page is replaced */
+	if (gcal_cache_find(cache, url, gdata_version)) {
+		entry->next = cache->entries->next;
+		destroy_entry(cache->entries);
+		cache->entries = entry;
+	} else
+		insert_entry(cache, entry);
+	result = 0;
+
+	if (!cache->path)
+		goto exit;
+
+	size = strlen(entry->key) + (etag ? strlen(etag) : 0) + 3;
+	if (!(header = malloc(size)))
+		goto exit;
+	snprintf(header, size, "%s\n%s\n", entry->key, etag ? etag : "");
+	if ((path = gcal_cache_path(cache->path, entry->key))) {
+		/* Disk is optional, memory cache is still good */
+		gcal_cache_save(path, header, data, length);
+		free(path);
+	}
+	free(header);
+	goto exit;
+
+error:
+	destroy_entry(entry);
+
+exit:
+	return result;
+}
+
+void gcal_cache_expire(struct gcal_cache *cache)
+{
+	if (cache)
+		cache->expired = time(NULL);
+}
+
+char *gcal_cache_path(const char *dir, const char *key)
+{
+	size_t length;
+	char *path;
+
+	if ((!dir) || (!key))
+		return NULL;
+
+	length = strlen(dir) + sizeof("/0123456789abcdef");
+	if ((path = malloc(length)))
+		snprintf(path, length, "%s/%016llx", dir, hash_key(key));
+
+	return path;
+}
+
+int gcal_cache_save(const char *path, const char *header,
+		    const char *data, size_t length)
+{
+	int fd, result = -1;
+	char *tmp;
+	FILE *file;
+
+	if ((!path) || (!header) || (!data))
+		return result;
+
+	if (!(tmp = malloc(strlen(path) + sizeof(".XXXXXX"))))
+		return result;
+	sprintf(tmp, "%s.XXXXXX", path);
+
+	if ((fd = mkstemp(tmp)) == -1)
+		goto exit;
+	if (!(file = fdopen(fd, "wb"))) {
+		close(fd);
+		goto cleanup;
+	}
+
+	if ((fwrite(header, 1, strlen(header), file) == strlen(header)) &&
+	    (fwrite(data, 1, length, file) == length))
+		result = 0;
+	if (fclose(file))
+		result = -1;
+
+	if (!result)
+		result = rename(tmp, path);
+
+cleanup:
+	if (result)
+		unlink(tmp);
+
+exit:
+	free(tmp);
+	return result;
+}
+
+struct gcal_entries_cache *gcal_entries_cache_new(size_t size,
+						  gcal_entry_cb init,
+						  gcal_copy_cb copy,
+						  gcal_entry_cb destroy)
+{
+	struct gcal_entries_cache *cache;
+
+	if ((!size) || (!init) || (!copy) || (!destroy))
+		return NULL;
+
+	if (!(cache = malloc(sizeof(struct gcal_entries_cache))))
+		return NULL;
+
+	cache->size = 64;
+	cache->count = 0;
+	cache->entry_size = size;
+	cache->init = init;
+	cache->copy = copy;
+	cache->destroy = destroy;
+	cache->buckets = malloc(sizeof(struct gcal_entries_node *) *
+				cache->size);
+	if (!cache->buckets) {
+		free(cache);
+		return NULL;
+	}
+	memset(cache->buckets, 0, sizeof(struct gcal_entries_node *) *
+	       cache->size);
+
+	return cache;
+}
+
+void gcal_entries_cache_delete(struct gcal_entries_cache *cache)
+{
+	struct gcal_entries_node *node;
+	size_t i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->size; ++i)
+		while ((node = cache->buckets[i])) {
+			cache->buckets[i] = node->next;
+			cache->destroy(node->entry);
+			free(node->entry);
+			free(node);
+		}
+
+	free(cache->buckets);
+	free(cache);
+}
+
+static struct gcal_entries_node *find_node(struct gcal_entries_cache *cache,
+					   const char *id)
+{
+	struct gcal_entries_node *node;
+
+	node = cache->buckets[hash_key(id) % cache->size];
+	for (; node; node = node->next)
+		if (!strcmp(((struct gcal_entry *)node->entry)->id, id))
+			break;
+
+	return node;
+}
+
+/* Doubles the number of buckets, keeping at most 2 entries by bucket */
+static void grow_table(struct gcal_entries_cache *cache)
+{
+	struct gcal_entries_node **buckets, *node;
+	size_t i, size = cache->size * 2, index;
+
+	if (!(buckets = malloc(sizeof(struct gcal_entries_node *) * size)))
+		return;
+	memset(buckets, 0, sizeof(struct gcal_entries_node *) * size);
+
+	for (i = 0; i < cache->size; ++i)
+		while ((node = cache->buckets[i])) {
+			cache->buckets[i] = node->next;
+			index = hash_key(((struct gcal_entry *)node->entry)->id) %
+				size;
+			node->next = buckets[index];
+			buckets[index] = node;
+		}
+
+	free(cache->buckets);
+	cache->buckets = buckets;
+	cache->size = size;
+}
+
+int gcal_entries_cache_get(struct gcal_entries_cache *cache, const char *id,
+			   const char *etag, void *entry)
+{
+	struct gcal_entries_node *node;
+	struct gcal_entry *cached;
+
+	if ((!cache) || (!id) || (!etag) || (!entry))
+		return -1;
+
+	if (!(node = find_node(cache, id)))
+		return -1;
+
+	cached = (struct gcal_entry *)node->entry;
+	if ((!cached->etag) || (strcmp(cached->etag, etag)) ||
+	    (cached->store_xml != ((struct gcal_entry *)entry)->store_xml) ||
+	    (cached->field_mask != ((struct gcal_entry *)entry)->field_mask))
+		return -1;
+
+	return cache->copy(entry, node->entry);
+}
+
+int gcal_entries_cache_put(struct gcal_entries_cache *cache,
+			   const void *entry)
+{
+	const struct gcal_entry *common = (const struct gcal_entry *)entry;
+	struct gcal_entries_node *node;
+	void *copy;
+	size_t index;
+
+	if ((!cache) || (!entry) || (!common->id) || (!common->etag))
+		return -1;
+
+	/* Updated entry */
+	if ((node = find_node(cache, common->id)))
+		return cache->copy(node->entry, entry);
+
+	if (!(copy = malloc(cache->entry_size)))
+		return -1;
+	memset(copy, 0, cache->entry_size);
+	cache->init(copy);
+	if (cache->copy(copy, entry)) {
+		cache->destroy(copy);
+		free(copy);
+		return -1;
+	}
+
+	if (!(node = malloc(sizeof(struct gcal_entries_node)))) {
+		cache->destroy(copy);
+		free(copy);
+		return -1;
+	}
+
+	index = hash_key(common->id) % cache->size;
+	node->entry = copy;
+	node->next = cache->buckets[index];
+	cache->buckets[index] = node;
+
+	if (++cache->count > cache->size * 2)
+		grow_table(cache);
+
+	return 0;
+}
@@ -0,0 +1,346 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_flight.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Single flight downloads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "internal_gcal.h"
+#include "gcal_flight.h"
+#include "gcal_status.h"
+
+/** A running request, shared by all objects asking for the same page */
+struct gcal_flight {
+	/** Authorization, GData version, write callback and URL */
+	char *key;
+	/** Number of objects using it */
+	int refs;
+	/** If the request is finished */
+	char done;
+	/** Fetch result */
+	int result;
+	/** Answer (NULL if it can't be shared) */
+	char *buffer;
+	/** Answer length */
+	size_t length;
+	/** Value of previous_length (binary data) */
+	size_t previous_length;
+	/** HTTP code */
+	long http_code;
+	/** Curl error message */
+	char *curl_msg;
+	/** Answer ETag */
+	char *etag;
+	/** Redirected URL (google calendar) */
+	char *url;
+	/** Signaled when the request is finished */
+	pthread_cond_t finished;
+	/** Next running request */
+	struct gcal_flight *next;
+};
+
+/* Running requests, protected by the lock */
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct gcal_flight *flights = NULL;
+
+/** How often a waiting object checks if it was canceled (miliseconds) */
+#define FLIGHT_POLL 100
+
+static char *strdup_null(const char *str)
+{
+	return str ? strdup(str) : NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Deadline of the object (0 if none): the one running or, if the request
+ * wasn't started yet, the one it would get.
+ */
+static double flight_deadline(struct gcal_resource *gcalobj)
+{
+	if (gcalobj->policy.deadline)
+		return gcalobj->policy.deadline;
+	if (gcalobj->policy.timeout)
+		return now() + gcalobj->policy.timeout / 1000.0;
+
+	return 0;
+}
+
+/* Waits for the request to finish, must be called with the lock. Returns 0
+ * if finished, 1 if the object was canceled and 2 if its deadline passed.
+ */
+static int flight_wait(struct gcal_flight *flight,
+		       struct gcal_resource *gcalobj)
+{
+	struct timespec ts;
+	double deadline, until;
+
+	deadline = flight_deadline(gcalobj);
+	while (!flight->done) {
+		if (__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST))
+			return 1;
+
+		/* A cancel doesn't signal the condition, so wake up often */
+		until = now() + FLIGHT_POLL / 1000.0;
+		if (deadline) {
+			if (now() >= deadline)
+				return 2;
+			if (until > deadline)
+				until = deadline;
+		}
+		ts.tv_sec = (time_t)until;
+		ts.tv_nsec = (long)((until - ts.tv_sec) * 1e9);
+		pthread_cond_timedwait(&flight->finished, &flights_lock, &ts);
+	}
+
+	return 0;
+}
+
+/* The write callback decides what ends up in the buffer (e.g. text or
+ * binary), so it is part of the key.
+ */
+static char *flight_key(struct gcal_resource *gcalobj, const char *url,
+			void *cb_download, const char *gdata_version)
+{
+	char *key;
+	size_t length;
+
+	length = strlen(gcalobj->auth) + strlen(gdata_version) +
+		strlen(url) + 2 * sizeof(void *) + 7;
+	if ((key = malloc(length)))
+		snprintf(key, length, "%s\n%s\n%" PRIxPTR "\n%s",
+			 gcalobj->auth, gdata_version,
+			 (uintptr_t)cb_download, url);
+
+	return key;
+}
+
+static struct gcal_flight *flight_find(const char *key)
+{
+	struct gcal_flight *flight;
+
+	for (flight = flights; flight; flight = flight->next)
+		if (!strcmp(flight->key, key))
+			break;
+
+	return flight;
+}
+
+static void flight_remove(struct gcal_flight *flight)
+{
+	struct gcal_flight **ptr;
+
+	for (ptr = &flights; *ptr; ptr = &(*ptr)->next)
+		if (*ptr == flight) {
+			*ptr = flight->next;
+			break;
+		}
+}
+
+/* Must be called with the lock */
+static void flight_unref(struct gcal_flight *flight)
+{
+	if (--flight->refs)
+		return;
+
+	pthread_cond_destroy(&flight->finished);
+	free(flight->key);
+	if (flight->buffer)
+		free(flight->buffer);
+	if (flight->curl_msg)
+		free(flight->curl_msg);
+	if (flight->etag)
+		free(flight->etag);
+	if (flight->url)
+		free(flight->url);
+	free(flight);
+}
+
+/* Keeps the answer of the object that sent the request */
+static void flight_keep(struct gcal_flight *flight,
+			struct gcal_resource *gcalobj, int result)
+{
+	flight->result = result;
+	flight->done = 1;
+
+	/* An interrupted request is not an answer to the others */
+	if (gcalobj->internal_status != GCAL_INTERRUPT_NONE)
+		return;
+
+	/* Text pages don't update previous length */
+	flight->previous_length = gcalobj->previous_length;
+	flight->length = gcalobj->previous_length;
+	if (!flight->length)
+		flight->length = strlen(gcalobj->buffer);
+
+	if (!(flight->buffer = malloc(flight->length + 1)))
+		return;
+	memcpy(flight->buffer, gcalobj->buffer, flight->length);
+	flight->buffer[flight->length] = '\0';
+
+	flight->http_code = gcalobj->http_code;
+	flight->curl_msg = strdup_null(gcalobj->curl_msg);
+	flight->etag = strdup_null(gcalobj->etag);
+	flight->url = strdup_null(gcalobj->url);
+}
+
+/* Copies the shared answer, returns -1 if there is no answer to share */
+static int flight_copy(struct gcal_flight *flight,
+		       struct gcal_resource *gcalobj)
+{
+	char *buffer;
+
+	if (!flight->buffer)
+		return -1;
+
+	if (gcalobj->length < flight->length + 1) {
+		if (!(buffer = realloc(gcalobj->buffer, flight->length + 1)))
+			return -1;
+		gcalobj->buffer = buffer;
+		gcalobj->length = flight->length + 1;
+	}
+	memset(gcalobj->buffer, 0, gcalobj->length);
+	memcpy(gcalobj->buffer, flight->buffer, flight->length);
+	gcalobj->previous_length = flight->previous_length;
+	gcalobj->http_code = flight->http_code;
+	gcalobj->internal_status = GCAL_INTERRUPT_NONE;
+
+	if (gcalobj->curl_msg)
+		free(gcalobj->curl_msg);
+	gcalobj->curl_msg = strdup_null(flight->curl_msg);
+	if (gcalobj->etag)
+		free(gcalobj->etag);
+	gcalobj->etag = strdup_null(flight->etag);
+	if (flight->url) {
+		if (gcalobj->url)
+			free(gcalobj->url);
+		gcalobj->url = strdup(flight->url);
+	}
+
+	return 0;
+}
+
+int gcal_flight_get(struct gcal_resource *gcalobj, const char *url,
+		    void *cb_download, const char *gdata_version,
+		    gcal_fetch_cb fetch)
+{
+	struct gcal_flight *flight;
+	pthread_condattr_t attr;
+	char *key;
+	int result;
+
+	if ((!gcalobj) || (!gcalobj->auth) || (!url) || (!gdata_version))
+		goto alone;
+
+	if (!(key = flight_key(gcalobj, url, cb_download, gdata_version)))
+		goto alone;
+
+	pthread_mutex_lock(&flights_lock);
+	if ((flight = flight_find(key))) {
+		free(key);
+		++flight->refs;
+		switch (flight_wait(flight, gcalobj)) {
+		case 1:
+			flight_unref(flight);
+			pthread_mutex_unlock(&flights_lock);
+			__atomic_store_n(&gcalobj->canceled, 0,
+					 __ATOMIC_SEQ_CST);
+			gcalobj->internal_status = GCAL_INTERRUPT_CANCEL;
+			clean_buffer(gcalobj);
+			return -1;
+		case 2:
+			/* Request is stuck, try on our own */
+			flight_unref(flight);
+			pthread_mutex_unlock(&flights_lock);
+			goto alone;
+		}
+
+		result = flight->result;
+		if (flight_copy(flight, gcalobj))
+			result = -2;
+		flight_unref(flight);
+		pthread_mutex_unlock(&flights_lock);
+
+		if (result != -2)
+			return result;
+		goto alone;
+	}
+
+	if (!(flight = calloc(1, sizeof(struct gcal_flight)))) {
+		pthread_mutex_unlock(&flights_lock);
+		free(key);
+		goto alone;
+	}
+	flight->key = key;
+	flight->refs = 1;
+	/* Same clock as the deadlines */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&flight->finished, &attr);
+	pthread_condattr_destroy(&attr);
+	flight->next = flights;
+	flights = flight;
+	pthread_mutex_unlock(&flights_lock);
+
+	result = fetch(gcalobj, url, cb_download, gdata_version);
+
+	pthread_mutex_lock(&flights_lock);
+	flight_keep(flight, gcalobj, result);
+	/* New requests for this page will be sent again */
+	flight_remove(flight);
+	pthread_cond_broadcast(&flight->finished);
+	flight_unref(flight);
+	pthread_mutex_unlock(&flights_lock);
+
+	return result;
+
+alone:
+	return fetch(gcalobj, url, cb_download, gdata_version);
+}
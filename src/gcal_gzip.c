@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_gzip.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Compression of request bodies.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+
+#ifdef GCAL_HAVE_ZLIB
+/* Input data is not changed by zlib */
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+
+#include "gcal_gzip.h"
+
+#ifdef GCAL_HAVE_ZLIB
+
+/* Window bits plus 16 writes a gzip header instead of a zlib one */
+#define GZIP_WINDOW (15 + 16)
+#define GZIP_MEMORY 8
+
+int gcal_gzip_available(void)
+{
+	return 1;
+}
+
+int gcal_gzip(const char *data, size_t length, char **packed,
+	      size_t *packed_length)
+{
+	int result = -1;
+	z_stream stream;
+	uLong bound;
+
+	if ((!data) || (!packed) || (!packed_length) ||
+	    (length != (uInt)length))
+		goto exit;
+
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+			 GZIP_WINDOW, GZIP_MEMORY, Z_DEFAULT_STRATEGY) != Z_OK)
+		goto exit;
+
+	/* Output is done in a single pass */
+	bound = deflateBound(&stream, length);
+	if (!(*packed = malloc(bound)))
+		goto cleanup;
+
+	stream.next_in = (const Bytef *)data;
+	stream.avail_in = length;
+	stream.next_out = (Bytef *)*packed;
+	stream.avail_out = bound;
+	if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+		free(*packed);
+		*packed = NULL;
+		goto cleanup;
+	}
+
+	*packed_length = stream.total_out;
+	result = 0;
+
+cleanup:
+	deflateEnd(&stream);
+
+exit:
+	return result;
+}
+
+#else
+
+int gcal_gzip_available(void)
+{
+	return 0;
+}
+
+int gcal_gzip(const char *data, size_t length, char **packed,
+	      size_t *packed_length)
+{
+	(void)data; /* prevent compiler warning */
+	(void)length;
+	(void)packed;
+	(void)packed_length;
+
+	return -1;
+}
+
+#endif
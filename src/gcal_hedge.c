@@ -0,0 +1,284 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_hedge.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Hedged reads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <time.h>
+#include <curl/curl.h>
+
+#include "internal_gcal.h"
+#include "gcal_hedge.h"
+#include "gcal_multi.h"
+#include "gcal_retry.h"
+
+/* Min number of latencies to compute the percentile */
+static const size_t GCAL_HEDGE_MIN_SAMPLES = 8;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void gcal_hedge_sample(struct gcal_resource *gcalobj, long latency)
+{
+	struct gcal_hedge *hedge = &gcalobj->hedge;
+
+	hedge->samples[hedge->next] = latency;
+	hedge->next = (hedge->next + 1) % GCAL_HEDGE_SAMPLES;
+	if (hedge->count < GCAL_HEDGE_SAMPLES)
+		++hedge->count;
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+	long first = *(const long *)a, second = *(const long *)b;
+
+	return (first > second) - (first < second);
+}
+
+long gcal_hedge_delay(struct gcal_resource *gcalobj)
+{
+	struct gcal_hedge *hedge = &gcalobj->hedge;
+	long sorted[GCAL_HEDGE_SAMPLES], delay;
+	size_t index;
+
+	if (hedge->count < GCAL_HEDGE_MIN_SAMPLES)
+		return hedge->delay;
+
+	memcpy(sorted, hedge->samples, hedge->count * sizeof(long));
+	qsort(sorted, hedge->count, sizeof(long), compare_latency);
+
+	index = hedge->count * hedge->percentile / 100;
+	if (index >= hedge->count)
+		index = hedge->count - 1;
+
+	delay = sorted[index];
+	return delay < hedge->delay ? hedge->delay : delay;
+}
+
+/* Checks if server has already started to answer */
+static int answered(CURL *curl)
+{
+	long header = 0;
+
+	curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &header);
+	return header > 0;
+}
+
+/* Only an answer the request can use wins: a fast error (e.g. 503) from
+ * one connection must not drop the other, which can still succeed.
+ */
+static int usable(struct gcal_resource *gcalobj, CURL *curl, CURLcode code)
+{
+	long http_code = 0;
+
+	if (code != CURLE_OK)
+		return 0;
+
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+	if ((http_code == GCAL_DEFAULT_ANSWER) ||
+	    (http_code == GCAL_NOT_MODIFIED))
+		return 1;
+
+	/* Calendar feed is redirected first */
+	return (http_code == GCAL_REDIRECT_ANSWER) &&
+		(!strcmp(gcalobj->service, "cl"));
+}
+
+/* The copy uses a slot: a new curl handle (so a new connection) with all
+ * the options of the prepared request.
+ */
+static struct gcal_resource *start_copy(struct gcal_resource *gcalobj,
+					CURLM *multi)
+{
+	struct gcal_resource *copy;
+
+	if (!(copy = gcal_slot_new(gcalobj)))
+		return NULL;
+
+	curl_easy_setopt(copy->curl, CURLOPT_WRITEDATA, (void *)copy);
+	curl_easy_setopt(copy->curl, CURLOPT_HEADERDATA, (void *)copy);
+	gcal_deadline_apply(gcalobj, copy->curl);
+
+	if (curl_multi_add_handle(multi, copy->curl) != CURLM_OK) {
+		gcal_destroy(copy);
+		return NULL;
+	}
+
+	if (gcalobj->fout_log)
+		fprintf(gcalobj->fout_log, "gcal_hedge_send: request copy "
+			"sent\n");
+
+	return copy;
+}
+
+/* The copy answer becomes the gcal object answer */
+static void take_copy(struct gcal_resource *gcalobj,
+		      struct gcal_resource *copy)
+{
+	CURL *curl = gcalobj->curl;
+	char *buffer = gcalobj->buffer, *etag = gcalobj->etag;
+	size_t length = gcalobj->length, previous = gcalobj->previous_length;
+
+	gcalobj->curl = copy->curl;
+	gcalobj->buffer = copy->buffer;
+	gcalobj->length = copy->length;
+	gcalobj->previous_length = copy->previous_length;
+	gcalobj->etag = copy->etag;
+	gcalobj->retry_after = copy->retry_after;
+
+	copy->curl = curl;
+	copy->buffer = buffer;
+	copy->length = length;
+	copy->previous_length = previous;
+	copy->etag = etag;
+
+	curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEDATA, (void *)gcalobj);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_HEADERDATA, (void *)gcalobj);
+}
+
+CURLcode gcal_hedge_send(struct gcal_resource *gcalobj)
+{
+	struct gcal_resource *copy = NULL;
+	CURLM *multi = NULL;
+	CURLMsg *msg;
+	CURL *winner = NULL, *handle;
+	CURLcode result = CURLE_FAILED_INIT, code;
+	double start, elapsed, latency, offset = 0, copy_offset = 0;
+	long delay, wait;
+	int running, pending, busy = 0, copy_busy = 0;
+
+	if ((gcalobj->hedge.percentile <= 0) || (!gcalobj->auth) ||
+	    (!(multi = curl_multi_init()))) {
+		result = curl_easy_perform(gcalobj->curl);
+		winner = gcalobj->curl;
+		goto latency;
+	}
+
+	delay = gcal_hedge_delay(gcalobj);
+	start = now();
+	if (curl_multi_add_handle(multi, gcalobj->curl) != CURLM_OK)
+		goto cleanup;
+	busy = 1;
+
+	while ((busy || copy_busy) && (!winner)) {
+		if (curl_multi_perform(multi, &running) != CURLM_OK)
+			break;
+
+		while ((msg = curl_multi_info_read(multi, &pending))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			/* 'msg' is not valid after removing the handle */
+			handle = msg->easy_handle;
+			code = msg->data.result;
+			curl_multi_remove_handle(multi, handle);
+
+			if (handle == gcalobj->curl) {
+				busy = 0;
+				result = code;
+			} else
+				copy_busy = 0;
+
+			/* First usable answer wins, an error of the
+			 * request is kept if both fail.
+			 */
+			if ((!winner) && (usable(gcalobj, handle, code)))
+				winner = handle;
+		}
+
+		if ((winner) || ((!busy) && (!copy_busy)))
+			break;
+
+		elapsed = (now() - start) * 1000;
+		if ((!copy) && (elapsed >= delay)) {
+			/* Only a request without answer is hedged */
+			if ((!answered(gcalobj->curl)) &&
+			    (copy = start_copy(gcalobj, multi))) {
+				copy_busy = 1;
+				copy_offset = elapsed;
+			} else
+				delay = LONG_MAX;
+		}
+
+		wait = 1000;
+		if ((!copy) && (delay - elapsed < wait))
+			wait = delay - elapsed < 1 ? 1 : delay - elapsed;
+		curl_multi_wait(multi, NULL, 0, (int)wait, NULL);
+	}
+
+	if ((copy) && (winner == copy->curl)) {
+		/* Server was stuck in the first request, the answer came
+		 * after the copy was sent.
+		 */
+		offset = copy_offset;
+		take_copy(gcalobj, copy);
+		/* The first request is running in the copy handle now */
+		copy_busy = busy;
+		busy = 0;
+		result = CURLE_OK;
+	}
+
+cleanup:
+	if (busy)
+		curl_multi_remove_handle(multi, gcalobj->curl);
+	if (copy_busy)
+		curl_multi_remove_handle(multi, copy->curl);
+	if (copy)
+		gcal_destroy(copy);
+	curl_multi_cleanup(multi);
+
+latency:
+	/* Time to first byte of the winner (the copy handle, if it won),
+	 * counted from the start of the request.
+	 */
+	if ((winner) && (result == CURLE_OK)) {
+		curl_easy_getinfo(gcalobj->curl, CURLINFO_STARTTRANSFER_TIME,
+				  &latency);
+		gcal_hedge_sample(gcalobj, (long)(offset + latency * 1000));
+	}
+
+	return result;
+}
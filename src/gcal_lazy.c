@@ -0,0 +1,355 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_lazy.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Lazy decoding of entry fields.
+ *
+ * A field is decoded by extracting the entry again with a field mask that
+ * has only the pending fields asked for, then the extracted fields are
+ * moved to the entry.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "internal_gcal.h"
+#include "gcal_lazy.h"
+#include "gcal_parser.h"
+#include "atom_parser.h"
+#include "json_parser.h"
+#include "gcont.h"
+
+/* Exchanges two fields of same type */
+#define SWAP(type, a, b) do {			\
+		type swap_tmp = (a);		\
+		(a) = (b);			\
+		(b) = swap_tmp;			\
+	} while (0)
+
+struct gcal_lazy_feed *gcal_lazy_feed_new(dom_document *document,
+					  const char *data)
+{
+	struct gcal_lazy_feed *feed;
+
+	if ((!document) && (!data))
+		return NULL;
+
+	if (!(feed = malloc(sizeof(struct gcal_lazy_feed))))
+		return NULL;
+
+	feed->refs = 1;
+	feed->document = document;
+	feed->data = NULL;
+	if ((!document) && (!(feed->data = strdup(data)))) {
+		free(feed);
+		return NULL;
+	}
+	pthread_mutex_init(&feed->lock, NULL);
+
+	return feed;
+}
+
+static void acquire_feed(struct gcal_lazy_feed *feed)
+{
+	pthread_mutex_lock(&feed->lock);
+	++feed->refs;
+	pthread_mutex_unlock(&feed->lock);
+}
+
+void gcal_lazy_feed_release(struct gcal_lazy_feed *feed)
+{
+	int refs;
+
+	if (!feed)
+		return;
+
+	pthread_mutex_lock(&feed->lock);
+	refs = --feed->refs;
+	pthread_mutex_unlock(&feed->lock);
+	if (refs)
+		return;
+
+	if (feed->document)
+		clean_dom_document(feed->document);
+	if (feed->data)
+		free(feed->data);
+	pthread_mutex_destroy(&feed->lock);
+	free(feed);
+}
+
+void gcal_lazy_attach(struct gcal_entry *entry, struct gcal_lazy_feed *feed)
+{
+	if ((!entry) || (!feed))
+		return;
+
+	entry->pending = entry->field_mask & ~GCAL_LAZY_KEYS;
+	if (!entry->pending)
+		return;
+
+	entry->field_mask &= GCAL_LAZY_KEYS;
+	entry->feed = feed;
+	acquire_feed(feed);
+}
+
+void gcal_lazy_share(struct gcal_entry *dest, const struct gcal_entry *src)
+{
+	if ((!dest) || (!src) || (!src->feed))
+		return;
+
+	dest->pending = src->pending;
+	dest->feed = src->feed;
+	dest->node = src->node;
+	dest->text = src->text;
+	dest->text_length = src->text_length;
+	acquire_feed(dest->feed);
+}
+
+void gcal_lazy_detach(struct gcal_entry *entry)
+{
+	if ((!entry) || (!entry->feed))
+		return;
+
+	gcal_lazy_feed_release(entry->feed);
+	entry->feed = NULL;
+	entry->node = NULL;
+	entry->text = NULL;
+	entry->text_length = 0;
+	entry->pending = 0;
+}
+
+/* Marks fields as decoded, the feed is dropped after the last one */
+static void decoded(struct gcal_entry *entry, unsigned int fields)
+{
+	entry->field_mask |= fields;
+	entry->pending &= ~fields;
+	if (!entry->pending)
+		gcal_lazy_detach(entry);
+}
+
+/* The replaced fields (i.e. NULL) go to 'src' and are released with it */
+static void move_event(struct gcal_event *dest, struct gcal_event *src,
+		       unsigned int fields)
+{
+	if (fields & GCAL_F_ID)
+		SWAP(char *, dest->common.id, src->common.id);
+	if (fields & GCAL_F_ETAG)
+		SWAP(char *, dest->common.etag, src->common.etag);
+	if (fields & GCAL_F_TITLE)
+		SWAP(char *, dest->common.title, src->common.title);
+	if (fields & GCAL_F_EDIT_URI)
+		SWAP(char *, dest->common.edit_uri, src->common.edit_uri);
+	if (fields & GCAL_F_UPDATED) {
+		SWAP(char *, dest->common.updated, src->common.updated);
+		SWAP(char *, dest->common.published, src->common.published);
+	}
+	if (fields & GCAL_F_CONTENT)
+		SWAP(char *, dest->content, src->content);
+	if (fields & GCAL_F_STATUS) {
+		SWAP(char *, dest->status, src->status);
+		dest->common.deleted = src->common.deleted;
+	}
+	if (fields & GCAL_F_WHEN) {
+		SWAP(char *, dest->dt_start, src->dt_start);
+		SWAP(char *, dest->dt_end, src->dt_end);
+	}
+	/* Recurrence comes with both 'when' and alarms */
+	if ((fields & (GCAL_F_WHEN | GCAL_F_ALARMS)) && (!dest->dt_recurrent))
+		SWAP(char *, dest->dt_recurrent, src->dt_recurrent);
+	if (fields & GCAL_F_WHERE)
+		SWAP(char *, dest->where, src->where);
+	if (fields & GCAL_F_ATTENDEES) {
+		SWAP(struct gcal_event_attendees *, dest->attendees,
+		     src->attendees);
+		SWAP(unsigned int, dest->attendees_nr, src->attendees_nr);
+	}
+	if (fields & GCAL_F_ALARMS) {
+		SWAP(struct gcal_event_alarms *, dest->alarms, src->alarms);
+		SWAP(unsigned int, dest->alarms_nr, src->alarms_nr);
+	}
+	if (fields & GCAL_F_GUESTS) {
+		SWAP(char *, dest->anyoneCanAddSelf, src->anyoneCanAddSelf);
+		SWAP(char *, dest->guestsCanInviteOthers,
+		     src->guestsCanInviteOthers);
+		SWAP(char *, dest->guestsCanModify, src->guestsCanModify);
+		SWAP(char *, dest->guestsCanSeeGuests,
+		     src->guestsCanSeeGuests);
+	}
+	if (fields & GCAL_F_SEQUENCE)
+		SWAP(char *, dest->sequence, src->sequence);
+	if (fields & GCAL_F_VISIBILITY)
+		SWAP(char *, dest->common.visibility, src->common.visibility);
+}
+
+int gcal_lazy_event(struct gcal_event *event, unsigned int fields)
+{
+	int result = -1;
+	struct gcal_event extracted;
+
+	if ((!event) || (!(fields &= event->common.pending)))
+		return 0;
+
+	if ((!event->common.node) && (!event->common.text))
+		return result;
+
+	memset(&extracted, 0, sizeof(struct gcal_event));
+	gcal_init_event(&extracted);
+	extracted.common.field_mask = fields;
+
+	if (event->common.feed->document)
+		result = atom_extract_data(event->common.node,
+					   &extracted);
+	else
+		result = json_extract_data(event->common.text,
+					   event->common.text_length,
+					   &extracted);
+
+	if (!result) {
+		move_event(event, &extracted, fields);
+		decoded(&event->common, fields);
+	}
+
+	gcal_destroy_entry(&extracted);
+	return result;
+}
+
+static void move_contact(struct gcal_contact *dest, struct gcal_contact *src,
+			 unsigned int fields)
+{
+	if (fields & GCAL_F_ID)
+		SWAP(char *, dest->common.id, src->common.id);
+	if (fields & GCAL_F_ETAG)
+		SWAP(char *, dest->common.etag, src->common.etag);
+	if (fields & GCAL_F_UPDATED)
+		SWAP(char *, dest->common.updated, src->common.updated);
+	if (fields & GCAL_F_STATUS)
+		dest->common.deleted = src->common.deleted;
+	if (fields & GCAL_F_TITLE) {
+		SWAP(char *, dest->common.title, src->common.title);
+		SWAP(struct gcal_structured_subvalues *,
+		     dest->structured_name, src->structured_name);
+		SWAP(int, dest->structured_name_nr, src->structured_name_nr);
+	}
+	if (fields & GCAL_F_EDIT_URI)
+		SWAP(char *, dest->common.edit_uri, src->common.edit_uri);
+	if (fields & GCAL_F_EMAILS) {
+		SWAP(char **, dest->emails_field, src->emails_field);
+		SWAP(char **, dest->emails_type, src->emails_type);
+		SWAP(int, dest->emails_nr, src->emails_nr);
+		SWAP(int, dest->pref_email, src->pref_email);
+	}
+	if (fields & GCAL_F_CONTENT)
+		SWAP(char *, dest->content, src->content);
+	if (fields & GCAL_F_NICKNAME)
+		SWAP(char *, dest->nickname, src->nickname);
+	if (fields & GCAL_F_WEBSITES) {
+		SWAP(char *, dest->homepage, src->homepage);
+		SWAP(char *, dest->blog, src->blog);
+	}
+	if (fields & GCAL_F_ORGANIZATION) {
+		SWAP(char *, dest->org_name, src->org_name);
+		SWAP(char *, dest->org_title, src->org_title);
+		SWAP(char *, dest->occupation, src->occupation);
+	}
+	if (fields & GCAL_F_PHONES) {
+		SWAP(char **, dest->phone_numbers_field,
+		     src->phone_numbers_field);
+		SWAP(char **, dest->phone_numbers_type,
+		     src->phone_numbers_type);
+		SWAP(int, dest->phone_numbers_nr, src->phone_numbers_nr);
+	}
+	if (fields & GCAL_F_IM) {
+		SWAP(char **, dest->im_address, src->im_address);
+		SWAP(char **, dest->im_protocol, src->im_protocol);
+		SWAP(char **, dest->im_type, src->im_type);
+		SWAP(int, dest->im_nr, src->im_nr);
+		SWAP(int, dest->im_pref, src->im_pref);
+	}
+	if (fields & GCAL_F_ADDRESS) {
+		SWAP(char *, dest->post_address, src->post_address);
+		SWAP(struct gcal_structured_subvalues *,
+		     dest->structured_address, src->structured_address);
+		SWAP(char **, dest->structured_address_type,
+		     src->structured_address_type);
+		SWAP(int, dest->structured_address_nr,
+		     src->structured_address_nr);
+		SWAP(int, dest->structured_address_pref,
+		     src->structured_address_pref);
+	}
+	if (fields & GCAL_F_GROUPS) {
+		SWAP(char **, dest->groupMembership, src->groupMembership);
+		SWAP(int, dest->groupMembership_nr, src->groupMembership_nr);
+	}
+	if (fields & GCAL_F_BIRTHDAY)
+		SWAP(char *, dest->birthday, src->birthday);
+	if (fields & GCAL_F_PHOTO) {
+		SWAP(char *, dest->photo, src->photo);
+		SWAP(char *, dest->photo_etag, src->photo_etag);
+		SWAP(unsigned int, dest->photo_length, src->photo_length);
+	}
+}
+
+int gcal_lazy_contact(struct gcal_contact *contact, unsigned int fields)
+{
+	int result = -1;
+	struct gcal_contact extracted;
+
+	if ((!contact) || (!(fields &= contact->common.pending)))
+		return 0;
+
+	if ((!contact->common.node) && (!contact->common.text))
+		return result;
+
+	memset(&extracted, 0, sizeof(struct gcal_contact));
+	gcal_init_contact(&extracted);
+	extracted.common.field_mask = fields;
+
+	if (contact->common.feed->document)
+		result = atom_extract_contact(contact->common.node,
+					      &extracted);
+	else
+		result = json_extract_contact(contact->common.text,
+					      contact->common.text_length,
+					      &extracted);
+
+	if (!result) {
+		move_contact(contact, &extracted, fields);
+		decoded(&contact->common, fields);
+	}
+
+	gcal_destroy_contact(&extracted);
+	return result;
+}
@@ -0,0 +1,425 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_multi.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Simultaneous transfers (using curl multi interface).
+ *
+ * Each transfer runs in its own slot (a copy of the user gcal object),
+ * slots are reused until all URLs are downloaded.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+#include "internal_gcal.h"
+#include "gcal_multi.h"
+#include "gcal_retry.h"
+#include "gcal_status.h"
+
+/** A running transfer */
+struct gcal_transfer {
+	/** The gcal object (own curl handle and buffer) */
+	struct gcal_resource *slot;
+	/** Index of the URL being downloaded */
+	size_t job;
+	/** If google calendar redirection was already followed */
+	int redirected;
+	/** If the curl handle is inside the multi handle */
+	char busy;
+};
+
+/** Transfers state, shared by helper functions */
+struct gcal_multi {
+	/** User gcal object, its rate limit is shared by all slots */
+	struct gcal_resource *gcalobj;
+	CURLM *multi;
+	const char * const *urls;
+	size_t count;
+	size_t next;
+	void *cb_download;
+	const char *gdata_version;
+	gcal_multi_cb done;
+	void *user;
+	int result;
+};
+
+struct gcal_resource *gcal_slot_new(struct gcal_resource *gcalobj)
+{
+	struct gcal_resource *slot = NULL;
+	CURL *curl;
+
+	if ((!gcalobj) || (!gcalobj->auth))
+		goto exit;
+
+	slot = gcal_construct(GCALENDAR);
+	if (!slot)
+		goto exit;
+
+	/* Copying the handle keeps user options (e.g. proxy), including the
+	 * progress callback data: canceling the user object cancels the
+	 * transfers of its slots.
+	 */
+	curl = curl_easy_duphandle(gcalobj->curl);
+	if (!curl)
+		goto cleanup;
+	curl_easy_cleanup(slot->curl);
+	slot->curl = curl;
+
+	strcpy(slot->service, gcalobj->service);
+	slot->store_xml_entry = gcalobj->store_xml_entry;
+	slot->field_mask = gcalobj->field_mask;
+	slot->lazy_fields = gcalobj->lazy_fields;
+	slot->deleted = gcalobj->deleted;
+	slot->max_transfers = gcalobj->max_transfers;
+	slot->lazy_photo = gcalobj->lazy_photo;
+
+	if (!(slot->auth = strdup(gcalobj->auth)))
+		goto cleanup;
+	if (gcalobj->user)
+		if (!(slot->user = strdup(gcalobj->user)))
+			goto cleanup;
+	if (gcalobj->domain)
+		if (!(slot->domain = strdup(gcalobj->domain)))
+			goto cleanup;
+
+	goto exit;
+
+cleanup:
+	gcal_destroy(slot);
+	slot = NULL;
+
+exit:
+	return slot;
+}
+
+/* Starts the next pending URL using a free slot. Returns 1 if a transfer
+ * was started, 0 when there is nothing left to download and -1 if the user
+ * callback asked to abort or the request was interrupted.
+ */
+static int next_transfer(struct gcal_multi *ctx,
+			 struct gcal_transfer *transfer)
+{
+	CURLcode code;
+
+	while (ctx->next < ctx->count) {
+		transfer->job = ctx->next++;
+		transfer->redirected = 0;
+
+		if (!prepare_follow_redirection(transfer->slot,
+						ctx->urls[transfer->job],
+						ctx->cb_download,
+						ctx->gdata_version)) {
+			code = gcal_rate_limit(ctx->gcalobj);
+			if (code != CURLE_OK) {
+				ctx->gcalobj->internal_status =
+					code == CURLE_ABORTED_BY_CALLBACK ?
+					GCAL_INTERRUPT_CANCEL :
+					GCAL_INTERRUPT_TIMEOUT;
+				ctx->result = -1;
+				return -1;
+			}
+			gcal_deadline_apply(ctx->gcalobj,
+					    transfer->slot->curl);
+			if (curl_multi_add_handle(ctx->multi,
+						  transfer->slot->curl) ==
+			    CURLM_OK) {
+				transfer->busy = 1;
+				return 1;
+			}
+		}
+
+		ctx->result = -1;
+		if (ctx->done(transfer->slot, transfer->job, -1, ctx->user))
+			return -1;
+	}
+
+	return 0;
+}
+
+int gcal_multi_get(struct gcal_resource *gcalobj, const char * const *urls,
+		   size_t count, void *cb_download, const char *gdata_version,
+		   gcal_multi_cb done, void *user)
+{
+	struct gcal_multi ctx;
+	struct gcal_transfer *transfers = NULL, *transfer;
+	size_t i, slots;
+	int active = 0, running, pending, answer, stop = 0, deadline;
+	CURLMsg *msg;
+	CURL *handle;
+	CURLcode code;
+
+	if ((!gcalobj) || (!urls) || (!done))
+		return -1;
+	if (!count)
+		return 0;
+
+	ctx.gcalobj = gcalobj;
+	ctx.urls = urls;
+	ctx.count = count;
+	ctx.next = 0;
+	ctx.cb_download = cb_download;
+	ctx.gdata_version = gdata_version;
+	ctx.done = done;
+	ctx.user = user;
+	ctx.result = -1;
+
+	/* All transfers share the deadline */
+	gcalobj->internal_status = GCAL_INTERRUPT_NONE;
+	deadline = gcal_deadline_start(gcalobj);
+
+	slots = gcalobj->max_transfers < 1 ? 1 : gcalobj->max_transfers;
+	if (slots > count)
+		slots = count;
+
+	if (!(ctx.multi = curl_multi_init()))
+		goto exit;
+
+	transfers = calloc(slots, sizeof(struct gcal_transfer));
+	if (!transfers)
+		goto cleanup;
+
+	for (i = 0; i < slots; ++i)
+		if (!(transfers[i].slot = gcal_slot_new(gcalobj)))
+			goto cleanup;
+
+	ctx.result = 0;
+	for (i = 0; (i < slots) && (!stop); ++i) {
+		answer = next_transfer(&ctx, &transfers[i]);
+		if (answer == 1)
+			++active;
+		else if (answer == -1)
+			stop = 1;
+	}
+
+	while ((active > 0) && (!stop)) {
+		if (curl_multi_perform(ctx.multi, &running) != CURLM_OK) {
+			ctx.result = -1;
+			break;
+		}
+
+		while ((!stop) &&
+		       (msg = curl_multi_info_read(ctx.multi, &pending))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			/* 'msg' is not valid after removing the handle */
+			handle = msg->easy_handle;
+			code = msg->data.result;
+
+			transfer = NULL;
+			for (i = 0; i < slots; ++i)
+				if (transfers[i].busy &&
+				    (transfers[i].slot->curl == handle)) {
+					transfer = &transfers[i];
+					break;
+				}
+			if (!transfer)
+				continue;
+
+			curl_multi_remove_handle(ctx.multi, handle);
+			transfer->busy = 0;
+
+			if ((code == CURLE_ABORTED_BY_CALLBACK) &&
+			    (__atomic_load_n(&gcalobj->canceled,
+					     __ATOMIC_SEQ_CST))) {
+				gcalobj->internal_status = GCAL_INTERRUPT_CANCEL;
+				stop = 1;
+			} else if (code == CURLE_OPERATION_TIMEDOUT)
+				gcalobj->internal_status =
+					GCAL_INTERRUPT_TIMEOUT;
+
+			answer = check_follow_redirection(transfer->slot, code,
+							  transfer->redirected);
+			if (answer == 1) {
+				/* Follow gsessionid URL with the same handle */
+				transfer->redirected = 1;
+				gcal_deadline_apply(gcalobj, handle);
+				if (curl_multi_add_handle(ctx.multi, handle) ==
+				    CURLM_OK) {
+					transfer->busy = 1;
+					continue;
+				}
+				answer = -1;
+			}
+
+			--active;
+
+			if (answer)
+				ctx.result = -1;
+			/* A canceled transfer stops the others */
+			if (done(transfer->slot, transfer->job, answer, user) ||
+			    (stop)) {
+				stop = 1;
+				break;
+			}
+
+			answer = next_transfer(&ctx, transfer);
+			if (answer == 1)
+				++active;
+			else if (answer == -1)
+				stop = 1;
+		}
+
+		if ((active > 0) && (!stop))
+			curl_multi_wait(ctx.multi, NULL, 0, 1000, NULL);
+	}
+
+	if (stop)
+		ctx.result = -1;
+
+cleanup:
+	if (transfers) {
+		for (i = 0; i < slots; ++i) {
+			if (transfers[i].busy)
+				curl_multi_remove_handle(ctx.multi,
+							 transfers[i].slot->curl);
+			if (transfers[i].slot)
+				gcal_destroy(transfers[i].slot);
+		}
+		free(transfers);
+	}
+
+	curl_multi_cleanup(ctx.multi);
+
+exit:
+	if (gcalobj->internal_status == GCAL_INTERRUPT_CANCEL)
+		__atomic_store_n(&gcalobj->canceled, 0, __ATOMIC_SEQ_CST);
+	gcal_deadline_end(gcalobj, deadline);
+	return ctx.result;
+}
+
+void *gcal_multi_merge(void **parts, size_t *lengths, size_t count,
+		       size_t size, size_t *length)
+{
+	char *result = NULL;
+	size_t i, total = 0;
+
+	if ((!parts) || (!lengths) || (!length))
+		goto exit;
+
+	for (i = 0; i < count; ++i)
+		if (parts[i])
+			total += lengths[i];
+
+	/* Avoids malloc(0) returning NULL */
+	result = malloc(size * (total ? total : 1));
+	if (!result)
+		goto exit;
+
+	*length = 0;
+	for (i = 0; i < count; ++i) {
+		if (!parts[i])
+			continue;
+		memcpy(result + (*length * size), parts[i], lengths[i] * size);
+		*length += lengths[i];
+		free(parts[i]);
+		parts[i] = NULL;
+		lengths[i] = 0;
+	}
+
+exit:
+	return result;
+}
+
+/* Sort helper: entries pointers ordered by ID and then by position */
+static int compare_entry_id(const void *a, const void *b)
+{
+	const struct gcal_entry *first = *(struct gcal_entry * const *)a;
+	const struct gcal_entry *second = *(struct gcal_entry * const *)b;
+	int result = 0;
+
+	if (first->id && second->id)
+		result = strcmp(first->id, second->id);
+	else if (first->id)
+		result = 1;
+	else if (second->id)
+		result = -1;
+
+	if (!result)
+		result = (first > second) - (first < second);
+
+	return result;
+}
+
+size_t gcal_multi_dedup(void *entries, size_t length, size_t size,
+			void (*destroy)(void *))
+{
+	struct gcal_entry **sorted = NULL, *entry;
+	char *dropped = NULL, *ptr = entries;
+	size_t i, last;
+
+	if ((!entries) || (length < 2))
+		goto exit;
+
+	sorted = malloc(sizeof(struct gcal_entry *) * length);
+	dropped = calloc(length, sizeof(char));
+	if ((!sorted) || (!dropped))
+		goto cleanup;
+
+	/* Each entry starts with a 'struct gcal_entry' */
+	for (i = 0; i < length; ++i)
+		sorted[i] = (struct gcal_entry *)(ptr + (i * size));
+	qsort(sorted, length, sizeof(struct gcal_entry *), compare_entry_id);
+
+	for (i = 1; i < length; ++i)
+		if (sorted[i]->id && sorted[i - 1]->id &&
+		    !strcmp(sorted[i]->id, sorted[i - 1]->id))
+			dropped[((char *)sorted[i] - ptr) / size] = 1;
+
+	for (i = last = 0; i < length; ++i) {
+		entry = (struct gcal_entry *)(ptr + (i * size));
+		if (dropped[i]) {
+			if (destroy)
+				destroy(entry);
+			continue;
+		}
+		if (i != last)
+			memcpy(ptr + (last * size), entry, size);
+		++last;
+	}
+	length = last;
+
+cleanup:
+	if (sorted)
+		free(sorted);
+	if (dropped)
+		free(dropped);
+
+exit:
+	return length;
+}
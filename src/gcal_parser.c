@@ -41,6 +41,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "gcal_parser.h"
 #include "atom_parser.h"
 #include "xml_aux.h"
+#include "gcal_cache.h"
 
 #include <libxml/tree.h>
 #include <string.h>
@@ -279,9 +280,38 @@ exit:
 	return result;
 }
 
+/* Gets a cached copy of the entry, if it didn't change since last parse */
+static int cached_entry(struct gcal_entries_cache *cache, xmlNode *node,
+			void *entry)
+{
+	int result = -1;
+	char *id, *etag = NULL;
+
+	if (!cache)
+		return result;
+
+	if ((id = get_id_element(node)))
+		if ((etag = get_etag_attribute(node)))
+			result = gcal_entries_cache_get(cache, id, etag, entry);
+
+	if (id)
+		free(id);
+	if (etag)
+		free(etag);
+
+	return result;
+}
+
 int extract_all_entries(dom_document *doc,
 			struct gcal_event *data_extract, int length)
 {
+	return extract_all_entries_cached(doc, data_extract, length, NULL);
+}
+
+int extract_all_entries_cached(dom_document *doc,
+			       struct gcal_event *data_extract, int length,
+			       struct gcal_entries_cache *cache)
+{
 
 	int result = -1, i;
 	xmlXPathObject *xpath_obj = NULL;
@@ -302,9 +332,19 @@ int extract_all_entries(dom_document *doc,
 
 	/* extract the fields */
 	for (i = 0; i < length; ++i) {
+		if (!cached_entry(cache, nodes->nodeTab[i], &data_extract[i]))
+			continue;
+
+		/* Lazy entries decode other fields later from their node */
+		if (data_extract[i].common.feed)
+			data_extract[i].common.node = nodes->nodeTab[i];
+
 		result = atom_extract_data(nodes->nodeTab[i], &data_extract[i]);
 		if (result == -1)
 			goto cleanup;
+
+		if (cache)
+			gcal_entries_cache_put(cache, &data_extract[i]);
 	}
 
 	result = 0;
@@ -316,159 +356,196 @@ exit:
 	return result;
 }
 
-int xmlentry_create(struct gcal_event *entry, char **xml_entry, int *length)
+/* Writes the start of a tag, i.e. '<prefix:name' (prefix can be NULL) */
+static void open_tag(struct xml_writer *out, const char *prefix,
+		     const char *name)
 {
-	int result = -1;
-	xmlDoc *doc = NULL;
-	xmlNode *root, *node;
-	xmlNs *ns;
-	xmlChar *xml_str = NULL;
+	xml_write_raw(out, "<", 1);
+	if (prefix) {
+		xml_write_raw(out, prefix, strlen(prefix));
+		xml_write_raw(out, ":", 1);
+	}
+	xml_write_raw(out, name, strlen(name));
+}
 
-	doc = xmlNewDoc(BAD_CAST "1.0");
-	root = xmlNewNode(NULL, BAD_CAST "entry");
+/* Writes the end tag of an element with children */
+static void close_tag(struct xml_writer *out, const char *prefix,
+		      const char *name)
+{
+	xml_write_raw(out, "</", 2);
+	if (prefix) {
+		xml_write_raw(out, prefix, strlen(prefix));
+		xml_write_raw(out, ":", 1);
+	}
+	xml_write_raw(out, name, strlen(name));
+	xml_write_raw(out, ">", 1);
+}
 
-	if (!doc || !root)
-		goto exit;
+/* Writes an attribute, its value is 'value_prefix' followed by 'value' */
+static void write_attr(struct xml_writer *out, const char *name,
+		       const char *value_prefix, const char *value)
+{
+	xml_write_raw(out, " ", 1);
+	xml_write_raw(out, name, strlen(name));
+	xml_write_raw(out, "=\"", 2);
+	if (value_prefix)
+		xml_write_escaped(out, value_prefix, 1);
+	xml_write_escaped(out, value, 1);
+	xml_write_raw(out, "\"", 1);
+}
 
-	xmlSetProp(root, BAD_CAST "xmlns", BAD_CAST atom_href);
-	/* Google Data API 2.0 requires ETag to edit an entry */
-	if (entry->common.etag)
-		xmlSetProp(root, BAD_CAST "gd:etag",
-			   BAD_CAST entry->common.etag);
-	ns =  xmlNewNs(root, BAD_CAST gd_href, BAD_CAST "gd");
+/* Ends a start tag with 'text' as element content. Like libxml does, an
+ * element without text (NULL or empty) is written as an empty element.
+ */
+static void write_text(struct xml_writer *out, const char *prefix,
+		       const char *name, const char *text)
+{
+	if (!text || !text[0]) {
+		xml_write_raw(out, "/>", 2);
+		return;
+	}
 
-	xmlDocSetRootElement(doc, root);
+	xml_write_raw(out, ">", 1);
+	xml_write_escaped(out, text, 0);
+	close_tag(out, prefix, name);
+}
+
+/* Finishes the document, returning its length */
+static int end_document(struct xml_writer *out, size_t *length)
+{
+	xml_write_raw(out, "\n", 1);
+	if (out->error)
+		return -1;
+
+	*length = out->length;
+	return 0;
+}
+
+static const char xml_header[] = "<?xml version=\"1.0\"?>\n";
+
+int xmlentry_write(struct gcal_event *entry, char **buffer, size_t *size,
+		   size_t *length)
+{
+	struct xml_writer out;
 
+	if (!entry || !buffer || !size || !length)
+		return -1;
+
+	xml_writer_init(&out, buffer, size);
+	xml_write_raw(&out, xml_header, sizeof(xml_header) - 1);
+
+	open_tag(&out, NULL, "entry");
+	write_attr(&out, "xmlns:gd", NULL, gd_href);
+	write_attr(&out, "xmlns", NULL, atom_href);
+	/* Google Data API 2.0 requires ETag to edit an entry */
+	if (entry->common.etag)
+		write_attr(&out, "gd:etag", NULL, entry->common.etag);
+	xml_write_raw(&out, ">", 1);
 
 	/* entry ID, only if the 'entry' is already existant (i.e. the user
 	 * of library just got one entry result from a request from
 	 * server).
 	 */
 	if (entry->common.id) {
-		node = xmlNewNode(NULL, "id");
-		if (!node)
-			goto cleanup;
-		xmlNodeAddContent(node, entry->common.id);
-		xmlAddChild(root, node);
+		open_tag(&out, NULL, "id");
+		write_text(&out, NULL, "id", entry->common.id);
 	}
 
 	/* category element */
-	node = xmlNewNode(NULL, "category");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "scheme", BAD_CAST scheme_href);
-	xmlSetProp(node, BAD_CAST "term", BAD_CAST term_href_cal);
-	xmlAddChild(root, node);
+	open_tag(&out, NULL, "category");
+	write_attr(&out, "scheme", NULL, scheme_href);
+	write_attr(&out, "term", NULL, term_href_cal);
+	xml_write_raw(&out, "/>", 2);
 
 	/* title element */
-	node = xmlNewNode(NULL, "title");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "type", BAD_CAST "text");
-	xmlNodeAddContent(node, entry->common.title);
-	xmlAddChild(root, node);
+	open_tag(&out, NULL, "title");
+	write_attr(&out, "type", NULL, "text");
+	write_text(&out, NULL, "title", entry->common.title);
 
 	/* content element */
-	node = xmlNewNode(NULL, "content");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "type", BAD_CAST "text");
-	xmlNodeAddContent(node, entry->content);
-	xmlAddChild(root, node);
+	open_tag(&out, NULL, "content");
+	write_attr(&out, "type", NULL, "text");
+	write_text(&out, NULL, "content", entry->content);
 
 	/* entry edit URL, only if the 'entry' is already existant.
 	 */
 	if (entry->common.edit_uri) {
-		node = xmlNewNode(NULL, "link");
-		if (!node)
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "rel", BAD_CAST "edit");
-		xmlSetProp(node, BAD_CAST "type",
-			   BAD_CAST "application/atom+xml");
-		xmlSetProp(node, BAD_CAST "href",
-			   BAD_CAST entry->common.edit_uri);
-		xmlAddChild(root, node);
-
+		open_tag(&out, NULL, "link");
+		write_attr(&out, "rel", NULL, "edit");
+		write_attr(&out, "type", NULL, "application/atom+xml");
+		write_attr(&out, "href", NULL, entry->common.edit_uri);
+		xml_write_raw(&out, "/>", 2);
 	}
 
-
 	/* transparency */
-	node = xmlNewNode(ns, "transparency");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "value",
-		   BAD_CAST "http://schemas.google.com/g/2005#event.opaque");
-	xmlAddChild(root, node);
+	open_tag(&out, gd_ns, "transparency");
+	write_attr(&out, "value", NULL,
+		   "http://schemas.google.com/g/2005#event.opaque");
+	xml_write_raw(&out, "/>", 2);
 
 	/* event status */
-	node = xmlNewNode(ns, "eventStatus");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "value",
-		   BAD_CAST "http://schemas.google.com/g/2005#event.confirmed");
-	xmlAddChild(root, node);
-
+	open_tag(&out, gd_ns, "eventStatus");
+	write_attr(&out, "value", NULL,
+		   "http://schemas.google.com/g/2005#event.confirmed");
+	xml_write_raw(&out, "/>", 2);
 
 	/* where */
 	if (entry->where) {
-		node = xmlNewNode(ns, "where");
-		if (!node)
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "valueString", BAD_CAST entry->where);
-		xmlAddChild(root, node);
+		open_tag(&out, gd_ns, "where");
+		write_attr(&out, "valueString", NULL, entry->where);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* when */
 	if (entry->dt_start || entry->dt_end) {
-		node = xmlNewNode(ns, "when");
-		if (!node)
-			goto cleanup;
-
+		open_tag(&out, gd_ns, "when");
 		if (entry->dt_start)
-			xmlSetProp(node, BAD_CAST "startTime",
-				   BAD_CAST entry->dt_start);
+			write_attr(&out, "startTime", NULL, entry->dt_start);
 		if (entry->dt_end)
-			xmlSetProp(node, BAD_CAST "endTime",
-				   BAD_CAST entry->dt_end);
-
-		xmlAddChild(root, node);
+			write_attr(&out, "endTime", NULL, entry->dt_end);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/*recurrency*/
 	if (entry->dt_recurrent) {
-		node = xmlNewNode(ns, "recurrence");
-		if (!node)
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "type", BAD_CAST "text");
-		xmlNodeAddContent(node, entry->dt_recurrent);
-		xmlAddChild(root, node);
+		open_tag(&out, gd_ns, "recurrence");
+		write_attr(&out, "type", NULL, "text");
+		write_text(&out, gd_ns, "recurrence", entry->dt_recurrent);
 	}
 
+	close_tag(&out, NULL, "entry");
 
-	xmlDocDumpMemory(doc, &xml_str, length);
-	/* xmlDocDumpMemory doesn't include the last 0 in the returned size */
-	++(*length);
-	if (xml_str)
-		if ((*xml_entry = strdup(xml_str)))
-			result = 0;
-
-cleanup:
-
-	if (xml_str)
-		xmlFree(xml_str);
+	return end_document(&out, length);
+}
 
-	if (doc)
-		xmlFreeDoc(doc);
+int xmlentry_create(struct gcal_event *entry, char **xml_entry, int *length)
+{
+	char *buffer = NULL;
+	size_t size = 0, written;
 
-exit:
+	if (xmlentry_write(entry, &buffer, &size, &written)) {
+		if (buffer)
+			free(buffer);
+		return -1;
+	}
 
-	return result;
+	*xml_entry = buffer;
+	/* The length includes the last 0 */
+	*length = written + 1;
 
+	return 0;
 }
 
 int extract_all_contacts(dom_document *doc,
 			struct gcal_contact *data_extract, int length)
 {
+	return extract_all_contacts_cached(doc, data_extract, length, NULL);
+}
+
+int extract_all_contacts_cached(dom_document *doc,
+				struct gcal_contact *data_extract, int length,
+				struct gcal_entries_cache *cache)
+{
 
 	/* The logic of this function is the same of 'extract_all_entries'
 	 * but I can't find a way to share code without having a common
@@ -496,11 +573,21 @@ int extract_all_contacts(dom_document *doc,
 
 	/* extract the fields */
 	for (i = 0; i < length; ++i) {
+		if (!cached_entry(cache, nodes->nodeTab[i], &data_extract[i]))
+			continue;
+
+		/* Lazy entries decode other fields later from their node */
+		if (data_extract[i].common.feed)
+			data_extract[i].common.node = nodes->nodeTab[i];
+
 		result = atom_extract_contact(nodes->nodeTab[i],
 					      &data_extract[i]);
 
 		if (result == -1)
 			goto cleanup;
+
+		if (cache)
+			gcal_entries_cache_put(cache, &data_extract[i]);
 	}
 
 	result = 0;
@@ -512,65 +599,48 @@ exit:
 	return result;
 }
 
-int xmlcontact_create(struct gcal_contact *contact, char **xml_contact,
-		      int *length)
+int xmlcontact_write(struct gcal_contact *contact, char **buffer,
+		     size_t *size, size_t *length)
 {
-	/* XXX: this function is pretty much a copy of 'xmlentry_create'
+	/* XXX: this function is pretty much a copy of 'xmlentry_write'
 	 * some code could be shared if I provided a common type between
 	 * contact X calendar.
 	 */
-	int result = -1;
+	struct xml_writer out;
 	int i;
 	struct gcal_structured_subvalues *this_structured_entry;
 	int set_structured_entry = 0;
-	xmlDoc *doc = NULL;
-	xmlNode *root = NULL;
-	xmlNode *node = NULL;
-	xmlNode *node2 = NULL;
-	xmlNode *child = NULL;
-	xmlNs *ns;
-	xmlNs *ns2;
-	xmlChar *xml_str = NULL;
-	char *temp;
 	const char * rel_prefix = "http://schemas.google.com/g/2005#";
 
-	doc = xmlNewDoc(BAD_CAST "1.0");
-	root = xmlNewNode(NULL, BAD_CAST "atom:entry");
+	if (!contact || !buffer || !size || !length)
+		return -1;
 
-	if (!doc || !root)
-		goto exit;
+	xml_writer_init(&out, buffer, size);
+	xml_write_raw(&out, xml_header, sizeof(xml_header) - 1);
 
-	xmlSetProp(root, BAD_CAST "xmlns:atom", BAD_CAST atom_href);
+	open_tag(&out, atom_ns, "entry");
+	write_attr(&out, "xmlns:gd", NULL, gd_href);
+	/* Google contact group */
+	write_attr(&out, "xmlns:gContact", NULL, gContact_href);
+	write_attr(&out, "xmlns:atom", NULL, atom_href);
 	/* Google Data API 2.0 requires ETag to edit an entry */
 	if (contact->common.etag)
-		xmlSetProp(root, BAD_CAST "gd:etag",
-			   BAD_CAST contact->common.etag);
-
-	ns =  xmlNewNs(root, BAD_CAST gd_href, BAD_CAST "gd");
-
-	/* Google contact group */
-	ns2 =  xmlNewNs(root, BAD_CAST gContact_href, BAD_CAST "gContact");
-
-	xmlDocSetRootElement(doc, root);
+		write_attr(&out, "gd:etag", NULL, contact->common.etag);
+	xml_write_raw(&out, ">", 1);
 
 	/* category element */
-	node = xmlNewNode(NULL, "category");
-	if (!node)
-		goto cleanup;
-	xmlSetProp(node, BAD_CAST "scheme", BAD_CAST scheme_href);
-	xmlSetProp(node, BAD_CAST "term", BAD_CAST term_href_cont);
-	xmlAddChild(root, node);
+	open_tag(&out, NULL, "category");
+	write_attr(&out, "scheme", NULL, scheme_href);
+	write_attr(&out, "term", NULL, term_href_cont);
+	xml_write_raw(&out, "/>", 2);
 
 	/* entry ID, only if the 'contact' is already existant (i.e. the user
 	 * of library just got one contact result from a request from
 	 * server).
 	 */
 	if (contact->common.id) {
-		node = xmlNewNode(NULL, "id");
-		if (!node)
-			goto cleanup;
-		xmlNodeAddContent(node, contact->common.id);
-		xmlAddChild(root, node);
+		open_tag(&out, NULL, "id");
+		write_text(&out, NULL, "id", contact->common.id);
 	}
 
 	/* Sets contact structured name (Google API 3.0) */
@@ -580,265 +650,206 @@ int xmlcontact_create(struct gcal_contact *contact, char **xml_contact,
 		     this_structured_entry != NULL;
 		     this_structured_entry = this_structured_entry->next_field) {
 			if ((this_structured_entry->field_value != NULL)) {
+				if (!this_structured_entry->field_key)
+					return -1;
+
 				if( !set_structured_entry ) {
-					if (!(node = xmlNewNode(ns, "name")))
-						goto cleanup;
+					open_tag(&out, gd_ns, "name");
+					xml_write_raw(&out, ">", 1);
 					set_structured_entry = 1;
 				}
 
-				if (!(child = xmlNewNode(ns, BAD_CAST this_structured_entry->field_key)))
-					goto cleanup;
-				xmlNodeAddContent(child, BAD_CAST this_structured_entry->field_value);
-				xmlAddChild(node, child);
+				open_tag(&out, gd_ns,
+					 this_structured_entry->field_key);
+				write_text(&out, gd_ns,
+					   this_structured_entry->field_key,
+					   this_structured_entry->field_value);
 			}
 		}
 
 		if( set_structured_entry )
-			xmlAddChild(root, node);
+			close_tag(&out, gd_ns, "name");
 	} else if (contact->common.title && contact->common.title[0]) {
-		node = xmlNewNode(NULL, "gd:name");
-		if (!node)
-			goto cleanup;
-		node2 = xmlNewNode(NULL, "gd:fullName");
-		xmlNodeAddContent(node2, contact->common.title);
-		xmlAddChild(node, node2);
-		xmlAddChild(root, node);
+		open_tag(&out, gd_ns, "name");
+		xml_write_raw(&out, ">", 1);
+		open_tag(&out, gd_ns, "fullName");
+		write_text(&out, gd_ns, "fullName", contact->common.title);
+		close_tag(&out, gd_ns, "name");
 	}
 
 	/* entry edit URL, only if the 'entry' is already existant.
 	 */
 	if (contact->common.edit_uri && contact->common.edit_uri[0]) {
-		node = xmlNewNode(NULL, "link");
-		if (!node)
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "rel", BAD_CAST "edit");
-		xmlSetProp(node, BAD_CAST "type",
-			   BAD_CAST "application/atom+xml");
-		xmlSetProp(node, BAD_CAST "href",
-			   BAD_CAST contact->common.edit_uri);
-		xmlAddChild(root, node);
-
+		open_tag(&out, NULL, "link");
+		write_attr(&out, "rel", NULL, "edit");
+		write_attr(&out, "type", NULL, "application/atom+xml");
+		write_attr(&out, "href", NULL, contact->common.edit_uri);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* email addresses */
-	if (contact->emails_nr > 0) {
-		for (i = 0; i < contact->emails_nr; i++) {
-			if (!(node = xmlNewNode(ns, "email")))
-				goto cleanup;
-			temp = (char *)malloc((strlen(contact->emails_type[i])+strlen(rel_prefix)+1) * sizeof(char));
-			strcpy(temp, rel_prefix);
-			strcat(temp, contact->emails_type[i]);
-			xmlSetProp(node, BAD_CAST "rel",
-				  BAD_CAST temp);
-			xmlSetProp(node, BAD_CAST "address",
-				  BAD_CAST contact->emails_field[i]);
-			if (i == contact->pref_email)
-				xmlSetProp(node, BAD_CAST "primary",
-					  BAD_CAST "true");
-			xmlAddChild(root, node);
-			free(temp);
-		}
+	for (i = 0; i < contact->emails_nr; i++) {
+		open_tag(&out, gd_ns, "email");
+		write_attr(&out, "rel", rel_prefix, contact->emails_type[i]);
+		write_attr(&out, "address", NULL, contact->emails_field[i]);
+		if (i == contact->pref_email)
+			write_attr(&out, "primary", NULL, "true");
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* Here begin extra fields */
 	if (contact->content && contact->content[0]) {
-		node = xmlNewNode(NULL, "atom:content");
-		if (!node)
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "type", BAD_CAST "text");
-		xmlNodeAddContent(node, contact->content);
-		xmlAddChild(root, node);
+		open_tag(&out, atom_ns, "content");
+		write_attr(&out, "type", NULL, "text");
+		write_text(&out, atom_ns, "content", contact->content);
 	}
 
 	if (contact->nickname && contact->nickname[0]) {
-		node = xmlNewNode(NULL, "gContact:nickname");
-		if (!node)
-			goto cleanup;
-		xmlNodeAddContent(node, contact->nickname);
-		xmlAddChild(root, node);
+		open_tag(&out, gContact_ns, "nickname");
+		write_text(&out, gContact_ns, "nickname", contact->nickname);
 	}
 
 	if (contact->homepage && contact->homepage[0]) {
-		if (!(node = xmlNewNode(NULL, "gContact:website")))
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "rel", BAD_CAST "home-page");
-		xmlSetProp(node, BAD_CAST "href", BAD_CAST contact->homepage);
-		xmlAddChild(root, node);
+		open_tag(&out, gContact_ns, "website");
+		write_attr(&out, "rel", NULL, "home-page");
+		write_attr(&out, "href", NULL, contact->homepage);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	if (contact->blog && contact->blog[0]) {
-		if (!(node = xmlNewNode(NULL, "gContact:website")))
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "rel", BAD_CAST "blog");
-		xmlSetProp(node, BAD_CAST "href", BAD_CAST contact->blog);
-		xmlAddChild(root, node);
+		open_tag(&out, gContact_ns, "website");
+		write_attr(&out, "rel", NULL, "blog");
+		write_attr(&out, "href", NULL, contact->blog);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* organization (it has 2 subelements: orgName, orgTitle) */
 	if (contact->org_name && contact->org_name[0] || contact->org_title && contact->org_title[0]) {
-		if (!(node = xmlNewNode(ns, "organization")))
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "rel",
-			   BAD_CAST "http://schemas.google.com/g/2005#other");
+		open_tag(&out, gd_ns, "organization");
+		write_attr(&out, "rel", NULL,
+			   "http://schemas.google.com/g/2005#other");
+		xml_write_raw(&out, ">", 1);
 
 		if (contact->org_name && contact->org_name[0]) {
-			if (!(child = xmlNewNode(ns, "orgName")))
-				goto cleanup;
-			xmlNodeAddContent(child, contact->org_name);
-			xmlAddChild(node, child);
+			open_tag(&out, gd_ns, "orgName");
+			write_text(&out, gd_ns, "orgName", contact->org_name);
 		}
 
-
 		if (contact->org_title && contact->org_title[0]) {
-			if (!(child = xmlNewNode(ns, "orgTitle")))
-				goto cleanup;
-			xmlNodeAddContent(child, contact->org_title);
-			xmlAddChild(node, child);
+			open_tag(&out, gd_ns, "orgTitle");
+			write_text(&out, gd_ns, "orgTitle", contact->org_title);
 		}
 
-		xmlAddChild(root, node);
+		close_tag(&out, gd_ns, "organization");
 	}
 
 	if (contact->occupation && contact->occupation[0]) {
-		node = xmlNewNode(NULL, "gContact:occupation");
-		if (!node)
-			goto cleanup;
-		xmlNodeAddContent(node, contact->occupation);
-		xmlAddChild(root, node);
+		open_tag(&out, gContact_ns, "occupation");
+		write_text(&out, gContact_ns, "occupation",
+			   contact->occupation);
 	}
 
 	/* Get phone numbers */
-	if (contact->phone_numbers_nr > 0) {
-		for (i = 0; i < contact->phone_numbers_nr; i++) {
-			if (!(node = xmlNewNode(ns, "phoneNumber")))
-				goto cleanup;
-			/* TODO: support user setting phone type */
-
-			temp = (char *)malloc((strlen(contact->phone_numbers_type[i])+strlen(rel_prefix)+1) * sizeof(char));
-			strcpy(temp, rel_prefix);
-			strcat(temp, contact->phone_numbers_type[i]);
-			xmlSetProp(node, BAD_CAST "rel",
-				  BAD_CAST temp);
-
-			xmlNodeAddContent(node, contact->phone_numbers_field[i]);
-			xmlAddChild(root, node);
-			free(temp);
-		}
+	for (i = 0; i < contact->phone_numbers_nr; i++) {
+		/* TODO: support user setting phone type */
+		open_tag(&out, gd_ns, "phoneNumber");
+		write_attr(&out, "rel", rel_prefix,
+			   contact->phone_numbers_type[i]);
+		write_text(&out, gd_ns, "phoneNumber",
+			   contact->phone_numbers_field[i]);
 	}
 
 	/* im addresses */
-	if (contact->im_nr > 0) {
-		for (i = 0; i < contact->im_nr; i++) {
-			if (!(node = xmlNewNode(ns, "im")))
-				goto cleanup;
-			temp = (char *)malloc((strlen(contact->im_type[i])+strlen(rel_prefix)+1) * sizeof(char));
-			strcpy(temp, rel_prefix);
-			strcat(temp, contact->im_type[i]);
-			xmlSetProp(node, BAD_CAST "rel",
-				  BAD_CAST temp);
-			temp = (char *)malloc((strlen(contact->im_protocol[i])+strlen(rel_prefix)+1) * sizeof(char));
-			strcpy(temp, rel_prefix);
-			strcat(temp, contact->im_protocol[i]);
-			xmlSetProp(node, BAD_CAST "protocol",
-				  BAD_CAST temp);
-			xmlSetProp(node, BAD_CAST "address",
-				  BAD_CAST contact->im_address[i]);
-			if (i == contact->im_pref)
-				xmlSetProp(node, BAD_CAST "primary",
-					  BAD_CAST "true");
-			xmlAddChild(root, node);
-			free(temp);
-		}
+	for (i = 0; i < contact->im_nr; i++) {
+		open_tag(&out, gd_ns, "im");
+		write_attr(&out, "rel", rel_prefix, contact->im_type[i]);
+		write_attr(&out, "protocol", rel_prefix,
+			   contact->im_protocol[i]);
+		write_attr(&out, "address", NULL, contact->im_address[i]);
+		if (i == contact->im_pref)
+			write_attr(&out, "primary", NULL, "true");
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* Sets contact structured postal addressees (Google API 3.0) */
-	/* TODO: move this to another function (identation is looking bad) */
-	if (contact->structured_address_nr > 0) {
-		for (i = 0; i < contact->structured_address_nr; i++) {
-			set_structured_entry = 0;
-			for (this_structured_entry = contact->structured_address;
-			     this_structured_entry != NULL;
-			     this_structured_entry = this_structured_entry->next_field) {
-				if (this_structured_entry->field_value &&
-				    this_structured_entry->field_key &&
-				    (this_structured_entry->field_typenr == i)) {
-					if (!set_structured_entry) {
-						if (!(node = xmlNewNode(ns, "structuredPostalAddress")))
-							goto cleanup;
-						// TODO: support user settting address type
-						temp = (char *)malloc((strlen(contact->structured_address_type[i])+strlen(rel_prefix)+2) * sizeof(char));
-						strcpy(temp, rel_prefix);
-						strcat(temp, contact->structured_address_type[i]);
-						xmlSetProp(node, BAD_CAST "rel", BAD_CAST temp);
-						set_structured_entry = 1;
-						free(temp);
-					}
-
-					if (!(child = xmlNewNode(ns, BAD_CAST this_structured_entry->field_key)))
-						goto cleanup;
-					xmlNodeAddContent(child, BAD_CAST this_structured_entry->field_value);
-					if (i == contact->structured_address_pref)
-						xmlSetProp(node, BAD_CAST "primary",
-							BAD_CAST "true");
-					xmlAddChild(node, child);
-				}
+	for (i = 0; i < contact->structured_address_nr; i++) {
+		set_structured_entry = 0;
+		for (this_structured_entry = contact->structured_address;
+		     this_structured_entry != NULL;
+		     this_structured_entry = this_structured_entry->next_field) {
+			if (!this_structured_entry->field_value ||
+			    !this_structured_entry->field_key ||
+			    (this_structured_entry->field_typenr != i))
+				continue;
+
+			if (!set_structured_entry) {
+				// TODO: support user settting address type
+				open_tag(&out, gd_ns, "structuredPostalAddress");
+				write_attr(&out, "rel", rel_prefix,
+					   contact->structured_address_type[i]);
+				if (i == contact->structured_address_pref)
+					write_attr(&out, "primary", NULL, "true");
+				xml_write_raw(&out, ">", 1);
+				set_structured_entry = 1;
 			}
 
-			if (set_structured_entry)
-				xmlAddChild(root, node);
+			open_tag(&out, gd_ns, this_structured_entry->field_key);
+			write_text(&out, gd_ns, this_structured_entry->field_key,
+				   this_structured_entry->field_value);
 		}
-	} else if (contact->post_address && contact->post_address[0]) {
-		node = xmlNewNode(NULL, "gd:structuredPostalAddress");
-		if (!node)
-			goto cleanup;
-		node2 = xmlNewNode(NULL, "gd:formattedAddress");
-		xmlNodeAddContent(node2, contact->post_address);
-		xmlAddChild(node, node2);
-		xmlAddChild(root, node);
+
+		if (set_structured_entry)
+			close_tag(&out, gd_ns, "structuredPostalAddress");
+	}
+
+	if ((contact->structured_address_nr <= 0) &&
+	    contact->post_address && contact->post_address[0]) {
+		open_tag(&out, gd_ns, "structuredPostalAddress");
+		xml_write_raw(&out, ">", 1);
+		open_tag(&out, gd_ns, "formattedAddress");
+		write_text(&out, gd_ns, "formattedAddress",
+			   contact->post_address);
+		close_tag(&out, gd_ns, "structuredPostalAddress");
 	}
 
 	/* Google group membership info */
-	if (contact->groupMembership_nr > 0) {
-		for (i = 0; i < contact->groupMembership_nr; i++) {
-			if (!(node = xmlNewNode(ns2, "groupMembershipInfo")))
-				goto cleanup;
-			xmlSetProp(node, BAD_CAST "deleted",
-				  BAD_CAST "false");
-			xmlSetProp(node, BAD_CAST "href",
-				  BAD_CAST contact->groupMembership[i]);
-			xmlAddChild(root, node);
-		}
+	for (i = 0; i < contact->groupMembership_nr; i++) {
+		open_tag(&out, gContact_ns, "groupMembershipInfo");
+		write_attr(&out, "deleted", NULL, "false");
+		write_attr(&out, "href", NULL, contact->groupMembership[i]);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* birthday */
 	if (contact->birthday && contact->birthday[0]) {
-		/*if (!(node = xmlNewNode(NULL, BAD_CAST "gContact:birthday")))
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "xmlns", BAD_CAST "http://schemas.google.com/contact/2008");*/
-		if (!(node = xmlNewNode(NULL, "gContact:birthday")))
-			goto cleanup;
-		xmlSetProp(node, BAD_CAST "when", BAD_CAST contact->birthday);
-		xmlAddChild(root, node);
+		open_tag(&out, gContact_ns, "birthday");
+		write_attr(&out, "when", NULL, contact->birthday);
+		xml_write_raw(&out, "/>", 2);
 	}
 
 	/* TODO: implement missing fields (which ones? geo location?)
 	 */
 
-	xmlDocDumpMemory(doc, &xml_str, length);
-	/* xmlDocDumpMemory doesn't include the last 0 in the returned size */
-	++(*length);
-	if (xml_str)
-		if ((*xml_contact = strdup(xml_str)))
-			result = 0;
-cleanup:
+	close_tag(&out, atom_ns, "entry");
 
-	if (xml_str)
-		xmlFree(xml_str);
+	return end_document(&out, length);
+}
 
-	if (doc)
-		xmlFreeDoc(doc);
+int xmlcontact_create(struct gcal_contact *contact, char **xml_contact,
+		      int *length)
+{
+	char *buffer = NULL;
+	size_t size = 0, written;
 
-exit:
+	if (xmlcontact_write(contact, &buffer, &size, &written)) {
+		if (buffer)
+			free(buffer);
+		return -1;
+	}
 
-	return result;
+	*xml_contact = buffer;
+	/* The length includes the last 0 */
+	*length = written + 1;
+
+	return 0;
 }
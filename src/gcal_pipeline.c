@@ -0,0 +1,495 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_pipeline.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Pipelined download of feeds.
+ *
+ * Rings use the GCC atomic builtins. Each index is written by a single
+ * thread (tail by the producer, head by the consumer), a thread that
+ * can't go on sleeps after announcing it in 'sleeping', so the other
+ * thread only takes the lock to wake it up.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <libxml/parser.h>
+
+#include "internal_gcal.h"
+#include "gcal_pipeline.h"
+#include "gcal_retry.h"
+#include "gcalendar.h"
+#include "gcontact.h"
+
+#define RING_LOAD(x) __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define RING_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+
+/** Length of the ring of downloaded chunks (each one has at most
+ * CURL_MAX_WRITE_SIZE bytes).
+ */
+#define PIPELINE_CHUNKS 16
+
+/** A bounded single producer/single consumer queue */
+struct gcal_ring {
+	/** The items */
+	void **slots;
+	/** Number of slots (a power of 2) */
+	size_t size;
+	/** Count of popped items (written by the consumer) */
+	size_t head;
+	/** Count of pushed items (written by the producer) */
+	size_t tail;
+	/** Set by the producer after the last push */
+	int closed;
+	/** Set when the producer must stop */
+	int canceled;
+	/** Number of threads waiting on 'cond' */
+	int sleeping;
+	/** Protects the sleep */
+	pthread_mutex_t lock;
+	/** Signals a push, a pop, the close or the cancel */
+	pthread_cond_t cond;
+};
+
+struct gcal_ring *gcal_ring_new(size_t length)
+{
+	struct gcal_ring *ring;
+	size_t size = 1;
+
+	while (size < length)
+		size *= 2;
+
+	if (!(ring = malloc(sizeof(struct gcal_ring))))
+		return NULL;
+	memset(ring, 0, sizeof(struct gcal_ring));
+
+	if (!(ring->slots = malloc(sizeof(void *) * size))) {
+		free(ring);
+		return NULL;
+	}
+	ring->size = size;
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+
+	return ring;
+}
+
+void gcal_ring_delete(struct gcal_ring *ring)
+{
+	if (!ring)
+		return;
+
+	pthread_cond_destroy(&ring->cond);
+	pthread_mutex_destroy(&ring->lock);
+	free(ring->slots);
+	free(ring);
+}
+
+static int can_push(struct gcal_ring *ring)
+{
+	return RING_LOAD(ring->canceled) ||
+		(RING_LOAD(ring->tail) - RING_LOAD(ring->head) < ring->size);
+}
+
+static int can_pop(struct gcal_ring *ring)
+{
+	return RING_LOAD(ring->closed) ||
+		(RING_LOAD(ring->tail) != RING_LOAD(ring->head));
+}
+
+/* The check is repeated after 'sleeping' is set: either it sees the
+ * change or the other thread sees the sleeper.
+ */
+static void ring_wait(struct gcal_ring *ring,
+		      int (*ready)(struct gcal_ring *ring))
+{
+	pthread_mutex_lock(&ring->lock);
+	__atomic_add_fetch(&ring->sleeping, 1, __ATOMIC_SEQ_CST);
+	while (!ready(ring))
+		pthread_cond_wait(&ring->cond, &ring->lock);
+	__atomic_sub_fetch(&ring->sleeping, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+static void ring_wake(struct gcal_ring *ring)
+{
+	if (!RING_LOAD(ring->sleeping))
+		return;
+
+	pthread_mutex_lock(&ring->lock);
+	pthread_cond_broadcast(&ring->cond);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+int gcal_ring_push(struct gcal_ring *ring, void *item)
+{
+	size_t tail;
+
+	if ((!ring) || (!item))
+		return -1;
+
+	tail = ring->tail;
+	while (!can_push(ring))
+		ring_wait(ring, can_push);
+	if (RING_LOAD(ring->canceled))
+		return -1;
+
+	ring->slots[tail & (ring->size - 1)] = item;
+	RING_STORE(ring->tail, tail + 1);
+	ring_wake(ring);
+
+	return 0;
+}
+
+void *gcal_ring_pop(struct gcal_ring *ring, int wait)
+{
+	size_t head;
+	void *item;
+
+	if (!ring)
+		return NULL;
+
+	head = ring->head;
+	while (RING_LOAD(ring->tail) == head) {
+		/* Last pushes happen before the close */
+		if ((!wait) || ((RING_LOAD(ring->closed)) &&
+				(RING_LOAD(ring->tail) == head)))
+			return NULL;
+		ring_wait(ring, can_pop);
+	}
+
+	item = ring->slots[head & (ring->size - 1)];
+	RING_STORE(ring->head, head + 1);
+	ring_wake(ring);
+
+	return item;
+}
+
+void gcal_ring_close(struct gcal_ring *ring)
+{
+	if (!ring)
+		return;
+
+	RING_STORE(ring->closed, 1);
+	ring_wake(ring);
+}
+
+void gcal_ring_cancel(struct gcal_ring *ring)
+{
+	if (!ring)
+		return;
+
+	RING_STORE(ring->canceled, 1);
+	ring_wake(ring);
+}
+
+/** Part of the feed, as received by the network stage */
+struct gcal_chunk {
+	/** Length of data */
+	size_t length;
+	/** The data */
+	char data[];
+};
+
+/** A feed going through the pipeline */
+struct gcal_pipeline {
+	/** Feed owner (only the network stage uses it) */
+	struct gcal_resource *gcalobj;
+	/** If it is a contacts feed */
+	char contacts;
+	/** Google Data API version header */
+	const char *gdata_version;
+	/** Delivery callback */
+	gcal_stream_cb deliver;
+	/** Delivery callback user data */
+	void *deliver_user;
+	/** Persistence callback (can be NULL) */
+	gcal_stream_cb persist;
+	/** Persistence callback user data */
+	void *persist_user;
+	/** Network to parser */
+	struct gcal_ring *chunks;
+	/** Parser to delivery */
+	struct gcal_ring *entries;
+	/** Delivery to persistence */
+	struct gcal_ring *stored;
+	/** Parser of the feed */
+	struct gcal_stream *stream;
+	/** If the network stage sent any chunk */
+	char pushed;
+	/** Result of network stage (valid after 'chunks' is closed) */
+	int received;
+	/** Result of parser stage (valid after 'entries' is closed) */
+	int parsed;
+	/** Set when a callback stops the pipeline */
+	int stopped;
+};
+
+static void free_entry(char contacts, void *entry)
+{
+	if (contacts)
+		gcal_contact_delete(entry);
+	else
+		gcal_event_delete(entry);
+}
+
+/* A user callback asked to stop: the parser stops pushing entries, so it
+ * stops the network stage too.
+ */
+static void stop(struct gcal_pipeline *pipeline)
+{
+	RING_STORE(pipeline->stopped, 1);
+	gcal_ring_cancel(pipeline->entries);
+}
+
+static size_t write_cb_pipeline(void *ptr, size_t count, size_t chunk_size,
+				void *data)
+{
+	size_t size = count * chunk_size;
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)data;
+	struct gcal_chunk *chunk;
+	long code = 0;
+
+	/* Error and redirection pages are not the feed */
+	curl_easy_getinfo(pipeline->gcalobj->curl, CURLINFO_RESPONSE_CODE,
+			  &code);
+	if (code != GCAL_DEFAULT_ANSWER)
+		return gcal_write_buffer(ptr, count, chunk_size,
+					 pipeline->gcalobj);
+
+	/* Progress callback may only run after the whole feed was read, so a
+	 * cancel is checked here too. Anything different from size aborts
+	 * the transfer.
+	 */
+	if ((__atomic_load_n(&pipeline->gcalobj->canceled,
+			     __ATOMIC_SEQ_CST)) ||
+	    (!(chunk = malloc(sizeof(struct gcal_chunk) + size))))
+		return 0;
+	chunk->length = size;
+	memcpy(chunk->data, ptr, size);
+	if (gcal_ring_push(pipeline->chunks, chunk)) {
+		free(chunk);
+		return 0;
+	}
+
+	pipeline->pushed = 1;
+	return size;
+}
+
+/* Chunks sent to the parser can't be taken back */
+static int rewind_pipeline(struct gcal_resource *gcalobj, void *data)
+{
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)data;
+
+	if (pipeline->pushed)
+		return -1;
+
+	clean_buffer(gcalobj);
+	return 0;
+}
+
+static void *receive_stage(void *data)
+{
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)data;
+	struct gcal_resource *gcalobj = pipeline->gcalobj;
+	int result = -1, code, deadline;
+	char *url;
+
+	if (!(url = mount_query_url(gcalobj, NULL)))
+		goto exit;
+	code = prepare_follow_redirection(gcalobj, url, write_cb_pipeline,
+					  pipeline->gdata_version);
+	free(url);
+	if (code)
+		goto exit;
+	curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEDATA, (void *)pipeline);
+
+	/* Redirection is part of the same request */
+	deadline = gcal_deadline_start(gcalobj);
+
+	code = gcal_perform(gcalobj, rewind_pipeline, pipeline);
+	result = check_follow_redirection(gcalobj, code, 0);
+	if (result == 1) {
+		code = gcal_perform(gcalobj, rewind_pipeline, pipeline);
+		result = check_follow_redirection(gcalobj, code, 1);
+	}
+
+	gcal_deadline_end(gcalobj, deadline);
+
+exit:
+	pipeline->received = result;
+	gcal_ring_close(pipeline->chunks);
+	return NULL;
+}
+
+/* Called by the parser for each entry (the entry is taken) */
+static int parsed_entry(void **entry, void *user)
+{
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)user;
+
+	if (gcal_ring_push(pipeline->entries, *entry))
+		return 1;
+
+	*entry = NULL;
+	return 0;
+}
+
+static void *parse_stage(void *data)
+{
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)data;
+	struct gcal_chunk *chunk;
+	int result = 0;
+
+	while ((chunk = gcal_ring_pop(pipeline->chunks, 1))) {
+		/* On error (or stop) chunks are just dropped */
+		if ((!result) && (gcal_stream_parse(pipeline->stream,
+						    chunk->data,
+						    chunk->length))) {
+			result = -1;
+			gcal_ring_cancel(pipeline->chunks);
+		}
+		free(chunk);
+	}
+
+	if ((!result) && (!pipeline->received))
+		result = gcal_stream_finish(pipeline->stream);
+
+	pipeline->parsed = result;
+	gcal_ring_close(pipeline->entries);
+	return NULL;
+}
+
+static void *persist_stage(void *data)
+{
+	struct gcal_pipeline *pipeline = (struct gcal_pipeline *)data;
+	void *entry;
+
+	while ((entry = gcal_ring_pop(pipeline->stored, 1))) {
+		if ((!RING_LOAD(pipeline->stopped)) &&
+		    (pipeline->persist(&entry, pipeline->persist_user))) {
+			stop(pipeline);
+			gcal_ring_cancel(pipeline->stored);
+		}
+		if (entry)
+			free_entry(pipeline->contacts, entry);
+	}
+
+	return NULL;
+}
+
+int gcal_pipeline_run(struct gcal_resource *gcalobj, char contacts,
+		      const char *gdata_version,
+		      gcal_stream_cb deliver, void *deliver_user,
+		      gcal_stream_cb persist, void *persist_user)
+{
+	struct gcal_pipeline pipeline;
+	pthread_t parser, receiver, saver;
+	int result = -1, has_receiver = 0, has_saver = 0;
+	void *entry;
+
+	if ((!gcalobj) || (!deliver))
+		return result;
+	/* Failed to get authentication token */
+	if (!gcalobj->auth)
+		return result;
+
+	memset(&pipeline, 0, sizeof(pipeline));
+	pipeline.gcalobj = gcalobj;
+	pipeline.contacts = contacts;
+	pipeline.gdata_version = gdata_version;
+	pipeline.deliver = deliver;
+	pipeline.deliver_user = deliver_user;
+	pipeline.persist = persist;
+	pipeline.persist_user = persist_user;
+	pipeline.received = -1;
+
+	/* Parser is used by other threads */
+	xmlInitParser();
+
+	if ((!(pipeline.chunks = gcal_ring_new(PIPELINE_CHUNKS))) ||
+	    (!(pipeline.entries = gcal_ring_new(gcalobj->stream_queue))) ||
+	    ((persist) &&
+	     (!(pipeline.stored = gcal_ring_new(gcalobj->stream_queue)))) ||
+	    (!(pipeline.stream = gcal_stream_new(gcalobj, contacts,
+						 parsed_entry, &pipeline))))
+		goto cleanup;
+
+	if (pthread_create(&parser, NULL, parse_stage, &pipeline))
+		goto cleanup;
+	if (persist)
+		has_saver = !pthread_create(&saver, NULL, persist_stage,
+					    &pipeline);
+	if ((!persist) || (has_saver))
+		has_receiver = !pthread_create(&receiver, NULL, receive_stage,
+					       &pipeline);
+	/* Without network stage, the parser gets an empty feed */
+	if (!has_receiver)
+		gcal_ring_close(pipeline.chunks);
+
+	/* Delivery stage */
+	while ((entry = gcal_ring_pop(pipeline.entries, 1))) {
+		if ((!RING_LOAD(pipeline.stopped)) &&
+		    (deliver(&entry, deliver_user)))
+			stop(&pipeline);
+		if (!entry)
+			continue;
+		if ((has_saver) && (!RING_LOAD(pipeline.stopped)) &&
+		    (!gcal_ring_push(pipeline.stored, entry)))
+			continue;
+		free_entry(contacts, entry);
+	}
+
+	if (has_saver) {
+		gcal_ring_close(pipeline.stored);
+		pthread_join(saver, NULL);
+	}
+	if (has_receiver)
+		pthread_join(receiver, NULL);
+	pthread_join(parser, NULL);
+
+	if (RING_LOAD(pipeline.stopped))
+		result = 0;
+	else if ((!pipeline.received) && (!pipeline.parsed))
+		result = 0;
+
+cleanup:
+	gcal_stream_delete(pipeline.stream);
+	gcal_ring_delete(pipeline.stored);
+	gcal_ring_delete(pipeline.entries);
+	gcal_ring_delete(pipeline.chunks);
+	return result;
+}
@@ -0,0 +1,502 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_retry.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Retry of failed requests, rate limit and deadlines.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "internal_gcal.h"
+#include "gcal_retry.h"
+#include "gcal_status.h"
+#include "gcal_hedge.h"
+
+static const int GCAL_TOO_MANY_REQUESTS = 429;
+
+/** Token bucket of an account, shared by all objects authenticated as it */
+struct gcal_bucket {
+	/** Account name (i.e. user@domain) */
+	char *account;
+	/** Number of objects using it */
+	int refs;
+	/** Available tokens */
+	double tokens;
+	/** When the tokens were last updated (in seconds), 0 if never */
+	double last;
+	/** Next bucket */
+	struct gcal_bucket *next;
+};
+
+/* Buckets in use, protected by the lock (objects of an account can run
+ * in distinct threads).
+ */
+static pthread_mutex_t buckets_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct gcal_bucket *buckets = NULL;
+
+/* Current time in seconds (monotonic clock) */
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_ms(long ms)
+{
+	struct timespec wait, left;
+
+	wait.tv_sec = ms / 1000;
+	wait.tv_nsec = (ms % 1000) * 1000000;
+	while ((nanosleep(&wait, &left) == -1) && (errno == EINTR))
+		wait = left;
+}
+
+/* Must be called with the lock */
+static void bucket_unref(struct gcal_bucket *bucket)
+{
+	struct gcal_bucket **ptr;
+
+	if (--bucket->refs)
+		return;
+
+	for (ptr = &buckets; *ptr; ptr = &(*ptr)->next)
+		if (*ptr == bucket) {
+			*ptr = bucket->next;
+			break;
+		}
+	free(bucket->account);
+	free(bucket);
+}
+
+int gcal_rate_account(struct gcal_resource *gcalobj, const char *account)
+{
+	struct gcal_bucket *bucket;
+	int result = -1;
+
+	pthread_mutex_lock(&buckets_lock);
+	if ((gcalobj->bucket) && (account) &&
+	    (!strcmp(gcalobj->bucket->account, account))) {
+		result = 0;
+		goto exit;
+	}
+
+	if (gcalobj->bucket) {
+		bucket_unref(gcalobj->bucket);
+		gcalobj->bucket = NULL;
+	}
+	if (!account) {
+		result = 0;
+		goto exit;
+	}
+
+	for (bucket = buckets; bucket; bucket = bucket->next)
+		if (!strcmp(bucket->account, account))
+			break;
+
+	if (!bucket) {
+		if (!(bucket = malloc(sizeof(struct gcal_bucket))))
+			goto exit;
+		if (!(bucket->account = strdup(account))) {
+			free(bucket);
+			goto exit;
+		}
+		bucket->refs = 0;
+		bucket->tokens = 0;
+		bucket->last = 0;
+		bucket->next = buckets;
+		buckets = bucket;
+	}
+
+	++bucket->refs;
+	gcalobj->bucket = bucket;
+	result = 0;
+
+exit:
+	pthread_mutex_unlock(&buckets_lock);
+	return result;
+}
+
+/* Sleeps in small steps, so a cancel doesn't wait the whole delay.
+ * Returns -1 if request was canceled.
+ */
+static int pause_ms(struct gcal_resource *gcalobj, long ms)
+{
+	long step;
+
+	while (ms > 0) {
+		if (__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST))
+			return -1;
+		step = ms < 100 ? ms : 100;
+		sleep_ms(step);
+		ms -= step;
+	}
+
+	return __atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST) ? -1 : 0;
+}
+
+/* Miliseconds until the deadline (0 if it has passed), -1 if there is no
+ * deadline.
+ */
+static long remaining_ms(struct gcal_resource *gcalobj)
+{
+	double left;
+
+	if (!gcalobj->policy.deadline)
+		return -1;
+
+	left = gcalobj->policy.deadline - now();
+	return left > 0 ? (long)(left * 1000) : 0;
+}
+
+int gcal_deadline_start(struct gcal_resource *gcalobj)
+{
+	if ((!gcalobj) || (!gcalobj->policy.timeout) ||
+	    (gcalobj->policy.deadline))
+		return 0;
+
+	gcalobj->policy.deadline = now() + gcalobj->policy.timeout / 1000.0;
+	return 1;
+}
+
+void gcal_deadline_end(struct gcal_resource *gcalobj, int started)
+{
+	if ((gcalobj) && (started))
+		gcalobj->policy.deadline = 0;
+}
+
+void gcal_deadline_apply(struct gcal_resource *gcalobj, CURL *curl)
+{
+	long left = remaining_ms(gcalobj);
+
+	/* A timeout of 0 would disable it */
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS,
+			 left == -1 ? 0L : (left ? left : 1L));
+}
+
+int gcal_progress_cb(void *data, curl_off_t dltotal, curl_off_t dlnow,
+		     curl_off_t ultotal, curl_off_t ulnow)
+{
+	struct gcal_resource *gcalobj = (struct gcal_resource *)data;
+
+	(void)dltotal; /* prevent compiler warning */
+	(void)dlnow;
+	(void)ultotal;
+	(void)ulnow;
+
+	/* Anything different from 0 aborts the transfer */
+	return __atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST) ? 1 : 0;
+}
+
+/* Checks if request was interrupted (i.e. canceled or out of time, a
+ * low speed timeout can still be retried), the partial answer is dropped.
+ */
+static int interrupted(struct gcal_resource *gcalobj, CURLcode code,
+		       int last)
+{
+	long left = remaining_ms(gcalobj);
+
+	/* Cancel is consumed by the request it aborts. Write callbacks can
+	 * refuse the data of a canceled request too.
+	 */
+	if (((code == CURLE_ABORTED_BY_CALLBACK) ||
+	     (code == CURLE_WRITE_ERROR)) &&
+	    (__atomic_exchange_n(&gcalobj->canceled, 0, __ATOMIC_SEQ_CST))) {
+		gcalobj->internal_status = GCAL_INTERRUPT_CANCEL;
+	} else if ((code == CURLE_OPERATION_TIMEDOUT) &&
+		   ((last) || ((left != -1) && (left < 10))))
+		gcalobj->internal_status = GCAL_INTERRUPT_TIMEOUT;
+	else
+		return 0;
+
+	clean_buffer(gcalobj);
+	return 1;
+}
+
+CURLcode gcal_rate_limit(struct gcal_resource *gcalobj)
+{
+	struct gcal_policy *policy;
+	double *tokens, *last, current, wait = 0;
+	long delay, left;
+	CURLcode result = CURLE_OK;
+
+	if ((!gcalobj) || (gcalobj->policy.rate <= 0))
+		return CURLE_OK;
+
+	policy = &gcalobj->policy;
+	pthread_mutex_lock(&buckets_lock);
+	if (gcalobj->bucket) {
+		tokens = &gcalobj->bucket->tokens;
+		last = &gcalobj->bucket->last;
+	} else {
+		tokens = &policy->tokens;
+		last = &policy->last;
+	}
+
+	/* A bucket starts full */
+	current = now();
+	if (*last)
+		*tokens += (current - *last) * policy->rate;
+	else
+		*tokens = policy->burst;
+	if (*tokens > policy->burst)
+		*tokens = policy->burst;
+	*last = current;
+
+	/* Token is taken now, so others wait after us; it is only refilled
+	 * later (sleeping out of the lock).
+	 */
+	*tokens -= 1;
+	if (*tokens < 0)
+		wait = -*tokens / policy->rate;
+	pthread_mutex_unlock(&buckets_lock);
+
+	if (wait <= 0)
+		return CURLE_OK;
+
+	/* Waiting can't go beyond the deadline, nor survive a cancel */
+	delay = (long)(wait * 1000) + 1;
+	left = remaining_ms(gcalobj);
+	if ((left != -1) && (delay > left)) {
+		delay = left;
+		result = CURLE_OPERATION_TIMEDOUT;
+	}
+	if (pause_ms(gcalobj, delay))
+		result = CURLE_ABORTED_BY_CALLBACK;
+
+	/* Request won't be sent, so the token is given back */
+	if (result != CURLE_OK) {
+		pthread_mutex_lock(&buckets_lock);
+		*tokens += 1;
+		pthread_mutex_unlock(&buckets_lock);
+	}
+
+	return result;
+}
+
+long gcal_retry_after(const char *value, size_t length)
+{
+	char buffer[64];
+	char *end;
+	long result;
+	time_t date;
+
+	if ((!value) || (!length) || (length >= sizeof(buffer)))
+		return -1;
+
+	memcpy(buffer, value, length);
+	buffer[length] = '\0';
+
+	result = strtol(buffer, &end, 10);
+	if ((end != buffer) && (!*end))
+		return result < 0 ? -1 : result;
+
+	/* Or a date like 'Fri, 31 Dec 1999 23:59:59 GMT' */
+	if ((date = curl_getdate(buffer, NULL)) == -1)
+		return -1;
+
+	result = date - time(NULL);
+	return result < 0 ? 0 : result;
+}
+
+/* Network errors and temporary server errors are worth a retry */
+static int temporary_failure(struct gcal_resource *gcalobj, CURLcode code)
+{
+	long http_code = 0;
+
+	switch (code) {
+	case CURLE_OK:
+		break;
+	case CURLE_COULDNT_RESOLVE_HOST:
+	case CURLE_COULDNT_CONNECT:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_SEND_ERROR:
+	case CURLE_RECV_ERROR:
+	case CURLE_GOT_NOTHING:
+	case CURLE_PARTIAL_FILE:
+		return 1;
+	default:
+		return 0;
+	}
+
+	curl_easy_getinfo(gcalobj->curl, CURLINFO_RESPONSE_CODE, &http_code);
+	return (http_code == GCAL_TOO_MANY_REQUESTS) ||
+		(http_code == 500) || (http_code == 502) ||
+		(http_code == 503) || (http_code == 504);
+}
+
+/* A request that isn't idempotent (i.e. POST adding an entry) is only
+ * repeated when server surely didn't process it: it wasn't sent or server
+ * refused it, asking for a later retry. A timeout or 5xx answer could come
+ * after the entry was added, a retry would add it twice.
+ */
+static int unprocessed_failure(struct gcal_resource *gcalobj, CURLcode code)
+{
+	long http_code = 0, sent = 0;
+
+	switch (code) {
+	case CURLE_OK:
+		break;
+	case CURLE_COULDNT_RESOLVE_PROXY:
+	case CURLE_COULDNT_RESOLVE_HOST:
+	case CURLE_COULDNT_CONNECT:
+		return 1;
+	default:
+		/* e.g. timeout while connecting */
+		curl_easy_getinfo(gcalobj->curl, CURLINFO_REQUEST_SIZE, &sent);
+		return (!sent) && (temporary_failure(gcalobj, code));
+	}
+
+	curl_easy_getinfo(gcalobj->curl, CURLINFO_RESPONSE_CODE, &http_code);
+	return ((http_code == GCAL_TOO_MANY_REQUESTS) || (http_code == 503)) &&
+		(gcalobj->retry_after >= 0);
+}
+
+/* Exponential backoff with jitter: a random value between half and full
+ * delay (so clients don't retry all at once), but never shorter than what
+ * server asked.
+ */
+static long retry_delay(struct gcal_resource *gcalobj, int attempt)
+{
+	struct gcal_policy *policy = &gcalobj->policy;
+	long delay = policy->delay, half;
+
+	while ((attempt-- > 0) && (delay < policy->max_delay))
+		delay *= 2;
+	if (delay > policy->max_delay)
+		delay = policy->max_delay;
+
+	half = delay / 2;
+	if (half > 0)
+		delay = half + rand_r(&policy->seed) % (half + 1);
+
+	if ((gcalobj->retry_after >= 0) &&
+	    (gcalobj->retry_after * 1000 > delay))
+		delay = gcalobj->retry_after * 1000;
+
+	return delay;
+}
+
+static CURLcode send_request(struct gcal_resource *gcalobj)
+{
+	return curl_easy_perform(gcalobj->curl);
+}
+
+static CURLcode perform(struct gcal_resource *gcalobj, gcal_rewind_cb rewind,
+			void *data, CURLcode (*send)(struct gcal_resource *),
+			int idempotent)
+{
+	CURLcode result;
+	long delay, left;
+	int attempt = 0, deadline;
+
+	gcalobj->internal_status = GCAL_INTERRUPT_NONE;
+	deadline = gcal_deadline_start(gcalobj);
+
+	while (1) {
+		result = gcal_rate_limit(gcalobj);
+		if (result != CURLE_OK) {
+			interrupted(gcalobj, result, 1);
+			break;
+		}
+		gcalobj->retry_after = -1;
+
+		/* Each try can only use what is left of the deadline */
+		gcal_deadline_apply(gcalobj, gcalobj->curl);
+
+		result = send(gcalobj);
+		if (interrupted(gcalobj, result, 0))
+			break;
+		if ((attempt >= gcalobj->policy.retries) ||
+		    ((idempotent) && (!temporary_failure(gcalobj, result))) ||
+		    ((!idempotent) &&
+		     (!unprocessed_failure(gcalobj, result)))) {
+			interrupted(gcalobj, result, 1);
+			break;
+		}
+
+		delay = retry_delay(gcalobj, attempt++);
+		left = remaining_ms(gcalobj);
+		if ((left != -1) && (delay >= left)) {
+			interrupted(gcalobj, result, 1);
+			break;
+		}
+
+		if (rewind) {
+			if (rewind(gcalobj, data)) {
+				interrupted(gcalobj, result, 1);
+				break;
+			}
+		} else
+			clean_buffer(gcalobj);
+
+		if (gcalobj->fout_log)
+			fprintf(gcalobj->fout_log, "gcal_perform: retry %d in "
+				"%ld ms\n", attempt, delay);
+		if (pause_ms(gcalobj, delay)) {
+			interrupted(gcalobj, CURLE_ABORTED_BY_CALLBACK, 1);
+			result = CURLE_ABORTED_BY_CALLBACK;
+			break;
+		}
+	}
+
+	gcal_deadline_end(gcalobj, deadline);
+	return result;
+}
+
+CURLcode gcal_perform(struct gcal_resource *gcalobj, gcal_rewind_cb rewind,
+		      void *data)
+{
+	return perform(gcalobj, rewind, data, send_request, 1);
+}
+
+CURLcode gcal_perform_post(struct gcal_resource *gcalobj)
+{
+	return perform(gcalobj, NULL, NULL, send_request, 0);
+}
+
+CURLcode gcal_perform_read(struct gcal_resource *gcalobj)
+{
+	return perform(gcalobj, NULL, NULL, gcal_hedge_send, 1);
+}
@@ -68,3 +68,11 @@ const char *gcal_status_msg(struct gcal_resource *ptr_gcal)
 
 	return ptr_gcal->curl_msg;
 }
+
+int gcal_status_interrupted(struct gcal_resource *ptr_gcal)
+{
+	if (!ptr_gcal)
+		return -1;
+
+	return ptr_gcal->internal_status;
+}
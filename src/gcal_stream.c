@@ -0,0 +1,942 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   gcal_stream.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  Streaming parser of feeds.
+ *
+ * The Atom parser uses the default libxml2 tree builder, but when an entry
+ * element of the feed ends it is extracted and removed from the tree. So
+ * the tree has at most the feed element and one entry.
+ *
+ * When a document ends, the data left starts another one: the same parser
+ * (reset) reads entries saved one after another (see \ref
+ * gcal_set_store_xml).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <libxml/parser.h>
+#include <libxml/SAX2.h>
+
+#include "internal_gcal.h"
+#include "gcal_stream.h"
+#include "gcal_retry.h"
+#include "gcal_status.h"
+#include "atom_parser.h"
+#include "json_parser.h"
+#include "gcont.h"
+
+/** Size of the first JSON buffer, it grows to fit the largest entry */
+#define STREAM_JSON_SIZE 4096
+
+/** A feed being parsed */
+struct gcal_stream {
+	/** Feed owner (it sets the entries options and downloads the feed) */
+	struct gcal_resource *gcalobj;
+	/** If it is a contacts feed */
+	char contacts;
+	/** Called for each entry */
+	gcal_stream_cb callback;
+	/** Callback user data */
+	void *user;
+	/** Entry memory, reused while the callback doesn't take it */
+	void *entry;
+	/** Number of entries handed to the callback */
+	size_t count;
+	/** If the feed format is known (first byte received) */
+	char started;
+	/** If it is a JSON feed */
+	char json;
+	/** Parsing ended: 1 stopped by the callback, -1 error */
+	int stopped;
+	/** If the download must pause (see \ref gcal_stream_hold) */
+	char hold;
+	/** If the transfer is paused */
+	char paused;
+	/** Handlers of the Atom parser */
+	xmlSAXHandler sax;
+	/** Atom push parser */
+	xmlParserCtxtPtr parser;
+	/** Bytes given to the Atom parser since its document started */
+	size_t fed;
+	/** If the root element of the Atom document ended */
+	char ended;
+	/** Where the Atom document ended (bytes since its start) */
+	long end;
+	/** JSON scan state */
+	struct json_scan scan;
+	/** JSON data not consumed yet */
+	char *pending;
+	/** Length of pending data */
+	size_t pending_length;
+	/** Allocated size of pending data */
+	size_t pending_size;
+};
+
+/* Frees the fields of an entry, its memory is kept */
+static void clean_entry(char contacts, void *entry)
+{
+	if (contacts)
+		gcal_destroy_contact(entry);
+	else
+		gcal_destroy_entry(entry);
+}
+
+/* Extracts an entry and hands it to the callback, either 'node' (Atom) or
+ * 'text' (JSON) is used.
+ */
+static void found(struct gcal_stream *stream, xmlNode *node,
+		  const char *text, size_t length)
+{
+	struct gcal_entry *common;
+	int result;
+
+	if (!stream->entry) {
+		if (stream->contacts)
+			stream->entry = malloc(sizeof(struct gcal_contact));
+		else
+			stream->entry = malloc(sizeof(struct gcal_event));
+		if (!stream->entry)
+			goto error;
+	}
+
+	if (stream->contacts) {
+		gcal_init_contact(stream->entry);
+		common = &((struct gcal_contact *)stream->entry)->common;
+	} else {
+		gcal_init_event(stream->entry);
+		common = &((struct gcal_event *)stream->entry)->common;
+	}
+	if (stream->gcalobj) {
+		if (stream->gcalobj->store_xml_entry)
+			common->store_xml = 1;
+		common->field_mask = stream->gcalobj->field_mask;
+	}
+
+	if (node && stream->contacts)
+		result = atom_extract_contact(node, stream->entry);
+	else if (node)
+		result = atom_extract_data(node, stream->entry);
+	else if (stream->contacts)
+		result = json_extract_contact(text, length, stream->entry);
+	else
+		result = json_extract_data(text, length, stream->entry);
+
+	if (result == -1) {
+		/* Fields extracted so far are freed with the entry */
+		clean_entry(stream->contacts, stream->entry);
+		goto error;
+	}
+
+	++stream->count;
+	if (stream->callback(&stream->entry, stream->user))
+		stream->stopped = 1;
+
+	/* Entry wasn't taken, its memory is reused */
+	if (stream->entry)
+		clean_entry(stream->contacts, stream->entry);
+
+	return;
+
+error:
+	stream->stopped = -1;
+}
+
+/* Removes an entry of the feed tree after its extraction (along with the
+ * text nodes before it, i.e. the blanks between entries).
+ */
+static void drop_entry(xmlNode *node)
+{
+	xmlNode *prev;
+
+	while ((prev = node->prev) && (prev->type == XML_TEXT_NODE)) {
+		xmlUnlinkNode(prev);
+		xmlFreeNode(prev);
+	}
+
+	xmlUnlinkNode(node);
+	xmlFreeNode(node);
+}
+
+static void end_element(void *ctx, const xmlChar *localname,
+			const xmlChar *prefix, const xmlChar *URI)
+{
+	xmlParserCtxtPtr parser = (xmlParserCtxtPtr)ctx;
+	struct gcal_stream *stream = (struct gcal_stream *)parser->_private;
+	xmlNode *node = parser->node, *parent;
+
+	xmlSAX2EndElementNs(ctx, localname, prefix, URI);
+
+	if ((!node) || (stream->stopped) || (!(parent = node->parent)))
+		return;
+
+	/* Entries of the feed or the root of a single entry document */
+	if ((!strcmp((const char *)localname, "entry")) &&
+	    ((parent->type == XML_DOCUMENT_NODE) ||
+	     ((parent->parent) &&
+	      (parent->parent->type == XML_DOCUMENT_NODE)))) {
+		found(stream, node, NULL, 0);
+		if (parent->type != XML_DOCUMENT_NODE)
+			drop_entry(node);
+	}
+
+	/* The parser stops at the end of the document, what comes next (if
+	 * anything) is another document.
+	 */
+	if (parent->type == XML_DOCUMENT_NODE) {
+		stream->ended = 1;
+		stream->end = xmlByteConsumed(parser);
+	}
+
+	if ((stream->stopped) || (stream->ended))
+		xmlStopParser(parser);
+}
+
+static int is_blank(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+/* Starts the next document, reusing the parser */
+static int next_document(struct gcal_stream *stream)
+{
+	if (stream->parser->myDoc) {
+		xmlFreeDoc(stream->parser->myDoc);
+		stream->parser->myDoc = NULL;
+	}
+
+	if (xmlCtxtResetPush(stream->parser, NULL, 0, "noname.xml", NULL))
+		return -1;
+
+	stream->parser->_private = stream;
+	stream->ended = 0;
+	stream->fed = 0;
+
+	return 0;
+}
+
+static int parse_atom(struct gcal_stream *stream, const char *data,
+		      size_t length)
+{
+	size_t used;
+
+	while (length) {
+		if (!stream->parser) {
+			memset(&stream->sax, 0, sizeof(stream->sax));
+			xmlSAXVersion(&stream->sax, 2);
+			stream->sax.endElementNs = end_element;
+
+			stream->parser = xmlCreatePushParserCtxt(&stream->sax,
+								 NULL, NULL, 0,
+								 "noname.xml");
+			if (!stream->parser)
+				return -1;
+			stream->parser->_private = stream;
+
+		} else if (stream->ended) {
+			/* Blanks between documents */
+			if (is_blank(*data)) {
+				++data;
+				--length;
+				continue;
+			}
+
+			if (next_document(stream))
+				return -1;
+		}
+
+		if ((xmlParseChunk(stream->parser, data, length, 0)) &&
+		    (!stream->stopped) && (!stream->ended))
+			return -1;
+
+		if ((stream->stopped) || (!stream->ended)) {
+			stream->fed += length;
+			break;
+		}
+
+		/* Document ended before the end of data, the rest is the
+		 * next one.
+		 */
+		if ((stream->end <= (long)stream->fed) ||
+		    (stream->end - stream->fed > length))
+			return -1;
+		used = stream->end - stream->fed;
+		data += used;
+		length -= used;
+	}
+
+	return 0;
+}
+
+/* Appends data to the pending JSON text and hands its complete entries to
+ * the callback, then drops the consumed text.
+ */
+static int parse_json(struct gcal_stream *stream, const char *data,
+		      size_t length)
+{
+	const char *entry;
+	size_t entry_length, used, offset = 0;
+	char *tmp;
+	int result;
+
+	if (stream->pending_length + length > stream->pending_size) {
+		if (!stream->pending_size)
+			stream->pending_size = STREAM_JSON_SIZE;
+		while (stream->pending_length + length > stream->pending_size)
+			stream->pending_size *= 2;
+		tmp = realloc(stream->pending, stream->pending_size);
+		if (!tmp)
+			return -1;
+		stream->pending = tmp;
+	}
+	memcpy(stream->pending + stream->pending_length, data, length);
+	stream->pending_length += length;
+
+	while ((!stream->stopped) &&
+	       ((result = json_next_entry(&stream->scan,
+					  stream->pending + offset,
+					  stream->pending_length - offset,
+					  &used, &entry, &entry_length)) == 1)) {
+		found(stream, NULL, entry, entry_length);
+		offset += used;
+	}
+
+	if (stream->stopped)
+		return 0;
+	if (result == -1)
+		return -1;
+
+	offset += used;
+	stream->pending_length -= offset;
+	memmove(stream->pending, stream->pending + offset,
+		stream->pending_length);
+
+	return 0;
+}
+
+struct gcal_stream *gcal_stream_new(struct gcal_resource *gcalobj,
+				    char contacts, gcal_stream_cb callback,
+				    void *user)
+{
+	struct gcal_stream *stream = NULL;
+
+	if (!callback)
+		goto exit;
+
+	if (!(stream = malloc(sizeof(struct gcal_stream))))
+		goto exit;
+
+	memset(stream, 0, sizeof(struct gcal_stream));
+	stream->gcalobj = gcalobj;
+	stream->contacts = contacts;
+	stream->callback = callback;
+	stream->user = user;
+	json_scan_init(&stream->scan);
+
+exit:
+	return stream;
+}
+
+/* Drops the parser state (the feed will be parsed from its start) */
+static void reset(struct gcal_stream *stream)
+{
+	if (stream->parser) {
+		if (stream->parser->myDoc)
+			xmlFreeDoc(stream->parser->myDoc);
+		xmlFreeParserCtxt(stream->parser);
+		stream->parser = NULL;
+	}
+	stream->fed = 0;
+	stream->ended = 0;
+
+	stream->pending_length = 0;
+	json_scan_init(&stream->scan);
+	stream->started = stream->json = 0;
+	stream->stopped = 0;
+}
+
+void gcal_stream_delete(struct gcal_stream *stream)
+{
+	if (!stream)
+		return;
+
+	reset(stream);
+	if (stream->pending)
+		free(stream->pending);
+	/* Entry memory was already cleaned up after the callback */
+	if (stream->entry)
+		free(stream->entry);
+	free(stream);
+}
+
+int gcal_stream_parse(struct gcal_stream *stream, const char *data,
+		      size_t length)
+{
+	size_t i;
+
+	if ((!stream) || (!data))
+		return -1;
+	if (stream->stopped)
+		return stream->stopped;
+
+	/* Format is known by the first character that isn't blank */
+	for (i = 0; (!stream->started) && (i < length); ++i) {
+		if ((data[i] == ' ') || (data[i] == '\t') ||
+		    (data[i] == '\n') || (data[i] == '\r'))
+			continue;
+		stream->json = (data[i] == '{');
+		stream->started = 1;
+	}
+	if (!stream->started)
+		return 0;
+
+	if (stream->json) {
+		if (parse_json(stream, data, length))
+			stream->stopped = -1;
+	} else if (parse_atom(stream, data, length))
+		stream->stopped = -1;
+
+	return stream->stopped;
+}
+
+int gcal_stream_finish(struct gcal_stream *stream)
+{
+	if (!stream)
+		return -1;
+	if (stream->stopped)
+		return (stream->stopped == 1) ? 0 : -1;
+
+	if (!stream->started)
+		return -1;
+	if (stream->json)
+		return json_scan_done(&stream->scan) ? 0 : -1;
+
+	/* Last document is complete (only blanks came after it) */
+	if (stream->ended)
+		return 0;
+
+	if ((xmlParseChunk(stream->parser, NULL, 0, 1)) ||
+	    (!stream->parser->wellFormed) || (stream->stopped))
+		return -1;
+
+	return 0;
+}
+
+size_t gcal_stream_count(const struct gcal_stream *stream)
+{
+	return stream ? stream->count : 0;
+}
+
+void gcal_stream_hold(struct gcal_stream *stream)
+{
+	if (stream)
+		stream->hold = 1;
+}
+
+int gcal_stream_release(struct gcal_stream *stream)
+{
+	int result = 0;
+
+	if (stream) {
+		result = stream->paused;
+		stream->hold = stream->paused = 0;
+	}
+
+	return result;
+}
+
+void gcal_stream_recycle(struct gcal_stream *stream, void *entry)
+{
+	if ((!stream) || (!entry))
+		return;
+
+	clean_entry(stream->contacts, entry);
+	if (!stream->entry)
+		stream->entry = entry;
+	else
+		free(entry);
+}
+
+static size_t write_cb_stream(void *ptr, size_t count, size_t chunk_size,
+			      void *data)
+{
+	size_t size = count * chunk_size;
+	struct gcal_stream *stream = (struct gcal_stream *)data;
+	long code = 0;
+
+	/* Error and redirection pages are not the feed */
+	curl_easy_getinfo(stream->gcalobj->curl, CURLINFO_RESPONSE_CODE,
+			  &code);
+	if (code != GCAL_DEFAULT_ANSWER)
+		return gcal_write_buffer(ptr, count, chunk_size,
+					 stream->gcalobj);
+
+	/* Consumer is behind: libcurl keeps the data until resumed */
+	if (stream->hold) {
+		stream->paused = 1;
+		return CURL_WRITEFUNC_PAUSE;
+	}
+
+	/* Anything different from size aborts the transfer */
+	if (gcal_stream_parse(stream, (const char *)ptr, size))
+		return 0;
+
+	return size;
+}
+
+/* Entries handed to the callback can't be taken back, so only a request
+ * that didn't find any entry can be retried.
+ */
+static int rewind_stream(struct gcal_resource *gcalobj, void *data)
+{
+	struct gcal_stream *stream = (struct gcal_stream *)data;
+
+	if (stream->count)
+		return -1;
+
+	reset(stream);
+	clean_buffer(gcalobj);
+	return 0;
+}
+
+/* Sets the curl handle to download the feed into a stream parser */
+static int prepare_stream(struct gcal_resource *gcalobj,
+			  const char *gdata_version, struct gcal_stream *stream)
+{
+	int result = -1;
+	char *url;
+
+	/* Failed to get authentication token */
+	if (!gcalobj->auth)
+		goto exit;
+
+	if (!(url = mount_query_url(gcalobj, NULL)))
+		goto exit;
+
+	result = prepare_follow_redirection(gcalobj, url, write_cb_stream,
+					    gdata_version);
+	if (!result)
+		curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEDATA,
+				 (void *)stream);
+	free(url);
+
+exit:
+	return result;
+}
+
+int gcal_stream_dump(struct gcal_resource *gcalobj, const char *gdata_version,
+		     struct gcal_stream *stream)
+{
+	int result = -1, code, deadline;
+
+	if ((!gcalobj) || (!stream) || (stream->gcalobj != gcalobj))
+		goto exit;
+
+	if (prepare_stream(gcalobj, gdata_version, stream))
+		goto exit;
+
+	/* Redirection is part of the same request */
+	deadline = gcal_deadline_start(gcalobj);
+
+	code = gcal_perform(gcalobj, rewind_stream, stream);
+	if (!stream->stopped)
+		result = check_follow_redirection(gcalobj, code, 0);
+	if (result == 1) {
+		reset(stream);
+		code = gcal_perform(gcalobj, rewind_stream, stream);
+		if (!stream->stopped)
+			result = check_follow_redirection(gcalobj, code, 1);
+	}
+
+	/* Stopped by the callback (the transfer was aborted on purpose) */
+	if (stream->stopped == 1)
+		result = 0;
+	else if (!result)
+		result = gcal_stream_finish(stream);
+
+	gcal_deadline_end(gcalobj, deadline);
+
+exit:
+	return result;
+}
+
+/** Entries of a feed collected in an array, see \ref gcal_stream_array */
+struct stream_array {
+	/** If entries are contacts */
+	char contacts;
+	/** Entries (\ref gcal_event or \ref gcal_contact) */
+	char *entries;
+	/** Number of entries */
+	size_t count;
+	/** Allocated number of entries */
+	size_t size;
+	/** Set if memory allocation failed */
+	char error;
+};
+
+static int array_entry(void **entry, void *user)
+{
+	struct stream_array *array = (struct stream_array *)user;
+	size_t entry_size;
+	char *tmp;
+
+	if (array->contacts)
+		entry_size = sizeof(struct gcal_contact);
+	else
+		entry_size = sizeof(struct gcal_event);
+
+	if (array->count == array->size) {
+		array->size = array->size ? array->size * 2 : 16;
+		if (!(tmp = realloc(array->entries, array->size * entry_size))) {
+			array->error = 1;
+			return 1;
+		}
+		array->entries = tmp;
+	}
+
+	/* The copy owns the entry fields */
+	memcpy(array->entries + array->count * entry_size, *entry,
+	       entry_size);
+	++array->count;
+	free(*entry);
+	*entry = NULL;
+
+	return 0;
+}
+
+int gcal_stream_array(char contacts, const char *buffer, size_t length,
+		      void **entries, size_t *count)
+{
+	int result = -1;
+	struct gcal_stream *stream;
+	struct stream_array array;
+
+	if ((!buffer) || (!entries) || (!count))
+		goto exit;
+
+	memset(&array, 0, sizeof(array));
+	array.contacts = contacts;
+	if (!(stream = gcal_stream_new(NULL, contacts, array_entry, &array)))
+		goto exit;
+
+	result = gcal_stream_parse(stream, buffer, length);
+	if (!result)
+		result = gcal_stream_finish(stream);
+	if (array.error)
+		result = -1;
+	gcal_stream_delete(stream);
+
+	if (result) {
+		if (contacts)
+			gcal_destroy_contacts((struct gcal_contact *)
+					      array.entries, array.count);
+		else
+			gcal_destroy_entries((struct gcal_event *)
+					     array.entries, array.count);
+		goto exit;
+	}
+
+	*entries = array.entries;
+	*count = array.count;
+
+exit:
+	return result;
+}
+
+int gcal_stream_array_file(char contacts, const char *path, void **entries,
+			   size_t *count)
+{
+	int result = -1, fd;
+	struct stat info;
+	void *data;
+
+	if ((!path) || ((fd = open(path, O_RDONLY)) == -1))
+		return result;
+
+	if (fstat(fd, &info) || (!S_ISREG(info.st_mode)) || (!info.st_size))
+		goto cleanup;
+
+	/* The file is read once, from its start to its end */
+	data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		goto cleanup;
+	madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+	result = gcal_stream_array(contacts, (const char *)data, info.st_size,
+				   entries, count);
+	munmap(data, info.st_size);
+
+cleanup:
+	close(fd);
+	return result;
+}
+
+/** A feed being read entry by entry, see \ref gcal_iter_open */
+struct gcal_iter {
+	/** Feed owner, its curl handle does the download */
+	struct gcal_resource *gcalobj;
+	/** Parser of the feed */
+	struct gcal_stream *stream;
+	/** Drives the download a bit at a time */
+	CURLM *multi;
+	/** Parsed entries not returned yet (a ring buffer) */
+	void **queue;
+	/** Position of the first entry in the queue */
+	size_t first;
+	/** Number of entries in the queue */
+	size_t length;
+	/** Allocated length of the queue */
+	size_t size;
+	/** Last entry returned, owned by the iterator until detached */
+	void *current;
+	/** If the curl handle is in the download */
+	char running;
+	/** If calendar redirection was followed */
+	char redirected;
+	/** 0 while there is no error, -1 otherwise */
+	int result;
+	/** Value returned by \ref gcal_deadline_start */
+	int deadline;
+};
+
+/* Queues the entries found by the parser (they are taken) */
+static int queue_entry(void **entry, void *user)
+{
+	struct gcal_iter *iter = (struct gcal_iter *)user;
+	void **tmp;
+	size_t i, size;
+
+	if (iter->length == iter->size) {
+		size = iter->size ? iter->size * 2 : 8;
+		if (!(tmp = malloc(sizeof(void *) * size))) {
+			iter->result = -1;
+			return -1;
+		}
+		for (i = 0; i < iter->length; ++i)
+			tmp[i] = iter->queue[(iter->first + i) % iter->size];
+		free(iter->queue);
+		iter->queue = tmp;
+		iter->first = 0;
+		iter->size = size;
+	}
+
+	iter->queue[(iter->first + iter->length) % iter->size] = *entry;
+	++iter->length;
+	*entry = NULL;
+
+	/* Queue is full, download waits for the caller */
+	if (iter->length >= iter->gcalobj->stream_queue)
+		gcal_stream_hold(iter->stream);
+
+	return 0;
+}
+
+struct gcal_iter *gcal_iter_open(struct gcal_resource *gcalobj, char contacts,
+				 const char *gdata_version)
+{
+	struct gcal_iter *iter = NULL;
+	CURLcode code;
+
+	if (!gcalobj)
+		goto exit;
+
+	if (!(iter = malloc(sizeof(struct gcal_iter))))
+		goto exit;
+	memset(iter, 0, sizeof(struct gcal_iter));
+	iter->gcalobj = gcalobj;
+
+	gcalobj->internal_status = GCAL_INTERRUPT_NONE;
+	iter->deadline = gcal_deadline_start(gcalobj);
+
+	if (!(iter->stream = gcal_stream_new(gcalobj, contacts, queue_entry,
+					     iter)))
+		goto cleanup;
+	if (!(iter->multi = curl_multi_init()))
+		goto cleanup;
+	if (prepare_stream(gcalobj, gdata_version, iter->stream))
+		goto cleanup;
+
+	code = gcal_rate_limit(gcalobj);
+	if (code != CURLE_OK) {
+		gcalobj->internal_status = code == CURLE_ABORTED_BY_CALLBACK ?
+			GCAL_INTERRUPT_CANCEL : GCAL_INTERRUPT_TIMEOUT;
+		goto cleanup;
+	}
+	gcal_deadline_apply(gcalobj, gcalobj->curl);
+	if (curl_multi_add_handle(iter->multi, gcalobj->curl) != CURLM_OK)
+		goto cleanup;
+	iter->running = 1;
+
+	goto exit;
+
+cleanup:
+	gcal_iter_close(iter);
+	iter = NULL;
+
+exit:
+	return iter;
+}
+
+/* Handles the end of the download: follows calendar redirection or
+ * checks the whole feed was parsed.
+ */
+static void download_done(struct gcal_iter *iter, CURLcode code)
+{
+	struct gcal_resource *gcalobj = iter->gcalobj;
+	int answer;
+
+	curl_multi_remove_handle(iter->multi, gcalobj->curl);
+	iter->running = 0;
+
+	if ((code == CURLE_ABORTED_BY_CALLBACK) &&
+	    (__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST)))
+		gcalobj->internal_status = GCAL_INTERRUPT_CANCEL;
+	else if (code == CURLE_OPERATION_TIMEDOUT)
+		gcalobj->internal_status = GCAL_INTERRUPT_TIMEOUT;
+
+	answer = check_follow_redirection(gcalobj, code, iter->redirected);
+	if (answer == 1) {
+		/* Follow gsessionid URL with the same handle */
+		iter->redirected = 1;
+		gcal_deadline_apply(gcalobj, gcalobj->curl);
+		if (curl_multi_add_handle(iter->multi, gcalobj->curl) ==
+		    CURLM_OK) {
+			iter->running = 1;
+			return;
+		}
+		answer = -1;
+	}
+
+	if ((answer) || (gcal_stream_finish(iter->stream)))
+		iter->result = -1;
+}
+
+void *gcal_iter_next(struct gcal_iter *iter)
+{
+	int running, pending;
+	CURLMsg *msg;
+
+	if (!iter)
+		return NULL;
+
+	/* Previous entry memory is reused, unless it was detached */
+	if (iter->current) {
+		gcal_stream_recycle(iter->stream, iter->current);
+		iter->current = NULL;
+	}
+
+	while ((!iter->length) && (iter->running)) {
+		/* Queue was emptied, so the download goes on */
+		if (gcal_stream_release(iter->stream))
+			curl_easy_pause(iter->gcalobj->curl, CURLPAUSE_CONT);
+
+		if (curl_multi_perform(iter->multi, &running) != CURLM_OK) {
+			curl_multi_remove_handle(iter->multi,
+						 iter->gcalobj->curl);
+			iter->running = 0;
+			iter->result = -1;
+			break;
+		}
+
+		while ((iter->running) &&
+		       (msg = curl_multi_info_read(iter->multi, &pending)))
+			if (msg->msg == CURLMSG_DONE)
+				download_done(iter, msg->data.result);
+
+		if ((!iter->length) && (iter->running))
+			curl_multi_wait(iter->multi, NULL, 0, 1000, NULL);
+	}
+
+	if (!iter->length)
+		return NULL;
+
+	iter->current = iter->queue[iter->first];
+	iter->first = (iter->first + 1) % iter->size;
+	--iter->length;
+
+	return iter->current;
+}
+
+void *gcal_iter_detach(struct gcal_iter *iter)
+{
+	void *entry = NULL;
+
+	if (iter) {
+		entry = iter->current;
+		iter->current = NULL;
+	}
+
+	return entry;
+}
+
+int gcal_iter_close(struct gcal_iter *iter)
+{
+	int result;
+
+	if (!iter)
+		return -1;
+
+	/* Closing before the end of the feed is not an error */
+	if (iter->running)
+		curl_multi_remove_handle(iter->multi, iter->gcalobj->curl);
+	if (iter->multi)
+		curl_multi_cleanup(iter->multi);
+
+	if (iter->current)
+		gcal_stream_recycle(iter->stream, iter->current);
+	for (; iter->length; --iter->length) {
+		gcal_stream_recycle(iter->stream, iter->queue[iter->first]);
+		iter->first = (iter->first + 1) % iter->size;
+	}
+	free(iter->queue);
+	gcal_stream_delete(iter->stream);
+
+	if (iter->gcalobj->internal_status == GCAL_INTERRUPT_CANCEL)
+		__atomic_store_n(&iter->gcalobj->canceled, 0,
+				 __ATOMIC_SEQ_CST);
+	gcal_deadline_end(iter->gcalobj, iter->deadline);
+
+	result = iter->result;
+	free(iter);
+
+	return result;
+}
@@ -44,11 +44,27 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <time.h>
 #include "gcalendar.h"
 #include "internal_gcal.h"
 #include "gcal_parser.h"
+#include "gcal_multi.h"
+#include "gcal_lazy.h"
+#include "gcal_stream.h"
+#include "gcal_pipeline.h"
 #include "msvc_hacks.h"
 
+/** Downloaded ranges of a feed, see \ref gcal_get_events_range. */
+struct gcal_ranges {
+	/** The user gcal object */
+	struct gcal_resource *gcalobj;
+	/** Vector with the events of each range */
+	struct gcal_event **parts;
+	/** Number of events in each range */
+	size_t *lengths;
+};
+
 gcal_t gcal_new(gservice mode)
 {
 	return gcal_construct(mode);
@@ -100,6 +116,41 @@ void gcal_event_delete(gcal_event_t event)
 	free(event);
 }
 
+int gcal_events_from_feed(const char *buffer, size_t length,
+			  struct gcal_event_array *events)
+{
+	void *entries = NULL;
+	size_t count = 0;
+
+	if (!events)
+		return -1;
+
+	if (gcal_stream_array(0, buffer, length, &entries, &count))
+		return -1;
+
+	events->entries = entries;
+	events->length = count;
+
+	return 0;
+}
+
+int gcal_events_from_file(const char *path, struct gcal_event_array *events)
+{
+	void *entries = NULL;
+	size_t count = 0;
+
+	if (!events)
+		return -1;
+
+	if (gcal_stream_array_file(0, path, &entries, &count))
+		return -1;
+
+	events->entries = entries;
+	events->length = count;
+
+	return 0;
+}
+
 int gcal_get_edit_url(char *entry, char **extracted_url)
 {
 	int result = -1;
@@ -389,6 +440,327 @@ exit:
 	return result;
 }
 
+/** User callback of \ref gcal_get_events_cb */
+struct gcal_events_cb {
+	/** Called for each event */
+	gcal_event_cb callback;
+	/** User data pointer */
+	void *user;
+};
+
+static int event_found(void **entry, void *user)
+{
+	struct gcal_events_cb *events = (struct gcal_events_cb *)user;
+	gcal_event_t event = (gcal_event_t)*entry;
+	int result;
+
+	result = events->callback(&event, events->user);
+	*entry = event;
+
+	return result;
+}
+
+int gcal_get_events_cb(gcal_t gcalobj, gcal_event_cb callback,
+		       void *user_data)
+{
+	int result = -1;
+	struct gcal_stream *stream;
+	struct gcal_events_cb events;
+
+	if ((!gcalobj) || (!callback))
+		goto exit;
+
+	events.callback = callback;
+	events.user = user_data;
+	if (!(stream = gcal_stream_new(gcalobj, 0, event_found, &events)))
+		goto exit;
+
+	result = gcal_stream_dump(gcalobj, "GData-Version: 2", stream);
+	gcal_stream_delete(stream);
+
+exit:
+	return result;
+}
+
+int gcal_get_events_pipeline(gcal_t gcalobj, gcal_event_cb deliver,
+			     gcal_event_cb persist, void *user_data)
+{
+	struct gcal_events_cb delivered, persisted;
+
+	if ((!gcalobj) || (!deliver))
+		return -1;
+
+	delivered.callback = deliver;
+	delivered.user = user_data;
+	persisted.callback = persist;
+	persisted.user = user_data;
+
+	return gcal_pipeline_run(gcalobj, 0, "GData-Version: 2",
+				 event_found, &delivered,
+				 persist ? event_found : NULL, &persisted);
+}
+
+gcal_event_iter_t gcal_event_iter_open(gcal_t gcalobj)
+{
+	return gcal_iter_open(gcalobj, 0, "GData-Version: 2");
+}
+
+gcal_event_t gcal_event_iter_next(gcal_event_iter_t iter)
+{
+	return (gcal_event_t)gcal_iter_next(iter);
+}
+
+gcal_event_t gcal_event_iter_detach(gcal_event_iter_t iter)
+{
+	return (gcal_event_t)gcal_iter_detach(iter);
+}
+
+int gcal_event_iter_close(gcal_event_iter_t iter)
+{
+	return gcal_iter_close(iter);
+}
+
+/* Converts a RFC 3339 timestamp (e.g. 2008-09-10T21:00:00.000-03:00)
+ * to seconds since epoch.
+ */
+static int parse_timestamp(const char *timestamp, time_t *seconds)
+{
+	struct tm date;
+	int offset = 0, hours, minutes;
+	const char *ptr;
+
+	memset(&date, 0, sizeof(date));
+	ptr = strptime(timestamp, "%Y-%m-%dT%H:%M:%S", &date);
+	if (!ptr)
+		ptr = strptime(timestamp, "%Y-%m-%d", &date);
+	if (!ptr)
+		return -1;
+
+	/* Fraction of seconds doesn't matter here */
+	if (*ptr == '.')
+		for (++ptr; isdigit(*ptr); ++ptr)
+			;
+
+	if ((*ptr == '+') || (*ptr == '-')) {
+		if (sscanf(ptr + 1, "%d:%d", &hours, &minutes) != 2)
+			return -1;
+		offset = (hours * 3600) + (minutes * 60);
+		if (*ptr == '-')
+			offset = -offset;
+	}
+
+	*seconds = timegm(&date) - offset;
+	return 0;
+}
+
+static int range_done(struct gcal_resource *slot, size_t job, int result,
+		      void *user)
+{
+	struct gcal_ranges *ranges = (struct gcal_ranges *)user;
+
+	ranges->gcalobj->http_code = slot->http_code;
+	if (result)
+		return -1;
+
+	slot->has_xml = 1;
+	ranges->parts[job] = gcal_get_entries(slot, &ranges->lengths[job]);
+	slot->has_xml = 0;
+	if (!ranges->parts[job])
+		return -1;
+
+	return 0;
+}
+
+/* A calendar that fails doesn't stop downloading the others */
+static int calendar_done(struct gcal_resource *slot, size_t job, int result,
+			 void *user)
+{
+	range_done(slot, job, result, user);
+	return 0;
+}
+
+static void destroy_event(void *event)
+{
+	gcal_destroy_entry((struct gcal_event *)event);
+}
+
+int gcal_get_events_range(gcal_t gcalobj, struct gcal_event_array *events_array,
+			  const char *start_min, const char *start_max,
+			  size_t ranges)
+{
+	int result = -1;
+	size_t i;
+	time_t min, max, step, begin, end;
+	char param_min[TIMESTAMP_MAX_SIZE + sizeof("start-min=")];
+	char param_max[TIMESTAMP_MAX_SIZE + sizeof("start-max=")];
+	char **urls = NULL;
+	struct gcal_ranges downloaded;
+
+	downloaded.parts = NULL;
+	downloaded.lengths = NULL;
+
+	if (events_array) {
+		events_array->entries = NULL;
+		events_array->length = 0;
+	}
+
+	if ((!gcalobj) || (!events_array) || (!start_min) || (!start_max))
+		goto exit;
+
+	if (parse_timestamp(start_min, &min) || parse_timestamp(start_max, &max))
+		goto exit;
+	if (max <= min)
+		goto exit;
+
+	/* Windows have at least 1 second */
+	if (ranges < 1)
+		ranges = 1;
+	if ((time_t)ranges > (max - min))
+		ranges = max - min;
+	step = (max - min) / ranges;
+
+	urls = calloc(ranges, sizeof(char *));
+	downloaded.gcalobj = gcalobj;
+	downloaded.parts = calloc(ranges, sizeof(struct gcal_event *));
+	downloaded.lengths = calloc(ranges, sizeof(size_t));
+	if ((!urls) || (!downloaded.parts) || (!downloaded.lengths))
+		goto cleanup;
+
+	/* Each window is [start-min, start-max), the last one ends in
+	 * the user requested 'start_max'.
+	 */
+	for (i = 0; i < ranges; ++i) {
+		begin = min + (i * step);
+		end = (i == ranges - 1) ? max : begin + step;
+
+		strcpy(param_min, "start-min=");
+		strftime(param_min + strlen(param_min), TIMESTAMP_MAX_SIZE,
+			 "%Y-%m-%dT%H:%M:%SZ", gmtime(&begin));
+		strcpy(param_max, "start-max=");
+		strftime(param_max + strlen(param_max), TIMESTAMP_MAX_SIZE,
+			 "%Y-%m-%dT%H:%M:%SZ", gmtime(&end));
+
+		urls[i] = mount_query_url(gcalobj, param_min, param_max, NULL);
+		if (!urls[i])
+			goto cleanup;
+	}
+
+	result = gcal_multi_get(gcalobj, (const char * const *)urls, ranges,
+				NULL, "GData-Version: 2", range_done,
+				&downloaded);
+	if (result)
+		goto cleanup;
+
+	result = -1;
+	events_array->entries = gcal_multi_merge((void **)downloaded.parts,
+						 downloaded.lengths, ranges,
+						 sizeof(struct gcal_event),
+						 &events_array->length);
+	if (!events_array->entries)
+		goto cleanup;
+
+	/* An event crossing windows boundaries is returned more than once */
+	events_array->length = gcal_multi_dedup(events_array->entries,
+						events_array->length,
+						sizeof(struct gcal_event),
+						destroy_event);
+	result = 0;
+
+cleanup:
+	for (i = 0; i < ranges; ++i) {
+		if (urls && urls[i])
+			free(urls[i]);
+		if (downloaded.parts && downloaded.parts[i])
+			gcal_destroy_entries(downloaded.parts[i],
+					     downloaded.lengths[i]);
+	}
+	if (urls)
+		free(urls);
+	if (downloaded.parts)
+		free(downloaded.parts);
+	if (downloaded.lengths)
+		free(downloaded.lengths);
+
+exit:
+	return result;
+}
+
+int gcal_get_calendars_events(gcal_t gcalobj,
+			      struct gcal_resource_array *gcal_array,
+			      const size_t *indexes, size_t count,
+			      struct gcal_event_array *events_arrays)
+{
+	int result = -1;
+	size_t i, calendar;
+	char **urls = NULL;
+	struct gcal_ranges downloaded;
+
+	downloaded.parts = NULL;
+	downloaded.lengths = NULL;
+
+	if ((!gcalobj) || (!gcal_array) || (!events_arrays))
+		goto exit;
+
+	/* No selection means all calendars */
+	if (!indexes)
+		count = gcal_array->length;
+
+	for (i = 0; i < count; ++i) {
+		events_arrays[i].entries = NULL;
+		events_arrays[i].length = 0;
+	}
+	if (!count)
+		goto exit;
+
+	urls = calloc(count, sizeof(char *));
+	downloaded.gcalobj = gcalobj;
+	downloaded.parts = calloc(count, sizeof(struct gcal_event *));
+	downloaded.lengths = calloc(count, sizeof(size_t));
+	if ((!urls) || (!downloaded.parts) || (!downloaded.lengths))
+		goto cleanup;
+
+	for (i = 0; i < count; ++i) {
+		calendar = indexes ? indexes[i] : i;
+		if (calendar >= gcal_array->length)
+			goto cleanup;
+
+		urls[i] = mount_query_url(&gcal_array->entries[calendar], NULL);
+		if (!urls[i])
+			goto cleanup;
+	}
+
+	result = gcal_multi_get(gcalobj, (const char * const *)urls, count,
+				NULL, "GData-Version: 2", calendar_done,
+				&downloaded);
+
+	/* Calendars successfully downloaded are returned even on error */
+	for (i = 0; i < count; ++i) {
+		if (!downloaded.parts[i])
+			result = -1;
+		events_arrays[i].entries = downloaded.parts[i];
+		events_arrays[i].length = downloaded.lengths[i];
+		downloaded.parts[i] = NULL;
+	}
+
+cleanup:
+	for (i = 0; i < count; ++i) {
+		if (urls && urls[i])
+			free(urls[i]);
+		if (downloaded.parts && downloaded.parts[i])
+			gcal_destroy_entries(downloaded.parts[i],
+					     downloaded.lengths[i]);
+	}
+	if (urls)
+		free(urls);
+	if (downloaded.parts)
+		free(downloaded.parts);
+	if (downloaded.lengths)
+		free(downloaded.lengths);
+
+exit:
+	return result;
+}
+
 void gcal_cleanup_events(struct gcal_event_array *events)
 {
 	if (!events)
@@ -421,6 +793,7 @@ char gcal_event_is_deleted(gcal_event_t event)
 {
 	if ((!event))
 		return -1;
+	gcal_lazy_event(event, GCAL_F_STATUS);
 	return gcal_get_deleted(&(event->common));
 }
 
@@ -428,6 +801,7 @@ char *gcal_event_get_id(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_ID);
 	return gcal_get_id(&(event->common));
 }
 
@@ -435,6 +809,7 @@ char *gcal_event_get_published(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_UPDATED);
 	return gcal_get_published(&(event->common));
 }
 
@@ -442,6 +817,7 @@ char *gcal_event_get_updated(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_UPDATED);
 	return gcal_get_updated(&(event->common));
 }
 
@@ -449,6 +825,7 @@ char *gcal_event_get_visibility(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_VISIBILITY);
 	return gcal_get_visibility(&(event->common));
 }
 
@@ -456,6 +833,7 @@ char *gcal_event_get_title(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_TITLE);
 	return gcal_get_title(&(event->common));
 }
 
@@ -463,6 +841,7 @@ char *gcal_event_get_url(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_EDIT_URI);
 	return gcal_get_url(&(event->common));
 }
 
@@ -470,6 +849,7 @@ char *gcal_event_get_etag(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_ETAG);
 	return gcal_get_etag(&(event->common));
 }
 
@@ -478,6 +858,7 @@ char *gcal_event_get_content(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_CONTENT);
 	return event->content;
 }
 
@@ -485,6 +866,7 @@ char *gcal_event_get_start(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_WHEN);
 	return event->dt_start;
 }
 
@@ -492,6 +874,7 @@ char *gcal_event_get_end(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_WHEN);
 	return event->dt_end;
 }
 
@@ -499,6 +882,7 @@ char *gcal_event_get_where(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_WHERE);
 	return event->where;
 }
 
@@ -506,11 +890,13 @@ char *gcal_event_get_status(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_STATUS);
 	return event->status;
 }
 
 struct gcal_event_attendee *gcal_event_get_attendee_by_index(gcal_event_t event, size_t index)
 {
+	gcal_lazy_event(event, GCAL_F_ATTENDEES);
   if ((!event) || (!event->attendees) || (index > event->attendees_nr))
 		return NULL;
 	return &(event->attendees[index]);
@@ -518,6 +904,7 @@ struct gcal_event_attendee *gcal_event_get_attendee_by_index(gcal_event_t event,
 
 struct gcal_event_alarms *gcal_event_get_alarm_by_index(gcal_event_t event, size_t index)
 {
+	gcal_lazy_event(event, GCAL_F_ALARMS);
   if ((!event) || (!event->alarms) || (index > event->alarms_nr))
 		return NULL;
 	return &(event->alarms[index]);
@@ -527,6 +914,7 @@ size_t gcal_event_get_number_of_attendees(gcal_event_t event)
 {
 	if ((!event))
 		return -1;
+	gcal_lazy_event(event, GCAL_F_ATTENDEES);
 	return (size_t) event->attendees_nr;
 }
 
@@ -534,6 +922,7 @@ size_t gcal_event_get_number_of_alarms(gcal_event_t event)
 {
 	if ((!event))
 		return -1;
+	gcal_lazy_event(event, GCAL_F_ALARMS);
 	return (size_t) event->alarms_nr;
 }
 
@@ -541,6 +930,7 @@ char *gcal_event_get_anyoneCanAddSelf(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_GUESTS);
 	return event->anyoneCanAddSelf;
 }
 
@@ -548,6 +938,7 @@ char *gcal_event_get_guestsCanInviteOthers(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_GUESTS);
 	return event->guestsCanInviteOthers;
 }
 
@@ -555,6 +946,7 @@ char *gcal_event_get_guestsCanModify(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_GUESTS);
 	return event->guestsCanModify;
 }
 
@@ -562,6 +954,7 @@ char *gcal_event_get_guestsCanSeeGuests(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_GUESTS);
 	return event->guestsCanSeeGuests;
 }
 
@@ -569,6 +962,7 @@ char *gcal_event_get_sequence(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_SEQUENCE);
 	return event->sequence;
 }
 
@@ -576,6 +970,7 @@ char *gcal_event_get_recurrent(gcal_event_t event)
 {
 	if ((!event))
 		return NULL;
+	gcal_lazy_event(event, GCAL_F_WHEN);
 	return event->dt_recurrent;
 }
 
@@ -587,6 +982,9 @@ int gcal_event_set_title(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_TITLE))
+		return result;
+
 	if (event->common.title)
 		free(event->common.title);
 
@@ -604,6 +1002,9 @@ int gcal_event_set_content(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_CONTENT))
+		return result;
+
 	if (event->content)
 		free(event->content);
 
@@ -621,6 +1022,9 @@ int gcal_event_set_start(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_WHEN))
+		return result;
+
 	if (event->dt_start)
 		free(event->dt_start);
 
@@ -638,6 +1042,9 @@ int gcal_event_set_end(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_WHEN))
+		return result;
+
 	if (event->dt_end)
 		free(event->dt_end);
 
@@ -655,6 +1062,9 @@ int gcal_event_set_where(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_WHERE))
+		return result;
+
 	if (event->where)
 		free(event->where);
 
@@ -673,6 +1083,9 @@ int gcal_event_set_url(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_EDIT_URI))
+		return result;
+
 	if (event->common.edit_uri)
 		free(event->common.edit_uri);
 
@@ -691,6 +1104,9 @@ int gcal_event_set_id(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_ID))
+		return result;
+
 	if (event->common.id)
 		free(event->common.id);
 
@@ -709,6 +1125,9 @@ int gcal_event_set_etag(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_ETAG))
+		return result;
+
 	if (event->common.etag)
 		free(event->common.etag);
 
@@ -726,6 +1145,9 @@ int gcal_event_set_recurrent(gcal_event_t event, const char *field)
 	if ((!event) || (!field))
 		return result;
 
+	if (gcal_lazy_event(event, GCAL_F_WHEN))
+		return result;
+
 	if (event->dt_recurrent)
 		free(event->dt_recurrent);
 
@@ -39,9 +39,16 @@ POSSIBILITY OF SUCH DAMAGE.
  *
  */
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "internal_gcal.h"
 #include "gcontact.h"
 #include "gcal_parser.h"
+#include "json_parser.h"
+#include "gcal_multi.h"
+#include "gcal_cache.h"
+#include "gcal_retry.h"
+#include "gcal_lazy.h"
 #include "msvc_hacks.h"
 
 
@@ -50,21 +57,28 @@ static size_t write_cb_binary(void *ptr, size_t count, size_t chunk_size,
 {
 
 	size_t size = count * chunk_size;
+	size_t length;
 	struct gcal_resource *gcal_ptr = (struct gcal_resource *)data;
 	char *ptr_tmp;
 
 	if (size > (gcal_ptr->length - gcal_ptr->previous_length - 1)) {
-		gcal_ptr->length = gcal_ptr->length + size + 1;
-		ptr_tmp = realloc(gcal_ptr->buffer, gcal_ptr->length);
+		/* Doubles the buffer, so it isn't realloced for each chunk */
+		length = gcal_ptr->length * 2;
+		while (length < gcal_ptr->previous_length + size + 1)
+			length *= 2;
+		ptr_tmp = realloc(gcal_ptr->buffer, length);
 
 		if (!ptr_tmp) {
 			if (gcal_ptr->fout_log)
 				fprintf(gcal_ptr->fout_log,
 					"write_cb: Failed relloc!\n");
+			/* Aborts the transfer */
+			size = 0;
 			goto exit;
 		}
 
 		gcal_ptr->buffer = ptr_tmp;
+		gcal_ptr->length = length;
 	}
 
 	memcpy(gcal_ptr->buffer + gcal_ptr->previous_length, ptr, size);
@@ -74,6 +88,318 @@ exit:
 	return size;
 }
 
+/** Photo being written to a user sink, see \ref gcal_get_photo_sink */
+struct gcal_sink {
+	/** The gcal object doing the transfer */
+	struct gcal_resource *gcalobj;
+	/** User callback */
+	gcal_photo_sink write;
+	/** User data */
+	void *user;
+	/** Bytes already given to user */
+	size_t written;
+};
+
+static size_t write_cb_sink(void *ptr, size_t count, size_t chunk_size,
+			    void *data)
+{
+	size_t size = count * chunk_size;
+	struct gcal_sink *sink = (struct gcal_sink *)data;
+	long code = 0;
+
+	/* Error pages are not photo data */
+	curl_easy_getinfo(sink->gcalobj->curl, CURLINFO_RESPONSE_CODE, &code);
+	if (code != GCAL_DEFAULT_ANSWER)
+		return size;
+
+	/* Anything different from size aborts the transfer */
+	sink->written += size;
+	return sink->write(ptr, size, sink->user);
+}
+
+/* User can't take back data, so only a request that didn't write
+ * anything can be retried.
+ */
+static int rewind_sink(struct gcal_resource *gcalobj, void *data)
+{
+	struct gcal_sink *sink = (struct gcal_sink *)data;
+
+	(void)gcalobj; /* prevent compiler warning */
+	return sink->written ? -1 : 0;
+}
+
+/** Contact photos being downloaded, see \ref gcal_get_photos */
+struct gcal_photos {
+	/** Contacts with photo */
+	struct gcal_contact **contacts;
+	/** Number of photos successfully downloaded */
+	size_t done;
+	/** Photo cache directory (can be NULL) */
+	const char *cache;
+};
+
+/* Photo cache: there is one file by contact, named with a hash of
+ * contact id. The file starts with a header made of contact id and
+ * photo ETag (one by line), followed by the photo data.
+ */
+static char *cache_header(struct gcal_contact *contact, size_t *length)
+{
+	char *header;
+
+	*length = strlen(contact->common.id) + strlen(contact->photo_etag) + 2;
+	if ((header = malloc(*length + 1)))
+		snprintf(header, *length + 1, "%s\n%s\n", contact->common.id,
+			 contact->photo_etag);
+
+	return header;
+}
+
+/* Loads the photo if the cache has it with same ETag */
+static int cache_load(const char *dir, struct gcal_contact *contact)
+{
+	int result = -1;
+	char *path = NULL, *header = NULL, *tmp = NULL;
+	unsigned char *data;
+	size_t length;
+	long end;
+	FILE *file = NULL;
+
+	/* Without ETag, there is no way to tell if photo is updated */
+	if ((!contact->common.id) || (!contact->photo_etag) ||
+	    (!*contact->photo_etag))
+		goto exit;
+
+	if (!(path = gcal_cache_path(dir, contact->common.id)))
+		goto exit;
+	if (!(header = cache_header(contact, &length)))
+		goto cleanup;
+	if (!(tmp = malloc(length)))
+		goto cleanup;
+
+	if (!(file = fopen(path, "rb")))
+		goto cleanup;
+
+	/* Other contact (hash collision) or outdated photo */
+	if ((fread(tmp, 1, length, file) != length) ||
+	    (memcmp(tmp, header, length)))
+		goto cleanup;
+
+	if (fseek(file, 0, SEEK_END) || ((end = ftell(file)) <= (long)length))
+		goto cleanup;
+	if (fseek(file, length, SEEK_SET))
+		goto cleanup;
+
+	length = end - length;
+	if (!(data = malloc(length)))
+		goto cleanup;
+	if (fread(data, 1, length, file) != length) {
+		free(data);
+		goto cleanup;
+	}
+
+	if (contact->photo_data)
+		free(contact->photo_data);
+	contact->photo_data = data;
+	contact->photo_length = length;
+	result = 0;
+
+cleanup:
+	if (file)
+		fclose(file);
+	if (tmp)
+		free(tmp);
+	if (header)
+		free(header);
+	free(path);
+
+exit:
+	return result;
+}
+
+static void cache_store(const char *dir, struct gcal_contact *contact)
+{
+	char *path, *header;
+	size_t length;
+
+	if ((!contact->common.id) || (!contact->photo_etag) ||
+	    (!*contact->photo_etag))
+		return;
+
+	if (!(path = gcal_cache_path(dir, contact->common.id)))
+		return;
+	if ((header = cache_header(contact, &length))) {
+		gcal_cache_save(path, header, (const char *)contact->photo_data,
+				contact->photo_length);
+		free(header);
+	}
+	free(path);
+}
+
+/* Replaces the contact photo data by the downloaded bytes */
+static int store_photo(struct gcal_contact *contact,
+		       struct gcal_resource *gcalobj, const char *cache)
+{
+	unsigned char *data;
+
+	data = malloc(sizeof(char) * gcalobj->previous_length);
+	if (!data)
+		return -1;
+
+	if (contact->photo_data)
+		free(contact->photo_data);
+	contact->photo_data = data;
+
+	/* Only the received bytes, not the buffer size */
+	contact->photo_length = gcalobj->previous_length;
+	memcpy(contact->photo_data, gcalobj->buffer, contact->photo_length);
+
+	if (cache)
+		cache_store(cache, contact);
+
+	return 0;
+}
+
+static int photo_done(struct gcal_resource *slot, size_t job, int result,
+		      void *user)
+{
+	struct gcal_photos *photos = (struct gcal_photos *)user;
+
+	/* On failure, contact keeps just the photo flag (i.e. length 1) */
+	if (result)
+		return 0;
+
+	if (store_photo(photos->contacts[job], slot, photos->cache))
+		return -1;
+
+	++photos->done;
+	return 0;
+}
+
+int gcal_get_photos(struct gcal_resource *gcalobj,
+		    struct gcal_contact **contacts, size_t count)
+{
+	int result = -1;
+	size_t i, total;
+	struct gcal_photos photos;
+	const char **urls = NULL;
+
+	photos.contacts = NULL;
+	photos.done = 0;
+
+	if ((!gcalobj) || (!contacts))
+		goto exit;
+	photos.cache = gcalobj->photo_cache;
+
+	photos.contacts = malloc(sizeof(struct gcal_contact *) * (count + 1));
+	urls = malloc(sizeof(char *) * (count + 1));
+	if ((!photos.contacts) || (!urls))
+		goto cleanup;
+
+	/* Skip contacts without photo */
+	for (i = 0, total = 0; i < count; ++i) {
+		gcal_lazy_contact(contacts[i], GCAL_F_ID | GCAL_F_PHOTO);
+		if ((!contacts[i]) || (!contacts[i]->photo_length) ||
+		    (!contacts[i]->photo))
+			continue;
+
+		/* Photo didn't change since it was cached */
+		if ((photos.cache) && (!cache_load(photos.cache, contacts[i])))
+			continue;
+
+		photos.contacts[total] = contacts[i];
+		urls[total++] = contacts[i]->photo;
+	}
+
+	/* A single photo doesn't need a new connection */
+	if (total == 1) {
+		if (!get_follow_redirection(gcalobj, urls[0], write_cb_binary,
+					    "GData-Version: 3.0"))
+			if (!store_photo(photos.contacts[0], gcalobj,
+					 photos.cache))
+				photos.done = 1;
+		clean_buffer(gcalobj);
+
+	} else if (gcal_multi_get(gcalobj, urls, total, write_cb_binary,
+				  "GData-Version: 3.0", photo_done, &photos))
+		if (gcalobj->fout_log)
+			fprintf(gcalobj->fout_log, "failed downloading photos!\n");
+
+	if (photos.done == total)
+		result = 0;
+
+cleanup:
+	if (photos.contacts)
+		free(photos.contacts);
+	if (urls)
+		free(urls);
+
+exit:
+	return result;
+}
+
+int gcal_get_photo_sink(struct gcal_resource *gcalobj,
+			struct gcal_contact *contact,
+			gcal_photo_sink write, void *user)
+{
+	int result = -1;
+	struct gcal_sink sink;
+
+	if ((!gcalobj) || (!contact) || (!write))
+		goto exit;
+
+	if (gcal_lazy_contact(contact, GCAL_F_PHOTO))
+		goto exit;
+
+	if ((!contact->photo_length) || (!contact->photo))
+		goto exit;
+
+	if (prepare_follow_redirection(gcalobj, contact->photo, write_cb_sink,
+				       "GData-Version: 3.0"))
+		goto exit;
+
+	sink.gcalobj = gcalobj;
+	sink.write = write;
+	sink.user = user;
+	sink.written = 0;
+	curl_easy_setopt(gcalobj->curl, CURLOPT_WRITEDATA, (void *)&sink);
+
+	/* Photos are never redirected */
+	result = gcal_perform(gcalobj, rewind_sink, &sink);
+	result = check_follow_redirection(gcalobj, result, 1);
+
+exit:
+	return result;
+}
+
+int gcal_put_photo_file(struct gcal_resource *gcalobj,
+			struct gcal_contact *contact, int fd)
+{
+	int result = -1;
+
+	if ((!gcalobj) || (!contact))
+		goto exit;
+
+	if ((gcal_lazy_contact(contact, GCAL_F_PHOTO)) || (!contact->photo))
+		goto exit;
+
+	result = up_file(fd, gcalobj, contact->photo,
+			 /* Google Data API 2.0 requires ETag */
+			 "If-Match: *",
+			 "Content-Type: image/*",
+			 GCAL_DEFAULT_ANSWER);
+	if (result)
+		goto exit;
+
+	/* Local photo data (if any) is outdated now */
+	if (contact->photo_length > 1)
+		free(contact->photo_data);
+	contact->photo_data = NULL;
+	contact->photo_length = 1;
+
+exit:
+	return result;
+}
+
 struct gcal_contact *gcal_get_all_contacts(struct gcal_resource *gcalobj,
 					   size_t *length)
 
@@ -81,6 +407,11 @@ struct gcal_contact *gcal_get_all_contacts(struct gcal_resource *gcalobj,
 	int result = -1;
 	size_t i = 0;
 	struct gcal_contact *ptr_res = NULL;
+	struct gcal_contact **photos = NULL;
+	struct gcal_lazy_feed *feed = NULL;
+	dom_document *doc;
+	const char *data;
+	struct gcal_entries_cache *cache;
 
 	if (!gcalobj)
 		goto exit;
@@ -88,14 +419,31 @@ struct gcal_contact *gcal_get_all_contacts(struct gcal_resource *gcalobj,
 	if (!gcalobj->buffer || !gcalobj->has_xml)
 		goto exit;
 
-	gcalobj->document = build_dom_document(gcalobj->buffer);
-	if (!gcalobj->document)
+	/* JSON feeds don't need a DOM tree */
+	if (json_is_feed(gcalobj->buffer))
+		result = json_entries(gcalobj->buffer);
+	else if ((gcalobj->document = build_dom_document(gcalobj->buffer)))
+		result = get_entries_number(gcalobj->document);
+	else
 		goto exit;
 
-	result = get_entries_number(gcalobj->document);
 	if (result == -1)
 		goto cleanup;
 
+	doc = gcalobj->document;
+	data = gcalobj->buffer;
+	cache = gcalobj->entries_cache;
+
+	/* Lazy entries keep the feed (and don't use the parse cache) */
+	if (gcalobj->lazy_fields) {
+		if (!(feed = gcal_lazy_feed_new(doc, data)))
+			goto cleanup;
+		gcalobj->document = NULL;
+		if (!doc)
+			data = feed->data;
+		cache = NULL;
+	}
+
 	ptr_res = malloc(sizeof(struct gcal_contact) * result);
 	if (!ptr_res)
 		goto cleanup;
@@ -106,45 +454,53 @@ struct gcal_contact *gcal_get_all_contacts(struct gcal_resource *gcalobj,
 		gcal_init_contact((ptr_res + i));
 		if (gcalobj->store_xml_entry)
 			(ptr_res + i)->common.store_xml = 1;
+		(ptr_res + i)->common.field_mask = gcalobj->field_mask;
+		gcal_lazy_attach(&(ptr_res + i)->common, feed);
 	}
 
-	result = extract_all_contacts(gcalobj->document, ptr_res, *length);
+	if (!doc)
+		result = json_extract_all_contacts(data, ptr_res, *length,
+						   cache);
+	else
+		result = extract_all_contacts_cached(doc, ptr_res, *length,
+						     cache);
 	if (result == -1) {
-		free(ptr_res);
+		gcal_destroy_contacts(ptr_res, *length);
 		ptr_res = NULL;
 		goto cleanup;
 	}
 
 	/* Check contacts with photo and download the pictures */
-	for (i = 0; i < *length; ++i){
-		if (ptr_res[i].photo_length) {
-			if (gcalobj->fout_log)
-				fprintf(gcalobj->fout_log,
-					"contact with photo!\n");
-
- 			result = get_follow_redirection(gcalobj,
- 							ptr_res[i].photo,
-							write_cb_binary,
-							"GData-Version: 3.0");
-			ptr_res[i].photo_data = malloc(sizeof(char) *
-						       gcalobj->length);
-			if (!ptr_res[i].photo_data)
-				goto exit;
-			ptr_res[i].photo_length = gcalobj->length;
-			memcpy(ptr_res[i].photo_data, gcalobj->buffer,
-			       ptr_res[i].photo_length);
-
-			clean_buffer(gcalobj);
-
-		} else if (gcalobj->fout_log)
+	if (gcalobj->lazy_photo)
+		goto cleanup;
+
+	photos = malloc(sizeof(struct gcal_contact *) * (*length + 1));
+	if (!photos)
+		goto cleanup;
+
+	for (i = 0; i < *length; ++i) {
+		photos[i] = ptr_res + i;
+		gcal_lazy_contact(photos[i], GCAL_F_ID | GCAL_F_PHOTO);
+		if (!gcalobj->fout_log)
+			continue;
+
+		if (ptr_res[i].photo_length)
+			fprintf(gcalobj->fout_log, "contact with photo!\n");
+		else
 			fprintf(gcalobj->fout_log, "contact without photo!\n");
 	}
-	goto exit;
+
+	/* Photos are downloaded at same time, using distinct connections */
+	gcal_get_photos(gcalobj, photos, *length);
 
 cleanup:
+	gcal_lazy_feed_release(feed);
 	clean_dom_document(gcalobj->document);
 	gcalobj->document = NULL;
 
+	if (photos)
+		free(photos);
+
 exit:
 
 	return ptr_res;
@@ -190,6 +546,7 @@ void gcal_init_contact(struct gcal_contact *contact)
 	contact->structured_name->next_field = NULL;
 
 	contact->common.store_xml = 0;
+	contact->common.field_mask = GCAL_F_ALL;
 	contact->common.id = contact->common.updated = NULL;
 	contact->common.title = contact->common.xml = NULL;
 	contact->common.edit_uri = contact->common.etag = NULL;
@@ -208,8 +565,14 @@ void gcal_init_contact(struct gcal_contact *contact)
 	contact->homepage = NULL;
 	contact->blog = NULL;
 	contact->photo = contact->photo_data = NULL;
+	contact->photo_etag = NULL;
 	contact->photo_length = 0;
 	contact->birthday = NULL;
+	contact->common.feed = NULL;
+	contact->common.node = NULL;
+	contact->common.text = NULL;
+	contact->common.text_length = 0;
+	contact->common.pending = 0;
 }
 
 void gcal_destroy_contact(struct gcal_contact *contact)
@@ -247,6 +610,7 @@ void gcal_destroy_contact(struct gcal_contact *contact)
 	clean_string(contact->homepage);
 	clean_string(contact->blog);
 	clean_string(contact->photo);
+	clean_string(contact->photo_etag);
 	clean_string(contact->photo_data);
 	contact->photo_length = 0;
 	clean_string(contact->birthday);
@@ -278,6 +642,145 @@ void gcal_destroy_contact(struct gcal_contact *contact)
 	    }
 	} while (contact->structured_name);
 	free(contact->structured_name);
+
+	gcal_lazy_detach(&contact->common);
+}
+
+static int copy_string(char **dest, const char *src)
+{
+	*dest = NULL;
+	if (!src)
+		return 0;
+
+	if (!(*dest = strdup(src)))
+		return -1;
+
+	return 0;
+}
+
+static int copy_multi_string(char ***dest, char **src, int n)
+{
+	int i;
+
+	*dest = NULL;
+	if ((!src) || (n <= 0))
+		return 0;
+
+	if (!(*dest = malloc(sizeof(char *) * n)))
+		return -1;
+	memset(*dest, 0, sizeof(char *) * n);
+
+	for (i = 0; i < n; ++i)
+		if (copy_string(*dest + i, src[i]))
+			return -1;
+
+	return 0;
+}
+
+static int copy_structured(struct gcal_structured_subvalues **dest,
+			   const struct gcal_structured_subvalues *src)
+{
+	struct gcal_structured_subvalues **next = dest;
+
+	*dest = NULL;
+	for (; src; src = src->next_field) {
+		if (!(*next = malloc(sizeof(struct gcal_structured_subvalues))))
+			return -1;
+		memset(*next, 0, sizeof(struct gcal_structured_subvalues));
+		(*next)->field_typenr = src->field_typenr;
+		if (copy_string(&(*next)->field_key, src->field_key) ||
+		    copy_string(&(*next)->field_value, src->field_value))
+			return -1;
+		next = &(*next)->next_field;
+	}
+
+	return 0;
+}
+
+int gcal_copy_contact(struct gcal_contact *dest,
+		      const struct gcal_contact *src)
+{
+	int result = -1;
+	struct gcal_contact copy;
+
+	if ((!dest) || (!src))
+		return result;
+
+	/* Fields are set to NULL, so 'copy' can be released at any point */
+	memset(&copy, 0, sizeof(struct gcal_contact));
+	copy.common.store_xml = src->common.store_xml;
+	copy.common.field_mask = src->common.field_mask;
+	copy.common.deleted = src->common.deleted;
+	copy.structured_name_nr = src->structured_name_nr;
+	copy.emails_nr = src->emails_nr;
+	copy.pref_email = src->pref_email;
+	copy.phone_numbers_nr = src->phone_numbers_nr;
+	copy.im_nr = src->im_nr;
+	copy.im_pref = src->im_pref;
+	copy.structured_address_nr = src->structured_address_nr;
+	copy.structured_address_pref = src->structured_address_pref;
+	copy.groupMembership_nr = src->groupMembership_nr;
+	copy.photo_length = src->photo_length;
+
+	/* Contacts don't use 'published' and 'visibility' */
+	if (copy_string(&copy.common.id, src->common.id) ||
+	    copy_string(&copy.common.updated, src->common.updated) ||
+	    copy_string(&copy.common.title, src->common.title) ||
+	    copy_string(&copy.common.edit_uri, src->common.edit_uri) ||
+	    copy_string(&copy.common.etag, src->common.etag) ||
+	    copy_string(&copy.common.xml, src->common.xml) ||
+	    copy_structured(&copy.structured_name, src->structured_name) ||
+	    copy_multi_string(&copy.emails_field, src->emails_field,
+			      src->emails_nr) ||
+	    copy_multi_string(&copy.emails_type, src->emails_type,
+			      src->emails_nr) ||
+	    copy_string(&copy.content, src->content) ||
+	    copy_string(&copy.nickname, src->nickname) ||
+	    copy_string(&copy.homepage, src->homepage) ||
+	    copy_string(&copy.blog, src->blog) ||
+	    copy_string(&copy.org_name, src->org_name) ||
+	    copy_string(&copy.org_title, src->org_title) ||
+	    copy_string(&copy.occupation, src->occupation) ||
+	    copy_multi_string(&copy.phone_numbers_field,
+			      src->phone_numbers_field,
+			      src->phone_numbers_nr) ||
+	    copy_multi_string(&copy.phone_numbers_type,
+			      src->phone_numbers_type,
+			      src->phone_numbers_nr) ||
+	    copy_multi_string(&copy.im_address, src->im_address,
+			      src->im_nr) ||
+	    copy_multi_string(&copy.im_protocol, src->im_protocol,
+			      src->im_nr) ||
+	    copy_multi_string(&copy.im_type, src->im_type, src->im_nr) ||
+	    copy_string(&copy.post_address, src->post_address) ||
+	    copy_structured(&copy.structured_address,
+			    src->structured_address) ||
+	    copy_multi_string(&copy.structured_address_type,
+			      src->structured_address_type,
+			      src->structured_address_nr) ||
+	    copy_multi_string(&copy.groupMembership, src->groupMembership,
+			      src->groupMembership_nr) ||
+	    copy_string(&copy.birthday, src->birthday) ||
+	    copy_string(&copy.photo, src->photo) ||
+	    copy_string(&copy.photo_etag, src->photo_etag))
+		goto cleanup;
+
+	if ((src->photo_length > 1) && (src->photo_data)) {
+		if (!(copy.photo_data = malloc(src->photo_length)))
+			goto cleanup;
+		memcpy(copy.photo_data, src->photo_data, src->photo_length);
+	}
+
+	/* Pending fields are decoded from the same feed */
+	gcal_lazy_share(&copy.common, &src->common);
+
+	gcal_destroy_contact(dest);
+	*dest = copy;
+	return 0;
+
+cleanup:
+	gcal_destroy_contact(&copy);
+	return result;
 }
 
 void gcal_destroy_contacts(struct gcal_contact *contacts, size_t length)
@@ -298,12 +801,17 @@ int gcal_create_contact(struct gcal_resource *gcalobj,
 			struct gcal_contact *updated)
 {
 	int result = -1, length;
-	char *xml_contact = NULL, *buffer;
+	size_t xml_length;
+	char *buffer;
 
 	if ((!contact) || (!gcalobj))
 		return result;
 
-	result = xmlcontact_create(contact, &xml_contact, &length);
+	if (gcal_lazy_contact(contact, GCAL_F_ALL))
+		return result;
+
+	result = xmlcontact_write(contact, &gcalobj->upload,
+				  &gcalobj->upload_size, &xml_length);
 	if (result == -1)
 		goto exit;
 
@@ -318,7 +826,7 @@ int gcal_create_contact(struct gcal_resource *gcalobj,
 	snprintf(buffer, length - 1, "%s%s%s%s%s", GCONTACT_START,
 		 gcalobj->user, GCAL_DELIMITER, gcalobj->domain, GCONTACT_END);
 
-	result = up_entry(xml_contact, strlen(xml_contact), gcalobj,
+	result = up_entry(gcalobj->upload, xml_length, gcalobj,
 			  buffer, NULL, POST, NULL, GCAL_EDIT_ANSWER);
 	if (result)
 		goto cleanup;
@@ -364,8 +872,6 @@ xmlclean:
 	gcalobj->document = NULL;
 
 cleanup:
-	if (xml_contact)
-		free(xml_contact);
 	if (buffer)
 		free(buffer);
 
@@ -377,21 +883,21 @@ exit:
 int gcal_delete_contact(struct gcal_resource *gcalobj,
 			struct gcal_contact *contact)
 {
-	int result = -1, length;
+	int result = -1;
 	char *h_auth;
 
 	if (!contact || !gcalobj)
 		goto exit;
 
+	if (gcal_lazy_contact(contact, GCAL_F_EDIT_URI))
+		goto exit;
+
 	/* Must cleanup HTTP buffer between requests */
 	clean_buffer(gcalobj);
 
 	/* TODO: add X-HTTP header */
-	length = strlen(gcalobj->auth) + sizeof(HEADER_GET) + 1;
-	h_auth = (char *) malloc(length);
-	if (!h_auth)
+	if (!(h_auth = gcal_auth_header(gcalobj)))
 		goto exit;
-	snprintf(h_auth, length - 1, "%s%s", HEADER_GET, gcalobj->auth);
 
 	curl_easy_setopt(gcalobj->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
 	result = http_post(gcalobj, contact->common.edit_uri,
@@ -405,9 +911,6 @@ int gcal_delete_contact(struct gcal_resource *gcalobj,
 	/* Restores curl context to previous standard mode */
 	curl_easy_setopt(gcalobj->curl, CURLOPT_CUSTOMREQUEST, NULL);
 
-	if (h_auth)
-		free(h_auth);
-
 exit:
 
 	return result;
@@ -418,39 +921,43 @@ int gcal_edit_contact(struct gcal_resource *gcalobj,
 		      struct gcal_contact *updated)
 {
 
-	int result = -1, length;
-	char *xml_contact = NULL;
+	int result = -1;
+	size_t length;
 
 	if ((!contact) || (!gcalobj))
 		goto exit;
 
-	result = xmlcontact_create(contact, &xml_contact, &length);
+	if (gcal_lazy_contact(contact, GCAL_F_ALL))
+		goto exit;
+
+	result = xmlcontact_write(contact, &gcalobj->upload,
+				  &gcalobj->upload_size, &length);
 	if (result == -1)
 		goto exit;
 
-	result = up_entry(xml_contact, strlen(xml_contact), gcalobj,
+	result = up_entry(gcalobj->upload, length, gcalobj,
 			  contact->common.edit_uri,
 			  /* Google Data API 2.0 requires ETag */
 			  "If-Match: *",
 			  PUT, NULL, GCAL_DEFAULT_ANSWER);
 	if (result)
-		goto cleanup;
+		goto exit;
 
 	/* Copy raw XML */
 	if (gcalobj->store_xml_entry) {
 		if (contact->common.xml)
 			free(contact->common.xml);
 		if (!(contact->common.xml = strdup(gcalobj->buffer)))
-			goto cleanup;
+			goto exit;
 	}
 
 	/* Parse buffer and create the new contact object */
 	if (!updated)
-		goto cleanup;
+		goto exit;
 	result = -2;
 	gcalobj->document = build_dom_document(gcalobj->buffer);
 	if (!gcalobj->document)
-		goto cleanup;
+		goto exit;
 
 	/* There is only one 'entry' in the buffer */
 	gcal_init_contact(updated);
@@ -467,7 +974,7 @@ int gcal_edit_contact(struct gcal_resource *gcalobj,
 				  PUT, "Content-Type: image/*",
 				  GCAL_DEFAULT_ANSWER);
 		if (result)
-			goto cleanup;
+			goto exit;
 
 	}
 
@@ -478,11 +985,6 @@ xmlclean:
 	clean_dom_document(gcalobj->document);
 	gcalobj->document = NULL;
 
-cleanup:
-
-	if (xml_contact)
-		free(xml_contact);
-
 exit:
 	return result;
 
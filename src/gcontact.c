@@ -44,10 +44,29 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "gcontact.h"
 #include "gcal_parser.h"
+#include "gcal_multi.h"
+#include "gcal_lazy.h"
+#include "gcal_stream.h"
+#include "gcal_pipeline.h"
 #include "internal_gcal.h"
 
+/** Downloaded ranges of the contacts feed, see
+ * \ref gcal_get_contacts_range.
+ */
+struct gcal_contact_ranges {
+	/** The user gcal object */
+	struct gcal_resource *gcalobj;
+	/** Vector with the contacts of each range */
+	struct gcal_contact **parts;
+	/** Number of contacts in each range */
+	size_t *lengths;
+};
+
 
 /** Strings associated with phone number types */
 const char* gcal_phone_type_str[] = {
@@ -136,6 +155,42 @@ void gcal_contact_delete(gcal_contact_t contact)
 
 }
 
+int gcal_contacts_from_feed(const char *buffer, size_t length,
+			    struct gcal_contact_array *contacts)
+{
+	void *entries = NULL;
+	size_t count = 0;
+
+	if (!contacts)
+		return -1;
+
+	if (gcal_stream_array(1, buffer, length, &entries, &count))
+		return -1;
+
+	contacts->entries = entries;
+	contacts->length = count;
+
+	return 0;
+}
+
+int gcal_contacts_from_file(const char *path,
+			    struct gcal_contact_array *contacts)
+{
+	void *entries = NULL;
+	size_t count = 0;
+
+	if (!contacts)
+		return -1;
+
+	if (gcal_stream_array_file(1, path, &entries, &count))
+		return -1;
+
+	contacts->entries = entries;
+	contacts->length = count;
+
+	return 0;
+}
+
 int gcal_get_contacts(gcal_t gcalobj, struct gcal_contact_array *contact_array)
 {
 	int result = -1;
@@ -163,6 +218,213 @@ int gcal_get_contacts(gcal_t gcalobj, struct gcal_contact_array *contact_array)
 
 }
 
+/** User callback of \ref gcal_get_contacts_cb */
+struct gcal_contacts_cb {
+	/** Called for each contact */
+	gcal_contact_cb callback;
+	/** User data pointer */
+	void *user;
+};
+
+static int contact_found(void **entry, void *user)
+{
+	struct gcal_contacts_cb *contacts = (struct gcal_contacts_cb *)user;
+	gcal_contact_t contact = (gcal_contact_t)*entry;
+	int result;
+
+	result = contacts->callback(&contact, contacts->user);
+	*entry = contact;
+
+	return result;
+}
+
+int gcal_get_contacts_cb(gcal_t gcalobj, gcal_contact_cb callback,
+			 void *user_data)
+{
+	int result = -1;
+	struct gcal_stream *stream;
+	struct gcal_contacts_cb contacts;
+
+	if ((!gcalobj) || (!callback))
+		goto exit;
+
+	contacts.callback = callback;
+	contacts.user = user_data;
+	if (!(stream = gcal_stream_new(gcalobj, 1, contact_found, &contacts)))
+		goto exit;
+
+	result = gcal_stream_dump(gcalobj, "GData-Version: 3.0", stream);
+	gcal_stream_delete(stream);
+
+exit:
+	return result;
+}
+
+int gcal_get_contacts_pipeline(gcal_t gcalobj, gcal_contact_cb deliver,
+			       gcal_contact_cb persist, void *user_data)
+{
+	struct gcal_contacts_cb delivered, persisted;
+
+	if ((!gcalobj) || (!deliver))
+		return -1;
+
+	delivered.callback = deliver;
+	delivered.user = user_data;
+	persisted.callback = persist;
+	persisted.user = user_data;
+
+	return gcal_pipeline_run(gcalobj, 1, "GData-Version: 3.0",
+				 contact_found, &delivered,
+				 persist ? contact_found : NULL, &persisted);
+}
+
+gcal_contact_iter_t gcal_contact_iter_open(gcal_t gcalobj)
+{
+	return gcal_iter_open(gcalobj, 1, "GData-Version: 3.0");
+}
+
+gcal_contact_t gcal_contact_iter_next(gcal_contact_iter_t iter)
+{
+	return (gcal_contact_t)gcal_iter_next(iter);
+}
+
+gcal_contact_t gcal_contact_iter_detach(gcal_contact_iter_t iter)
+{
+	return (gcal_contact_t)gcal_iter_detach(iter);
+}
+
+int gcal_contact_iter_close(gcal_contact_iter_t iter)
+{
+	return gcal_iter_close(iter);
+}
+
+static int contact_range_done(struct gcal_resource *slot, size_t job,
+			      int result, void *user)
+{
+	struct gcal_contact_ranges *ranges = (struct gcal_contact_ranges *)user;
+
+	ranges->gcalobj->http_code = slot->http_code;
+	if (result)
+		return -1;
+
+	slot->has_xml = 1;
+	ranges->parts[job] = gcal_get_all_contacts(slot, &ranges->lengths[job]);
+	slot->has_xml = 0;
+	if (!ranges->parts[job])
+		return -1;
+
+	return 0;
+}
+
+static void destroy_contact(void *contact)
+{
+	gcal_destroy_contact((struct gcal_contact *)contact);
+}
+
+int gcal_get_contacts_range(gcal_t gcalobj,
+			    struct gcal_contact_array *contact_array,
+			    size_t ranges)
+{
+	int result = -1, total;
+	size_t i, step;
+	char param_index[64], param_max[64];
+	char *max_results;
+	char **urls = NULL;
+	struct gcal_contact_ranges downloaded;
+
+	downloaded.parts = NULL;
+	downloaded.lengths = NULL;
+
+	if (contact_array) {
+		contact_array->entries = NULL;
+		contact_array->length = 0;
+	}
+
+	if ((!gcalobj) || (!contact_array))
+		goto exit;
+
+	/* Asks for a single entry, just to know the total of contacts */
+	if (gcal_query(gcalobj, "max-results=1", "GData-Version: 3.0"))
+		goto exit;
+	total = gcal_entry_number(gcalobj);
+	if (total == -1)
+		goto exit;
+
+	if (ranges < 1)
+		ranges = 1;
+	if (total && ((size_t)total < ranges))
+		ranges = total;
+	step = total / ranges + ((total % ranges) ? 1 : 0);
+	if (!step)
+		step = 1;
+
+	urls = calloc(ranges, sizeof(char *));
+	downloaded.gcalobj = gcalobj;
+	downloaded.parts = calloc(ranges, sizeof(struct gcal_contact *));
+	downloaded.lengths = calloc(ranges, sizeof(size_t));
+	if ((!urls) || (!downloaded.parts) || (!downloaded.lengths))
+		goto cleanup;
+
+	/* Ranges must not use the default 'max-results' */
+	max_results = gcalobj->max_results;
+	gcalobj->max_results = NULL;
+	for (i = 0; i < ranges; ++i) {
+		snprintf(param_index, sizeof(param_index) - 1,
+			 "start-index=%lu", (unsigned long)(1 + (i * step)));
+		snprintf(param_max, sizeof(param_max) - 1,
+			 "max-results=%lu", (unsigned long)step);
+
+		urls[i] = mount_query_url(gcalobj, param_index, param_max,
+					  "orderby=lastmodified", NULL);
+		if (!urls[i])
+			break;
+	}
+	gcalobj->max_results = max_results;
+	if (i != ranges)
+		goto cleanup;
+
+	result = gcal_multi_get(gcalobj, (const char * const *)urls, ranges,
+				NULL, "GData-Version: 3.0", contact_range_done,
+				&downloaded);
+	if (result)
+		goto cleanup;
+
+	result = -1;
+	contact_array->entries = gcal_multi_merge((void **)downloaded.parts,
+						  downloaded.lengths, ranges,
+						  sizeof(struct gcal_contact),
+						  &contact_array->length);
+	if (!contact_array->entries)
+		goto cleanup;
+
+	/* A contact edited while downloading can move between ranges: it
+	 * is either read twice or skipped (see gcontact.h).
+	 */
+	contact_array->length = gcal_multi_dedup(contact_array->entries,
+						 contact_array->length,
+						 sizeof(struct gcal_contact),
+						 destroy_contact);
+	result = 0;
+
+cleanup:
+	for (i = 0; i < ranges; ++i) {
+		if (urls && urls[i])
+			free(urls[i]);
+		if (downloaded.parts && downloaded.parts[i])
+			gcal_destroy_contacts(downloaded.parts[i],
+					      downloaded.lengths[i]);
+	}
+	if (urls)
+		free(urls);
+	if (downloaded.parts)
+		free(downloaded.parts);
+	if (downloaded.lengths)
+		free(downloaded.lengths);
+
+exit:
+	return result;
+}
+
 void gcal_cleanup_contacts(struct gcal_contact_array *contacts)
 {
 	if (!contacts)
@@ -324,6 +586,7 @@ char *gcal_contact_get_id(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ID);
 	return gcal_get_id(&(contact->common));
 }
 
@@ -331,6 +594,7 @@ char *gcal_contact_get_updated(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_UPDATED);
 	return gcal_get_updated(&(contact->common));
 }
 
@@ -338,6 +602,7 @@ char *gcal_contact_get_title(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_TITLE);
 	return gcal_get_title(&(contact->common));
 }
 
@@ -345,6 +610,7 @@ char *gcal_contact_get_url(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_EDIT_URI);
 	return gcal_get_url(&(contact->common));
 }
 
@@ -352,6 +618,7 @@ char *gcal_contact_get_etag(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ETAG);
 	return gcal_get_etag(&(contact->common));
 }
 
@@ -359,6 +626,7 @@ char gcal_contact_is_deleted(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_STATUS);
 	return gcal_get_deleted(&(contact->common));
 }
 
@@ -368,6 +636,7 @@ int gcal_contact_get_emails_count(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_EMAILS);
 	return contact->emails_nr;
 }
 
@@ -375,6 +644,7 @@ int gcal_contact_get_pref_email(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_EMAILS);
 	return contact->pref_email;
 }
 
@@ -382,6 +652,7 @@ char *gcal_contact_get_email_address(gcal_contact_t contact, int i)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_EMAILS);
 	if (!(contact->emails_field) || (i >= contact->emails_nr))
 		return NULL;
 	return contact->emails_field[i];
@@ -404,6 +675,7 @@ gcal_email_type gcal_contact_get_email_address_type(gcal_contact_t contact, int
 
 	if ((!contact))
 		return result;
+	gcal_lazy_contact(contact, GCAL_F_EMAILS);
 	if (!(contact->emails_type) || (i >= contact->emails_nr))
 		return result;
 	for (j = 0; j < E_ITEMS_COUNT; j++)
@@ -416,6 +688,7 @@ char *gcal_contact_get_content(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_CONTENT);
 	return contact->content;
 }
 
@@ -423,6 +696,7 @@ char *gcal_contact_get_nickname(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_NICKNAME);
 	return contact->nickname;
 }
 
@@ -430,6 +704,7 @@ char *gcal_contact_get_organization(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ORGANIZATION);
 	return contact->org_name;
 }
 
@@ -437,6 +712,7 @@ char *gcal_contact_get_profission(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ORGANIZATION);
 	return contact->org_title;
 }
 
@@ -444,6 +720,7 @@ char *gcal_contact_get_occupation(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ORGANIZATION);
 	return contact->occupation;
 }
 
@@ -451,6 +728,7 @@ char *gcal_contact_get_homepage(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_WEBSITES);
 	return contact->homepage;
 }
 
@@ -458,6 +736,7 @@ char *gcal_contact_get_blog(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_WEBSITES);
 	return contact->blog;
 }
 
@@ -465,6 +744,7 @@ int gcal_contact_get_phone_numbers_count(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_PHONES);
 	return contact->phone_numbers_nr;
 }
 
@@ -472,6 +752,7 @@ char *gcal_contact_get_phone_number(gcal_contact_t contact, int i)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_PHONES);
 	if (!(contact->phone_numbers_field) || (i >= contact->phone_numbers_nr))
 		return NULL;
 	return contact->phone_numbers_field[i];
@@ -495,6 +776,7 @@ gcal_phone_type gcal_contact_get_phone_number_type(gcal_contact_t contact, int i
 
 	if ((!contact))
 		return result;
+	gcal_lazy_contact(contact, GCAL_F_PHONES);
 	if (!(contact->phone_numbers_type) || (i >= contact->phone_numbers_nr))
 		return result;
 	for (j = 0; j < P_ITEMS_COUNT; j++)
@@ -507,6 +789,7 @@ char *gcal_contact_get_im(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	if (!(contact->im_address))
 		return NULL;
 
@@ -523,6 +806,7 @@ int gcal_contact_get_im_count(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	return contact->im_nr;
 }
 
@@ -530,6 +814,7 @@ int gcal_contact_get_pref_im(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	return contact->im_pref;
 }
 
@@ -537,6 +822,7 @@ char *gcal_contact_get_im_protocol(gcal_contact_t contact, int i)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	if (!(contact->im_protocol) || (i >= contact->im_nr))
 		return NULL;
 	return contact->im_protocol[i];
@@ -546,6 +832,7 @@ char *gcal_contact_get_im_address(gcal_contact_t contact, int i)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	if (!(contact->im_address) || (i >= contact->im_nr))
 		return NULL;
 	return contact->im_address[i];
@@ -558,6 +845,7 @@ gcal_phone_type gcal_contact_get_im_type(gcal_contact_t contact, int i)
 
 	if ((!contact))
 		return result;
+	gcal_lazy_contact(contact, GCAL_F_IM);
 	if (!(contact->im_type) || (i >= contact->im_nr))
 		return result;
 	for (j = 0; j < I_ITEMS_COUNT; j++)
@@ -568,8 +856,9 @@ gcal_phone_type gcal_contact_get_im_type(gcal_contact_t contact, int i)
 
 gcal_structured_subvalues_t gcal_contact_get_structured_name(gcal_contact_t contact)
 {
-	if ((!contact) || (!contact->structured_name))
+	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_TITLE);
 	return contact->structured_name;
 }
 
@@ -577,13 +866,15 @@ char *gcal_contact_get_address(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return contact->post_address;
 }
 
 gcal_structured_subvalues_t gcal_contact_get_structured_address(gcal_contact_t contact)
 {
-	if ((!contact) || (!contact->structured_address))
+	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return contact->structured_address;
 }
 
@@ -591,6 +882,7 @@ int gcal_contact_get_structured_address_count(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return contact->structured_address_nr;
 }
 
@@ -598,6 +890,7 @@ int *gcal_contact_get_structured_address_count_obj(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return &contact->structured_address_nr;
 }
 
@@ -633,6 +926,7 @@ char ***gcal_contact_get_structured_address_type_obj(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return &contact->structured_address_type;
 }
 
@@ -645,6 +939,7 @@ gcal_address_type gcal_contact_get_structured_address_type(gcal_contact_t contac
 
 	if ((!contact))
 		return result;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 
 	if (!(contact->structured_address_type) ||
 	    (structured_entry_nr >= structured_entry_count))
@@ -661,6 +956,7 @@ int gcal_contact_get_pref_structured_address(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_ADDRESS);
 	return contact->structured_address_pref;
 }
 
@@ -668,6 +964,7 @@ int gcal_contact_get_groupMembership_count(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_GROUPS);
 	return contact->groupMembership_nr;
 }
 
@@ -675,6 +972,7 @@ char *gcal_contact_get_groupMembership(gcal_contact_t contact, int i)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_GROUPS);
 	if (!(contact->groupMembership) || (i >= contact->groupMembership_nr))
 		return NULL;
 	return contact->groupMembership[i];
@@ -692,14 +990,111 @@ unsigned int gcal_contact_get_photolength(gcal_contact_t contact)
 {
 	if ((!contact))
 		return -1;
+	gcal_lazy_contact(contact, GCAL_F_PHOTO);
 
 	return contact->photo_length;
 }
 
+char *gcal_contact_get_photo_etag(gcal_contact_t contact)
+{
+	if ((!contact))
+		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_PHOTO);
+
+	return contact->photo_etag;
+}
+
+int gcal_contact_fetch_photo(gcal_t gcalobj, gcal_contact_t contact)
+{
+	if ((!gcalobj) || (!contact))
+		return -1;
+	gcal_lazy_contact(contact, GCAL_F_PHOTO);
+
+	/* Contact has no photo */
+	if ((!contact->photo_length) || (!contact->photo))
+		return -1;
+
+	return gcal_get_photos(gcalobj, &contact, 1);
+}
+
+int gcal_contact_fetch_photos(gcal_t gcalobj, gcal_contact_t *contacts,
+			      size_t count)
+{
+	if ((!gcalobj) || (!contacts))
+		return -1;
+
+	return gcal_get_photos(gcalobj, contacts, count);
+}
+
+int gcal_contact_fetch_photo_cb(gcal_t gcalobj, gcal_contact_t contact,
+				gcal_photo_sink write, void *user)
+{
+	if ((!gcalobj) || (!contact) || (!write))
+		return -1;
+
+	return gcal_get_photo_sink(gcalobj, contact, write, user);
+}
+
+static size_t write_fd(const void *data, size_t length, void *user)
+{
+	int fd = *(int *)user;
+	const char *ptr = data;
+	size_t written = 0;
+	ssize_t result;
+
+	while (written < length) {
+		result = write(fd, ptr + written, length - written);
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		written += result;
+	}
+
+	return written;
+}
+
+int gcal_contact_fetch_photo_fd(gcal_t gcalobj, gcal_contact_t contact,
+				int fd)
+{
+	if ((!gcalobj) || (!contact) || (fd < 0))
+		return -1;
+
+	return gcal_get_photo_sink(gcalobj, contact, write_fd, &fd);
+}
+
+int gcal_contact_upload_photo_fd(gcal_t gcalobj, gcal_contact_t contact,
+				 int fd)
+{
+	if ((!gcalobj) || (!contact) || (fd < 0))
+		return -1;
+
+	return gcal_put_photo_file(gcalobj, contact, fd);
+}
+
+int gcal_contact_upload_photo_file(gcal_t gcalobj, gcal_contact_t contact,
+				   const char *path)
+{
+	int result, fd;
+
+	if ((!gcalobj) || (!contact) || (!path))
+		return -1;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+
+	result = gcal_put_photo_file(gcalobj, contact, fd);
+	close(fd);
+
+	return result;
+}
+
 char *gcal_contact_get_birthday(gcal_contact_t contact)
 {
 	if ((!contact))
 		return NULL;
+	gcal_lazy_contact(contact, GCAL_F_BIRTHDAY);
 	return contact->birthday;
 }
 
@@ -711,6 +1106,9 @@ int gcal_contact_set_title(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_TITLE))
+		return result;
+
 	if (contact->common.title)
 		free(contact->common.title);
 
@@ -729,6 +1127,9 @@ int gcal_contact_delete_email_addresses(gcal_contact_t contact)
 	if (!contact)
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_EMAILS))
+		return result;
+
 	if (contact->emails_nr > 0) {
 		for (temp = 0; temp < contact->emails_nr; temp++) {
 			if (contact->emails_field[temp])
@@ -757,6 +1158,9 @@ int gcal_contact_add_email_address(gcal_contact_t contact, const char *field,
 	if ((!contact) || (!field) || (type<0) || (type>=E_ITEMS_COUNT))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_EMAILS))
+		return result;
+
 	contact->emails_field = (char**) realloc(contact->emails_field,
 						 (contact->emails_nr+1) *
 						 sizeof(char*));
@@ -793,6 +1197,9 @@ int gcal_contact_set_url(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_EDIT_URI))
+		return result;
+
 	if (contact->common.edit_uri)
 		free(contact->common.edit_uri);
 
@@ -811,6 +1218,9 @@ int gcal_contact_set_id(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ID))
+		return result;
+
 	if (contact->common.id)
 		free(contact->common.id);
 
@@ -829,6 +1239,9 @@ int gcal_contact_set_etag(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ETAG))
+		return result;
+
 	if (contact->common.etag)
 		free(contact->common.etag);
 
@@ -847,6 +1260,9 @@ int gcal_contact_delete_phone_numbers(gcal_contact_t contact)
 	if (!contact)
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_PHONES))
+		return result;
+
 	if (contact->phone_numbers_nr > 0) {
 		for (temp = 0; temp < contact->phone_numbers_nr; temp++) {
 			if (contact->phone_numbers_field[temp])
@@ -876,6 +1292,9 @@ int gcal_contact_add_phone_number(gcal_contact_t contact, const char *field,
 	if ((!contact) || (!field) || (type<0) || (type>=P_ITEMS_COUNT))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_PHONES))
+		return result;
+
 	contact->phone_numbers_field = (char**) realloc(contact->phone_numbers_field, (contact->phone_numbers_nr+1) * sizeof(char*));
 	contact->phone_numbers_field[contact->phone_numbers_nr] = strdup(field);
 
@@ -908,6 +1327,9 @@ int gcal_contact_delete_im(gcal_contact_t contact)
 	if (!contact)
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_IM))
+		return result;
+
 	if (contact->im_nr > 0) {
 		for (temp = 0; temp < contact->im_nr; temp++) {
 			if (contact->im_protocol[temp])
@@ -939,6 +1361,9 @@ int gcal_contact_add_im(gcal_contact_t contact, const char *protcol,
 	if ((!contact) || (!protcol) || (!address) || (type<0) || (type>=I_ITEMS_COUNT))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_IM))
+		return result;
+
 	contact->im_protocol = (char**) realloc(contact->im_protocol, (contact->im_nr+1) * sizeof(char*));
 	contact->im_protocol[contact->im_nr] = strdup(protcol);
 
@@ -965,6 +1390,9 @@ int gcal_contact_set_address(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ADDRESS))
+		return result;
+
 	if (contact->post_address)
 		free(contact->post_address);
 
@@ -983,6 +1411,9 @@ int gcal_contact_set_structured_address_nr(gcal_contact_t contact,
 	if (!contact || (type < 0) || (type >= A_ITEMS_COUNT))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ADDRESS))
+		return result;
+
 	entry_nr = contact->structured_address_nr;
 	contact->structured_address_type = (char**) realloc(contact->structured_address_type, (entry_nr + 1) * sizeof(char*));
 	contact->structured_address_type[entry_nr] = strdup(gcal_address_type_str[type]);
@@ -1000,6 +1431,9 @@ int gcal_contact_set_pref_structured_address(gcal_contact_t contact, int pref_ad
 	if ((!contact) || (pref_address < 0))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ADDRESS))
+		return result;
+
 	contact->structured_address_pref = pref_address;
 	
 	result = 0;
@@ -1100,6 +1534,9 @@ int gcal_contact_delete_groupMembership(gcal_contact_t contact)
 	if (!contact)
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_GROUPS))
+		return result;
+
 	if (contact->groupMembership_nr > 0) {
 		for (temp = 0; temp < contact->groupMembership_nr; temp++) {
 			if (contact->groupMembership[temp])
@@ -1122,6 +1559,9 @@ int gcal_contact_add_groupMembership(gcal_contact_t contact, char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_GROUPS))
+		return result;
+
 	contact->groupMembership = (char**) realloc(contact->groupMembership, (contact->groupMembership_nr+1) * sizeof(char*));
 	contact->groupMembership[contact->groupMembership_nr] = strdup(field);
 
@@ -1139,6 +1579,9 @@ int gcal_contact_set_profission(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ORGANIZATION))
+		return result;
+
 	if (contact->org_title)
 		free(contact->org_title);
 
@@ -1157,6 +1600,9 @@ int gcal_contact_set_organization(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ORGANIZATION))
+		return result;
+
 	if (contact->org_name)
 		free(contact->org_name);
 
@@ -1174,6 +1620,9 @@ int gcal_contact_set_occupation(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_ORGANIZATION))
+		return result;
+
 	if (contact->occupation)
 		free(contact->occupation);
 
@@ -1191,6 +1640,9 @@ int gcal_contact_set_content(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_CONTENT))
+		return result;
+
 	if (contact->content)
 		free(contact->content);
 
@@ -1208,6 +1660,9 @@ int gcal_contact_set_nickname(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_NICKNAME))
+		return result;
+
 	if (contact->nickname)
 		free(contact->nickname);
 
@@ -1226,6 +1681,9 @@ int gcal_contact_set_photo(gcal_contact_t contact, const char *field,
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_PHOTO))
+		return result;
+
 	if (contact->photo_data)
 		if (contact->photo_length > 1)
 			free(contact->photo_data);
@@ -1247,6 +1705,9 @@ int gcal_contact_set_birthday(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_BIRTHDAY))
+		return result;
+
 	if (contact->birthday)
 		free(contact->birthday);
 
@@ -1264,6 +1725,9 @@ int gcal_contact_set_homepage(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_WEBSITES))
+		return result;
+
 	if (contact->homepage)
 		free(contact->homepage);
 
@@ -1281,6 +1745,9 @@ int gcal_contact_set_blog(gcal_contact_t contact, const char *field)
 	if ((!contact) || (!field))
 		return result;
 
+	if (gcal_lazy_contact(contact, GCAL_F_WEBSITES))
+		return result;
+
 	if (contact->blog)
 		free(contact->blog);
 
@@ -0,0 +1,1513 @@
+/*
+Copyright (c) 2008 Instituto Nokia de Tecnologia
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the INdT nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+/**
+ * @file   json_parser.c
+ * @author Adenilson Cavalcanti
+ *
+ * @brief  This is the JSON feed parser, it extracts the same data of the
+ * Atom parser from feeds downloaded with 'alt=json'.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "internal_gcal.h"
+#include "json_parser.h"
+#include "atom_parser.h"
+
+/** A JSON value, it points to its text in the feed (nothing is copied) */
+struct json_value {
+	/** First character */
+	const char *start;
+	/** After the last character */
+	const char *end;
+};
+
+/** Iterates the members of an object or the elements of an array */
+struct json_iter {
+	/** Current position */
+	const char *pos;
+	/** End of the object/array */
+	const char *end;
+	/** If there wasn't any item yet */
+	char first;
+	/** A single value used as an array of one element */
+	char single;
+};
+
+/** Elements selected from an entry (like a XPath node set) */
+struct json_nodes {
+	/** The elements */
+	struct json_value *tab;
+	/** Number of elements */
+	int nr;
+	/** Allocated length */
+	int size;
+};
+
+static const char *skip_blank(const char *pos, const char *end)
+{
+	while ((pos < end) && ((*pos == ' ') || (*pos == '\t') ||
+			       (*pos == '\n') || (*pos == '\r')))
+		++pos;
+
+	return pos;
+}
+
+/* Returns the position after the closing quote of a string */
+static const char *skip_string(const char *pos, const char *end)
+{
+	for (++pos; pos < end; ++pos) {
+		if (*pos == '\\')
+			++pos;
+		else if (*pos == '"')
+			return pos + 1;
+	}
+
+	return NULL;
+}
+
+/* Returns the position after a value, NULL if it is malformed */
+static const char *skip_value(const char *pos, const char *end)
+{
+	int depth = 0;
+
+	while (pos < end) {
+		switch (*pos) {
+		case '"':
+			if (!(pos = skip_string(pos, end)))
+				return NULL;
+			if (!depth)
+				return pos;
+			continue;
+		case '{':
+		case '[':
+			++depth;
+			break;
+		case '}':
+		case ']':
+			if (--depth < 0)
+				return NULL;
+			if (!depth)
+				return pos + 1;
+			break;
+		default:
+			/* Numbers and literals (true, false, null) */
+			if (!depth) {
+				while ((pos < end) && (*pos != ',') &&
+				       (*pos != '}') && (*pos != ']') &&
+				       (*pos != ' ') && (*pos != '\n') &&
+				       (*pos != '\t') && (*pos != '\r'))
+					++pos;
+				return pos;
+			}
+		}
+		++pos;
+	}
+
+	return NULL;
+}
+
+static int is_object(const struct json_value *value)
+{
+	return (value->start < value->end) && (*value->start == '{');
+}
+
+/* Elements are objects (or arrays of them), attributes are strings */
+static int is_element(const struct json_value *value)
+{
+	return (value->start < value->end) &&
+		((*value->start == '{') || (*value->start == '['));
+}
+
+static void members(const struct json_value *object, struct json_iter *iter)
+{
+	iter->pos = object->start + 1;
+	iter->end = object->end;
+	iter->first = 1;
+	iter->single = 0;
+}
+
+static int next_member(struct json_iter *iter, struct json_value *key,
+		       struct json_value *value)
+{
+	const char *pos = skip_blank(iter->pos, iter->end);
+
+	if ((pos >= iter->end) || (*pos == '}'))
+		return 0;
+	if (!iter->first) {
+		if (*pos != ',')
+			return 0;
+		pos = skip_blank(pos + 1, iter->end);
+	}
+	iter->first = 0;
+
+	if ((pos >= iter->end) || (*pos != '"'))
+		return 0;
+	key->start = pos + 1;
+	if (!(pos = skip_string(pos, iter->end)))
+		return 0;
+	key->end = pos - 1;
+
+	pos = skip_blank(pos, iter->end);
+	if ((pos >= iter->end) || (*pos != ':'))
+		return 0;
+
+	value->start = skip_blank(pos + 1, iter->end);
+	if (!(value->end = skip_value(value->start, iter->end)))
+		return 0;
+
+	iter->pos = value->end;
+	return 1;
+}
+
+/* An element that can repeat is an array, but a single object is fine */
+static void elements(const struct json_value *value, struct json_iter *iter)
+{
+	iter->end = value->end;
+	iter->first = 1;
+	iter->single = (value->start >= value->end) || (*value->start != '[');
+	iter->pos = iter->single ? value->start : value->start + 1;
+}
+
+static int next_element(struct json_iter *iter, struct json_value *value)
+{
+	const char *pos = skip_blank(iter->pos, iter->end);
+
+	if (iter->single) {
+		if ((!iter->first) || (pos >= iter->end))
+			return 0;
+		iter->first = 0;
+		value->start = pos;
+		value->end = iter->end;
+		return 1;
+	}
+
+	if ((pos >= iter->end) || (*pos == ']'))
+		return 0;
+	if (!iter->first) {
+		if (*pos != ',')
+			return 0;
+		pos = skip_blank(pos + 1, iter->end);
+	}
+	iter->first = 0;
+
+	value->start = pos;
+	if (!(value->end = skip_value(pos, iter->end)))
+		return 0;
+
+	iter->pos = value->end;
+	return 1;
+}
+
+/* Compares a member name. Like 'xmlGetProp', attributes are found by
+ * local name (i.e. 'gd$etag' is 'etag').
+ */
+static int same_name(const struct json_value *key, const char *name,
+		     int local)
+{
+	const char *start = key->start, *pos;
+	size_t length = strlen(name);
+
+	if (local)
+		for (pos = key->start + 1; pos < key->end; ++pos)
+			if (*pos == '$')
+				start = pos + 1;
+
+	return ((size_t)(key->end - start) == length) &&
+		(!memcmp(start, name, length));
+}
+
+/* Finds an element (local is 0) or an attribute (local is 1) */
+static int member(const struct json_value *object, const char *name,
+		  int local, struct json_value *value)
+{
+	struct json_iter iter;
+	struct json_value key;
+
+	if (!is_object(object))
+		return 0;
+
+	members(object, &iter);
+	while (next_member(&iter, &key, value))
+		if (same_name(&key, name, local) &&
+		    (is_element(value) != local))
+			return 1;
+
+	return 0;
+}
+
+/* Writes an unicode code point in UTF-8 */
+static char *put_utf8(char *out, unsigned long code)
+{
+	if (code < 0x80)
+		*out++ = code;
+	else if (code < 0x800) {
+		*out++ = 0xc0 | (code >> 6);
+		*out++ = 0x80 | (code & 0x3f);
+	} else if (code < 0x10000) {
+		*out++ = 0xe0 | (code >> 12);
+		*out++ = 0x80 | ((code >> 6) & 0x3f);
+		*out++ = 0x80 | (code & 0x3f);
+	} else {
+		*out++ = 0xf0 | (code >> 18);
+		*out++ = 0x80 | ((code >> 12) & 0x3f);
+		*out++ = 0x80 | ((code >> 6) & 0x3f);
+		*out++ = 0x80 | (code & 0x3f);
+	}
+
+	return out;
+}
+
+static int get_hex(const char *pos, const char *end, unsigned long *code)
+{
+	int i;
+
+	*code = 0;
+	if (end - pos < 4)
+		return -1;
+
+	for (i = 0; i < 4; ++i, ++pos) {
+		*code <<= 4;
+		if ((*pos >= '0') && (*pos <= '9'))
+			*code |= *pos - '0';
+		else if ((*pos >= 'a') && (*pos <= 'f'))
+			*code |= *pos - 'a' + 10;
+		else if ((*pos >= 'A') && (*pos <= 'F'))
+			*code |= *pos - 'A' + 10;
+		else
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Copies a string value (decoding escapes) or the text of other scalars */
+static char *string_dup(const struct json_value *value)
+{
+	const char *pos = value->start, *end = value->end;
+	unsigned long code, low;
+	char *result, *out;
+
+	if ((pos < end) && (*pos == '"')) {
+		++pos;
+		--end;
+	}
+
+	/* Decoded text is never longer */
+	if (!(result = malloc(end - pos + 1)))
+		return NULL;
+
+	for (out = result; pos < end; ++pos) {
+		if ((*pos != '\\') || (pos + 1 >= end)) {
+			*out++ = *pos;
+			continue;
+		}
+
+		switch (*++pos) {
+		case 'b': *out++ = '\b'; break;
+		case 'f': *out++ = '\f'; break;
+		case 'n': *out++ = '\n'; break;
+		case 'r': *out++ = '\r'; break;
+		case 't': *out++ = '\t'; break;
+		case 'u':
+			if (get_hex(pos + 1, end, &code))
+				break;
+			pos += 4;
+			/* Surrogate pair */
+			if ((code >= 0xd800) && (code < 0xdc00) &&
+			    (end - pos > 6) && (pos[1] == '\\') &&
+			    (pos[2] == 'u') && (!get_hex(pos + 3, end, &low)) &&
+			    (low >= 0xdc00) && (low < 0xe000)) {
+				code = 0x10000 + ((code - 0xd800) << 10) +
+					(low - 0xdc00);
+				pos += 6;
+			}
+			out = put_utf8(out, code);
+			break;
+		default:
+			*out++ = *pos;
+		}
+	}
+	*out = '\0';
+
+	return result;
+}
+
+/* Gets the text (member '$t') of an element, if it isn't empty */
+static int get_text_value(const struct json_value *node,
+			  struct json_value *text)
+{
+	struct json_iter iter;
+	struct json_value key;
+
+	if (!is_object(node))
+		return 0;
+
+	members(node, &iter);
+	while (next_member(&iter, &key, text))
+		if (same_name(&key, "$t", 0) && (!is_element(text)))
+			/* An empty element has no text node */
+			return (text->end - text->start > 2) ||
+				(*text->start != '"');
+
+	return 0;
+}
+
+static int add_node(struct json_nodes *nodes, const struct json_value *node)
+{
+	struct json_value *tmp;
+	int size;
+
+	if (nodes->nr == nodes->size) {
+		size = nodes->size ? nodes->size * 2 : 8;
+		tmp = realloc(nodes->tab, size * sizeof(struct json_value));
+		if (!tmp)
+			return -1;
+		nodes->tab = tmp;
+		nodes->size = size;
+	}
+
+	nodes->tab[nodes->nr++] = *node;
+	return 0;
+}
+
+/* Checks the value of an attribute */
+static int attribute_is(const struct json_value *node, const char *attr,
+			const char *expected)
+{
+	struct json_value value;
+	char *tmp;
+	int result;
+
+	if (!member(node, attr, 1, &value))
+		return 0;
+	if (!(tmp = string_dup(&value)))
+		return 0;
+
+	result = !strcmp(tmp, expected);
+	free(tmp);
+
+	return result;
+}
+
+/* Selects the elements 'name' (or 'name/child') of an entry, optionally only
+ * the ones with an attribute value. They are the XPath expressions used by
+ * the Atom parser, e.g. "//atom:entry/atom:link[@rel='edit']".
+ */
+static int select_nodes(const struct json_value *entry, const char *name,
+			const char *child, const char *attr,
+			const char *attr_value, struct json_nodes *nodes)
+{
+	struct json_iter iter, iter_child;
+	struct json_value value, node, value_child, node_child;
+
+	nodes->tab = NULL;
+	nodes->nr = nodes->size = 0;
+
+	if (!member(entry, name, 0, &value))
+		return 0;
+
+	elements(&value, &iter);
+	while (next_element(&iter, &node)) {
+		if (!child) {
+			if ((attr) && (!attribute_is(&node, attr, attr_value)))
+				continue;
+			if (add_node(nodes, &node))
+				goto error;
+			continue;
+		}
+
+		if (!member(&node, child, 0, &value_child))
+			continue;
+		elements(&value_child, &iter_child);
+		while (next_element(&iter_child, &node_child))
+			if (add_node(nodes, &node_child))
+				goto error;
+	}
+
+	return nodes->nr;
+
+error:
+	free(nodes->tab);
+	nodes->tab = NULL;
+	nodes->nr = 0;
+	return -1;
+}
+
+/* Gets the text of an element (e.g. "//atom:entry/atom:id/text()"): like
+ * 'extract_and_check', it is an empty string if there isn't exactly one.
+ */
+static char *get_text(const struct json_value *entry, const char *name,
+		      const char *child)
+{
+	struct json_nodes nodes;
+	struct json_value text, found;
+	int i, count = 0;
+	char *result;
+
+	if (select_nodes(entry, name, child, NULL, NULL, &nodes) == -1)
+		return NULL;
+
+	for (i = 0; i < nodes.nr; ++i)
+		if (get_text_value(&nodes.tab[i], &text)) {
+			found = text;
+			++count;
+		}
+
+	result = count == 1 ? string_dup(&found) : strdup("");
+	free(nodes.tab);
+
+	return result;
+}
+
+/* Gets an attribute of an element (e.g. "//atom:entry/gd:where" and
+ * "valueString"): like 'extract_and_check', it is an empty string if there
+ * isn't exactly one element and NULL if the element doesn't have it.
+ */
+static char *get_attribute(const struct json_value *entry, const char *name,
+			   const char *filter, const char *filter_value,
+			   const char *attr)
+{
+	struct json_nodes nodes;
+	struct json_value value;
+	char *result = NULL;
+	int count;
+
+	count = select_nodes(entry, name, NULL, filter, filter_value, &nodes);
+	if (count == -1)
+		return NULL;
+
+	if (count != 1)
+		result = strdup("");
+	else if (member(&nodes.tab[0], attr, 1, &value))
+		result = string_dup(&value);
+
+	free(nodes.tab);
+
+	return result;
+}
+
+/* Same as 'get_attribute', but absent attributes (i.e. left out of a
+ * partial response) are empty strings.
+ */
+static char *get_optional(const struct json_value *entry, const char *name,
+			  const char *attr)
+{
+	char *result = get_attribute(entry, name, NULL, NULL, attr);
+
+	if (!result)
+		result = strdup("");
+
+	return result;
+}
+
+/* Gets the value after '#' (e.g. 'home' for '...2005#home') */
+static char *get_type(const struct json_value *node, const char *attr)
+{
+	struct json_value value;
+	char *tmp, *result, *type;
+
+	if (!member(node, attr, 1, &value))
+		return strdup("");
+	if (!(tmp = string_dup(&value)))
+		return NULL;
+
+	type = strchr(tmp, '#');
+	result = strdup(type ? type + 1 : "");
+	free(tmp);
+
+	return result;
+}
+
+/* Checks if an attribute is 'true' (e.g. 'primary') */
+static int is_true(const struct json_value *node, const char *attr)
+{
+	return attribute_is(node, attr, "true");
+}
+
+/* The same of 'extract_and_check_multi' (plus the XPath filter) */
+static int get_multi(const struct json_value *entry, const char *name,
+		     const char *filter, const char *filter_value,
+		     int getContent, const char *attr1, const char *attr2,
+		     const char *attr3, const char *attr4, char ***values,
+		     char ***types, char ***protocols, int *pref)
+{
+	struct json_nodes nodes;
+	struct json_value value;
+	int result, i;
+
+	result = select_nodes(entry, name, NULL, filter, filter_value, &nodes);
+	if (result <= 0)
+		return result;
+
+	*values = calloc(nodes.nr, sizeof(char *));
+	if (attr2)
+		*types = calloc(nodes.nr, sizeof(char *));
+	if (attr3)
+		*protocols = calloc(nodes.nr, sizeof(char *));
+	if ((!*values) || (attr2 && !*types) || (attr3 && !*protocols)) {
+		result = -1;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nodes.nr; ++i) {
+		if (getContent)
+			(*values)[i] = get_text_value(&nodes.tab[i], &value) ?
+				string_dup(&value) : strdup("");
+		else if (member(&nodes.tab[i], attr1, 1, &value))
+			(*values)[i] = string_dup(&value);
+		else
+			(*values)[i] = strdup(" ");
+
+		if (attr2)
+			(*types)[i] = get_type(&nodes.tab[i], attr2);
+		if (attr3)
+			(*protocols)[i] = get_type(&nodes.tab[i], attr3);
+		if ((attr4) && (is_true(&nodes.tab[i], attr4)))
+			*pref = i;
+	}
+
+cleanup:
+	free(nodes.tab);
+	return result;
+}
+
+/* The same of 'extract_and_check_multisub': each child element of the
+ * selected elements is a field (e.g. 'givenName' of 'gd:name').
+ */
+static int get_multisub(const struct json_value *entry, const char *name,
+			const char *attr1, const char *attr2,
+			struct gcal_structured_subvalues **values,
+			char ***types, int *pref)
+{
+	struct json_nodes nodes;
+	struct json_iter iter, iter_child;
+	struct json_value key, value, child, text;
+	struct gcal_structured_subvalues *tempval, *next;
+	const char *local;
+	int result, i;
+
+	result = select_nodes(entry, name, NULL, NULL, NULL, &nodes);
+	if (result <= 0)
+		return result;
+
+	tempval = *values;
+	if ((attr1) && (!(*types = calloc(nodes.nr, sizeof(char *))))) {
+		result = -1;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nodes.nr; ++i) {
+		members(&nodes.tab[i], &iter);
+		while (is_object(&nodes.tab[i]) &&
+		       next_member(&iter, &key, &value)) {
+			if (!is_element(&value))
+				continue;
+
+			/* Field key is the local name */
+			for (local = key.end; (local > key.start) &&
+				     (local[-1] != '$'); --local)
+				;
+
+			elements(&value, &iter_child);
+			while (next_element(&iter_child, &child)) {
+				next = malloc(sizeof(struct gcal_structured_subvalues));
+				if (!next) {
+					result = -1;
+					goto cleanup;
+				}
+				next->field_typenr = 0;
+				next->field_key = NULL;
+				next->field_value = NULL;
+				next->next_field = NULL;
+
+				tempval->next_field = next;
+				tempval->field_typenr = i;
+				tempval->field_key = malloc(key.end - local + 1);
+				if (tempval->field_key) {
+					memcpy(tempval->field_key, local,
+					       key.end - local);
+					tempval->field_key[key.end - local] = '\0';
+				}
+				tempval->field_value =
+					get_text_value(&child, &text) ?
+					string_dup(&text) : strdup("");
+				/* init next entry */
+				tempval = next;
+			}
+		}
+
+		if (attr1)
+			(*types)[i] = get_type(&nodes.tab[i], attr1);
+		if ((attr2) && (is_true(&nodes.tab[i], attr2)))
+			*pref = i;
+	}
+
+cleanup:
+	free(nodes.tab);
+	return result;
+}
+
+/* Gets the value after the last '.' (e.g. 'accepted' for
+ * '...2005#event.accepted').
+ */
+static char *get_enum(const struct json_value *node, const char *attr)
+{
+	struct json_value value;
+	char *tmp, *dot, *result = NULL;
+
+	if (!member(node, attr, 1, &value))
+		return NULL;
+	if (!(tmp = string_dup(&value)))
+		return NULL;
+
+	if ((dot = strrchr(tmp, '.')))
+		result = strdup(dot + 1);
+	free(tmp);
+
+	return result;
+}
+
+static int starts(const char *value, const char *prefix)
+{
+	return !strncmp(value, prefix, strlen(prefix));
+}
+
+/* Finds the first child element which local name starts with 'prefix' */
+static int first_child(const struct json_value *node, const char *prefix,
+		       struct json_value *child)
+{
+	struct json_iter iter, iter_child;
+	struct json_value key, value;
+	const char *local;
+	size_t length = strlen(prefix);
+
+	members(node, &iter);
+	while (next_member(&iter, &key, &value)) {
+		if (!is_element(&value))
+			continue;
+
+		for (local = key.end; (local > key.start) &&
+			     (local[-1] != '$'); --local)
+			;
+		if (((size_t)(key.end - local) < length) ||
+		    (memcmp(local, prefix, length)))
+			continue;
+
+		elements(&value, &iter_child);
+		return next_element(&iter_child, child);
+	}
+
+	return 0;
+}
+
+/* The same of 'extract_and_check_alarms' for recurrent events */
+static int get_alarms(const struct json_value *entry,
+		      struct gcal_event_alarms **alarms)
+{
+	struct json_nodes nodes;
+	struct json_value value;
+	char *tmp;
+	int result, i;
+
+	result = select_nodes(entry, "gd$reminder", NULL, NULL, NULL, &nodes);
+	if (result <= 0)
+		return result > 0 ? result : 0;
+
+	if (!(*alarms = calloc(nodes.nr, sizeof(struct gcal_event_alarms)))) {
+		result = 0;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nodes.nr; ++i) {
+		if (member(&nodes.tab[i], "method", 1, &value) &&
+		    (tmp = string_dup(&value))) {
+			if (starts(tmp, "email"))
+				(*alarms)[i].type = GCAL_ALARM_EMAIL;
+			else if (starts(tmp, "alert"))
+				(*alarms)[i].type = GCAL_ALARM_ALERT;
+			free(tmp);
+		}
+
+		if (member(&nodes.tab[i], "minutes", 1, &value) &&
+		    (tmp = string_dup(&value))) {
+			(*alarms)[i].minutes = atoi(tmp);
+			free(tmp);
+		}
+	}
+
+cleanup:
+	free(nodes.tab);
+	return result;
+}
+
+/* The same of 'extract_and_check_attendees' */
+static int get_attendees(const struct json_value *entry,
+			 struct gcal_event_attendees **attendees)
+{
+	struct json_nodes nodes;
+	struct json_value value, child;
+	struct gcal_event_attendees *attendee;
+	char *tmp;
+	int result, i;
+
+	result = select_nodes(entry, "gd$who", NULL, NULL, NULL, &nodes);
+	if (result <= 0)
+		return result > 0 ? result : 0;
+
+	if (!(*attendees = calloc(nodes.nr,
+				  sizeof(struct gcal_event_attendees)))) {
+		result = 0;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nodes.nr; ++i) {
+		attendee = *attendees + i;
+		if (member(&nodes.tab[i], "email", 1, &value))
+			attendee->email = string_dup(&value);
+		else
+			attendee->email = strdup(" ");
+
+		if ((tmp = get_enum(&nodes.tab[i], "rel"))) {
+			if (starts(tmp, "attendee"))
+				attendee->rel = GCAL_REL_ATTENDEE;
+			else if (starts(tmp, "organizer"))
+				attendee->rel = GCAL_REL_ORGANIZER;
+			else if (starts(tmp, "performer"))
+				attendee->rel = GCAL_REL_PERFORMER;
+			else if (starts(tmp, "speaker"))
+				attendee->rel = GCAL_REL_SPEAKER;
+			free(tmp);
+		}
+
+		/* Organizer status is the event status */
+		if (attendee->rel == GCAL_REL_ORGANIZER) {
+			if ((!first_child(entry, "eventStatus", &child)) ||
+			    (!(tmp = get_enum(&child, "value"))))
+				continue;
+
+			if (starts(tmp, "confirmed"))
+				attendee->status = GCAL_STATUS_CONFIRMED;
+			else if (starts(tmp, "busy"))
+				attendee->status = GCAL_STATUS_BUSY;
+			else if (starts(tmp, "canceled"))
+				attendee->status = GCAL_STATUS_CANCELED;
+			free(tmp);
+
+		} else if (first_child(&nodes.tab[i], "attendeeStatus", &child)) {
+			if (!(tmp = get_enum(&child, "value")))
+				continue;
+
+			if (starts(tmp, "accepted"))
+				attendee->status = GCAL_STATUS_ACCEPTED;
+			else if (starts(tmp, "declined"))
+				attendee->status = GCAL_STATUS_DECLINED;
+			else if (starts(tmp, "invited"))
+				attendee->status = GCAL_STATUS_INVITED;
+			else if (starts(tmp, "tentative"))
+				attendee->status = GCAL_STATUS_TENTATIVE;
+			free(tmp);
+
+		} else if (first_child(&nodes.tab[i], "attendeeType", &child)) {
+			if (!(tmp = get_enum(&child, "value")))
+				continue;
+
+			if (starts(tmp, "optional"))
+				attendee->type = GCAL_TYPE_OPTIONAL;
+			else if (starts(tmp, "required"))
+				attendee->type = GCAL_TYPE_REQUIRED;
+			free(tmp);
+		}
+	}
+
+cleanup:
+	free(nodes.tab);
+	return result;
+}
+
+/* Entry ETag is the attribute 'gd$etag' */
+static char *get_etag(const struct json_value *entry)
+{
+	struct json_value value;
+
+	if (!member(entry, "etag", 1, &value))
+		return NULL;
+
+	return string_dup(&value);
+}
+
+/* ETag can be left out of partial responses */
+static char *get_entry_etag(const struct json_value *entry)
+{
+	char *result = get_etag(entry);
+
+	if (!result)
+		result = strdup("");
+
+	return result;
+}
+
+/* Stores the raw JSON entry */
+static char *get_raw(const struct json_value *entry, char store)
+{
+	char *result;
+
+	if (!store)
+		return strdup("");
+
+	if ((result = malloc(entry->end - entry->start + 1))) {
+		memcpy(result, entry->start, entry->end - entry->start);
+		result[entry->end - entry->start] = '\0';
+	}
+
+	return result;
+}
+
+int json_is_feed(const char *data)
+{
+	if (!data)
+		return 0;
+
+	data = skip_blank(data, data + strlen(data));
+	return *data == '{';
+}
+
+/* Gets the entries of a feed (or the entry of a single entry document) */
+static int get_entries(const char *data, struct json_value *feed,
+		       struct json_value *entries)
+{
+	struct json_value root;
+
+	if (!data)
+		return -1;
+
+	root.end = data + strlen(data);
+	root.start = skip_blank(data, root.end);
+	if (!is_object(&root))
+		return -1;
+	/* Truncated or malformed document */
+	if (!(root.end = skip_value(root.start, root.end)))
+		return -1;
+
+	if (member(&root, "feed", 0, feed)) {
+		if (!member(feed, "entry", 0, entries))
+			entries->start = entries->end = feed->end;
+		return 0;
+	}
+
+	feed->start = feed->end = root.end;
+	if (member(&root, "entry", 0, entries))
+		return 0;
+
+	return -1;
+}
+
+static int count_entries(const struct json_value *entries)
+{
+	struct json_iter iter;
+	struct json_value node;
+	int count = 0;
+
+	elements(entries, &iter);
+	while (next_element(&iter, &node))
+		++count;
+
+	return count;
+}
+
+int json_entries(const char *data)
+{
+	struct json_value feed, entries, value;
+	char *total;
+	int result = -1;
+
+	if (get_entries(data, &feed, &entries))
+		goto exit;
+
+	total = get_text(&feed, "openSearch$totalResults", NULL);
+	if (!total)
+		goto exit;
+	if (total[0])
+		result = atoi(total);
+	free(total);
+
+	/* Partial responses may not have the total: entries are counted */
+	if ((result == -1) && (!member(&feed, "openSearch$totalResults", 0,
+				       &value)))
+		result = count_entries(&entries);
+
+exit:
+	return result;
+}
+
+int json_extract_data(const char *entry, size_t length,
+		      struct gcal_event *ptr_entry)
+{
+	struct json_value doc;
+	unsigned int mask;
+	char recurrent = 0;
+	int result = -1;
+
+	if (!entry || !ptr_entry)
+		goto exit;
+	mask = ptr_entry->common.field_mask;
+
+	doc.start = entry;
+	doc.end = entry + length;
+	if (!is_object(&doc))
+		goto exit;
+
+	/* Google Data API 2.0 requires ETag to edit an entry */
+	if ((mask & GCAL_F_ETAG) &&
+	    (!(ptr_entry->common.etag = get_entry_etag(&doc))))
+		goto exit;
+
+	/* Store JSON raw data */
+	if (!(ptr_entry->common.xml = get_raw(&doc, ptr_entry->common.store_xml)))
+		goto exit;
+
+	if ((mask & GCAL_F_TITLE) &&
+	    (!(ptr_entry->common.title = get_text(&doc, "title", NULL))))
+		goto exit;
+
+	if ((mask & GCAL_F_ID) &&
+	    (!(ptr_entry->common.id = get_text(&doc, "id", NULL))))
+		goto exit;
+
+	if (mask & GCAL_F_EDIT_URI) {
+		ptr_entry->common.edit_uri = get_attribute(&doc, "link", "rel",
+							   "edit", "href");
+		if (!ptr_entry->common.edit_uri)
+			goto exit;
+		/* See 'atom_extract_data' */
+		workaround_edit_url(ptr_entry->common.edit_uri);
+	}
+
+	if (mask & GCAL_F_CONTENT)
+		ptr_entry->content = get_text(&doc, "content", NULL);
+
+	if (mask & GCAL_F_WHERE)
+		ptr_entry->where = get_attribute(&doc, "gd$where", NULL, NULL,
+						 "valueString");
+
+	if ((mask & GCAL_F_STATUS) &&
+	    (!(ptr_entry->status = get_optional(&doc, "gd$eventStatus",
+						"value"))))
+		goto exit;
+
+	if (mask & GCAL_F_ATTENDEES)
+		ptr_entry->attendees_nr = get_attendees(&doc,
+							&ptr_entry->attendees);
+
+	if (mask & (GCAL_F_WHEN | GCAL_F_ALARMS)) {
+		ptr_entry->dt_recurrent = get_text(&doc, "gd$recurrence", NULL);
+		if (!ptr_entry->dt_recurrent)
+			goto exit;
+		recurrent = ptr_entry->dt_recurrent[0] != 0;
+	}
+
+	if ((mask & GCAL_F_WHEN) && (recurrent)) {
+		ptr_entry->dt_start = strdup("");
+		ptr_entry->dt_end = strdup("");
+	} else if (mask & GCAL_F_WHEN) {
+		ptr_entry->dt_start = get_attribute(&doc, "gd$when", NULL,
+						    NULL, "startTime");
+		ptr_entry->dt_end = get_attribute(&doc, "gd$when", NULL, NULL,
+						  "endTime");
+	}
+
+	/* Only alarms of recurrent events are extracted */
+	if ((mask & GCAL_F_ALARMS) && (recurrent))
+		ptr_entry->alarms_nr = get_alarms(&doc, &ptr_entry->alarms);
+
+	if (mask & GCAL_F_GUESTS) {
+		ptr_entry->anyoneCanAddSelf =
+			get_optional(&doc, "gCal$anyoneCanAddSelf", "value");
+		if (!ptr_entry->anyoneCanAddSelf)
+			goto exit;
+
+		ptr_entry->guestsCanInviteOthers =
+			get_optional(&doc, "gCal$guestsCanInviteOthers",
+				     "value");
+		if (!ptr_entry->guestsCanInviteOthers)
+			goto exit;
+
+		ptr_entry->guestsCanModify =
+			get_optional(&doc, "gCal$guestsCanModify", "value");
+		if (!ptr_entry->guestsCanModify)
+			goto exit;
+
+		ptr_entry->guestsCanSeeGuests =
+			get_optional(&doc, "gCal$guestsCanSeeGuests", "value");
+		if (!ptr_entry->guestsCanSeeGuests)
+			goto exit;
+	}
+
+	if ((mask & GCAL_F_SEQUENCE) &&
+	    (!(ptr_entry->sequence = get_optional(&doc, "gCal$sequence",
+						  "value"))))
+		goto exit;
+
+	/* Detects if event was deleted/canceled and marks the flag */
+	if ((ptr_entry->status) &&
+	    (!(strcmp("http://schemas.google.com/g/2005#event.canceled",
+		      ptr_entry->status))))
+		ptr_entry->common.deleted = 1;
+	else
+		ptr_entry->common.deleted = 0;
+
+	if (mask & GCAL_F_UPDATED) {
+		ptr_entry->common.published = get_text(&doc, "published",
+						       NULL);
+		if (!ptr_entry->common.published)
+			goto exit;
+
+		ptr_entry->common.updated = get_text(&doc, "updated", NULL);
+		if (!ptr_entry->common.updated)
+			goto exit;
+	}
+
+	if (mask & GCAL_F_VISIBILITY)
+		ptr_entry->common.visibility = get_attribute(&doc,
+							     "gd$visibility",
+							     NULL, NULL,
+							     "value");
+
+	result = 0;
+
+exit:
+	return result;
+}
+
+int json_extract_contact(const char *entry, size_t length,
+			 struct gcal_contact *ptr_entry)
+{
+	struct json_nodes nodes;
+	struct json_value doc;
+	unsigned int mask;
+	int result = -1;
+
+	if (!entry || !ptr_entry)
+		goto exit;
+	mask = ptr_entry->common.field_mask;
+
+	doc.start = entry;
+	doc.end = entry + length;
+	if (!is_object(&doc))
+		goto exit;
+
+	/* Google Data API 2.0 requires ETag to edit an entry */
+	if ((mask & GCAL_F_ETAG) &&
+	    (!(ptr_entry->common.etag = get_entry_etag(&doc))))
+		goto exit;
+
+	/* Store JSON raw data */
+	if (!(ptr_entry->common.xml = get_raw(&doc, ptr_entry->common.store_xml)))
+		goto exit;
+
+	/* Detects if this contacts was deleted */
+	if (mask & GCAL_F_STATUS) {
+		ptr_entry->common.deleted = select_nodes(&doc, "gd$deleted",
+							 NULL, NULL, NULL,
+							 &nodes) == 1;
+		free(nodes.tab);
+	}
+
+	if ((mask & GCAL_F_ID) &&
+	    (!(ptr_entry->common.id = get_text(&doc, "id", NULL))))
+		goto exit;
+
+	if (mask & GCAL_F_UPDATED)
+		ptr_entry->common.updated = get_text(&doc, "updated", NULL);
+
+	if (mask & GCAL_F_TITLE) {
+		ptr_entry->structured_name_nr =
+			get_multisub(&doc, "gd$name", NULL, NULL,
+				     &ptr_entry->structured_name, NULL, NULL);
+
+		ptr_entry->common.title = get_text(&doc, "gd$name",
+						   "gd$fullName");
+		if (!ptr_entry->common.title && !ptr_entry->structured_name_nr)
+			goto exit;
+	}
+
+	if ((mask & GCAL_F_EDIT_URI) &&
+	    (!(ptr_entry->common.edit_uri = get_attribute(&doc, "link", "rel",
+							  "edit", "href"))))
+		goto exit;
+
+	if (mask & GCAL_F_EMAILS)
+		ptr_entry->emails_nr = get_multi(&doc, "gd$email", NULL, NULL,
+						 0, "address", "rel", NULL,
+						 "primary",
+						 &ptr_entry->emails_field,
+						 &ptr_entry->emails_type, NULL,
+						 &ptr_entry->pref_email);
+
+	/* Here begins extra fields */
+	if (mask & GCAL_F_CONTENT)
+		ptr_entry->content = get_text(&doc, "content", NULL);
+
+	if (mask & GCAL_F_NICKNAME)
+		ptr_entry->nickname = get_text(&doc, "gContact$nickname", NULL);
+
+	if (mask & GCAL_F_WEBSITES) {
+		ptr_entry->homepage = get_attribute(&doc, "gContact$website",
+						    "rel", "home-page", "href");
+		ptr_entry->blog = get_attribute(&doc, "gContact$website", "rel",
+						"blog", "href");
+	}
+
+	if (mask & GCAL_F_ORGANIZATION) {
+		ptr_entry->org_name = get_text(&doc, "gd$organization",
+					       "gd$orgName");
+		ptr_entry->org_title = get_text(&doc, "gd$organization",
+						"gd$orgTitle");
+		ptr_entry->occupation = get_text(&doc, "gContact$occupation",
+						 NULL);
+	}
+
+	if (mask & GCAL_F_PHONES)
+		ptr_entry->phone_numbers_nr =
+			get_multi(&doc, "gd$phoneNumber", NULL, NULL, 1, NULL,
+				  "rel", NULL, NULL,
+				  &ptr_entry->phone_numbers_field,
+				  &ptr_entry->phone_numbers_type, NULL, NULL);
+
+	if (mask & GCAL_F_IM)
+		ptr_entry->im_nr = get_multi(&doc, "gd$im", NULL, NULL, 0,
+					     "address", "rel", "protocol",
+					     "primary", &ptr_entry->im_address,
+					     &ptr_entry->im_type,
+					     &ptr_entry->im_protocol,
+					     &ptr_entry->im_pref);
+
+	if (mask & GCAL_F_ADDRESS) {
+		ptr_entry->post_address =
+			get_text(&doc, "gd$structuredPostalAddress",
+				 "gd$formattedAddress");
+
+		ptr_entry->structured_address_nr =
+			get_multisub(&doc, "gd$structuredPostalAddress", "rel",
+				     "primary", &ptr_entry->structured_address,
+				     &ptr_entry->structured_address_type,
+				     &ptr_entry->structured_address_pref);
+	}
+
+	if (mask & GCAL_F_GROUPS)
+		ptr_entry->groupMembership_nr =
+			get_multi(&doc, "gContact$groupMembershipInfo",
+				  "deleted", "false", 0, "href", NULL, NULL,
+				  NULL, &ptr_entry->groupMembership, NULL,
+				  NULL, NULL);
+
+	if (mask & GCAL_F_BIRTHDAY)
+		ptr_entry->birthday = get_attribute(&doc, "gContact$birthday",
+						    NULL, NULL, "when");
+
+	/* Gets contact photo edit url and test for etag */
+	if (mask & GCAL_F_PHOTO) {
+		ptr_entry->photo = get_attribute(&doc, "link", "type",
+						 "image/*", "href");
+		ptr_entry->photo_etag = get_attribute(&doc, "link", "type",
+						      "image/*", "etag");
+		if (ptr_entry->photo_etag)
+			ptr_entry->photo_length = 1;
+	}
+
+	result = 0;
+
+exit:
+	return result;
+}
+
+/* Gets a cached copy of the entry, if it didn't change since last parse */
+static int cached_entry(struct gcal_entries_cache *cache,
+			const struct json_value *node, void *entry)
+{
+	int result = -1;
+	char *id, *etag = NULL;
+
+	if (!cache)
+		return result;
+
+	if ((id = get_text(node, "id", NULL)))
+		if ((etag = get_etag(node)))
+			result = gcal_entries_cache_get(cache, id, etag, entry);
+
+	if (id)
+		free(id);
+	if (etag)
+		free(etag);
+
+	return result;
+}
+
+int json_extract_all_entries(const char *data,
+			     struct gcal_event *data_extract, int length,
+			     struct gcal_entries_cache *cache)
+{
+	struct json_value feed, entries, node;
+	struct json_iter iter;
+	int result = -1, i;
+
+	if (get_entries(data, &feed, &entries))
+		goto exit;
+
+	/* Entries must be the array length */
+	if (count_entries(&entries) != length) {
+		fprintf(stderr, "json_extract_all_entries: Size mismatch!\n");
+		goto exit;
+	}
+
+	elements(&entries, &iter);
+	for (i = 0; next_element(&iter, &node); ++i) {
+		if (!cached_entry(cache, &node, &data_extract[i]))
+			continue;
+
+		/* Lazy entries decode other fields later from their text */
+		if (data_extract[i].common.feed) {
+			data_extract[i].common.text = node.start;
+			data_extract[i].common.text_length = node.end -
+				node.start;
+		}
+
+		if (json_extract_data(node.start, node.end - node.start,
+				      &data_extract[i]))
+			goto exit;
+
+		if (cache)
+			gcal_entries_cache_put(cache, &data_extract[i]);
+	}
+
+	result = 0;
+
+exit:
+	return result;
+}
+
+int json_extract_all_contacts(const char *data,
+			      struct gcal_contact *data_extract, int length,
+			      struct gcal_entries_cache *cache)
+{
+	struct json_value feed, entries, node;
+	struct json_iter iter;
+	int result = -1, i;
+
+	if (get_entries(data, &feed, &entries))
+		goto exit;
+
+	/* Entries must be the array length */
+	if (count_entries(&entries) != length) {
+		fprintf(stderr, "json_extract_all_contacts: Size mismatch!\n");
+		goto exit;
+	}
+
+	elements(&entries, &iter);
+	for (i = 0; next_element(&iter, &node); ++i) {
+		if (!cached_entry(cache, &node, &data_extract[i]))
+			continue;
+
+		/* Lazy entries decode other fields later from their text */
+		if (data_extract[i].common.feed) {
+			data_extract[i].common.text = node.start;
+			data_extract[i].common.text_length = node.end -
+				node.start;
+		}
+
+		if (json_extract_contact(node.start, node.end - node.start,
+					 &data_extract[i]))
+			goto exit;
+
+		if (cache)
+			gcal_entries_cache_put(cache, &data_extract[i]);
+	}
+
+	result = 0;
+
+exit:
+	return result;
+}
+
+/** States of \ref json_scan */
+enum json_scan_state {
+	SCAN_ROOT,
+	SCAN_ROOT_MEMBERS,
+	SCAN_FEED_MEMBERS,
+	SCAN_ENTRIES,
+	SCAN_END
+};
+
+void json_scan_init(struct json_scan *scan)
+{
+	if (!scan)
+		return;
+
+	scan->state = SCAN_ROOT;
+	scan->parent = SCAN_ROOT_MEMBERS;
+}
+
+int json_scan_done(const struct json_scan *scan)
+{
+	return scan && (scan->state == SCAN_END);
+}
+
+/* Checks the name of a member, 'key' includes the quotes */
+static int is_key(const char *key, const char *key_end, const char *name)
+{
+	size_t length = strlen(name);
+
+	return ((size_t)(key_end - key) == length + 2) &&
+		!strncmp(key + 1, name, length);
+}
+
+int json_next_entry(struct json_scan *scan, const char *data, size_t length,
+		    size_t *used, const char **entry, size_t *entry_length)
+{
+	const char *pos = data, *end = data + length;
+	const char *key, *key_end, *next, *value;
+	int result = 0;
+
+	if ((!scan) || (!data) || (!used) || (!entry) || (!entry_length))
+		return -1;
+
+	while ((pos = skip_blank(pos, end)) < end) {
+		switch (scan->state) {
+		case SCAN_ROOT:
+			if (*pos != '{')
+				goto error;
+			++pos;
+			scan->state = SCAN_ROOT_MEMBERS;
+			break;
+
+		case SCAN_ROOT_MEMBERS:
+		case SCAN_FEED_MEMBERS:
+			if (*pos == ',') {
+				++pos;
+				break;
+			}
+			if (*pos == '}') {
+				++pos;
+				if (scan->state == SCAN_FEED_MEMBERS)
+					scan->state = SCAN_ROOT_MEMBERS;
+				else
+					scan->state = SCAN_END;
+				break;
+			}
+			if (*pos != '"')
+				goto error;
+
+			/* Member name and start of its value must be here */
+			key = pos;
+			if (!(key_end = skip_string(pos, end)))
+				goto exit;
+			next = skip_blank(key_end, end);
+			if (next == end)
+				goto exit;
+			if (*next != ':')
+				goto error;
+			value = skip_blank(next + 1, end);
+			if (value == end)
+				goto exit;
+
+			if ((scan->state == SCAN_ROOT_MEMBERS) && (*value == '{')
+			    && is_key(key, key_end, "feed")) {
+				pos = value + 1;
+				scan->state = SCAN_FEED_MEMBERS;
+				break;
+			}
+			if ((*value == '[') && is_key(key, key_end, "entry")) {
+				pos = value + 1;
+				scan->parent = scan->state;
+				scan->state = SCAN_ENTRIES;
+				break;
+			}
+
+			/* Other values are skipped when complete */
+			if (!(next = skip_value(value, end)))
+				goto exit;
+			if ((next == end) && (*value != '"') && (*value != '{')
+			    && (*value != '['))
+				goto exit;
+			pos = next;
+
+			/* Single entry document (or feed with one entry) */
+			if (is_key(key, key_end, "entry")) {
+				if (*value != '{')
+					goto error;
+				*entry = value;
+				*entry_length = next - value;
+				result = 1;
+				goto exit;
+			}
+			break;
+
+		case SCAN_ENTRIES:
+			if (*pos == ',') {
+				++pos;
+				break;
+			}
+			if (*pos == ']') {
+				++pos;
+				scan->state = scan->parent;
+				break;
+			}
+			if (*pos != '{')
+				goto error;
+			if (!(next = skip_value(pos, end)))
+				goto exit;
+			*entry = pos;
+			*entry_length = next - pos;
+			pos = next;
+			result = 1;
+			goto exit;
+
+		default:
+			/* Anything after the root object is ignored */
+			pos = end;
+		}
+	}
+
+	goto exit;
+
+error:
+	result = -1;
+
+exit:
+	*used = pos - data;
+	return result;
+}
@@ -43,6 +43,10 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "xml_aux.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 int register_namespaces(xmlXPathContext *xpathCtx, const xmlChar *name_space,
 			const xmlChar* href)
 {
@@ -140,3 +144,148 @@ void xmlentry_destroy_resources(xmlTextWriter **writer, xmlBuffer **buffer)
 			*buffer = NULL;
 		}
 }
+
+void xml_writer_init(struct xml_writer *writer, char **buffer, size_t *size)
+{
+	writer->buffer = buffer;
+	writer->size = size;
+	writer->length = 0;
+	writer->error = 0;
+	if (*buffer && *size)
+		**buffer = 0;
+}
+
+void xml_write_raw(struct xml_writer *writer, const char *data, size_t length)
+{
+	size_t size;
+	char *ptr;
+
+	if (writer->error || !length)
+		return;
+
+	size = *writer->size;
+	if (writer->length + length + 1 > size) {
+		if (!size)
+			size = 1024;
+		while (writer->length + length + 1 > size)
+			size *= 2;
+
+		if (!(ptr = realloc(*writer->buffer, size))) {
+			writer->error = 1;
+			return;
+		}
+		*writer->buffer = ptr;
+		*writer->size = size;
+	}
+
+	memcpy(*writer->buffer + writer->length, data, length);
+	writer->length += length;
+	(*writer->buffer)[writer->length] = 0;
+}
+
+/* Same as libxml 'IS_CHAR' */
+static int valid_char(unsigned int value)
+{
+	return (value == 0x9) || (value == 0xA) || (value == 0xD) ||
+		((value >= 0x20) && (value <= 0xD7FF)) ||
+		((value >= 0xE000) && (value <= 0xFFFD)) ||
+		((value >= 0x10000) && (value <= 0x10FFFF));
+}
+
+static void write_char_ref(struct xml_writer *writer, unsigned int value)
+{
+	char tmp[16];
+	int length;
+
+	length = snprintf(tmp, sizeof(tmp), "&#x%X;", value);
+	xml_write_raw(writer, tmp, length);
+}
+
+/* Decodes an UTF-8 sequence, returning its length (0 if it isn't valid) */
+static size_t decode_utf8(const unsigned char *ptr, unsigned int *value)
+{
+	size_t length, i;
+
+	if (*ptr < 0xC0)
+		return 0;
+	else if (*ptr < 0xE0) {
+		length = 2;
+		*value = *ptr & 0x1F;
+	} else if (*ptr < 0xF0) {
+		length = 3;
+		*value = *ptr & 0x0F;
+	} else if (*ptr < 0xF8) {
+		length = 4;
+		*value = *ptr & 0x07;
+	} else
+		return 0;
+
+	for (i = 1; i < length; ++i) {
+		if (!ptr[i])
+			return 0;
+		*value = (*value << 6) | (ptr[i] & 0x3F);
+	}
+
+	if (!valid_char(*value))
+		return 0;
+
+	return length;
+}
+
+void xml_write_escaped(struct xml_writer *writer, const char *text,
+		       int attribute)
+{
+	const unsigned char *ptr, *run;
+	const char *entity;
+	unsigned int value;
+	size_t length;
+
+	if (!text)
+		return;
+
+	for (run = ptr = (const unsigned char *)text; *ptr; ) {
+		entity = NULL;
+		if (*ptr == '<')
+			entity = "&lt;";
+		else if (*ptr == '>')
+			entity = "&gt;";
+		else if (*ptr == '&')
+			entity = "&amp;";
+		else if (attribute && (*ptr == '"'))
+			entity = "&quot;";
+		else if (attribute && (*ptr == '\n'))
+			entity = "&#10;";
+		else if (attribute && (*ptr == '\r'))
+			entity = "&#13;";
+		else if (attribute && (*ptr == '\t'))
+			entity = "&#9;";
+		else if (*ptr == '\r')
+			entity = "&#xD;";
+		else if (((*ptr >= 0x20) && (*ptr < 0x80)) ||
+			 (*ptr == '\n') || (*ptr == '\t')) {
+			++ptr;
+			continue;
+		}
+
+		xml_write_raw(writer, (const char *)run, ptr - run);
+		if (entity) {
+			xml_write_raw(writer, entity, strlen(entity));
+			++ptr;
+		} else if (*ptr < 0x20)
+			/* Control characters can't be written in XML */
+			++ptr;
+		else if ((length = decode_utf8(ptr, &value))) {
+			write_char_ref(writer, value);
+			ptr += length;
+		} else {
+			/* Not UTF-8 (or not a XML character): libxml
+			 * writes the byte value in attributes.
+			 */
+			write_char_ref(writer, *ptr);
+			++ptr;
+		}
+		run = ptr;
+	}
+
+	xml_write_raw(writer, (const char *)run, ptr - run);
+}
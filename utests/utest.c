@@ -25,6 +25,9 @@
 #include "utest_userapi.h"
 #include "utest_xmlmode.h"
 #include "utest_screw.h"
+#include "utest_cache.h"
+#include "utest_transfer.h"
+#include "utest_stream.h"
 
 static Suite *core_suite(void)
 {
@@ -47,6 +50,12 @@ static Suite *core_suite(void)
 			suite_add_tcase(s, gcaldebug_tcase_create());
 		else if (!(strcmp(test_var, "query")))
 			suite_add_tcase(s, gcal_query_tcase_create());
+		else if (!(strcmp(test_var, "cache")))
+			suite_add_tcase(s, cache_tcase_create());
+		else if (!(strcmp(test_var, "transfer")))
+			suite_add_tcase(s, transfer_tcase_create());
+		else if (!(strcmp(test_var, "stream")))
+			suite_add_tcase(s, stream_tcase_create());
 		else
 			goto all;
 
@@ -60,6 +69,9 @@ all:
 	suite_add_tcase(s, gcontact_tcase_create());
 	suite_add_tcase(s, gcaldebug_tcase_create());
 	suite_add_tcase(s, gcal_query_tcase_create());
+	suite_add_tcase(s, cache_tcase_create());
+	suite_add_tcase(s, transfer_tcase_create());
+	suite_add_tcase(s, stream_tcase_create());
 exit:
 	return s;
 }
@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+/*
+ * @file   utest_cache.c
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of the response and parse caches.
+ *
+ */
+
+#include "utest_cache.h"
+#include "gcal.h"
+#include "gcalendar.h"
+#include "gcontact.h"
+#include "gcal_parser.h"
+#include "gcal_cache.h"
+#include "atom_parser.h"
+#include "xml_aux.h"
+#include "internal_gcal.h"
+#include <string.h>
+#include <stdlib.h>
+#include "utils.h"
+
+static char *xml_data = NULL;
+
+static void setup(void)
+{
+	if (find_load_file("/utests/4entries_location.xml", &xml_data))
+		exit(1);
+}
+
+static void teardown(void)
+{
+	if (xml_data)
+		free(xml_data);
+}
+
+START_TEST (test_response_cache)
+{
+	struct gcal_cache *cache;
+	struct gcal_cache_entry *entry;
+	struct gcal_resource *gcalobj;
+	const char url[] = "http://www.google.com/m8/feeds/contacts/a/full";
+	const char version[] = "GData-Version: 3.0";
+	char dir[] = "/tmp/gcal_cacheXXXXXX";
+	int res;
+
+	fail_if(mkdtemp(dir) == NULL, "failed creating cache directory!");
+	cache = gcal_cache_new(60, dir);
+	fail_if(cache == NULL, "failed creating cache!");
+	fail_if(gcal_cache_account(cache, "a@gmail.com"), "failed account!");
+
+	fail_if(gcal_cache_find(cache, url, version) != NULL,
+		"empty cache must not have pages!");
+	res = gcal_cache_store(cache, url, version, "\"etag\"",
+			       xml_data, strlen(xml_data));
+	fail_if(res == -1, "failed storing page!");
+
+	/* Page key has the GData version */
+	fail_if(gcal_cache_find(cache, url, "GData-Version: 2") != NULL,
+		"page must not be found with other version!");
+	entry = gcal_cache_find(cache, url, version);
+	fail_if(entry == NULL, "page not found!");
+	fail_if(strcmp(gcal_cache_etag(entry), "\"etag\""), "wrong ETag!");
+	fail_if(!gcal_cache_fresh(cache, entry), "page must be fresh!");
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	res = gcal_cache_restore(entry, gcalobj);
+	fail_if(res == -1, "failed restoring page!");
+	fail_if(strcmp(gcalobj->buffer, xml_data), "restored page differs!");
+
+	/* After a change in server, pages must be revalidated */
+	gcal_cache_expire(cache);
+	fail_if(gcal_cache_fresh(cache, entry), "page must be stale!");
+	gcal_cache_touch(cache, entry);
+	gcal_cache_delete(cache);
+
+	/* Page is loaded from disk by a new cache, same account only */
+	cache = gcal_cache_new(0, dir);
+	fail_if(cache == NULL, "failed creating cache!");
+	fail_if(gcal_cache_find(cache, url, version) != NULL,
+		"page found without account!");
+	gcal_cache_account(cache, "b@gmail.com");
+	fail_if(gcal_cache_find(cache, url, version) != NULL,
+		"page found by other account!");
+	gcal_cache_account(cache, "a@gmail.com");
+	entry = gcal_cache_find(cache, url, version);
+	fail_if(entry == NULL, "page not loaded from disk!");
+	fail_if(gcal_cache_fresh(cache, entry), "ttl 0 must revalidate!");
+	res = gcal_cache_restore(entry, gcalobj);
+	fail_if(res == -1, "failed restoring page!");
+	fail_if(strcmp(gcalobj->buffer, xml_data), "loaded page differs!");
+
+	/* Changing account drops pages in memory */
+	gcal_cache_account(cache, "b@gmail.com");
+	res = gcal_cache_store(cache, url, version, NULL, "b", 1);
+	fail_if(res == -1, "failed storing page!");
+	gcal_cache_account(cache, "a@gmail.com");
+	entry = gcal_cache_find(cache, url, version);
+	fail_if(entry == NULL, "page not loaded from disk!");
+	gcal_cache_restore(entry, gcalobj);
+	fail_if(strcmp(gcalobj->buffer, xml_data), "page of other account!");
+	gcal_cache_delete(cache);
+
+	/* Authentication sets the account, not authenticated has none */
+	fail_if(gcal_set_response_cache(gcalobj, 1, 60, dir),
+		"failed enabling cache!");
+	fail_if(gcal_cache_find(gcalobj->cache, url, version) != NULL,
+		"page found without authentication!");
+	fail_if(gcal_set_response_cache(gcalobj, 0, 0, NULL),
+		"failed disabling cache!");
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_parse_cache)
+{
+	xmlXPathObject *xpath_obj = NULL;
+	xmlDoc *doc = NULL;
+	struct gcal_resource *gcalobj;
+	struct gcal_event events[4];
+	struct gcal_contact contacts[2];
+	char *changed, *ptr, *file_contents = NULL;
+	int res, i, length;
+
+	gcalobj = gcal_construct(GCALENDAR);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	fail_if(gcal_set_parse_cache(gcalobj, 1), "failed creating cache!");
+
+	/* First parse fills the cache */
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i)
+		gcal_init_event(&events[i]);
+	res = extract_all_entries_cached(doc, events, 4,
+					 gcalobj->entries_cache);
+	fail_if(res == -1, "failed to extract entries!");
+	fail_if(strcmp(events[1].common.title, "lunch"), "wrong title!");
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&events[i]);
+	clean_doc_tree(&doc);
+
+	/* Same ETag: entry comes from cache, even if data is different */
+	changed = strdup(xml_data);
+	fail_if(changed == NULL, "failed copying XML!");
+	ptr = strstr(changed, ">lunch<");
+	fail_if(ptr == NULL, "title not found!");
+	memcpy(ptr, ">LUNCH<", strlen(">LUNCH<"));
+	res = build_doc_tree(&doc, changed);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i)
+		gcal_init_event(&events[i]);
+	res = extract_all_entries_cached(doc, events, 4,
+					 gcalobj->entries_cache);
+	fail_if(res == -1, "failed to extract entries!");
+	fail_if(strcmp(events[1].common.title, "lunch"),
+		"unchanged entry not copied from cache!");
+	fail_if(strncmp(events[1].content, "I will add a description", 24),
+		"wrong cached description: %s\n", events[1].content);
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&events[i]);
+	clean_doc_tree(&doc);
+
+	/* New ETag: entry is extracted again */
+	while ((ptr = strstr(changed, "EE4NTgBGfCp7ImA6WhVV")))
+		*ptr = 'F';
+	res = build_doc_tree(&doc, changed);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i)
+		gcal_init_event(&events[i]);
+	res = extract_all_entries_cached(doc, events, 4,
+					 gcalobj->entries_cache);
+	fail_if(res == -1, "failed to extract entries!");
+	fail_if(strcmp(events[1].common.title, "LUNCH"),
+		"changed entry not extracted!");
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&events[i]);
+	clean_doc_tree(&doc);
+	free(changed);
+	gcal_destroy(gcalobj);
+
+	/* Cached contacts must have all fields */
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	fail_if(gcal_set_parse_cache(gcalobj, 1), "failed creating cache!");
+	if (find_load_file("/utests/supercontact.xml", &file_contents))
+		fail_if(1, "Cannot load test XML file!");
+	res = build_doc_tree(&doc, file_contents);
+	fail_if(res == -1, "failed to build document tree!");
+	xpath_obj = atom_get_entries(doc);
+	fail_if(xpath_obj == NULL, "failed to get entry node list!");
+	length = xpath_obj->nodesetval->nodeNr;
+	xmlXPathFreeObject(xpath_obj);
+	fail_if(length != 1, "wrong number of contacts: %d\n", length);
+
+	for (i = 0; i < 2; ++i) {
+		gcal_init_contact(&contacts[i]);
+		res = extract_all_contacts_cached(doc, &contacts[i], 1,
+						  gcalobj->entries_cache);
+		fail_if(res == -1, "failed to extract contacts!");
+	}
+
+	fail_if(strcmp(contacts[0].common.id, contacts[1].common.id),
+		"wrong cached id!");
+	fail_if(contacts[0].emails_nr != contacts[1].emails_nr,
+		"wrong cached emails!");
+	for (i = 0; i < contacts[0].emails_nr; ++i)
+		fail_if(strcmp(contacts[0].emails_field[i],
+			       contacts[1].emails_field[i]),
+			"wrong cached email!");
+	fail_if(contacts[0].phone_numbers_nr != contacts[1].phone_numbers_nr,
+		"wrong cached phone numbers!");
+	fail_if(contacts[0].structured_address_nr !=
+		contacts[1].structured_address_nr,
+		"wrong cached addresses!");
+	fail_if(strcmp(gcal_contact_get_structured_entry(
+			       contacts[0].structured_name, 0, 1,
+			       "givenName"),
+		       gcal_contact_get_structured_entry(
+			       contacts[1].structured_name, 0, 1,
+			       "givenName")),
+		"wrong cached structured name!");
+
+	for (i = 0; i < 2; ++i)
+		gcal_destroy_contact(&contacts[i]);
+	clean_doc_tree(&doc);
+	free(file_contents);
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+TCase *cache_tcase_create(void)
+{
+	TCase *tc = NULL;
+	tc = tcase_create("cache");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_response_cache);
+	tcase_add_test(tc, test_parse_cache);
+	return tc;
+}
@@ -0,0 +1,16 @@
+#ifndef __UTEST_CACHE__
+#define __UTEST_CACHE__
+/*
+ * @file   utest_cache.h
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of the response and parse caches.
+ */
+
+#include <check.h>
+
+TCase *cache_tcase_create(void);
+
+
+#endif
@@ -11,6 +11,8 @@
 #include "gcont.h"
 #include "gcontact.h"
 #include "gcal_parser.h"
+#include "internal_gcal.h"
+#include "utils.h"
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -133,6 +135,27 @@ START_TEST (test_contact_extract)
 END_TEST
 
 
+START_TEST (test_contact_document)
+{
+	size_t count;
+	struct gcal_contact *contacts;
+
+	free(ptr_gcal->buffer);
+	ptr_gcal->buffer = NULL;
+	if (find_load_file("/utests/empty_photo.xml", &ptr_gcal->buffer))
+		fail_if(1, "Cannot load test XML file!");
+	ptr_gcal->length = strlen(ptr_gcal->buffer);
+	ptr_gcal->has_xml = 1;
+
+	/* The DOM tree is only needed while extracting */
+	contacts = gcal_get_all_contacts(ptr_gcal, &count);
+	fail_if(contacts == NULL, "Failed extracting the contacts vector!");
+	fail_if(ptr_gcal->document != NULL, "DOM tree was not freed!");
+	gcal_destroy_contacts(contacts, count);
+}
+END_TEST
+
+
 START_TEST (test_contact_xml)
 {
 	int result, length, address_nr, address_count;
@@ -561,6 +584,7 @@ TCase *gcontact_tcase_create(void)
 	tcase_add_test(tc, test_contact_dump);
 	tcase_add_test(tc, test_contact_entries);
 	tcase_add_test(tc, test_contact_extract);
+	tcase_add_test(tc, test_contact_document);
 	tcase_add_test(tc, test_contact_xml);
 	tcase_add_test(tc, test_contact_add);
 	tcase_add_test(tc, test_contact_delete);
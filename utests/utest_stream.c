@@ -0,0 +1,1104 @@
+/*
+ * @file   utest_stream.c
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of JSON, streaming and pipeline parsing.
+ *
+ */
+
+#include "utest_stream.h"
+#include "gcal.h"
+#include "gcalendar.h"
+#include "gcontact.h"
+#include "gcal_parser.h"
+#include "atom_parser.h"
+#include "json_parser.h"
+#include "xml_aux.h"
+#include "gcal_stream.h"
+#include "gcal_pipeline.h"
+#include "gcal_status.h"
+#include "internal_gcal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "utils.h"
+
+static char *xml_data = NULL;
+
+static void setup(void)
+{
+	if (find_load_file("/utests/4entries_location.xml", &xml_data))
+		exit(1);
+}
+
+static void teardown(void)
+{
+	if (xml_data)
+		free(xml_data);
+}
+
+/* Fields missing in the entry are NULL */
+static int differ(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a != b;
+
+	return strcmp(a, b);
+}
+
+#define fail_if_differ(a, b, field)					\
+	fail_if(differ((a)->field, (b)->field), #field " differs: %s, %s\n",	\
+		(a)->field, (b)->field)
+
+/* Events in Atom and JSON must be the same */
+static void compare_events(const char *atom_file, const char *json_file,
+			   int length)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_event atom[4], json[4];
+	char *atom_data = NULL, *json_data = NULL;
+	int res, i, j;
+
+	if (find_load_file(atom_file, &atom_data))
+		fail_if(1, "Cannot load test XML file!");
+	if (find_load_file(json_file, &json_data))
+		fail_if(1, "Cannot load test JSON file!");
+	fail_if(!json_is_feed(json_data), "JSON feed not detected!");
+	fail_if(json_is_feed(atom_data), "Atom feed taken as JSON!");
+
+	res = build_doc_tree(&doc, atom_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < length; ++i) {
+		gcal_init_event(&atom[i]);
+		gcal_init_event(&json[i]);
+	}
+	fail_if(extract_all_entries(doc, atom, length) == -1,
+		"failed to extract Atom entries!");
+	fail_if(json_extract_all_entries(json_data, json, length + 1, NULL)
+		!= -1, "size mismatch not detected!");
+	fail_if(json_extract_all_entries(json_data, json, length, NULL) == -1,
+		"failed to extract JSON entries!");
+
+	for (i = 0; i < length; ++i) {
+		fail_if_differ(&atom[i], &json[i], common.id);
+		fail_if_differ(&atom[i], &json[i], common.etag);
+		fail_if_differ(&atom[i], &json[i], common.title);
+		fail_if_differ(&atom[i], &json[i], common.edit_uri);
+		fail_if_differ(&atom[i], &json[i], common.updated);
+		fail_if_differ(&atom[i], &json[i], common.published);
+		fail_if_differ(&atom[i], &json[i], content);
+		fail_if_differ(&atom[i], &json[i], dt_recurrent);
+		fail_if_differ(&atom[i], &json[i], dt_start);
+		fail_if_differ(&atom[i], &json[i], dt_end);
+		fail_if_differ(&atom[i], &json[i], where);
+		fail_if_differ(&atom[i], &json[i], status);
+		fail_if_differ(&atom[i], &json[i], sequence);
+		fail_if(atom[i].common.deleted != json[i].common.deleted,
+			"deleted differs!");
+		fail_if(atom[i].attendees_nr != json[i].attendees_nr,
+			"attendees number differs!");
+		for (j = 0; j < (int)atom[i].attendees_nr; ++j) {
+			fail_if_differ(&atom[i].attendees[j],
+				       &json[i].attendees[j], email);
+			fail_if((atom[i].attendees[j].rel !=
+				 json[i].attendees[j].rel) ||
+				(atom[i].attendees[j].status !=
+				 json[i].attendees[j].status),
+				"attendee differs!");
+		}
+		fail_if(atom[i].alarms_nr != json[i].alarms_nr,
+			"alarms number differs!");
+		for (j = 0; j < (int)atom[i].alarms_nr; ++j)
+			fail_if((atom[i].alarms[j].type !=
+				 json[i].alarms[j].type) ||
+				(atom[i].alarms[j].minutes !=
+				 json[i].alarms[j].minutes), "alarm differs!");
+	}
+
+	for (i = 0; i < length; ++i) {
+		gcal_destroy_entry(&atom[i]);
+		gcal_destroy_entry(&json[i]);
+	}
+	clean_doc_tree(&doc);
+	free(atom_data);
+	free(json_data);
+}
+
+START_TEST (test_json_events)
+{
+	compare_events("/utests/4entries_location.xml",
+		       "/utests/4entries_location.json", 4);
+	compare_events("/utests/3entries_recurrence.xml",
+		       "/utests/3entries_recurrence.json", 3);
+}
+END_TEST
+
+START_TEST (test_json_contact)
+{
+	xmlXPathObject *xpath_obj = NULL;
+	xmlDoc *doc = NULL;
+	struct gcal_contact atom, json;
+	struct gcal_structured_subvalues *field;
+	char *file_contents = NULL;
+	int res, i;
+
+	if (find_load_file("/utests/supercontact.xml", &file_contents))
+		fail_if(1, "Cannot load test XML file!");
+	res = build_doc_tree(&doc, file_contents);
+	fail_if(res == -1, "failed to build document tree!");
+	xpath_obj = atom_get_entries(doc);
+	fail_if(xpath_obj == NULL, "failed to get entries!");
+	gcal_init_contact(&atom);
+	res = atom_extract_contact(xpath_obj->nodesetval->nodeTab[0], &atom);
+	fail_if(res == -1, "failed to extract Atom contact!");
+	xmlXPathFreeObject(xpath_obj);
+	clean_doc_tree(&doc);
+	free(file_contents);
+
+	if (find_load_file("/utests/supercontact.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	gcal_init_contact(&json);
+	res = json_extract_all_contacts(file_contents, &json, 1, NULL);
+	fail_if(res == -1, "failed to extract JSON contact!");
+	free(file_contents);
+
+	fail_if_differ(&atom, &json, common.id);
+	fail_if_differ(&atom, &json, common.etag);
+	fail_if_differ(&atom, &json, common.title);
+	fail_if_differ(&atom, &json, common.edit_uri);
+	fail_if_differ(&atom, &json, nickname);
+	fail_if_differ(&atom, &json, homepage);
+	fail_if_differ(&atom, &json, blog);
+	fail_if_differ(&atom, &json, org_name);
+	fail_if_differ(&atom, &json, org_title);
+	fail_if_differ(&atom, &json, occupation);
+	fail_if_differ(&atom, &json, post_address);
+	fail_if_differ(&atom, &json, birthday);
+	fail_if((atom.emails_nr != json.emails_nr) ||
+		(atom.pref_email != json.pref_email), "emails differ!");
+	for (i = 0; i < atom.emails_nr; ++i)
+		fail_if(strcmp(atom.emails_field[i], json.emails_field[i]) ||
+			strcmp(atom.emails_type[i], json.emails_type[i]),
+			"email differs!");
+	fail_if(atom.phone_numbers_nr != json.phone_numbers_nr,
+		"phone numbers differ!");
+	for (i = 0; i < atom.phone_numbers_nr; ++i)
+		fail_if(strcmp(atom.phone_numbers_field[i],
+			       json.phone_numbers_field[i]) ||
+			strcmp(atom.phone_numbers_type[i],
+			       json.phone_numbers_type[i]), "phone differs!");
+	fail_if((atom.im_nr != json.im_nr) || (atom.im_pref != json.im_pref),
+		"IMs differ!");
+	for (i = 0; i < atom.im_nr; ++i)
+		fail_if(strcmp(atom.im_address[i], json.im_address[i]) ||
+			strcmp(atom.im_protocol[i], json.im_protocol[i]),
+			"IM differs!");
+	fail_if((atom.structured_address_nr != json.structured_address_nr) ||
+		(atom.structured_address_pref != json.structured_address_pref),
+		"structured addresses differ!");
+
+	/* Whitespace between XML elements are 'text' fields */
+	for (field = json.structured_name; field->next_field;
+	     field = field->next_field)
+		fail_if(strcmp(gcal_contact_get_structured_entry(
+				       atom.structured_name, 0, 1,
+				       field->field_key),
+			       field->field_value), "%s differs!",
+			field->field_key);
+
+	gcal_destroy_contact(&atom);
+	gcal_destroy_contact(&json);
+}
+END_TEST
+
+START_TEST (test_partial_response)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_resource *gcalobj;
+	struct gcal_event atom[2], json[2];
+	char *url, *file_contents = NULL;
+	int res, i;
+
+	/* Selector is URL encoded in queries */
+	gcalobj = gcal_construct(GCALENDAR);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcalobj->user = strdup("gcal4tester");
+	gcalobj->domain = strdup("gmail.com");
+	fail_if(gcal_set_fields(gcalobj, "entry(@gd:etag,id,gd:when)"),
+		"failed setting fields!");
+	url = mount_query_url(gcalobj, NULL);
+	fail_if(url == NULL, "failed mounting query URL!");
+	fail_if(!strstr(url, "&fields=entry%28%40gd%3Aetag%2Cid%2Cgd%3Awhen%29"),
+		"fields missing in query: %s\n", url);
+	free(url);
+	fail_if(gcal_set_fields(gcalobj, NULL), "failed clearing fields!");
+	url = mount_query_url(gcalobj, NULL);
+	fail_if(strstr(url, "fields=") != NULL, "fields not cleared: %s\n", url);
+	free(url);
+	gcal_destroy(gcalobj);
+
+	/* Entries without total, ETag, status, sequence, etc */
+	if (find_load_file("/utests/partial_response.xml", &file_contents))
+		fail_if(1, "Cannot load test XML file!");
+	res = build_doc_tree(&doc, file_contents);
+	fail_if(res == -1, "failed to build document tree!");
+	fail_if(atom_entries(doc) != 2, "entries not counted!");
+	for (i = 0; i < 2; ++i)
+		gcal_init_event(&atom[i]);
+	res = extract_all_entries(doc, atom, 2);
+	fail_if(res == -1, "failed to extract partial entries!");
+	clean_doc_tree(&doc);
+	free(file_contents);
+
+	if (find_load_file("/utests/partial_response.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	fail_if(json_entries(file_contents) != 2, "entries not counted!");
+	for (i = 0; i < 2; ++i)
+		gcal_init_event(&json[i]);
+	res = json_extract_all_entries(file_contents, json, 2, NULL);
+	fail_if(res == -1, "failed to extract partial JSON entries!");
+	free(file_contents);
+
+	for (i = 0; i < 2; ++i) {
+		fail_if_differ(&atom[i], &json[i], common.etag);
+		fail_if_differ(&atom[i], &json[i], common.id);
+		fail_if_differ(&atom[i], &json[i], common.updated);
+		fail_if_differ(&atom[i], &json[i], dt_start);
+		fail_if_differ(&atom[i], &json[i], dt_end);
+		fail_if_differ(&atom[i], &json[i], status);
+		fail_if_differ(&atom[i], &json[i], sequence);
+	}
+	fail_if(strcmp(atom[0].dt_start, "2008-03-26T18:00:00.000-05:00"),
+		"wrong start: %s\n", atom[0].dt_start);
+	fail_if(atom[0].dt_end != NULL, "absent end time must be NULL!");
+	fail_if(strcmp(atom[0].status, "") || strcmp(atom[0].sequence, ""),
+		"absent fields must be empty!");
+	fail_if(strcmp(atom[1].common.etag, ""), "absent ETag must be empty!");
+
+	for (i = 0; i < 2; ++i) {
+		gcal_destroy_entry(&atom[i]);
+		gcal_destroy_entry(&json[i]);
+	}
+}
+END_TEST
+
+START_TEST (test_field_mask)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_event full[4], masked[4], json[4];
+	struct gcal_contact contact;
+	char *file_contents = NULL;
+	unsigned int mask = GCAL_F_ID | GCAL_F_ETAG | GCAL_F_WHEN;
+	int res, i;
+
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i) {
+		gcal_init_event(&full[i]);
+		gcal_init_event(&masked[i]);
+		gcal_init_event(&json[i]);
+		masked[i].common.field_mask = mask;
+		json[i].common.field_mask = mask;
+	}
+	fail_if(extract_all_entries(doc, full, 4) == -1,
+		"failed to extract entries!");
+	fail_if(extract_all_entries(doc, masked, 4) == -1,
+		"failed to extract masked entries!");
+	clean_doc_tree(&doc);
+
+	if (find_load_file("/utests/4entries_location.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	res = json_extract_all_entries(file_contents, json, 4, NULL);
+	fail_if(res == -1, "failed to extract masked JSON entries!");
+	free(file_contents);
+
+	for (i = 0; i < 4; ++i) {
+		fail_if_differ(&full[i], &masked[i], common.id);
+		fail_if_differ(&full[i], &masked[i], common.etag);
+		fail_if_differ(&full[i], &masked[i], dt_start);
+		fail_if_differ(&full[i], &masked[i], dt_end);
+		fail_if_differ(&full[i], &json[i], dt_start);
+		fail_if_differ(&full[i], &json[i], common.id);
+		fail_if((masked[i].common.title) || (masked[i].where) ||
+			(masked[i].status) || (masked[i].common.updated) ||
+			(json[i].common.title) || (json[i].status),
+			"fields outside of mask were extracted!");
+	}
+
+	for (i = 0; i < 4; ++i) {
+		gcal_destroy_entry(&full[i]);
+		gcal_destroy_entry(&masked[i]);
+		gcal_destroy_entry(&json[i]);
+	}
+
+	/* Contacts */
+	if (find_load_file("/utests/supercontact.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	gcal_init_contact(&contact);
+	contact.common.field_mask = GCAL_F_ID | GCAL_F_PHONES;
+	res = json_extract_all_contacts(file_contents, &contact, 1, NULL);
+	fail_if(res == -1, "failed to extract masked contact!");
+	free(file_contents);
+	fail_if(contact.phone_numbers_nr != 8, "wrong phone numbers: %d\n",
+		contact.phone_numbers_nr);
+	fail_if((contact.common.title) || (contact.emails_nr) ||
+		(contact.structured_address_nr) || (contact.photo),
+		"contact fields outside of mask were extracted!");
+	gcal_destroy_contact(&contact);
+}
+END_TEST
+
+START_TEST (test_lazy_fields)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_resource *gcalobj;
+	struct gcal_event full[4], copy, *entries;
+	struct gcal_contact *contacts;
+	char *file_contents = NULL;
+	size_t length = 0;
+	int res, i;
+
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i)
+		gcal_init_event(&full[i]);
+	fail_if(extract_all_entries(doc, full, 4) == -1,
+		"failed to extract entries!");
+	clean_doc_tree(&doc);
+
+	gcalobj = gcal_construct(GCALENDAR);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcal_set_lazy_fields(gcalobj, 1);
+	free(gcalobj->buffer);
+	gcalobj->buffer = strdup(xml_data);
+	gcalobj->length = strlen(xml_data);
+	gcalobj->has_xml = 1;
+
+	/* Only key fields are decoded with the feed */
+	entries = gcal_get_entries(gcalobj, &length);
+	fail_if((entries == NULL) || (length != 4), "failed lazy parse!");
+	for (i = 0; i < 4; ++i) {
+		fail_if_differ(&full[i], &entries[i], common.id);
+		fail_if_differ(&full[i], &entries[i], common.etag);
+		fail_if((entries[i].common.title) || (entries[i].where) ||
+			(!entries[i].common.pending),
+			"fields were decoded before being used!");
+	}
+
+	/* Fields are decoded on first use, then kept */
+	fail_if(differ(gcal_event_get_where(&entries[1]), full[1].where),
+		"wrong lazy 'where'!");
+	fail_if(gcal_event_get_where(&entries[1]) != entries[1].where,
+		"decoded field must be kept!");
+	fail_if(entries[1].common.title != NULL, "other field was decoded!");
+	fail_if(differ(gcal_event_get_end(&entries[2]), full[2].dt_end),
+		"wrong lazy 'end'!");
+
+	/* Copies share the feed, it outlives the array */
+	gcal_init_event(&copy);
+	fail_if(gcal_copy_entry(&copy, &entries[3]), "failed copying event!");
+	gcal_destroy_entries(entries, length);
+	fail_if(differ(gcal_event_get_title(&copy), full[3].common.title),
+		"wrong lazy title in copy!");
+	fail_if(gcal_event_set_start(&copy, "2008-01-01"),
+		"failed setting start!");
+	fail_if(differ(gcal_event_get_end(&copy), full[3].dt_end),
+		"setter lost other fields!");
+	fail_if(differ(gcal_event_get_start(&copy), "2008-01-01"),
+		"decoding replaced field set by user!");
+	gcal_destroy_entry(&copy);
+
+	/* JSON feed */
+	if (find_load_file("/utests/4entries_location.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	free(gcalobj->buffer);
+	gcalobj->buffer = file_contents;
+	gcalobj->length = strlen(file_contents);
+	entries = gcal_get_entries(gcalobj, &length);
+	fail_if((entries == NULL) || (length != 4), "failed lazy JSON parse!");
+	/* Entries don't point to the downloaded buffer */
+	gcalobj->buffer[0] = '\0';
+	for (i = 0; i < 4; ++i) {
+		fail_if(differ(gcal_event_get_title(&entries[i]),
+			       full[i].common.title), "wrong lazy JSON title!");
+		fail_if(differ(gcal_event_get_start(&entries[i]),
+			       full[i].dt_start), "wrong lazy JSON start!");
+	}
+	gcal_destroy_entries(entries, length);
+
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&full[i]);
+	gcal_destroy(gcalobj);
+
+	/* Contacts */
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcal_set_lazy_fields(gcalobj, 1);
+	gcal_set_lazy_photo(gcalobj, 1);
+	if (find_load_file("/utests/supercontact.json", &file_contents))
+		fail_if(1, "Cannot load test JSON file!");
+	free(gcalobj->buffer);
+	gcalobj->buffer = file_contents;
+	gcalobj->length = strlen(file_contents);
+	gcalobj->has_xml = 1;
+	contacts = gcal_get_all_contacts(gcalobj, &length);
+	fail_if((contacts == NULL) || (length != 1), "failed lazy contact!");
+	fail_if(contacts[0].phone_numbers_nr, "phones decoded before use!");
+	fail_if(gcal_contact_get_phone_numbers_count(&contacts[0]) != 8,
+		"wrong lazy phone numbers!");
+	fail_if(gcal_contact_get_emails_count(&contacts[0]) < 1,
+		"wrong lazy emails!");
+	gcal_destroy_contacts(contacts, length);
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+/* Checks streamed events: the third one is kept by the callback */
+struct streamed {
+	struct gcal_event *full;
+	int count;
+	int stop;
+	int errors;
+	struct gcal_event *kept;
+};
+
+static int stream_event(void **entry, void *user)
+{
+	struct streamed *streamed = (struct streamed *)user;
+	struct gcal_event *event = (struct gcal_event *)*entry;
+	struct gcal_event *full = &streamed->full[streamed->count];
+
+	if ((differ(event->common.title, full->common.title)) ||
+	    (differ(event->common.id, full->common.id)) ||
+	    (differ(event->where, full->where)))
+		++streamed->errors;
+
+	if (streamed->count == 2) {
+		streamed->kept = event;
+		*entry = NULL;
+	}
+
+	return ++streamed->count == streamed->stop;
+}
+
+static int stream_contact(void **entry, void *user)
+{
+	int *phones = (int *)user;
+
+	*phones = gcal_contact_get_phone_numbers_count(*entry);
+	return 0;
+}
+
+/* Feeds data to the parser in small chunks, like a slow download */
+static int stream_chunks(struct gcal_stream *stream, const char *data,
+			 size_t length, size_t chunk)
+{
+	size_t i;
+	int result = 0;
+
+	for (i = 0; (!result) && (i < length); i += chunk)
+		result = gcal_stream_parse(stream, data + i,
+					   (length - i < chunk) ?
+					   length - i : chunk);
+
+	return result;
+}
+
+START_TEST (test_stream_entries)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_resource *gcalobj;
+	struct gcal_stream *stream;
+	struct gcal_event full[4];
+	struct streamed streamed;
+	char *json = NULL, *contact = NULL;
+	int res, i, phones = 0;
+
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i)
+		gcal_init_event(&full[i]);
+	fail_if(extract_all_entries(doc, full, 4) == -1,
+		"failed to extract entries!");
+	clean_doc_tree(&doc);
+	if (find_load_file("/utests/4entries_location.json", &json))
+		fail_if(1, "Cannot load test JSON file!");
+
+	gcalobj = gcal_construct(GCALENDAR);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+
+	/* Atom and JSON feeds give the same entries */
+	for (i = 0; i < 2; ++i) {
+		memset(&streamed, 0, sizeof(streamed));
+		streamed.full = full;
+		stream = gcal_stream_new(gcalobj, 0, stream_event, &streamed);
+		fail_if(stream == NULL, "failed creating stream parser!");
+		if (i)
+			res = stream_chunks(stream, json, strlen(json), 5);
+		else
+			res = stream_chunks(stream, xml_data,
+					    strlen(xml_data), 7);
+		fail_if(res || gcal_stream_finish(stream), "failed parsing!");
+		fail_if((streamed.count != 4) || (streamed.errors),
+			"wrong streamed entries!");
+		fail_if(gcal_stream_count(stream) != 4, "wrong entries count!");
+		gcal_stream_delete(stream);
+
+		/* Kept entry outlives the parser */
+		fail_if((!streamed.kept) ||
+			(differ(gcal_event_get_start(streamed.kept),
+				full[2].dt_start)), "wrong kept entry!");
+		gcal_event_delete(streamed.kept);
+	}
+
+	/* Callback stops the parsing */
+	memset(&streamed, 0, sizeof(streamed));
+	streamed.full = full;
+	streamed.stop = 2;
+	stream = gcal_stream_new(gcalobj, 0, stream_event, &streamed);
+	res = stream_chunks(stream, xml_data, strlen(xml_data), 64);
+	fail_if((res != 1) || (streamed.count != 2) ||
+		(gcal_stream_finish(stream)), "callback didn't stop parsing!");
+	gcal_stream_delete(stream);
+
+	/* Truncated feeds are an error */
+	for (i = 0; i < 2; ++i) {
+		memset(&streamed, 0, sizeof(streamed));
+		streamed.full = full;
+		stream = gcal_stream_new(gcalobj, 0, stream_event, &streamed);
+		if (i)
+			res = stream_chunks(stream, json, strlen(json) / 2, 16);
+		else
+			res = stream_chunks(stream, xml_data,
+					    strlen(xml_data) / 2, 16);
+		fail_if(res || (gcal_stream_finish(stream) != -1),
+			"truncated feed wasn't detected!");
+		gcal_stream_delete(stream);
+		fail_if(streamed.kept != NULL, "too many entries!");
+	}
+
+	/* Held download pauses once, it is resumed by the release */
+	fail_if(gcalobj->stream_queue != 64, "wrong default queue!");
+	gcal_set_stream_queue(gcalobj, 0);
+	fail_if(gcalobj->stream_queue != 1, "queue can't be empty!");
+	stream = gcal_stream_new(gcalobj, 0, stream_event, &streamed);
+	gcal_stream_hold(stream);
+	fail_if(gcal_stream_release(stream), "download wasn't paused!");
+	gcal_stream_delete(stream);
+
+	/* Iterator needs authentication (it downloads the feed) */
+	fail_if(gcal_event_iter_open(gcalobj) != NULL,
+		"iterator opened without authentication!");
+	fail_if((gcal_event_iter_next(NULL) != NULL) ||
+		(gcal_event_iter_detach(NULL) != NULL) ||
+		(gcal_event_iter_close(NULL) != -1), "NULL iterator!");
+
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&full[i]);
+	gcal_destroy(gcalobj);
+	free(json);
+
+	/* Contacts */
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	if (find_load_file("/utests/supercontact.json", &contact))
+		fail_if(1, "Cannot load test JSON file!");
+	stream = gcal_stream_new(gcalobj, 1, stream_contact, &phones);
+	res = stream_chunks(stream, contact, strlen(contact), 3);
+	fail_if(res || gcal_stream_finish(stream) ||
+		(gcal_stream_count(stream) != 1), "failed streaming contact!");
+	fail_if(phones != 8, "wrong streamed phone numbers!");
+	gcal_stream_delete(stream);
+	free(contact);
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+/* HTTP answer with a contacts feed of 'count' entries, titled in order
+ * and big enough to arrive in many chunks. Entry 'broken' (if not -1) is
+ * not well formed.
+ */
+static char *feed_answer(int count, int broken, size_t *body_length)
+{
+	static const char head[] = "<?xml version='1.0' encoding='UTF-8'?>"
+		"<feed xmlns='http://www.w3.org/2005/Atom' "
+		"xmlns:gd='http://schemas.google.com/g/2005'>";
+	static const char entry[] = "<entry><id>http://www.google.com/m8/"
+		"feeds/contacts/tester%%40gmail.com/base/%04d</id>"
+		"<updated>2008-03-26T20:21:09.000Z</updated>"
+		"<gd:name><gd:fullName>Contact %04d</gd:fullName></gd:name>"
+		"<content>%s</content></entry>";
+	char padding[301], *answer, *body;
+	size_t length, used;
+	int i;
+
+	memset(padding, 'x', sizeof(padding) - 1);
+	padding[sizeof(padding) - 1] = '\0';
+	length = sizeof(head) + count * (sizeof(entry) + sizeof(padding)) +
+		sizeof("</feed>");
+	body = malloc(length);
+	fail_if(body == NULL, "failed allocating feed!");
+
+	used = snprintf(body, length, "%s", head);
+	for (i = 0; i < count; ++i)
+		if (i == broken)
+			used += snprintf(body + used, length - used,
+					 "<entry><id></entry>");
+		else
+			used += snprintf(body + used, length - used, entry,
+					 i, i, padding);
+	used += snprintf(body + used, length - used, "</feed>");
+	*body_length = used;
+
+	length = used + 256;
+	answer = malloc(length);
+	fail_if(answer == NULL, "failed allocating answer!");
+	snprintf(answer, length, "HTTP/1.1 200 OK\r\n"
+		 "Content-Type: application/atom+xml\r\n"
+		 "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+		 used, body);
+	free(body);
+
+	return answer;
+}
+
+/* Contacts object whose requests go to the local server (as a proxy, the
+ * feed URL is the google one).
+ */
+static struct gcal_resource *feed_client(struct fake_server *server)
+{
+	struct gcal_resource *gcalobj;
+	char proxy[32];
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcalobj->auth = strdup("token");
+	gcalobj->user = strdup("tester");
+	gcalobj->domain = strdup("gmail.com");
+	snprintf(proxy, sizeof(proxy), "http://127.0.0.1:%d", server->port);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_PROXY, proxy);
+	curl_easy_setopt(gcalobj->curl, CURLOPT_NOPROXY, "");
+
+	return gcalobj;
+}
+
+START_TEST (test_stream_queue)
+{
+	struct fake_server server;
+	struct fake_answer answer;
+	struct gcal_resource *gcalobj;
+	gcal_contact_iter_t iter;
+	gcal_contact_t contact;
+	curl_off_t received = 0;
+	size_t length;
+	char title[16];
+	int i;
+
+	answer.delay = 0;
+	answer.body_delay = 0;
+	answer.text = feed_answer(300, -1, &length);
+	fail_if(fake_server_start(&server, &answer, 1),
+		"failed starting server!");
+	gcalobj = feed_client(&server);
+	gcal_set_stream_queue(gcalobj, 1);
+
+	iter = gcal_contact_iter_open(gcalobj);
+	fail_if(iter == NULL, "failed opening iterator!");
+	contact = gcal_contact_iter_next(iter);
+	fail_if((!contact) ||
+		(strcmp(gcal_contact_get_title(contact), "Contact 0000")),
+		"wrong first contact!");
+
+	/* Queue is full: download is paused until it is emptied */
+	curl_easy_getinfo(gcalobj->curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+	fail_if((size_t)received >= length,
+		"download wasn't paused: %ld bytes", (long)received);
+
+	/* Resumed downloads give every entry, in order */
+	for (i = 1; (contact = gcal_contact_iter_next(iter)); ++i) {
+		snprintf(title, sizeof(title), "Contact %04d", i);
+		fail_if(strcmp(gcal_contact_get_title(contact), title),
+			"wrong contact: %s (expected %s)",
+			gcal_contact_get_title(contact), title);
+	}
+	fail_if(i != 300, "wrong number of contacts: %d", i);
+	fail_if(gcal_contact_iter_close(iter), "failed iterating feed!");
+
+	fail_if(fake_server_stop(&server) != 1, "wrong number of requests!");
+	free((char *)answer.text);
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+/* Pushes 1..10000 to a ring, stopping if it is canceled */
+static void *ring_producer(void *data)
+{
+	struct gcal_ring *ring = (struct gcal_ring *)data;
+	size_t i;
+
+	for (i = 1; i <= 10000; ++i)
+		if (gcal_ring_push(ring, (void *)i))
+			break;
+
+	gcal_ring_close(ring);
+	return (void *)i;
+}
+
+START_TEST (test_pipeline_ring)
+{
+	struct gcal_ring *ring;
+	struct gcal_resource *gcalobj;
+	pthread_t producer;
+	void *item, *pushed;
+	size_t expected = 1;
+
+	/* Items come in order and the ring is closed after the last one */
+	ring = gcal_ring_new(3);
+	fail_if(ring == NULL, "failed creating ring!");
+	fail_if(gcal_ring_pop(ring, 0) != NULL, "empty ring has an item!");
+	fail_if(pthread_create(&producer, NULL, ring_producer, ring),
+		"failed creating thread!");
+	while ((item = gcal_ring_pop(ring, 1))) {
+		fail_if((size_t)item != expected, "wrong item %zu!",
+			(size_t)item);
+		++expected;
+	}
+	pthread_join(producer, &pushed);
+	fail_if(expected != 10001, "missing items!");
+	gcal_ring_delete(ring);
+
+	/* Canceled ring stops the producer, pushed items can be popped */
+	ring = gcal_ring_new(4);
+	fail_if(pthread_create(&producer, NULL, ring_producer, ring),
+		"failed creating thread!");
+	fail_if(gcal_ring_pop(ring, 1) != (void *)1, "wrong first item!");
+	gcal_ring_cancel(ring);
+	for (expected = 1; gcal_ring_pop(ring, 1); ++expected)
+		;
+	pthread_join(producer, &pushed);
+	fail_if((size_t)pushed != expected + 1, "producer wasn't stopped!");
+	fail_if(gcal_ring_push(ring, (void *)1) != -1, "canceled push!");
+	gcal_ring_delete(ring);
+
+	/* Pipeline needs authentication (it downloads the feed) */
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcal_get_contacts_pipeline(gcalobj, NULL, NULL, NULL) != -1,
+		"pipeline without callback!");
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+/* Checks the pipeline callbacks get the feed in order */
+struct piped {
+	struct gcal_resource *gcalobj;
+	int delivered;
+	int persisted;
+	int errors;
+	/* Delivery that cancels the download (0 if none) */
+	int cancel_at;
+	/* Delivery or persistence that stops the pipeline (0 if none) */
+	int stop_at;
+	int persist_stop_at;
+};
+
+static int piped_in_order(gcal_contact_t contact, int index)
+{
+	char title[16];
+
+	snprintf(title, sizeof(title), "Contact %04d", index);
+	return strcmp(gcal_contact_get_title(contact), title) ? 1 : 0;
+}
+
+static int piped_deliver(gcal_contact_t *contact, void *user)
+{
+	struct piped *piped = (struct piped *)user;
+
+	piped->errors += piped_in_order(*contact, piped->delivered++);
+	if (piped->delivered == piped->cancel_at)
+		gcal_cancel(piped->gcalobj);
+
+	return piped->delivered == piped->stop_at;
+}
+
+static int piped_persist(gcal_contact_t *contact, void *user)
+{
+	struct piped *piped = (struct piped *)user;
+
+	piped->errors += piped_in_order(*contact, piped->persisted++);
+	return piped->persisted == piped->persist_stop_at;
+}
+
+START_TEST (test_pipeline_stages)
+{
+	struct fake_server server;
+	struct fake_answer answer;
+	struct gcal_resource *gcalobj;
+	struct piped piped;
+	size_t length;
+	int res;
+
+	/* Bigger than what the rings hold, so stages really overlap */
+	answer.delay = 0;
+	answer.body_delay = 0;
+	answer.text = feed_answer(2000, -1, &length);
+	fail_if(fake_server_start(&server, &answer, 1),
+		"failed starting server!");
+	gcalobj = feed_client(&server);
+	gcal_set_stream_queue(gcalobj, 4);
+
+	/* Whole feed goes through delivery and persistence, in order */
+	memset(&piped, 0, sizeof(piped));
+	piped.gcalobj = gcalobj;
+	res = gcal_get_contacts_pipeline(gcalobj, piped_deliver,
+					 piped_persist, &piped);
+	fail_if(res || (piped.delivered != 2000) || (piped.persisted != 2000),
+		"wrong pipeline: %d %d %d", res, piped.delivered,
+		piped.persisted);
+	fail_if(piped.errors, "entries out of order!");
+
+	/* Stop from delivery: stages finish and are joined */
+	memset(&piped, 0, sizeof(piped));
+	piped.gcalobj = gcalobj;
+	piped.stop_at = 50;
+	res = gcal_get_contacts_pipeline(gcalobj, piped_deliver,
+					 piped_persist, &piped);
+	fail_if(res || (piped.delivered != 50) || (piped.persisted >= 50),
+		"delivery didn't stop: %d %d %d", res, piped.delivered,
+		piped.persisted);
+
+	/* Stop from persistence */
+	memset(&piped, 0, sizeof(piped));
+	piped.gcalobj = gcalobj;
+	piped.persist_stop_at = 20;
+	res = gcal_get_contacts_pipeline(gcalobj, piped_deliver,
+					 piped_persist, &piped);
+	fail_if(res || (piped.persisted != 20) || (piped.delivered == 2000),
+		"persistence didn't stop: %d %d %d", res, piped.delivered,
+		piped.persisted);
+
+	/* Cancel while the feed is being received */
+	memset(&piped, 0, sizeof(piped));
+	piped.gcalobj = gcalobj;
+	piped.cancel_at = 10;
+	res = gcal_get_contacts_pipeline(gcalobj, piped_deliver, NULL,
+					 &piped);
+	fail_if((res != -1) || (piped.delivered == 2000),
+		"download wasn't canceled: %d %d", res, piped.delivered);
+	fail_if(gcal_status_interrupted(gcalobj) != GCAL_INTERRUPT_CANCEL,
+		"cancel not reported!");
+	fail_if(piped.errors, "entries out of order!");
+
+	fail_if(fake_server_stop(&server) != 4, "wrong number of requests!");
+	free((char *)answer.text);
+
+	/* Parser error stops the download */
+	answer.text = feed_answer(2000, 100, &length);
+	fail_if(fake_server_start(&server, &answer, 1),
+		"failed starting server!");
+	gcal_destroy(gcalobj);
+	gcalobj = feed_client(&server);
+	memset(&piped, 0, sizeof(piped));
+	piped.gcalobj = gcalobj;
+	res = gcal_get_contacts_pipeline(gcalobj, piped_deliver,
+					 piped_persist, &piped);
+	fail_if((res != -1) || (piped.delivered > 100),
+		"parser error not reported: %d %d", res, piped.delivered);
+	fail_if(piped.errors, "entries out of order!");
+
+	fake_server_stop(&server);
+	free((char *)answer.text);
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_entry_writer)
+{
+	struct gcal_event event;
+	struct gcal_contact contact;
+	char *buffer = NULL, *xml = NULL;
+	char *emails[] = { "tom@example.com" }, *types[] = { "home" };
+	size_t size = 0, length, previous;
+	int result, xml_length;
+	const char event_xml[] = "<?xml version=\"1.0\"?>\n"
+		"<entry xmlns:gd=\"http://schemas.google.com/g/2005\" "
+		"xmlns=\"http://www.w3.org/2005/Atom\" "
+		"gd:etag=\"&quot;A0&amp;B&quot;\">"
+		"<category scheme=\"http://schemas.google.com/g/2005#kind\" "
+		"term=\"http://schemas.google.com/g/2005#event\"/>"
+		"<title type=\"text\">Tom &amp; Jerry &lt;show&gt;</title>"
+		"<content type=\"text\">Line 1\nsaid \"hi\"&#xD;</content>"
+		"<gd:transparency value=\"http://schemas.google.com/g/2005#"
+		"event.opaque\"/>"
+		"<gd:eventStatus value=\"http://schemas.google.com/g/2005#"
+		"event.confirmed\"/>"
+		"<gd:where valueString=\"Caf&#xE9; &quot;Le Bon&quot;\"/>"
+		"<gd:when startTime=\"2008-04-08T08:00:00.000Z\"/></entry>\n";
+	const char contact_xml[] = "<?xml version=\"1.0\"?>\n"
+		"<atom:entry xmlns:gd=\"http://schemas.google.com/g/2005\" "
+		"xmlns:gContact=\"http://schemas.google.com/contact/2008\" "
+		"xmlns:atom=\"http://www.w3.org/2005/Atom\">"
+		"<category scheme=\"http://schemas.google.com/g/2005#kind\" "
+		"term=\"http://schemas.google.com/contact/2008#contact\"/>"
+		"<gd:name><gd:fullName>Tom &lt;Cat&gt;</gd:fullName></gd:name>"
+		"<gd:email rel=\"http://schemas.google.com/g/2005#home\" "
+		"address=\"tom@example.com\" primary=\"true\"/>"
+		"<gContact:nickname>T&amp;J</gContact:nickname></atom:entry>\n";
+
+	/* Same document libxml used to dump, escaping included */
+	memset(&event, 0, sizeof(event));
+	event.common.title = "Tom & Jerry <show>";
+	event.content = "Line 1\nsaid \"hi\"\r";
+	event.where = "Caf\xc3\xa9 \"Le Bon\"";
+	event.dt_start = "2008-04-08T08:00:00.000Z";
+	event.common.etag = "\"A0&B\"";
+	result = xmlentry_write(&event, &buffer, &size, &length);
+	fail_if(result == -1, "failed writing entry!");
+	fail_if(strcmp(buffer, event_xml), "wrong entry XML: %s", buffer);
+	fail_if(length != strlen(event_xml), "wrong length: %zu", length);
+
+	result = xmlentry_create(&event, &xml, &xml_length);
+	fail_if(result == -1 || strcmp(xml, event_xml),
+		"failed creating entry!");
+	fail_if(xml_length != strlen(event_xml) + 1, "wrong length!");
+	free(xml);
+
+	/* The buffer is reused (it only grows) */
+	memset(&contact, 0, sizeof(contact));
+	contact.common.title = "Tom <Cat>";
+	contact.emails_nr = 1;
+	contact.emails_field = emails;
+	contact.emails_type = types;
+	contact.nickname = "T&J";
+	xml = buffer;
+	previous = size;
+	result = xmlcontact_write(&contact, &buffer, &size, &length);
+	fail_if(result == -1, "failed writing contact!");
+	fail_if(buffer != xml || size != previous, "buffer wasn't reused!");
+	fail_if(strcmp(buffer, contact_xml), "wrong contact XML: %s", buffer);
+	fail_if(length != strlen(contact_xml), "wrong length: %zu", length);
+
+	/* Text can't have control characters, non UTF-8 bytes are kept */
+	event.common.etag = NULL;
+	event.common.title = "a\x01z\xff";
+	result = xmlentry_write(&event, &buffer, &size, &length);
+	fail_if(result == -1 || !strstr(buffer, ">az&#xFF;</title>"),
+		"wrong escaping: %s", buffer);
+
+	free(buffer);
+}
+END_TEST
+
+START_TEST (test_feed_array)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_event full[4];
+	struct gcal_event_array events;
+	struct gcal_contact_array contacts;
+	char *saved, *twice, *path, *json = NULL;
+	size_t length = 0;
+	int res, i;
+
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+	for (i = 0; i < 4; ++i) {
+		gcal_init_event(&full[i]);
+		full[i].common.store_xml = 1;
+	}
+	fail_if(extract_all_entries(doc, full, 4) == -1,
+		"failed to extract entries!");
+	clean_doc_tree(&doc);
+
+	/* Whole feed */
+	res = gcal_events_from_feed(xml_data, strlen(xml_data), &events);
+	fail_if(res || (events.length != 4), "failed parsing feed!");
+	for (i = 0; i < 4; ++i)
+		fail_if(differ(gcal_event_get_start(&events.entries[i]),
+			       full[i].dt_start), "wrong event %d!", i);
+	gcal_cleanup_events(&events);
+
+	/* Saved entries one after another, then the feed twice */
+	for (i = 0; i < 4; ++i)
+		length += strlen(full[i].common.xml) + 1;
+	saved = malloc(length + 1);
+	fail_if(saved == NULL, "failed allocating memory!");
+	saved[0] = 0;
+	for (i = 0; i < 4; ++i) {
+		strcat(saved, full[i].common.xml);
+		strcat(saved, "\n");
+	}
+	res = gcal_events_from_feed(saved, strlen(saved), &events);
+	fail_if(res || (events.length != 4), "failed parsing saved entries!");
+	for (i = 0; i < 4; ++i)
+		fail_if(differ(gcal_event_get_where(&events.entries[i]),
+			       full[i].where), "wrong saved event %d!", i);
+	gcal_cleanup_events(&events);
+	free(saved);
+
+	twice = malloc(strlen(xml_data) * 2 + 1);
+	fail_if(twice == NULL, "failed allocating memory!");
+	strcpy(twice, xml_data);
+	strcat(twice, xml_data);
+	res = gcal_events_from_feed(twice, strlen(twice), &events);
+	fail_if(res || (events.length != 8), "failed parsing 2 feeds!");
+	fail_if(differ(gcal_event_get_start(&events.entries[6]),
+		       full[2].dt_start), "wrong event of second feed!");
+	gcal_cleanup_events(&events);
+
+	/* Incomplete documents are an error */
+	twice[strlen(xml_data) + 100] = 0;
+	res = gcal_events_from_feed(twice, strlen(twice), &events);
+	fail_if((res != -1) || (events.length != 0),
+		"truncated document was accepted!");
+	free(twice);
+	for (i = 0; i < 4; ++i)
+		gcal_destroy_entry(&full[i]);
+
+	/* From a file */
+	path = find_file_path("/utests/4entries_location.xml");
+	fail_if(path == NULL, "Cannot find test file!");
+	res = gcal_events_from_file(path, &events);
+	fail_if(res || (events.length != 4), "failed parsing file!");
+	gcal_cleanup_events(&events);
+	free(path);
+	fail_if(gcal_events_from_file("/nonexistent.xml", &events) != -1,
+		"file doesn't exist!");
+
+	/* Contacts, both formats */
+	path = find_file_path("/utests/supercontact.xml");
+	fail_if(path == NULL, "Cannot find test file!");
+	res = gcal_contacts_from_file(path, &contacts);
+	fail_if(res || (contacts.length != 1), "failed parsing contacts!");
+	fail_if(gcal_contact_get_phone_numbers_count(&contacts.entries[0])
+		!= 8, "wrong contact!");
+	gcal_cleanup_contacts(&contacts);
+	free(path);
+
+	if (find_load_file("/utests/supercontact.json", &json))
+		fail_if(1, "Cannot load test JSON file!");
+	res = gcal_contacts_from_feed(json, strlen(json), &contacts);
+	fail_if(res || (contacts.length != 1), "failed parsing JSON!");
+	gcal_cleanup_contacts(&contacts);
+	free(json);
+}
+END_TEST
+
+TCase *stream_tcase_create(void)
+{
+	TCase *tc = NULL;
+	tc = tcase_create("stream");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_json_events);
+	tcase_add_test(tc, test_json_contact);
+	tcase_add_test(tc, test_partial_response);
+	tcase_add_test(tc, test_field_mask);
+	tcase_add_test(tc, test_lazy_fields);
+	tcase_add_test(tc, test_stream_entries);
+	tcase_add_test(tc, test_stream_queue);
+	tcase_add_test(tc, test_pipeline_ring);
+	tcase_add_test(tc, test_pipeline_stages);
+	tcase_add_test(tc, test_entry_writer);
+	tcase_add_test(tc, test_feed_array);
+	return tc;
+}
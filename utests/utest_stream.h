@@ -0,0 +1,16 @@
+#ifndef __UTEST_STREAM__
+#define __UTEST_STREAM__
+/*
+ * @file   utest_stream.h
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of JSON, streaming and pipeline parsing.
+ */
+
+#include <check.h>
+
+TCase *stream_tcase_create(void);
+
+
+#endif
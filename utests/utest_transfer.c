@@ -0,0 +1,594 @@
+/*
+ * @file   utest_transfer.c
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of retries, rate limit, deadlines, hedging,
+ *         shared requests and compression.
+ *
+ */
+
+#include "utest_transfer.h"
+#include "gcal.h"
+#include "internal_gcal.h"
+#include "gcal_retry.h"
+#include "gcal_status.h"
+#include "gcal_hedge.h"
+#include "gcal_flight.h"
+#include "gcal_gzip.h"
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "utils.h"
+
+/* Object talking to the local server (contacts feed has no redirection) */
+static struct gcal_resource *fake_client(void)
+{
+	struct gcal_resource *gcalobj;
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcalobj->auth = strdup("token");
+	curl_easy_setopt(gcalobj->curl, CURLOPT_NOPROXY, "*");
+
+	return gcalobj;
+}
+
+START_TEST (test_retry_policy)
+{
+	struct gcal_resource *gcalobj;
+
+	fail_if(gcal_retry_after("120", 3) != 120, "wrong delay seconds!");
+	fail_if(gcal_retry_after("30\r\n", 2) != 30, "wrong value length!");
+	/* A date in the past means 'retry now' */
+	fail_if(gcal_retry_after("Fri, 31 Dec 1999 23:59:59 GMT", 29) != 0,
+		"wrong delay date!");
+	fail_if(gcal_retry_after("soon", 4) != -1, "invalid value accepted!");
+	fail_if(gcal_retry_after("-5", 2) != -1, "negative value accepted!");
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	fail_if(gcalobj->policy.retries != 0, "retries must be off by default!");
+	fail_if(gcalobj->policy.rate != 0, "rate limit must be off by default!");
+
+	gcal_set_retry(gcalobj, 3, 500, 100);
+	fail_if(gcalobj->policy.retries != 3, "wrong number of retries!");
+	fail_if(gcalobj->policy.max_delay != 500,
+		"max delay must not be shorter than delay!");
+
+	/* Full bucket: burst requests don't wait */
+	gcal_set_rate_limit(gcalobj, 1, 2);
+	gcal_rate_limit(gcalobj);
+	gcal_rate_limit(gcalobj);
+	fail_if(gcalobj->policy.tokens >= 1, "bucket must be empty!");
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+/* Miliseconds taken by a rate limited request */
+static long rate_wait(struct gcal_resource *gcalobj)
+{
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	gcal_rate_limit(gcalobj);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start.tv_sec) * 1000 +
+		(end.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+START_TEST (test_rate_account)
+{
+	struct gcal_resource *calendar, *contacts, *other;
+
+	calendar = gcal_construct(GCALENDAR);
+	contacts = gcal_construct(GCONTACT);
+	other = gcal_construct(GCONTACT);
+	fail_if((!calendar) || (!contacts) || (!other),
+		"failed constructing gcal objects!");
+	gcal_set_rate_limit(calendar, 10, 1);
+	gcal_set_rate_limit(contacts, 10, 1);
+	gcal_set_rate_limit(other, 10, 1);
+
+	/* Same account: one bucket for both objects */
+	fail_if(gcal_rate_account(calendar, "a@gmail.com") ||
+		gcal_rate_account(contacts, "a@gmail.com") ||
+		gcal_rate_account(other, "b@gmail.com"), "failed account!");
+	fail_if(calendar->bucket != contacts->bucket, "bucket not shared!");
+	fail_if(calendar->bucket == other->bucket, "accounts share bucket!");
+
+	fail_if(rate_wait(calendar) >= 50, "full bucket must not wait!");
+	fail_if(rate_wait(contacts) < 50, "bucket of account not used!");
+	fail_if(rate_wait(other) >= 50, "other account must not wait!");
+
+	/* Last object of the account releases its bucket */
+	gcal_destroy(calendar);
+	gcal_destroy(contacts);
+	contacts = gcal_construct(GCONTACT);
+	fail_if(contacts == NULL, "failed constructing gcal object!");
+	gcal_set_rate_limit(contacts, 10, 1);
+	gcal_rate_account(contacts, "a@gmail.com");
+	fail_if(rate_wait(contacts) >= 50, "new bucket must be full!");
+
+	gcal_destroy(contacts);
+	gcal_destroy(other);
+}
+END_TEST
+
+START_TEST (test_post_retry)
+{
+	struct gcal_resource *gcalobj;
+	struct fake_server server;
+	const struct fake_answer failed[] = {
+		{ 0, "HTTP/1.1 500 Internal Server Error\r\n"
+		  "Connection: close\r\nContent-Length: 0\r\n\r\n" } };
+	const struct fake_answer refused[] = {
+		{ 0, "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 0\r\n"
+		  "Connection: close\r\nContent-Length: 0\r\n\r\n" } };
+	int res;
+
+	gcalobj = fake_client();
+	gcal_set_retry(gcalobj, 2, 1, 1);
+
+	/* Server may have added the entry before failing */
+	fail_if(fake_server_start(&server, failed, 1),
+		"failed starting server!");
+	res = http_post(gcalobj, server.url, "Content-Type: application/atom+xml",
+			NULL, NULL, NULL, "<entry/>", 8, 201, "GData-Version: 2");
+	fail_if(res != -1, "failed POST must fail!");
+	fail_if(fake_server_stop(&server) != 1, "POST was retried!");
+
+	/* GET can be repeated */
+	fail_if(fake_server_start(&server, failed, 1),
+		"failed starting server!");
+	res = get_follow_redirection(gcalobj, server.url, NULL,
+				     "GData-Version: 2");
+	fail_if(res != -1, "failed GET must fail!");
+	fail_if(fake_server_stop(&server) != 3, "GET wasn't retried!");
+
+	/* Server didn't process it, asking for a retry */
+	fail_if(fake_server_start(&server, refused, 1),
+		"failed starting server!");
+	http_post(gcalobj, server.url, "Content-Type: application/atom+xml",
+		  NULL, NULL, NULL, "<entry/>", 8, 201, "GData-Version: 2");
+	fail_if(fake_server_stop(&server) != 3, "refused POST wasn't retried!");
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_timeout_cancel)
+{
+	struct gcal_resource *gcalobj;
+	struct fake_server server;
+	const struct fake_answer answer[] = {
+		{ 0, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		  "Content-Length: 4\r\n\r\nfeed" } };
+	int started;
+
+	fail_if(gcal_status_interrupted(NULL) != -1, "NULL must fail!");
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	fail_if(gcal_status_interrupted(gcalobj) != GCAL_INTERRUPT_NONE,
+		"new object can't be interrupted!");
+
+	/* No timeout, no deadline */
+	fail_if(gcal_deadline_start(gcalobj) != 0, "deadline without timeout!");
+
+	gcal_set_timeout(gcalobj, 2000, 10, 5);
+	started = gcal_deadline_start(gcalobj);
+	fail_if(started != 1, "failed starting deadline!");
+	/* Redirection shares the running deadline */
+	fail_if(gcal_deadline_start(gcalobj) != 0, "deadline started twice!");
+	gcal_deadline_end(gcalobj, started);
+	fail_if(gcalobj->policy.deadline != 0, "deadline still running!");
+
+	/* Cancel is kept until a transfer is aborted */
+	gcal_cancel(gcalobj);
+	fail_if(!__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST),
+		"cancel flag not set!");
+	fail_if(gcal_progress_cb(gcalobj, 0, 0, 0, 0) == 0,
+		"transfer must be aborted!");
+
+	gcal_destroy(gcalobj);
+
+	/* A cancel sent while idle aborts the next request... */
+	gcalobj = fake_client();
+	fail_if(fake_server_start(&server, answer, 1),
+		"failed starting server!");
+	gcal_cancel(gcalobj);
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 2") != -1,
+		"pending cancel didn't abort request!");
+	fail_if(gcal_status_interrupted(gcalobj) != GCAL_INTERRUPT_CANCEL,
+		"request wasn't canceled!");
+	fail_if(__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST),
+		"cancel must be cleared by the abort!");
+
+	/* ...unless it is dropped */
+	gcal_cancel(gcalobj);
+	gcal_cancel_reset(gcalobj);
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 2"),
+		"request failed after cancel reset!");
+	fail_if(strcmp(gcalobj->buffer, "feed"), "wrong answer!");
+	fake_server_stop(&server);
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_rate_interrupt)
+{
+	struct gcal_resource *gcalobj;
+	struct fake_server server;
+	const struct fake_answer answer[] = {
+		{ 0, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		  "Content-Length: 4\r\n\r\nfeed" } };
+	long elapsed;
+	int started;
+
+	gcalobj = fake_client();
+	gcal_set_rate_limit(gcalobj, 0.5, 1);
+	gcal_set_timeout(gcalobj, 200, 0, 0);
+	fail_if(gcal_rate_limit(gcalobj) != CURLE_OK, "full bucket failed!");
+
+	/* Empty bucket: the wait stops at the deadline */
+	started = gcal_deadline_start(gcalobj);
+	elapsed = rate_wait(gcalobj);
+	gcal_deadline_end(gcalobj, started);
+	fail_if((elapsed < 150) || (elapsed >= 1000),
+		"wait not bounded by deadline: %ld ms", elapsed);
+
+	/* Request isn't sent after waiting until the deadline */
+	fail_if(fake_server_start(&server, answer, 1),
+		"failed starting server!");
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 2") != -1,
+		"request must time out waiting for a token!");
+	fail_if(gcal_status_interrupted(gcalobj) != GCAL_INTERRUPT_TIMEOUT,
+		"request didn't time out!");
+
+	/* A cancel stops the wait too, and is consumed by it */
+	gcal_set_timeout(gcalobj, 0, 0, 0);
+	gcal_cancel(gcalobj);
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 2") != -1,
+		"request must be canceled waiting for a token!");
+	fail_if(gcal_status_interrupted(gcalobj) != GCAL_INTERRUPT_CANCEL,
+		"request wasn't canceled!");
+	fail_if(__atomic_load_n(&gcalobj->canceled, __ATOMIC_SEQ_CST),
+		"cancel must be cleared by the abort!");
+	fail_if(fake_server_stop(&server) != 0, "request was sent!");
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_hedge_delay)
+{
+	struct gcal_resource *gcalobj;
+	long i;
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	gcal_set_hedging(gcalobj, 90, 50);
+
+	/* Few latencies, min delay is used */
+	gcal_hedge_sample(gcalobj, 400);
+	fail_if(gcal_hedge_delay(gcalobj) != 50, "wrong initial delay!");
+
+	for (i = 1; i < 100; ++i)
+		gcal_hedge_sample(gcalobj, i * 10);
+	fail_if(gcalobj->hedge.count != GCAL_HEDGE_SAMPLES,
+		"wrong number of latencies!");
+	/* Only last latencies are used: 360 to 990 */
+	fail_if(gcal_hedge_delay(gcalobj) != 930, "wrong percentile: %ld",
+		gcal_hedge_delay(gcalobj));
+
+	/* Delay is never shorter than the min */
+	gcal_set_hedging(gcalobj, 90, 2000);
+	fail_if(gcal_hedge_delay(gcalobj) != 2000, "min delay not used!");
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_hedge_error)
+{
+	struct gcal_resource *gcalobj;
+	struct fake_server server;
+	const struct fake_answer answers[] = {
+		{ 600, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		  "Content-Length: 4\r\n\r\ngood" },
+		{ 0, "HTTP/1.1 503 Service Unavailable\r\n"
+		  "Connection: close\r\nContent-Length: 0\r\n\r\n" } };
+
+	/* Slow request is hedged, the copy fails fast */
+	gcalobj = fake_client();
+	gcal_set_hedging(gcalobj, 90, 100);
+	fail_if(fake_server_start(&server, answers, 2),
+		"failed starting server!");
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 3.0"),
+		"error of the copy was used!");
+	fail_if(fake_server_stop(&server) != 2, "request wasn't hedged!");
+	fail_if(strcmp(gcalobj->buffer, "good") || (gcalobj->http_code != 200),
+		"wrong answer: %ld", gcalobj->http_code);
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_hedge_latency)
+{
+	struct gcal_resource *gcalobj;
+	struct fake_server server;
+	const struct fake_answer answers[] = {
+		{ 800, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		  "Content-Length: 4\r\n\r\nslow" },
+		{ 0, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		  "Content-Length: 4\r\n\r\nfast", 400 } };
+	long latency;
+
+	/* Copy answers at once, but its body is slow */
+	gcalobj = fake_client();
+	gcal_set_hedging(gcalobj, 90, 100);
+	fail_if(fake_server_start(&server, answers, 2),
+		"failed starting server!");
+	fail_if(get_follow_redirection(gcalobj, server.url, NULL,
+				       "GData-Version: 3.0"),
+		"hedged request failed!");
+	fail_if(fake_server_stop(&server) != 2, "request wasn't hedged!");
+	fail_if(strcmp(gcalobj->buffer, "fast"), "copy didn't win!");
+
+	/* Latency is when the copy was sent plus its time to first byte */
+	fail_if(gcalobj->hedge.count != 1, "latency not sampled!");
+	latency = gcalobj->hedge.samples[0];
+	fail_if((latency < 100) || (latency >= 400),
+		"wrong latency: %ld", latency);
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+static const char flight_page[] = "<feed>shared</feed>";
+static int flight_fetches = 0;
+static pthread_mutex_t flight_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int fake_fetch(struct gcal_resource *gcalobj, const char *url,
+		      void *cb_download, const char *gdata_version)
+{
+	pthread_mutex_lock(&flight_mutex);
+	++flight_fetches;
+	pthread_mutex_unlock(&flight_mutex);
+
+	/* Gives time to other threads to join the request */
+	usleep(300000);
+	strcpy(gcalobj->buffer, flight_page);
+	gcalobj->http_code = 200;
+	return 0;
+}
+
+static void *flight_thread(void *data)
+{
+	struct gcal_resource *gcalobj = (struct gcal_resource *)data;
+
+	if (gcal_flight_get(gcalobj, "http://www.google.com/m8/feeds/a",
+			    NULL, "GData-Version: 3.0", fake_fetch))
+		return gcalobj;
+
+	return NULL;
+}
+
+START_TEST (test_single_flight)
+{
+	struct gcal_resource *gcalobj[4];
+	pthread_t threads[4];
+	void *failed;
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		gcalobj[i] = gcal_construct(GCONTACT);
+		fail_if(gcalobj[i] == NULL, "failed constructing gcal object!");
+		gcalobj[i]->auth = strdup("token");
+	}
+
+	for (i = 0; i < 4; ++i)
+		fail_if(pthread_create(&threads[i], NULL, flight_thread,
+				       gcalobj[i]), "failed creating thread!");
+	for (i = 0; i < 4; ++i) {
+		pthread_join(threads[i], &failed);
+		fail_if(failed != NULL, "failed download!");
+	}
+
+	fail_if(flight_fetches != 1, "request sent %d times!", flight_fetches);
+	for (i = 0; i < 4; ++i) {
+		fail_if(strcmp(gcalobj[i]->buffer, flight_page),
+			"wrong shared answer!");
+		fail_if(gcalobj[i]->http_code != 200, "wrong shared code!");
+	}
+
+	/* Request is not shared after it is finished */
+	flight_thread(gcalobj[0]);
+	fail_if(flight_fetches != 2, "finished request was shared!");
+
+	for (i = 0; i < 4; ++i)
+		gcal_destroy(gcalobj[i]);
+}
+END_TEST
+
+static int flight_stuck = 1;
+
+/* First request gets stuck until released, the others answer at once */
+static int stuck_fetch(struct gcal_resource *gcalobj, const char *url,
+		       void *cb_download, const char *gdata_version)
+{
+	int first;
+
+	pthread_mutex_lock(&flight_mutex);
+	first = !flight_fetches++;
+	pthread_mutex_unlock(&flight_mutex);
+
+	while ((first) &&
+	       (__atomic_load_n(&flight_stuck, __ATOMIC_SEQ_CST)))
+		usleep(10000);
+	strcpy(gcalobj->buffer, flight_page);
+	gcalobj->http_code = 200;
+	return 0;
+}
+
+static void *stuck_thread(void *data)
+{
+	struct gcal_resource *gcalobj = (struct gcal_resource *)data;
+
+	if (gcal_flight_get(gcalobj, "http://www.google.com/m8/feeds/b",
+			    NULL, "GData-Version: 3.0", stuck_fetch))
+		return gcalobj;
+
+	return NULL;
+}
+
+START_TEST (test_flight_wait)
+{
+	struct gcal_resource *gcalobj[4];
+	pthread_t leader, waiter;
+	void *failed;
+	int i;
+
+	flight_fetches = 0;
+	for (i = 0; i < 4; ++i) {
+		gcalobj[i] = gcal_construct(GCONTACT);
+		fail_if(gcalobj[i] == NULL, "failed constructing gcal object!");
+		gcalobj[i]->auth = strdup("token");
+	}
+
+	fail_if(pthread_create(&leader, NULL, stuck_thread, gcalobj[0]),
+		"failed creating thread!");
+	usleep(100000);
+
+	/* Waiting is bounded by the deadline, then it sends its own */
+	gcal_set_timeout(gcalobj[1], 200, 0, 0);
+	fail_if(stuck_thread(gcalobj[1]) != NULL, "failed download!");
+	fail_if(flight_fetches != 2, "waiter didn't send its own request!");
+	fail_if(strcmp(gcalobj[1]->buffer, flight_page), "wrong answer!");
+
+	/* A canceled waiter stops waiting */
+	fail_if(pthread_create(&waiter, NULL, stuck_thread, gcalobj[2]),
+		"failed creating thread!");
+	usleep(100000);
+	gcal_cancel(gcalobj[2]);
+	pthread_join(waiter, &failed);
+	fail_if(failed == NULL, "canceled waiter succeeded!");
+	fail_if(gcal_status_interrupted(gcalobj[2]) != GCAL_INTERRUPT_CANCEL,
+		"cancel not reported!");
+	fail_if(__atomic_load_n(&gcalobj[2]->canceled, __ATOMIC_SEQ_CST),
+		"cancel not cleared!");
+	fail_if(flight_fetches != 2, "canceled waiter sent a request!");
+
+	/* Other write callback, other request */
+	fail_if(gcal_flight_get(gcalobj[3], "http://www.google.com/m8/feeds/b",
+				(void *)stuck_thread, "GData-Version: 3.0",
+				stuck_fetch), "failed download!");
+	fail_if(flight_fetches != 3, "distinct callbacks shared a request!");
+
+	__atomic_store_n(&flight_stuck, 0, __ATOMIC_SEQ_CST);
+	pthread_join(leader, &failed);
+	fail_if(failed != NULL, "failed download!");
+
+	for (i = 0; i < 4; ++i)
+		gcal_destroy(gcalobj[i]);
+}
+END_TEST
+
+START_TEST (test_prebuilt_headers)
+{
+	struct gcal_resource *gcalobj;
+	struct curl_slist *headers;
+	char *header;
+
+	gcalobj = gcal_construct(GCONTACT);
+	fail_if(gcalobj == NULL, "failed constructing gcal object!");
+	fail_if(gcal_auth_header(gcalobj) != NULL, "no auth, no header!");
+
+	gcalobj->auth = strdup("first");
+	header = gcal_auth_header(gcalobj);
+	fail_if(strcmp(header, "Authorization: GoogleLogin auth=first"),
+		"wrong header: %s", header);
+	fail_if(gcal_auth_header(gcalobj) != header, "header not reused!");
+
+	fail_if(prepare_follow_redirection(gcalobj, "http://localhost/a", NULL,
+					   "GData-Version: 3.0"),
+		"failed preparing request!");
+	headers = gcalobj->get_headers;
+	fail_if(strcmp(headers->data, "GData-Version: 3.0") ||
+		strcmp(headers->next->data, header), "wrong header list!");
+	prepare_follow_redirection(gcalobj, "http://localhost/b", NULL,
+				   "GData-Version: 3.0");
+	fail_if(gcalobj->get_headers != headers, "header list not reused!");
+
+	/* New version or new token builds a new list */
+	prepare_follow_redirection(gcalobj, "http://localhost/c", NULL,
+				   "GData-Version: 2");
+	fail_if(strcmp(gcalobj->get_headers->data, "GData-Version: 2"),
+		"version not updated!");
+	free(gcalobj->auth);
+	gcalobj->auth = strdup("second");
+	prepare_follow_redirection(gcalobj, "http://localhost/d", NULL,
+				   "GData-Version: 2");
+	fail_if(strcmp(gcalobj->get_headers->next->data,
+		       "Authorization: GoogleLogin auth=second"),
+		"token not updated!");
+
+	gcal_destroy(gcalobj);
+}
+END_TEST
+
+START_TEST (test_gzip_body)
+{
+	char body[4096], *packed = NULL;
+	size_t length, i;
+
+	if (!gcal_gzip_available()) {
+		fail_if(gcal_gzip("data", 4, &packed, &length) != -1,
+			"compression without zlib!");
+		return;
+	}
+
+	for (i = 0; i < sizeof(body); ++i)
+		body[i] = "<entry/>"[i % 8];
+
+	fail_if(gcal_gzip(NULL, 0, &packed, &length) != -1, "NULL must fail!");
+	fail_if(gcal_gzip(body, sizeof(body), &packed, &length),
+		"failed compressing body!");
+	/* gzip magic number */
+	fail_if(((unsigned char)packed[0] != 0x1f) ||
+		((unsigned char)packed[1] != 0x8b), "not gzip format!");
+	fail_if(length >= sizeof(body), "body not compressed: %zu", length);
+
+	free(packed);
+}
+END_TEST
+
+TCase *transfer_tcase_create(void)
+{
+	TCase *tc = NULL;
+	tc = tcase_create("transfer");
+	tcase_add_test(tc, test_retry_policy);
+	tcase_add_test(tc, test_rate_account);
+	tcase_add_test(tc, test_post_retry);
+	tcase_add_test(tc, test_timeout_cancel);
+	tcase_add_test(tc, test_rate_interrupt);
+	tcase_add_test(tc, test_hedge_delay);
+	tcase_add_test(tc, test_hedge_error);
+	tcase_add_test(tc, test_hedge_latency);
+	tcase_add_test(tc, test_single_flight);
+	tcase_add_test(tc, test_flight_wait);
+	tcase_add_test(tc, test_prebuilt_headers);
+	tcase_add_test(tc, test_gzip_body);
+	return tc;
+}
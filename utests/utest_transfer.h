@@ -0,0 +1,17 @@
+#ifndef __UTEST_TRANSFER__
+#define __UTEST_TRANSFER__
+/*
+ * @file   utest_transfer.h
+ * @author Adenilson Cavalcanti da Silva <adenilson.silva@indt.org.br>
+ * @date   Mon Oct 19 2026
+ *
+ * @brief  Module for tests of retries, rate limit, deadlines, hedging,
+ *         shared requests and compression.
+ */
+
+#include <check.h>
+
+TCase *transfer_tcase_create(void);
+
+
+#endif
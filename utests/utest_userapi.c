@@ -51,6 +51,47 @@ START_TEST (test_get_calendar)
 }
 END_TEST
 
+START_TEST (test_get_calendar_range)
+{
+	gcal_t gcal;
+	struct gcal_event_array event_array;
+	size_t i, j;
+	int result;
+
+	gcal = gcal_new(GCALENDAR);
+	fail_if(gcal == NULL, "Failed constructing gcal object!");
+
+	result = gcal_get_authentication(gcal, "gcal4tester", "66libgcal");
+	fail_if(result == -1, "Cannot authenticate!");
+
+	gcal_set_max_transfers(gcal, 3);
+	result = gcal_get_events_range(gcal, &event_array,
+				       "2008-01-01T00:00:00Z",
+				       "2012-01-01T00:00:00-03:00", 6);
+	fail_if(result == -1, "Failed downloading events in ranges!");
+	fail_if(event_array.length < 1, "gcal4tester must have at least"
+		"1 event!");
+
+	for (i = 0; i < event_array.length; ++i)
+		for (j = i + 1; j < event_array.length; ++j)
+			fail_if(!strcmp(gcal_event_get_id(&event_array.entries[i]),
+					gcal_event_get_id(&event_array.entries[j])),
+				"Duplicated event!");
+
+	/* Invalid interval */
+	gcal_cleanup_events(&event_array);
+	result = gcal_get_events_range(gcal, &event_array,
+				       "2012-01-01T00:00:00Z",
+				       "2008-01-01T00:00:00Z", 2);
+	fail_if(result != -1, "Interval must be valid!");
+
+	/* Cleanup */
+	gcal_cleanup_events(&event_array);
+	gcal_delete(gcal);
+
+}
+END_TEST
+
 START_TEST (test_access_calendar)
 {
 	gcal_t gcal;
@@ -249,6 +290,67 @@ START_TEST (test_access_all_calendars)
 }
 END_TEST
 
+START_TEST (test_fetch_all_calendars)
+{
+	gcal_t				gcal;
+	gcal_t				newcal;
+	struct gcal_event_array		event_array;
+	struct gcal_event_array		*events_arrays;
+	struct gcal_resource_array	gcal_array;
+	size_t				selected[1] = { 0 };
+	size_t				i;
+	int				result;
+
+	gcal = gcal_new(GCALENDAR);
+	fail_if(gcal == NULL, "Failed constructing gcal object!");
+
+	result = gcal_get_authentication(gcal, "gcal4tester", "66libgcal");
+	fail_if(result == -1, "Cannot authenticate!");
+
+	result = gcal_calendar_list(gcal, &gcal_array);
+	fail_if(result == -1, "Cannot get calendars list");
+	fail_if(gcal_array.length == 0, "No available calendars");
+
+	events_arrays = malloc(sizeof(struct gcal_event_array) *
+			       gcal_array.length);
+	fail_if(events_arrays == NULL, "Failed allocating arrays!");
+
+	/* All calendars at once */
+	gcal_set_max_transfers(gcal, 2);
+	result = gcal_get_calendars_events(gcal, &gcal_array, NULL, 0,
+					   events_arrays);
+	fail_if(result == -1, "Cannot get events of all calendars");
+
+	/* Must match the calendars downloaded one by one */
+	for (i = 0; i < gcal_array.length; i++) {
+		result = gcal_get_calendar_by_index(&gcal_array, i, &newcal);
+		result = gcal_get_events(newcal, &event_array);
+		fail_if(result == -1, "Cannot get events list");
+		fail_if(event_array.length != events_arrays[i].length,
+			"Calendar events number is different!");
+		gcal_cleanup_events(&event_array);
+		gcal_cleanup_events(&events_arrays[i]);
+	}
+
+	/* Only the first calendar */
+	result = gcal_get_calendars_events(gcal, &gcal_array, selected, 1,
+					   events_arrays);
+	fail_if(result == -1, "Cannot get events of selected calendar");
+	gcal_cleanup_events(&events_arrays[0]);
+
+	/* Invalid calendar index */
+	selected[0] = gcal_array.length;
+	result = gcal_get_calendars_events(gcal, &gcal_array, selected, 1,
+					   events_arrays);
+	fail_if(result != -1, "Calendar index must be valid!");
+
+	/* Cleanup */
+	free(events_arrays);
+	gcal_cleanup_calendar(&gcal_array);
+	gcal_delete(gcal);
+}
+END_TEST
+
 START_TEST (test_oper_event_event)
 {
 	gcal_t gcal;
@@ -353,6 +455,37 @@ START_TEST (test_get_contacts)
 END_TEST
 
 
+START_TEST (test_get_contacts_range)
+{
+	gcal_t gcal;
+	struct gcal_contact_array contact_array;
+	int result;
+
+	gcal = gcal_new(GCONTACT);
+	fail_if(gcal == NULL, "Failed constructing gcal object!");
+
+	result = gcal_get_authentication(gcal, "gcal4tester", "66libgcal");
+	fail_if(result == -1, "Cannot authenticate!");
+
+	/* More ranges than contacts */
+	result = gcal_get_contacts_range(gcal, &contact_array, 5);
+	fail_if(result == -1, "Failed downloading contacts in ranges!");
+	fail_if(contact_array.length != 3, "gcal4tester must have only"
+		"3 contacts!");
+	gcal_cleanup_contacts(&contact_array);
+
+	result = gcal_get_contacts_range(gcal, &contact_array, 2);
+	fail_if(result == -1, "Failed downloading contacts in ranges!");
+	fail_if(contact_array.length != 3, "gcal4tester must have only"
+		"3 contacts!");
+
+	/* Cleanup */
+	gcal_cleanup_contacts(&contact_array);
+	gcal_delete(gcal);
+
+}
+END_TEST
+
 START_TEST (test_access_contacts)
 {
 	gcal_t gcal;
@@ -647,6 +780,337 @@ START_TEST (test_contact_photo)
 }
 END_TEST
 
+START_TEST (test_contact_photos_parallel)
+{
+	gcal_t gcal;
+	gcal_contact_t contacts[2], tmp;
+	char *photo_data[2];
+	char *titles[] = { "Gromit", "hutch" };
+	char *files[] = { "/utests/images/gromit.jpg",
+			  "/utests/images/hutch.png" };
+	struct gcal_contact_array contact_array;
+	size_t i, j, photo_length[2], found = 0;
+	int result;
+
+	gcal = gcal_new(GCONTACT);
+	result = gcal_get_authentication(gcal, "gcalntester", "77libgcal");
+	fail_if(result == -1, "Failed getting authentication");
+
+	/* Two contacts, each with its own photo */
+	for (i = 0; i < 2; ++i) {
+		if (find_load_photo(files[i], &photo_data[i], &photo_length[i]))
+			fail_if(1, "Cannot load photo!");
+		contacts[i] = gcal_contact_new(NULL);
+		fail_if(!contacts[i], "Cannot construct contact object!");
+		gcal_contact_set_title(contacts[i], titles[i]);
+		fail_if(gcal_contact_set_photo(contacts[i], photo_data[i],
+					       photo_length[i]),
+			"Failed copying photo data");
+		result = gcal_add_contact(gcal, contacts[i]);
+		fail_if(result == -1, "Failed adding a new contact!");
+	}
+
+	/* Photos are downloaded at same time, each one to its contact */
+	gcal_set_max_transfers(gcal, 2);
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+
+	for (i = 0; i < contact_array.length; ++i) {
+		tmp = gcal_contact_element(&contact_array, i);
+		for (j = 0; j < 2; ++j) {
+			if (strcmp(gcal_contact_get_id(tmp),
+				   gcal_contact_get_id(contacts[j])))
+				continue;
+			fail_if(gcal_contact_get_photolength(tmp) !=
+				photo_length[j], "Wrong photo length!");
+			fail_if(memcmp(gcal_contact_get_photo(tmp),
+				       photo_data[j], photo_length[j]),
+				"Photo of other contact!");
+			++found;
+		}
+	}
+	fail_if(found != 2, "Cannot locate contacts!");
+
+	/* Cleanup */
+	for (i = 0; i < 2; ++i) {
+		result = gcal_erase_contact(gcal, contacts[i]);
+		fail_if(result == -1, "Failed deleting contact!");
+		gcal_contact_delete(contacts[i]);
+		free(photo_data[i]);
+	}
+	gcal_cleanup_contacts(&contact_array);
+	gcal_delete(gcal);
+}
+END_TEST
+
+START_TEST (test_contact_lazy_photo)
+{
+	gcal_t gcal;
+	gcal_contact_t contact, tmp;
+	gcal_contact_t *contacts;
+	char *photo_data;
+	struct gcal_contact_array contact_array;
+	size_t i, photo_length;
+	int result;
+
+	if (find_load_photo("/utests/images/gromit.jpg",  &photo_data,
+			    &photo_length))
+		fail_if(1, "Cannot load photo!");
+
+	contact = gcal_contact_new(NULL);
+	fail_if (!contact, "Cannot construct contact object!");
+	gcal_contact_set_title(contact, "Gromit");
+	gcal_contact_add_email_address(contact, "gromit@wallace.com", E_OTHER, 1);
+	fail_if(gcal_contact_set_photo(contact, photo_data, photo_length),
+		"Failed copying photo data");
+
+	gcal = gcal_new(GCONTACT);
+	result = gcal_get_authentication(gcal, "gcalntester", "77libgcal");
+	fail_if(result == -1, "Failed getting authentication");
+
+	result = gcal_add_contact(gcal, contact);
+	fail_if(result == -1, "Failed adding a new contact!");
+
+	/* Contacts come without photo data in lazy mode */
+	gcal_set_lazy_photo(gcal, 1);
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+
+	tmp = gcal_contact_element(&contact_array, (contact_array.length - 1));
+	fail_if(tmp == NULL, "Last contact must not be NULL!");
+	fail_if(gcal_contact_get_photolength(tmp) != 1,
+		"Last updated contact must have only the photo link");
+	fail_if(gcal_contact_get_photo(tmp) != NULL,
+		"Photo must not be downloaded in lazy mode");
+	fail_if(gcal_contact_get_photo_etag(tmp) == NULL,
+		"Photo must have an ETag");
+
+	/* Download just this photo */
+	result = gcal_contact_fetch_photo(gcal, tmp);
+	fail_if(result == -1, "Failed downloading contact photo!");
+	fail_if(gcal_contact_get_photolength(tmp) != photo_length,
+		"Downloaded photo has a different length!");
+	fail_if(memcmp(gcal_contact_get_photo(tmp), photo_data, photo_length),
+		"Downloaded photo is different!");
+
+	/* Download all photos at once */
+	contacts = malloc(sizeof(gcal_contact_t) * contact_array.length);
+	fail_if(contacts == NULL, "Failed allocating contacts vector!");
+	for (i = 0; i < contact_array.length; ++i)
+		contacts[i] = gcal_contact_element(&contact_array, i);
+	result = gcal_contact_fetch_photos(gcal, contacts, contact_array.length);
+	fail_if(result == -1, "Failed downloading contact photos!");
+	fail_if(gcal_contact_get_photolength(tmp) != photo_length,
+		"Downloaded photo has a different length!");
+
+	result = gcal_erase_contact(gcal, contact);
+	fail_if(result == -1, "Failed deleting contact!");
+
+	/* Cleanup */
+	free(contacts);
+	gcal_contact_delete(contact);
+	gcal_delete(gcal);
+
+	gcal_cleanup_contacts(&contact_array);
+	free(photo_data);
+}
+END_TEST
+
+/* Appends photo data to a memory buffer */
+struct photo_sink {
+	char *data;
+	size_t length;
+};
+
+static size_t photo_sink_write(const void *data, size_t length, void *user)
+{
+	struct photo_sink *sink = (struct photo_sink *)user;
+	char *tmp;
+
+	tmp = realloc(sink->data, sink->length + length);
+	if (!tmp)
+		return 0;
+	memcpy(tmp + sink->length, data, length);
+	sink->data = tmp;
+	sink->length += length;
+
+	return length;
+}
+
+START_TEST (test_contact_photo_sink)
+{
+	gcal_t gcal;
+	gcal_contact_t contact, tmp;
+	char *photo_data;
+	struct gcal_contact_array contact_array;
+	struct photo_sink sink = { NULL, 0 };
+	size_t photo_length;
+	int result;
+
+	if (find_load_photo("/utests/images/gromit.jpg",  &photo_data,
+			    &photo_length))
+		fail_if(1, "Cannot load photo!");
+
+	contact = gcal_contact_new(NULL);
+	fail_if (!contact, "Cannot construct contact object!");
+	gcal_contact_set_title(contact, "Gromit");
+	gcal_contact_add_email_address(contact, "gromit@wallace.com", E_OTHER, 1);
+	fail_if(gcal_contact_set_photo(contact, photo_data, photo_length),
+		"Failed copying photo data");
+
+	gcal = gcal_new(GCONTACT);
+	result = gcal_get_authentication(gcal, "gcalntester", "77libgcal");
+	fail_if(result == -1, "Failed getting authentication");
+
+	result = gcal_add_contact(gcal, contact);
+	fail_if(result == -1, "Failed adding a new contact!");
+
+	gcal_set_lazy_photo(gcal, 1);
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+
+	tmp = gcal_contact_element(&contact_array, (contact_array.length - 1));
+	fail_if(tmp == NULL, "Last contact must not be NULL!");
+
+	/* Photo goes to the sink, not to the contact */
+	result = gcal_contact_fetch_photo_cb(gcal, tmp, photo_sink_write, &sink);
+	fail_if(result == -1, "Failed downloading contact photo!");
+	fail_if(sink.length != photo_length,
+		"Downloaded photo has a different length!");
+	fail_if(memcmp(sink.data, photo_data, photo_length),
+		"Downloaded photo is different!");
+	fail_if(gcal_contact_get_photo(tmp) != NULL,
+		"Photo must not be stored in the contact");
+
+	result = gcal_erase_contact(gcal, contact);
+	fail_if(result == -1, "Failed deleting contact!");
+
+	/* Cleanup */
+	free(sink.data);
+	gcal_contact_delete(contact);
+	gcal_delete(gcal);
+
+	gcal_cleanup_contacts(&contact_array);
+	free(photo_data);
+}
+END_TEST
+
+START_TEST (test_contact_photo_upload_file)
+{
+	gcal_t gcal;
+	gcal_contact_t contact, tmp;
+	char *photo_data, *photo_path;
+	struct gcal_contact_array contact_array;
+	size_t photo_length;
+	int result;
+
+	if (find_load_photo("/utests/images/gromit.jpg",  &photo_data,
+			    &photo_length))
+		fail_if(1, "Cannot load photo!");
+	photo_path = find_file_path("/utests/images/gromit.jpg");
+	fail_if(photo_path == NULL, "Cannot find photo!");
+
+	/* Contact is added without photo */
+	contact = gcal_contact_new(NULL);
+	fail_if (!contact, "Cannot construct contact object!");
+	gcal_contact_set_title(contact, "Gromit");
+	gcal_contact_add_email_address(contact, "gromit@wallace.com", E_OTHER, 1);
+
+	gcal = gcal_new(GCONTACT);
+	result = gcal_get_authentication(gcal, "gcalntester", "77libgcal");
+	fail_if(result == -1, "Failed getting authentication");
+
+	result = gcal_add_contact(gcal, contact);
+	fail_if(result == -1, "Failed adding a new contact!");
+
+	gcal_set_lazy_photo(gcal, 1);
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+
+	tmp = gcal_contact_element(&contact_array, (contact_array.length - 1));
+	fail_if(tmp == NULL, "Last contact must not be NULL!");
+
+	result = gcal_contact_upload_photo_file(gcal, tmp, photo_path);
+	fail_if(result == -1, "Failed uploading contact photo!");
+
+	result = gcal_contact_fetch_photo(gcal, tmp);
+	fail_if(result == -1, "Failed downloading contact photo!");
+	fail_if(gcal_contact_get_photolength(tmp) != photo_length,
+		"Downloaded photo has a different length!");
+	fail_if(memcmp(gcal_contact_get_photo(tmp), photo_data, photo_length),
+		"Downloaded photo is different!");
+
+	result = gcal_erase_contact(gcal, contact);
+	fail_if(result == -1, "Failed deleting contact!");
+
+	/* Cleanup */
+	gcal_contact_delete(contact);
+	gcal_delete(gcal);
+
+	gcal_cleanup_contacts(&contact_array);
+	free(photo_path);
+	free(photo_data);
+}
+END_TEST
+
+START_TEST (test_contact_photo_cache)
+{
+	gcal_t gcal;
+	gcal_contact_t contact, tmp;
+	char *photo_data;
+	char cache[] = "/tmp/gcal_photosXXXXXX";
+	struct gcal_contact_array contact_array;
+	size_t photo_length;
+	int result;
+
+	if (find_load_photo("/utests/images/gromit.jpg",  &photo_data,
+			    &photo_length))
+		fail_if(1, "Cannot load photo!");
+	fail_if(mkdtemp(cache) == NULL, "Cannot create cache directory!");
+
+	contact = gcal_contact_new(NULL);
+	fail_if (!contact, "Cannot construct contact object!");
+	gcal_contact_set_title(contact, "Gromit");
+	gcal_contact_add_email_address(contact, "gromit@wallace.com", E_OTHER, 1);
+	fail_if(gcal_contact_set_photo(contact, photo_data, photo_length),
+		"Failed copying photo data");
+
+	gcal = gcal_new(GCONTACT);
+	result = gcal_get_authentication(gcal, "gcalntester", "77libgcal");
+	fail_if(result == -1, "Failed getting authentication");
+	fail_if(gcal_set_photo_cache(gcal, cache), "Failed setting cache!");
+
+	result = gcal_add_contact(gcal, contact);
+	fail_if(result == -1, "Failed adding a new contact!");
+
+	/* First sync downloads and caches the photo */
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+	gcal_cleanup_contacts(&contact_array);
+
+	/* Second sync loads it from cache */
+	result = gcal_get_updated_contacts(gcal, &contact_array, NULL);
+	fail_if(result == -1, "Failed downloading updated contacts!");
+
+	tmp = gcal_contact_element(&contact_array, (contact_array.length - 1));
+	fail_if(tmp == NULL, "Last contact must not be NULL!");
+	fail_if(gcal_contact_get_photolength(tmp) != photo_length,
+		"Cached photo has a different length!");
+	fail_if(memcmp(gcal_contact_get_photo(tmp), photo_data, photo_length),
+		"Cached photo is different!");
+
+	result = gcal_erase_contact(gcal, contact);
+	fail_if(result == -1, "Failed deleting contact!");
+
+	/* Cleanup */
+	gcal_contact_delete(contact);
+	gcal_delete(gcal);
+
+	gcal_cleanup_contacts(&contact_array);
+	free(photo_data);
+}
+END_TEST
+
 START_TEST (test_url_sanity_calendar)
 {
 	gcal_t gcal;
@@ -907,16 +1371,24 @@ TCase *gcal_userapi(void)
 	tcase_set_timeout (tc, timeout_seconds);
 
 	tcase_add_test(tc, test_get_calendar);
+	tcase_add_test(tc, test_get_calendar_range);
 	tcase_add_test(tc, test_access_calendar);
 	tcase_add_test(tc, test_access_specific_calendar);
 	tcase_add_test(tc, test_access_all_calendars);
+	tcase_add_test(tc, test_fetch_all_calendars);
 	tcase_add_test(tc, test_oper_event_event);
 	tcase_add_test(tc, test_query_event_updated);
 	tcase_add_test(tc, test_get_contacts);
+	tcase_add_test(tc, test_get_contacts_range);
 	tcase_add_test(tc, test_access_contacts);
 	tcase_add_test(tc, test_oper_contact);
 	tcase_add_test(tc, test_query_contact_updated);
 	tcase_add_test(tc, test_contact_photo);
+	tcase_add_test(tc, test_contact_photos_parallel);
+	tcase_add_test(tc, test_contact_lazy_photo);
+	tcase_add_test(tc, test_contact_photo_sink);
+	tcase_add_test(tc, test_contact_photo_upload_file);
+	tcase_add_test(tc, test_contact_photo_cache);
 	tcase_add_test(tc, test_url_sanity_calendar);
 	tcase_add_test(tc, test_url_sanity_contact);
 	tcase_add_test(tc, test_contact_new_fields);
@@ -12,6 +12,8 @@
 #include "atom_parser.h"
 #include "xml_aux.h"
 #include "gcal.h"
+#include "gcal_parser.h"
+#include "gcal_multi.h"
 #include "internal_gcal.h"
 #include <string.h>
 #include <stdio.h>
@@ -325,6 +327,9 @@ START_TEST (test_get_contact_photo)
 	fail_if(strcmp(extracted.photo, "http://www.google.com/m8/feeds/photos"
 		       "/media/gcalntester%40gmail.com/1bd255c2889042a7") != 0,
 		"wrong photo url!");
+	fail_if(strcmp(extracted.photo_etag,
+		       "\"ewxvF0VEbCp7ImBWLBQnekhWIVUrODsJcyU.\"") != 0,
+		"wrong photo etag!");
 
 	free(file_contents);
 	if (xpath_obj)
@@ -336,6 +341,57 @@ START_TEST (test_get_contact_photo)
 END_TEST
 
 
+static void destroy_event(void *event)
+{
+	gcal_destroy_entry((struct gcal_event *)event);
+}
+
+START_TEST (test_merge_ranges)
+{
+	xmlDoc *doc = NULL;
+	struct gcal_event *parts[3];
+	struct gcal_event *merged;
+	size_t lengths[3], length = 0, i;
+	int res;
+
+	res = build_doc_tree(&doc, xml_data);
+	fail_if(res == -1, "failed to build document tree!");
+
+	/* Same 4 entries in 2 ranges, plus a missing range */
+	for (i = 0; i < 2; ++i) {
+		parts[i] = malloc(sizeof(struct gcal_event) * 4);
+		fail_if(parts[i] == NULL, "failed allocating entries!");
+		for (lengths[i] = 0; lengths[i] < 4; ++lengths[i])
+			gcal_init_event(parts[i] + lengths[i]);
+		res = extract_all_entries(doc, parts[i], 4);
+		fail_if(res == -1, "failed to extract entries!");
+	}
+	parts[2] = NULL;
+	lengths[2] = 0;
+
+	merged = gcal_multi_merge((void **)parts, lengths, 3,
+				  sizeof(struct gcal_event), &length);
+	fail_if(merged == NULL, "failed merging ranges!");
+	fail_if(length != 8, "merged vector must have 8 entries: %d\n",
+		(int)length);
+	fail_if(parts[0] != NULL, "merged ranges must be freed!");
+
+	length = gcal_multi_dedup(merged, length, sizeof(struct gcal_event),
+				  destroy_event);
+	fail_if(length != 4, "duplicated entries not removed: %d\n",
+		(int)length);
+	fail_if(strcmp(merged[0].common.title, "an event with location"),
+		"entries order must be kept!");
+	for (i = 1; i < length; ++i)
+		fail_if(!strcmp(merged[i].common.id, merged[i - 1].common.id),
+			"duplicated entry!");
+
+	gcal_destroy_entries(merged, length);
+	clean_doc_tree(&doc);
+}
+END_TEST
+
+
 TCase *xpath_tcase_create(void)
 {
 	TCase *tc = NULL;
@@ -349,6 +405,7 @@ TCase *xpath_tcase_create(void)
 	tcase_add_test(tc, test_get_contact_nophoto);
 	tcase_add_test(tc, test_get_contact_photo);
 	tcase_add_test(tc, test_normalize_url);
+	tcase_add_test(tc, test_merge_ranges);
 	return tc;
 
 }
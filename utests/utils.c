@@ -5,6 +5,10 @@
 #include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include "utils.h"
 
 int read_file(int fd, char **buffer, size_t *length)
@@ -113,3 +117,110 @@ int find_load_photo(char *path, char **file_content, size_t *length)
 	return res;
 }
 
+struct fake_connection {
+	int fd;
+	const struct fake_answer *answer;
+};
+
+static void *fake_reply(void *data)
+{
+	struct fake_connection *connection = (struct fake_connection *)data;
+	char request[4096];
+	const char *text = connection->answer->text, *body;
+	ssize_t length, total = 0;
+
+	/* Request has no body or a small one, reads until headers end */
+	while ((length = recv(connection->fd, request + total,
+			      sizeof(request) - total - 1, 0)) > 0) {
+		total += length;
+		request[total] = '\0';
+		if (strstr(request, "\r\n\r\n"))
+			break;
+	}
+
+	usleep(connection->answer->delay * 1000);
+	/* Client may have given up (e.g. hedged request) */
+	if ((connection->answer->body_delay) &&
+	    (body = strstr(text, "\r\n\r\n"))) {
+		body += 4;
+		send(connection->fd, text, body - text, MSG_NOSIGNAL);
+		usleep(connection->answer->body_delay * 1000);
+		text = body;
+	}
+	send(connection->fd, text, strlen(text), MSG_NOSIGNAL);
+	close(connection->fd);
+	free(connection);
+
+	return NULL;
+}
+
+static void *fake_accept(void *data)
+{
+	struct fake_server *server = (struct fake_server *)data;
+	struct fake_connection *connection;
+	int fd, index;
+
+	while ((fd = accept(server->fd, NULL, NULL)) != -1) {
+		index = server->connections;
+		if ((index >= FAKE_CONNECTIONS) ||
+		    (!(connection = malloc(sizeof(struct fake_connection))))) {
+			close(fd);
+			continue;
+		}
+		connection->fd = fd;
+		connection->answer = &server->answers[index < server->count ?
+						      index : server->count - 1];
+		if (pthread_create(&server->threads[index], NULL, fake_reply,
+				   connection)) {
+			close(fd);
+			free(connection);
+			continue;
+		}
+		++server->connections;
+	}
+
+	return NULL;
+}
+
+int fake_server_start(struct fake_server *server,
+		      const struct fake_answer *answers, int count)
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+
+	memset(server, 0, sizeof(struct fake_server));
+	server->answers = answers;
+	server->count = count;
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((server->fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+		return -1;
+	if ((bind(server->fd, (struct sockaddr *)&address, length)) ||
+	    (listen(server->fd, FAKE_CONNECTIONS)) ||
+	    (getsockname(server->fd, (struct sockaddr *)&address, &length)) ||
+	    (pthread_create(&server->accept_thread, NULL, fake_accept,
+			    server))) {
+		close(server->fd);
+		return -1;
+	}
+	server->port = ntohs(address.sin_port);
+	snprintf(server->url, sizeof(server->url),
+		 "http://127.0.0.1:%d/feed", server->port);
+
+	return 0;
+}
+
+int fake_server_stop(struct fake_server *server)
+{
+	int i;
+
+	shutdown(server->fd, SHUT_RDWR);
+	close(server->fd);
+	pthread_join(server->accept_thread, NULL);
+	for (i = 0; i < server->connections; ++i)
+		pthread_join(server->threads[i], NULL);
+
+	return server->connections;
+}
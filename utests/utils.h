@@ -1,9 +1,42 @@
 #ifndef __UTILS_UTEST__
 #define __UTILS_UTEST__
 
+#include <stddef.h>
+#include <pthread.h>
+
 int read_file(int fd, char **buffer, size_t *length);
 char *find_file_path(char *file_name);
 int find_load_file(char *path, char **file_content);
 int find_load_photo(char *path, char **file_content, size_t *length);
 
+/* Local HTTP server: each connection gets the next answer (the last one
+ * is repeated), sent after its delay. It lets transfers be tested without
+ * network.
+ */
+struct fake_answer {
+	long delay;
+	const char *text;
+	/* Delay between headers and body (optional) */
+	long body_delay;
+};
+
+#define FAKE_CONNECTIONS 16
+
+struct fake_server {
+	int fd;
+	int port;
+	const struct fake_answer *answers;
+	int count;
+	int connections;
+	pthread_t accept_thread;
+	pthread_t threads[FAKE_CONNECTIONS];
+	char url[64];
+};
+
+/* Returns -1 if the server can't be started */
+int fake_server_start(struct fake_server *server,
+		      const struct fake_answer *answers, int count);
+/* Returns the number of connections */
+int fake_server_stop(struct fake_server *server);
+
 #endif